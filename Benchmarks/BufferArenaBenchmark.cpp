@@ -0,0 +1,492 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Exercises OffsetAllocator with random allocations/frees of mixed sizes and
+// alignments, checking that live allocations never overlap and are aligned, and
+// times it against malloc()/free(). Then uploads the hidden area meshes of all
+// built-in synthetic profiles (as indexed by HiddenAreaMesh, several copies
+// standing in for headsets/viewports) into a BufferArena, applies the pending
+// copies to CPU images of the pages like a blit pass would, and checks the data
+// arrived intact. Reports pages and copies against one buffer and one blit per
+// mesh. Finally checks uploads larger than the page size.
+//
+// Usage: BufferArenaBenchmark [operations] [mesh copies]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BufferArena.h"
+#include "MeshProcessing.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    struct Operation
+    {
+        bool        is_allocation = false;
+        uint32_t    size = 0;
+        uint32_t    alignment = 1;
+        size_t      slot = 0;               // Index of the live allocation to free
+    };
+
+    //------------------------------------------------------------------------------
+    // A random sequence of allocations (mostly small, mesh sized, sometimes
+    // larger) and frees of random live allocations, keeping about 'num_live'
+    // allocations alive.
+    std::vector<Operation> make_operations(size_t num_operations, size_t num_live)
+    {
+        std::mt19937 generator(1);
+        std::vector<Operation> operations;
+        size_t live = 0;
+
+        operations.reserve(num_operations);
+
+        for (size_t i = 0; i < num_operations; ++i) {
+            Operation operation;
+            operation.is_allocation = ((live == 0) || ((generator() % (2 * num_live)) >= live));
+
+            if (operation.is_allocation) {
+                const bool is_large = ((generator() % 16) == 0);
+                operation.size = (is_large ? (4096 + (generator() % 65536)) : (16 + (generator() % 2048)));
+                operation.alignment = (1u << (generator() % 9));        // 1 to 256
+                ++live;
+            }
+            else {
+                operation.slot = (generator() % live);
+                --live;
+            }
+
+            operations.push_back(operation);
+        }
+
+        return operations;
+    }
+
+    struct StressResult
+    {
+        size_t                          num_failed = 0;
+        size_t                          num_overlaps = 0;
+        size_t                          num_misaligned = 0;
+        size_t                          peak_live_bytes = 0;
+        OffsetAllocator::StorageReport  report;
+    };
+
+    //------------------------------------------------------------------------------
+    // Run the operations, validating every allocation against the live intervals.
+    StressResult run_validated(OffsetAllocator& allocator, const std::vector<Operation>& operations)
+    {
+        StressResult result;
+
+        std::vector<OffsetAllocator::Allocation> live;
+        std::vector<uint32_t> live_sizes;
+        std::map<uint32_t, uint32_t> intervals;         // Offset to end
+        size_t live_bytes = 0;
+
+        for (const Operation& operation : operations) {
+            if (operation.is_allocation) {
+                const OffsetAllocator::Allocation allocation = allocator.allocate(operation.size, operation.alignment);
+
+                if (not allocation.is_valid()) {
+                    ++result.num_failed;
+                    live.push_back(allocation);
+                    live_sizes.push_back(0);
+                    continue;
+                }
+
+                if ((allocation.offset % operation.alignment) != 0) {
+                    ++result.num_misaligned;
+                }
+
+                const uint32_t begin = allocation.offset;
+                const uint32_t end = (begin + operation.size);
+                const auto next = intervals.lower_bound(begin);
+
+                if (((next != intervals.end()) && (next->first < end)) ||
+                    ((next != intervals.begin()) && (std::prev(next)->second > begin)) ||
+                    (end > allocator.size()))
+                {
+                    ++result.num_overlaps;
+                }
+
+                intervals[begin] = end;
+                live.push_back(allocation);
+                live_sizes.push_back(operation.size);
+                live_bytes += operation.size;
+                result.peak_live_bytes = std::max(result.peak_live_bytes, live_bytes);
+            }
+            else {
+                const size_t slot = operation.slot;
+
+                if (live[slot].is_valid()) {
+                    intervals.erase(live[slot].offset);
+                    live_bytes -= live_sizes[slot];
+                    allocator.free(live[slot]);
+                }
+
+                live[slot] = live.back();
+                live_sizes[slot] = live_sizes.back();
+                live.pop_back();
+                live_sizes.pop_back();
+            }
+        }
+
+        result.report = allocator.storage_report();
+
+        for (const OffsetAllocator::Allocation& allocation : live) {
+            allocator.free(allocation);
+        }
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // The vertex/index data of a hidden area mesh as HiddenAreaMesh uploads it.
+    struct MeshData
+    {
+        std::vector<float>      vertices;       // Pairs of floats
+        std::vector<uint16_t>   indices;
+    };
+
+    std::vector<MeshData> make_meshes()
+    {
+        std::vector<MeshData> meshes;
+
+        for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+            SyntheticVRSystem system(profile);
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                for (const vr::EHiddenAreaMeshType type : { vr::k_eHiddenAreaMesh_Standard, vr::k_eHiddenAreaMesh_Inverse, vr::k_eHiddenAreaMesh_LineLoop }) {
+                    const vr::HiddenAreaMesh_t mesh = system.GetHiddenAreaMesh(eye, type);
+                    MeshData data;
+                    IndexedMesh indexed_mesh;
+
+                    if ((type != vr::k_eHiddenAreaMesh_LineLoop) && MeshProcessing::make_indexed_mesh(mesh, indexed_mesh)) {
+                        for (const vr::HmdVector2_t& vertex : indexed_mesh.vertices) {
+                            data.vertices.insert(data.vertices.end(), { vertex.v[0], vertex.v[1] });
+                        }
+
+                        data.indices = std::move(indexed_mesh.indices);
+                    }
+                    else {
+                        const size_t num_vertices = ((type == vr::k_eHiddenAreaMesh_LineLoop) ? mesh.unTriangleCount : (3 * mesh.unTriangleCount));
+
+                        for (size_t vertex_index = 0; vertex_index < num_vertices; ++vertex_index) {
+                            data.vertices.insert(data.vertices.end(), { mesh.pVertexData[vertex_index].v[0], mesh.pVertexData[vertex_index].v[1] });
+                        }
+                    }
+
+                    meshes.push_back(std::move(data));
+                }
+            }
+        }
+
+        return meshes;
+    }
+
+    struct Upload
+    {
+        BufferArena::Range      range;
+        const void*             data = nullptr;
+    };
+
+    //------------------------------------------------------------------------------
+    // Apply the pending copies to CPU images of the pages like a blit pass and
+    // return the number of copies.
+    size_t flush(BufferArena& arena, std::vector<std::vector<uint8_t>>& pages)
+    {
+        while (pages.size() < arena.num_pages()) {
+            pages.emplace_back(arena.page_size(pages.size()), uint8_t(0xCD));
+        }
+
+        for (const BufferArena::Copy& copy : arena.pending_copies()) {
+            std::memcpy((pages[copy.page].data() + copy.destination_offset), (arena.staging().data() + copy.source_offset), copy.size);
+        }
+
+        const size_t num_copies = arena.pending_copies().size();
+        arena.clear_pending();
+        return num_copies;
+    }
+
+    size_t count_corrupt(const std::vector<Upload>& uploads, const std::vector<std::vector<uint8_t>>& pages)
+    {
+        size_t num_corrupt = 0;
+
+        for (const Upload& upload : uploads) {
+            if (upload.range.is_valid() &&
+                (std::memcmp((pages[upload.range.page].data() + upload.range.offset), upload.data, upload.range.size) != 0))
+            {
+                ++num_corrupt;
+            }
+        }
+
+        return num_corrupt;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_operations = ((argc > 1) ? size_t(std::atol(argv[1])) : 1000000);
+    const size_t num_mesh_copies = ((argc > 2) ? size_t(std::atol(argv[2])) : 16);
+    const size_t num_live = 2000;
+    const uint32_t allocator_size = (64 * 1024 * 1024);
+
+    size_t num_errors = 0;
+
+    //------------------------------------------------------------------------------
+    // Allocator stress test.
+    const std::vector<Operation> operations = make_operations(num_operations, num_live);
+
+    OffsetAllocator allocator(allocator_size);
+    const StressResult stress = run_validated(allocator, operations);
+
+    std::printf("OffsetAllocator: %zu operations, ~%zu live, peak %.1f MB live of %.1f MB\n",
+                operations.size(), num_live, (double(stress.peak_live_bytes) / (1024.0 * 1024.0)), (double(allocator_size) / (1024.0 * 1024.0)));
+    std::printf("  at end: %u allocations, %.1f MB free in %u regions, largest %.1f MB\n",
+                stress.report.num_allocations, (double(stress.report.free_bytes) / (1024.0 * 1024.0)),
+                stress.report.num_free_regions, (double(stress.report.largest_free_region) / (1024.0 * 1024.0)));
+
+    if ((stress.num_failed != 0) || (stress.num_overlaps != 0) || (stress.num_misaligned != 0)) {
+        std::printf("ERROR: %zu failed, %zu overlapping, %zu misaligned allocations\n",
+                    stress.num_failed, stress.num_overlaps, stress.num_misaligned);
+        ++num_errors;
+    }
+
+    const OffsetAllocator::StorageReport empty_report = allocator.storage_report();
+
+    if ((empty_report.num_allocations != 0) || (empty_report.num_free_regions != 1) || (empty_report.free_bytes != allocator_size)) {
+        std::printf("ERROR: free blocks not merged after freeing everything (%u regions)\n", empty_report.num_free_regions);
+        ++num_errors;
+    }
+
+    //------------------------------------------------------------------------------
+    // Timing of the same sequence without validation.
+    std::vector<OffsetAllocator::Allocation> live_allocations;
+    std::vector<void*> live_pointers;
+
+    live_allocations.reserve(num_operations);
+    live_pointers.reserve(num_operations);
+
+    const double allocator_seconds = best_seconds_of(3, [&]() {
+        for (const Operation& operation : operations) {
+            if (operation.is_allocation) {
+                live_allocations.push_back(allocator.allocate(operation.size, operation.alignment));
+            }
+            else {
+                allocator.free(live_allocations[operation.slot]);
+                live_allocations[operation.slot] = live_allocations.back();
+                live_allocations.pop_back();
+            }
+        }
+
+        for (const OffsetAllocator::Allocation& allocation : live_allocations) {
+            allocator.free(allocation);
+        }
+
+        live_allocations.clear();
+    });
+
+    const double malloc_seconds = best_seconds_of(3, [&]() {
+        for (const Operation& operation : operations) {
+            if (operation.is_allocation) {
+                live_pointers.push_back(std::malloc(operation.size));
+            }
+            else {
+                std::free(live_pointers[operation.slot]);
+                live_pointers[operation.slot] = live_pointers.back();
+                live_pointers.pop_back();
+            }
+        }
+
+        for (void* const pointer : live_pointers) {
+            std::free(pointer);
+        }
+
+        live_pointers.clear();
+    });
+
+    std::printf("  %.1f ns/operation (malloc/free %.1f ns/operation)\n",
+                (allocator_seconds / double(num_operations) * 1.0e9), (malloc_seconds / double(num_operations) * 1.0e9));
+
+    //------------------------------------------------------------------------------
+    // Mesh uploads.
+    const std::vector<MeshData> meshes = make_meshes();
+
+    BufferArena arena(256 * 1024);
+    std::vector<std::vector<uint8_t>> pages;
+    std::vector<Upload> uploads;
+    size_t num_buffers_unpooled = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t copy = 0; copy < num_mesh_copies; ++copy) {
+        for (const MeshData& mesh : meshes) {
+            Upload vertices;
+            vertices.data = mesh.vertices.data();
+            vertices.range = arena.upload(vertices.data, uint32_t(sizeof(float) * mesh.vertices.size()));
+            uploads.push_back(vertices);
+            ++num_buffers_unpooled;
+
+            if (not mesh.indices.empty()) {
+                Upload indices;
+                indices.data = mesh.indices.data();
+                indices.range = arena.upload(indices.data, uint32_t(sizeof(uint16_t) * mesh.indices.size()));
+                uploads.push_back(indices);
+                ++num_buffers_unpooled;
+            }
+        }
+    }
+
+    const double upload_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t num_staged_bytes = arena.staging().size();
+    const size_t num_copies = flush(arena, pages);
+
+    std::printf("BufferArena: %zu meshes x %zu copies, %zu buffers -> %zu pages of %.2f MB (%.1f%% used), %zu copies, %.1f KB staged, %.2f us/upload\n",
+                meshes.size(), num_mesh_copies, num_buffers_unpooled, arena.num_pages(),
+                (double(arena.page_size(0)) / (1024.0 * 1024.0)),
+                (100.0 * double(arena.statistics().allocated_bytes) / double(arena.statistics().reserved_bytes)),
+                num_copies, (double(num_staged_bytes) / 1024.0), (upload_seconds / double(uploads.size()) * 1.0e6));
+
+    if (num_copies > arena.num_pages()) {
+        std::printf("ERROR: %zu copies for %zu pages, back to back uploads not coalesced\n", num_copies, arena.num_pages());
+        ++num_errors;
+    }
+
+    size_t num_corrupt = count_corrupt(uploads, pages);
+
+    //------------------------------------------------------------------------------
+    // Replace every other upload (e.g. a headset's meshes changing) and flush
+    // again: freed ranges are reused and the remaining data stays intact.
+    const size_t num_pages_before = arena.num_pages();
+
+    for (size_t upload_index = 0; upload_index < uploads.size(); upload_index += 2) {
+        arena.free(uploads[upload_index].range);
+    }
+
+    for (size_t upload_index = 0; upload_index < uploads.size(); upload_index += 2) {
+        Upload& upload = uploads[upload_index];
+        upload.range = arena.upload(upload.data, upload.range.size);
+    }
+
+    const size_t num_replacement_copies = flush(arena, pages);
+    num_corrupt += count_corrupt(uploads, pages);
+
+    std::printf("  replaced %zu uploads with %zu copies, %zu pages\n", ((uploads.size() + 1) / 2), num_replacement_copies, arena.num_pages());
+
+    if (arena.num_pages() != num_pages_before) {
+        std::printf("ERROR: freed ranges not reused (%zu pages before, %zu after)\n", num_pages_before, arena.num_pages());
+        ++num_errors;
+    }
+
+    if (num_corrupt != 0) {
+        std::printf("ERROR: %zu uploads corrupt\n", num_corrupt);
+        ++num_errors;
+    }
+
+    //------------------------------------------------------------------------------
+    // Uploads larger than the page size (sizes between bin boundaries included),
+    // each followed by a small one: the large ones get pages of their own and
+    // nothing overlaps.
+    const uint32_t large_page_size = (1024 * 1024);
+
+    BufferArena large_arena(large_page_size);
+    std::vector<std::vector<uint8_t>> large_pages;
+    std::vector<Upload> large_uploads;
+    std::vector<uint8_t> large_data(6 * 1024 * 1024);
+    size_t num_invalid = 0;
+
+    for (size_t i = 0; i < large_data.size(); ++i) {
+        large_data[i] = uint8_t((i * 31) + (i >> 12));
+    }
+
+    for (const uint32_t size : { (3 * large_page_size / 2), (3 * large_page_size), (5 * large_page_size), (large_page_size + 16) }) {
+        for (const uint32_t upload_size : { size, 64u }) {
+            Upload upload;
+            upload.data = (large_data.data() + (large_uploads.size() * 4096));
+            upload.range = large_arena.upload(upload.data, upload_size);
+
+            if ((not upload.range.is_valid()) || (not upload.range.allocation.is_valid())) {
+                ++num_invalid;
+            }
+
+            large_uploads.push_back(upload);
+        }
+    }
+
+    flush(large_arena, large_pages);
+    const size_t num_large_corrupt = count_corrupt(large_uploads, large_pages);
+
+    std::printf("  %zu uploads, some larger than the %.2f MB page size -> %zu pages\n",
+                large_uploads.size(), (double(large_page_size) / (1024.0 * 1024.0)), large_arena.num_pages());
+
+    if ((num_invalid != 0) || (num_large_corrupt != 0)) {
+        std::printf("ERROR: %zu invalid, %zu corrupt uploads larger than a page\n", num_invalid, num_large_corrupt);
+        ++num_errors;
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
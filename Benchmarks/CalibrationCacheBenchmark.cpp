@@ -0,0 +1,327 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares startup without a calibration cache (querying the device strings,
+// hidden area meshes and render target size, sampling a DistortionLUT and
+// determining the visible regions) with loading a CalibrationCache for all
+// built-in synthetic profiles. Checks that
+// the loaded data matches the system and that a different key, distortion size,
+// render target size, corrupted or truncated file is rejected and rebuilt.
+//
+// Usage: CalibrationCacheBenchmark [distortion size] [directory] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CalibrationCache.h"
+#include "DistortionLUT.h"
+#include "SyntheticVRSystem.h"
+#include "ThreadPool.h"
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // What an application needs at startup, queried directly.
+    struct Calibration
+    {
+        CalibrationKey                      key;
+        std::vector<vr::HmdVector2_t>       hidden_area_meshes[2][vr::k_eHiddenAreaMesh_Max];
+        uint32_t                            render_target_width = 0;
+        uint32_t                            render_target_height = 0;
+        std::unique_ptr<DistortionLUT>      distortion_lut;
+        std::unique_ptr<VisibleRegion>      visible_regions[2];
+    };
+
+    Calibration query_calibration(vr::IVRSystem* const system, size_t distortion_size, ThreadPool* const pool)
+    {
+        Calibration calibration;
+
+        calibration.key = CalibrationKey::query(system);
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                const vr::HiddenAreaMesh_t mesh = system->GetHiddenAreaMesh(eye, vr::EHiddenAreaMeshType(type));
+                const size_t num_vertices = ((type == vr::k_eHiddenAreaMesh_LineLoop) ? mesh.unTriangleCount : (3 * mesh.unTriangleCount));
+
+                if (mesh.pVertexData) {
+                    calibration.hidden_area_meshes[eye][type].assign(mesh.pVertexData, (mesh.pVertexData + num_vertices));
+                }
+            }
+        }
+
+        system->GetRecommendedRenderTargetSize(&calibration.render_target_width, &calibration.render_target_height);
+        calibration.distortion_lut.reset(new DistortionLUT(system, distortion_size, distortion_size, pool));
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const std::vector<vr::HmdVector2_t>& inverse_mesh = calibration.hidden_area_meshes[eye][vr::k_eHiddenAreaMesh_Inverse];
+
+            calibration.visible_regions[eye].reset(new VisibleRegion({ inverse_mesh.data(), uint32_t(inverse_mesh.size() / 3) },
+                                                                     vr::k_eHiddenAreaMesh_Inverse,
+                                                                     calibration.render_target_width,
+                                                                     calibration.render_target_height));
+        }
+
+        return calibration;
+    }
+
+    bool matches(const CalibrationCache& cache, const Calibration& calibration)
+    {
+        if ((cache.key() != calibration.key) ||
+            (cache.render_target_width() != calibration.render_target_width) ||
+            (cache.render_target_height() != calibration.render_target_height))
+        {
+            return false;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                const vr::HiddenAreaMesh_t mesh = cache.hidden_area_mesh(eye, vr::EHiddenAreaMeshType(type));
+                const std::vector<vr::HmdVector2_t>& expected = calibration.hidden_area_meshes[eye][type];
+                const size_t num_vertices = ((type == vr::k_eHiddenAreaMesh_LineLoop) ? mesh.unTriangleCount : (3 * mesh.unTriangleCount));
+
+                if ((num_vertices != expected.size()) ||
+                    ((num_vertices > 0) && (std::memcmp(mesh.pVertexData, expected.data(), (sizeof(vr::HmdVector2_t) * num_vertices)) != 0)))
+                {
+                    return false;
+                }
+            }
+
+            const DistortionLUT& lut = *calibration.distortion_lut;
+            const size_t table_size = (sizeof(float) * lut.width() * lut.height() * DistortionLUT::Channel_Count);
+
+            if (std::memcmp(cache.distortion_lut().channel(eye, DistortionLUT::Channel_RedU),
+                            lut.channel(eye, DistortionLUT::Channel_RedU),
+                            table_size) != 0)
+            {
+                return false;
+            }
+
+            const std::unique_ptr<VisibleRegion> region = cache.visible_region(eye);
+            const VisibleRegion& expected_region = *calibration.visible_regions[eye];
+            const size_t rows_size = (sizeof(uint32_t) * expected_region.height());
+
+            if ((not region) ||
+                (region->width() != expected_region.width()) ||
+                (region->height() != expected_region.height()) ||
+                (region->num_visible_pixels() != expected_region.num_visible_pixels()) ||
+                (std::memcmp(region->row_begin(), expected_region.row_begin(), rows_size) != 0) ||
+                (std::memcmp(region->row_end(), expected_region.row_end(), rows_size) != 0))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& contents)
+    {
+        std::ofstream stream(path, (std::ios::out | std::ios::binary | std::ios::trunc));
+        stream.write(contents.data(), std::streamsize(contents.size()));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t distortion_size = ((argc > 1) ? size_t(std::atol(argv[1])) : 513);
+    const std::string directory = ((argc > 2) ? argv[2] : "/tmp");
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 5);
+
+    ThreadPool pool;
+
+    std::printf("Distortion: %zu x %zu, threads: %zu, best of %zu\n", distortion_size, distortion_size, pool.num_threads(), iterations);
+    std::printf("%-12s %12s %12s %12s %10s %12s\n", "profile", "uncached ms", "build ms", "load ms", "speedup", "bytes");
+
+    int status = EXIT_SUCCESS;
+
+    const auto fail = [&](const char* const profile, const char* const message) {
+        std::printf("ERROR: %s: %s\n", profile, message);
+        status = EXIT_FAILURE;
+    };
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        const char* const name = profile.name.c_str();
+        const CalibrationKey key = CalibrationKey::query(&system);
+        const std::string path = (directory + "/" + CalibrationCache::file_name(key));
+
+        ::unlink(path.c_str());
+
+        Calibration calibration;
+        std::unique_ptr<CalibrationCache> cache;
+
+        const double uncached_seconds = best_seconds_of(iterations, [&]() {
+            calibration = query_calibration(&system, distortion_size, &pool);
+        });
+
+        const double build_seconds = best_seconds_of(iterations, [&]() {
+            cache = CalibrationCache::build(path.c_str(), &system, key, distortion_size, &pool);
+        });
+
+        if (not matches(*cache, calibration)) {
+            fail(name, "built cache does not match the system!");
+        }
+
+        const double load_seconds = best_seconds_of(iterations, [&]() {
+            cache = CalibrationCache::load_or_build(path.c_str(), &system, distortion_size, &pool);
+        });
+
+        std::printf("%-12s %12.3f %12.3f %12.3f %9.1fx %12zu\n",
+                    name, (uncached_seconds * 1000.0), (build_seconds * 1000.0), (load_seconds * 1000.0),
+                    (uncached_seconds / load_seconds), cache->size_in_bytes());
+
+        if ((not cache->is_mapped()) || (not matches(*cache, calibration))) {
+            fail(name, "loaded cache does not match the system!");
+        }
+
+        //------------------------------------------------------------------------------
+        // Mismatches.
+        CalibrationKey other_serial = key;
+        other_serial.serial += "-other";
+
+        CalibrationKey other_driver = key;
+        other_driver.driver_version += ".1";
+
+        if (CalibrationCache::load(path.c_str(), other_serial, distortion_size) ||
+            CalibrationCache::load(path.c_str(), other_driver, distortion_size) ||
+            CalibrationCache::load(path.c_str(), key, (distortion_size + 1)))
+        {
+            fail(name, "cache loaded for a different key or size!");
+        }
+
+        std::vector<char> contents;
+        {
+            std::ifstream stream(path, (std::ios::in | std::ios::binary));
+            contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+
+        const std::string corrupted_path = (path + ".corrupted");
+
+        std::vector<char> corrupted = contents;
+        corrupted[corrupted.size() / 2] ^= 0x01;
+        write_file(corrupted_path, corrupted);
+
+        if (CalibrationCache::load(corrupted_path.c_str(), key, distortion_size)) {
+            fail(name, "corrupted cache loaded!");
+        }
+
+        std::vector<char> truncated(contents.begin(), (contents.end() - 16));
+        write_file(corrupted_path, truncated);
+
+        if (CalibrationCache::load(corrupted_path.c_str(), key, distortion_size)) {
+            fail(name, "truncated cache loaded!");
+        }
+
+        //------------------------------------------------------------------------------
+        // A driver update rebuilds the cache in place.
+        {
+            SyntheticHMDProfile updated_profile = profile;
+            updated_profile.driver_version += ".1";
+
+            SyntheticVRSystem updated_system(updated_profile);
+
+            cache = CalibrationCache::load_or_build(path.c_str(), &updated_system, distortion_size, &pool);
+
+            if (cache->is_mapped() || (cache->key().driver_version != updated_profile.driver_version)) {
+                fail(name, "cache not rebuilt after a driver update!");
+            }
+
+            cache = CalibrationCache::load_or_build(path.c_str(), &updated_system, distortion_size, &pool);
+
+            if (not cache->is_mapped()) {
+                fail(name, "rebuilt cache not loaded!");
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // A changed resolution setting rebuilds the cache with the new render target
+        // size.
+        {
+            SyntheticHMDProfile resized_profile = profile;
+            resized_profile.render_target_width += 16;
+
+            SyntheticVRSystem resized_system(resized_profile);
+
+            cache = CalibrationCache::load_or_build(path.c_str(), &resized_system, distortion_size, &pool);
+
+            if (cache->is_mapped() || (cache->render_target_width() != resized_profile.render_target_width)) {
+                fail(name, "cache not rebuilt after a render target size change!");
+            }
+        }
+
+        ::unlink(corrupted_path.c_str());
+        ::unlink(path.c_str());
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,300 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Measures the per-call overhead of InstrumentedCompositor over calling a
+// SyntheticCompositor directly and checks the recorded counts, error counts,
+// frame timings and histogram percentiles, concurrent recording, and that a
+// CompositorStatsExporter collects and writes snapshots while frames run.
+//
+// Usage: CompositorInstrumentationBenchmark [frames] [directory] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CompositorInstrumentation.h"
+#include "SyntheticCompositor.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t CALLS_PER_FRAME = 4;       // WaitGetPoses, two Submits, PostPresentHandoff
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // The frame loop of a scene application.
+    template <typename Compositor>
+    void run_frames(Compositor& compositor, size_t num_frames)
+    {
+        vr::TrackedDevicePose_t poses[vr::k_unMaxTrackedDeviceCount];
+        const vr::Texture_t texture = {};
+
+        for (size_t frame = 0; frame < num_frames; ++frame) {
+            compositor.WaitGetPoses(poses, vr::k_unMaxTrackedDeviceCount, nullptr, 0);
+            compositor.Submit(vr::Eye_Left, &texture);
+            compositor.Submit(vr::Eye_Right, &texture);
+            compositor.PostPresentHandoff();
+        }
+    }
+
+    bool within_bucket_error(uint64_t value, uint64_t expected)
+    {
+        return (std::fabs(double(value) - double(expected)) <= (double(expected) / double(LatencyHistogram::SUB_BUCKET_COUNT)));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_frames = ((argc > 1) ? size_t(std::atol(argv[1])) : 200000);
+    const std::string directory = ((argc > 2) ? argv[2] : "/tmp");
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 5);
+
+    int status = EXIT_SUCCESS;
+
+    const auto fail = [&](const char* const message) {
+        std::printf("ERROR: %s\n", message);
+        status = EXIT_FAILURE;
+    };
+
+    //------------------------------------------------------------------------------
+    // Percentiles of a known distribution.
+    {
+        LatencyHistogram histogram;
+
+        for (uint64_t value = 1; value <= 100000; ++value) {
+            histogram.record(value);
+        }
+
+        const LatencyHistogram::Snapshot snapshot = histogram.snapshot();
+
+        if ((snapshot.count != 100000) || (snapshot.max != 100000) ||
+            (not within_bucket_error(snapshot.percentile(0.5), 50000)) ||
+            (not within_bucket_error(snapshot.percentile(0.99), 99000)) ||
+            (snapshot.percentile(1.0) != 100000))
+        {
+            fail("histogram percentiles are off!");
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Concurrent recording.
+    {
+        constexpr size_t NUM_THREADS = 4;
+        constexpr size_t NUM_RECORDS = 250000;
+
+        LatencyHistogram histogram;
+        std::vector<std::thread> threads;
+
+        for (size_t t = 0; t < NUM_THREADS; ++t) {
+            threads.emplace_back([&histogram, t]() {
+                for (size_t i = 0; i < NUM_RECORDS; ++i) {
+                    histogram.record(uint64_t((i * (t + 1)) % 5000));
+                }
+            });
+        }
+
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        if (histogram.snapshot().count != (NUM_THREADS * NUM_RECORDS)) {
+            fail("concurrent records lost!");
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Overhead.
+    SyntheticCompositor compositor;
+    CompositorInstrumentation instrumentation;
+
+    const double direct_seconds = best_seconds_of(iterations, [&]() {
+        run_frames(compositor, num_frames);
+    });
+
+    const double instrumented_seconds = best_seconds_of(iterations, [&]() {
+        InstrumentedCompositor<SyntheticCompositor> instrumented(&compositor, instrumentation, 0);
+        run_frames(instrumented, num_frames);
+    });
+
+    const double sampled_seconds = best_seconds_of(iterations, [&]() {
+        InstrumentedCompositor<SyntheticCompositor> instrumented(&compositor, instrumentation, 1);
+        run_frames(instrumented, num_frames);
+    });
+
+    const double num_calls = double(num_frames * CALLS_PER_FRAME);
+    const double overhead_ns = (((instrumented_seconds - direct_seconds) / num_calls) * 1.0e9);
+    const double sampled_overhead_ns = (((sampled_seconds - direct_seconds) / num_calls) * 1.0e9);
+
+    std::printf("Frames: %zu (%zu calls each), best of %zu\n", num_frames, CALLS_PER_FRAME, iterations);
+    std::printf("Direct:                     %8.2f ns per call\n", ((direct_seconds / num_calls) * 1.0e9));
+    std::printf("Instrumented:               %8.2f ns per call (+%.2f ns)\n", ((instrumented_seconds / num_calls) * 1.0e9), overhead_ns);
+    std::printf("Instrumented, frame timing: %8.2f ns per call (+%.2f ns)\n", ((sampled_seconds / num_calls) * 1.0e9), sampled_overhead_ns);
+
+    if (std::max(overhead_ns, sampled_overhead_ns) > 1000.0) {
+        fail("instrumentation overhead exceeds 1 us per call!");
+    }
+
+    //------------------------------------------------------------------------------
+    // Counts, errors and frame timings with a stats exporter running.
+    {
+        const std::string path = (directory + "/compositor_statistics.csv");
+
+        SyntheticCompositor checked_compositor;
+        checked_compositor.inject_submit_error(vr::VRCompositorError_RequestFailed, 10);
+
+        CompositorInstrumentation checked_instrumentation;
+        std::vector<CompositorInstrumentation::Snapshot> snapshots;
+        uint64_t num_snapshots = 0;
+
+        {
+            CompositorStatsExporter exporter(checked_instrumentation, 0.001, 16, path.c_str());
+            InstrumentedCompositor<SyntheticCompositor> instrumented(&checked_compositor, checked_instrumentation);
+
+            run_frames(instrumented, num_frames);
+            instrumented.Submit(vr::Eye_Left, nullptr);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+            exporter.take_snapshot();
+            snapshots = exporter.snapshots();
+            num_snapshots = exporter.num_snapshots();
+        }
+
+        const CompositorInstrumentation::Snapshot snapshot = checked_instrumentation.snapshot();
+        const uint64_t frames = uint64_t(num_frames);
+
+        const size_t failed_slot = CompositorInstrumentation::error_slot(vr::VRCompositorError_RequestFailed);
+        const size_t invalid_slot = CompositorInstrumentation::error_slot(vr::VRCompositorError_InvalidTexture);
+
+        if ((snapshot.calls[CompositorCall_WaitGetPoses].count != frames) ||
+            (snapshot.calls[CompositorCall_Submit].count != ((2 * frames) + 1)) ||
+            (snapshot.calls[CompositorCall_PostPresentHandoff].count != frames))
+        {
+            fail("call counts do not match!");
+        }
+
+        if ((snapshot.results[CompositorCall_Submit][failed_slot] != ((2 * frames) / 10)) ||
+            (snapshot.results[CompositorCall_Submit][invalid_slot] != 1) ||
+            (snapshot.num_errors(CompositorCall_Submit) != (((2 * frames) / 10) + 1)) ||
+            (snapshot.num_errors(CompositorCall_WaitGetPoses) != 0))
+        {
+            fail("error counts do not match!");
+        }
+
+        //------------------------------------------------------------------------------
+        // The previous frame is sampled, so the first frame has no timing.
+        if ((snapshot.num_frame_timings != (frames - 1)) || (snapshot.num_dropped_frames != ((frames - 1) / 100))) {
+            fail("frame timing counts do not match!");
+        }
+
+        if (not within_bucket_error(snapshot.frame_timing[FrameTimingMetric_CompositorRenderGpu].percentile(0.5), 800)) {
+            fail("frame timing percentiles are off!");
+        }
+
+        if ((num_snapshots < 2) || snapshots.empty() || (snapshots.size() > 16)) {
+            fail("snapshots not collected!");
+        }
+
+        for (size_t i = 1; i < snapshots.size(); ++i) {
+            if ((snapshots[i].time < snapshots[i - 1].time) ||
+                (snapshots[i].calls[CompositorCall_Submit].count < snapshots[i - 1].calls[CompositorCall_Submit].count))
+            {
+                fail("snapshots are not monotonic!");
+                break;
+            }
+        }
+
+        size_t num_lines = 0;
+        {
+            std::ifstream stream(path);
+
+            for (std::string line; std::getline(stream, line); ) {
+                ++num_lines;
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Header, one row per snapshot and the final snapshot.
+        if (num_lines != (num_snapshots + 2)) {
+            fail("statistics file does not match the snapshots!");
+        }
+
+        std::printf("Snapshots: %llu (%zu lines written to %s)\n", static_cast<unsigned long long>(num_snapshots), num_lines, path.c_str());
+
+        for (size_t c = 0; c < CompositorCall_Count; ++c) {
+            const LatencyHistogram::Snapshot& histogram = snapshot.calls[c];
+
+            std::printf("%-20s count %8llu, mean %7.1f ns, p50 %5llu ns, p99 %6llu ns, p99.9 %6llu ns, max %8llu ns, errors %llu\n",
+                        CompositorInstrumentation::call_name(CompositorCall(c)),
+                        static_cast<unsigned long long>(histogram.count), histogram.mean(),
+                        static_cast<unsigned long long>(histogram.percentile(0.5)),
+                        static_cast<unsigned long long>(histogram.percentile(0.99)),
+                        static_cast<unsigned long long>(histogram.percentile(0.999)),
+                        static_cast<unsigned long long>(histogram.max),
+                        static_cast<unsigned long long>(snapshot.num_errors(CompositorCall(c))));
+        }
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,274 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Culls a synthetic scene of randomly placed spheres and boxes around the
+// viewer with StereoCuller (single thread and on a thread pool) and compares it
+// against the scalar reference and against culling each eye separately. Checks
+// that all kernels agree and that no object whose center projects into an eye's
+// view is culled for that eye.
+//
+// Usage: CullingBenchmark [number of objects] [iterations] [profile]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StereoCamera.h"
+#include "StereoCuller.h"
+#include "SyntheticVRSystem.h"
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    struct Scene
+    {
+        std::vector<float>  x, y, z, radius;
+        std::vector<float>  min_x, min_y, min_z, max_x, max_y, max_z;
+
+        SphereArrays spheres() const
+        {
+            SphereArrays arrays;
+            arrays.center_x = x.data();
+            arrays.center_y = y.data();
+            arrays.center_z = z.data();
+            arrays.radius = radius.data();
+            return arrays;
+        }
+
+        BoxArrays boxes() const
+        {
+            BoxArrays arrays;
+            arrays.min_x = min_x.data();
+            arrays.min_y = min_y.data();
+            arrays.min_z = min_z.data();
+            arrays.max_x = max_x.data();
+            arrays.max_y = max_y.data();
+            arrays.max_z = max_z.data();
+            return arrays;
+        }
+    };
+
+    //------------------------------------------------------------------------------
+    // Objects in a 100m cube around the viewer with sizes from 1cm to 2m. The boxes
+    // enclose the spheres.
+    Scene make_scene(size_t count)
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+        std::uniform_real_distribution<float> size(0.01f, 2.0f);
+
+        Scene scene;
+
+        for (size_t i = 0; i < count; ++i) {
+            const float x = position(generator), y = position(generator), z = position(generator), r = size(generator);
+
+            scene.x.push_back(x);
+            scene.y.push_back(y);
+            scene.z.push_back(z);
+            scene.radius.push_back(r);
+            scene.min_x.push_back(x - r);
+            scene.min_y.push_back(y - r);
+            scene.min_z.push_back(z - r);
+            scene.max_x.push_back(x + r);
+            scene.max_y.push_back(y + r);
+            scene.max_z.push_back(z + r);
+        }
+
+        return scene;
+    }
+
+    //------------------------------------------------------------------------------
+    // The straightforward approach: each eye's six planes in turn, one object at a
+    // time.
+    void cull_per_eye(const StereoCuller& culler, const Scene& scene, StereoVisibility& visibility)
+    {
+        const size_t count = scene.x.size();
+
+        visibility.count = count;
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const simd_float4* const planes = culler.eye_planes(eye);
+            std::vector<uint64_t>& bits = visibility.visible[eye];
+
+            bits.assign(((count + 63) / 64), 0);
+
+            for (size_t i = 0; i < count; ++i) {
+                bool is_visible = true;
+
+                for (size_t p = 0; (is_visible && (p < StereoCamera::Plane_Count)); ++p) {
+                    const float distance = ((planes[p][0] * scene.x[i]) + (planes[p][1] * scene.y[i]) + (planes[p][2] * scene.z[i]) + planes[p][3]);
+                    is_visible = (distance >= -scene.radius[i]);
+                }
+
+                bits[i / 64] |= (uint64_t(is_visible) << (i % 64));
+            }
+        }
+    }
+
+    bool center_is_in_view(const StereoCamera::EyeMatrices& matrices, float x, float y, float z)
+    {
+        const simd_float4 clip = MatrixUtils::multiply(matrices.view_projection, simd_float4 { x, y, z, 1.0f });
+
+        return ((clip[3] > 0.0f) &&
+                (std::fabs(clip[0]) <= clip[3]) &&
+                (std::fabs(clip[1]) <= clip[3]) &&
+                (clip[2] >= 0.0f) && (clip[2] <= clip[3]));
+    }
+
+    bool operator==(const StereoVisibility& a, const StereoVisibility& b)
+    {
+        return ((a.count == b.count) && (a.visible[0] == b.visible[0]) && (a.visible[1] == b.visible[1]));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t count = ((argc > 1) ? size_t(std::atol(argv[1])) : 100003);
+    const size_t iterations = ((argc > 2) ? size_t(std::atol(argv[2])) : 20);
+    const SyntheticHMDProfile* const profile = SyntheticVRSystem::find_builtin_profile((argc > 3) ? argv[3] : "vive-like");
+
+    if (not profile) {
+        std::fprintf(stderr, "Unknown profile!\n");
+        return EXIT_FAILURE;
+    }
+
+    SyntheticVRSystem system(*profile);
+    StereoCamera camera(&system, 0.1f, 100.0f);
+
+    simd_float4x4 head_to_world = MatrixUtils::identity();
+    head_to_world.columns[3] = simd_float4 { 0.0f, 1.7f, 0.0f, 1.0f };
+
+    StereoCamera::Frame frame;
+    camera.update(head_to_world, frame);
+
+    const StereoCuller culler(frame);
+    const Scene scene = make_scene(count);
+
+    ThreadPool pool;
+
+    //------------------------------------------------------------------------------
+    // Timing.
+    StereoVisibility spheres, spheres_parallel, spheres_scalar, spheres_per_eye;
+    StereoVisibility boxes, boxes_parallel, boxes_scalar;
+
+    const double sphere_seconds = best_seconds_of(iterations, [&]() { culler.cull(scene.spheres(), count, spheres); });
+    const double sphere_parallel_seconds = best_seconds_of(iterations, [&]() { culler.cull(scene.spheres(), count, spheres_parallel, &pool); });
+    const double sphere_scalar_seconds = best_seconds_of(iterations, [&]() { culler.cull_scalar(scene.spheres(), count, spheres_scalar); });
+    const double sphere_per_eye_seconds = best_seconds_of(iterations, [&]() { cull_per_eye(culler, scene, spheres_per_eye); });
+    const double box_seconds = best_seconds_of(iterations, [&]() { culler.cull(scene.boxes(), count, boxes); });
+    const double box_parallel_seconds = best_seconds_of(iterations, [&]() { culler.cull(scene.boxes(), count, boxes_parallel, &pool); });
+    const double box_scalar_seconds = best_seconds_of(iterations, [&]() { culler.cull_scalar(scene.boxes(), count, boxes_scalar); });
+
+    std::printf("%s, %zu objects, %zu threads\n", profile->name.c_str(), count, pool.num_threads());
+    std::printf("  Spheres  %-8s %8.3f ms  parallel %8.3f ms  scalar %8.3f ms  per eye %8.3f ms\n",
+                StereoCuller::kernel_name(), (sphere_seconds * 1000.0), (sphere_parallel_seconds * 1000.0),
+                (sphere_scalar_seconds * 1000.0), (sphere_per_eye_seconds * 1000.0));
+    std::printf("  Boxes    %-8s %8.3f ms  parallel %8.3f ms  scalar %8.3f ms\n",
+                StereoCuller::kernel_name(), (box_seconds * 1000.0), (box_parallel_seconds * 1000.0), (box_scalar_seconds * 1000.0));
+    std::printf("  Visible: spheres %zu / %zu, boxes %zu / %zu (left / right)\n",
+                spheres.num_visible(vr::Eye_Left), spheres.num_visible(vr::Eye_Right),
+                boxes.num_visible(vr::Eye_Left), boxes.num_visible(vr::Eye_Right));
+
+    //------------------------------------------------------------------------------
+    // Checks.
+    size_t num_errors = 0;
+
+    if (not ((spheres == spheres_scalar) && (spheres == spheres_parallel))) {
+        std::printf("ERROR: sphere results differ\n");
+        ++num_errors;
+    }
+
+    if (not ((boxes == boxes_scalar) && (boxes == boxes_parallel))) {
+        std::printf("ERROR: box results differ\n");
+        ++num_errors;
+    }
+
+    size_t num_missing = 0;
+    size_t num_box_misses = 0;
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (size_t i = 0; i < count; ++i) {
+            if (center_is_in_view(frame.eyes[eye], scene.x[i], scene.y[i], scene.z[i]) && not spheres.is_visible(eye, i)) {
+                ++num_missing;
+            }
+
+            if (spheres.is_visible(eye, i) && not boxes.is_visible(eye, i)) {
+                ++num_box_misses;
+            }
+        }
+    }
+
+    if (num_missing != 0) {
+        std::printf("ERROR: %zu spheres in view were culled\n", num_missing);
+        ++num_errors;
+    }
+
+    if (num_box_misses != 0) {
+        std::printf("ERROR: %zu boxes culled although their enclosed sphere is visible\n", num_box_misses);
+        ++num_errors;
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
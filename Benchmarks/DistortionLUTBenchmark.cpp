@@ -0,0 +1,167 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares the scalar and vectorized DistortionLUT batch lookup paths. Some of
+// the UVs are NaN, infinite or outside [0, 1] to check that both paths clamp
+// them the same way.
+//
+// Usage: DistortionLUTBenchmark [grid size] [sample count] [iterations] [profile]
+//
+// The table is sampled from a SyntheticVRSystem with the given built-in profile
+// (default: vive-like).
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    struct BatchOutput
+    {
+        explicit BatchOutput(size_t count)
+        {
+            for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+                storage[c].resize(count);
+                channels[c] = storage[c].data();
+            }
+        }
+
+        std::vector<float>      storage[DistortionLUT::Channel_Count];
+        float*                  channels[DistortionLUT::Channel_Count];
+    };
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t grid_size = ((argc > 1) ? size_t(std::atol(argv[1])) : 65);
+    const size_t count = ((argc > 2) ? size_t(std::atol(argv[2])) : 4000000);
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 5);
+
+    const char* const profile_name = ((argc > 4) ? argv[4] : "vive-like");
+
+    const SyntheticHMDProfile* const profile = SyntheticVRSystem::find_builtin_profile(profile_name);
+
+    if (not profile) {
+        std::fprintf(stderr, "Unknown profile: %s\n", profile_name);
+        return EXIT_FAILURE;
+    }
+
+    SyntheticVRSystem system(*profile);
+    const DistortionLUT lut(&system, grid_size, grid_size);
+
+    //------------------------------------------------------------------------------
+    // Random UVs with a fixed seed so runs are comparable.
+    std::vector<float> u(count);
+    std::vector<float> v(count);
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+        for (size_t i = 0; i < count; ++i) {
+            u[i] = distribution(generator);
+            v[i] = distribution(generator);
+        }
+
+        const float special_values[] = { NAN, -NAN, INFINITY, -INFINITY, -0.5f, 1.5f };
+        const size_t num_special_values = (sizeof(special_values) / sizeof(special_values[0]));
+
+        for (size_t i = 0; i < count; i += 97) {
+            u[i] = special_values[(i / 97) % num_special_values];
+            v[((i * 7) + 3) % count] = special_values[(i / 89) % num_special_values];
+        }
+    }
+
+    BatchOutput scalar_output(count);
+    BatchOutput vector_output(count);
+
+    const double scalar_seconds = best_seconds_of(iterations, [&]() {
+        lut.lookup_batch_scalar(vr::Eye_Left, u.data(), v.data(), count, scalar_output.channels);
+    });
+
+    const double vector_seconds = best_seconds_of(iterations, [&]() {
+        lut.lookup_batch(vr::Eye_Left, u.data(), v.data(), count, vector_output.channels);
+    });
+
+    //------------------------------------------------------------------------------
+    // Both paths must agree (a NaN result counts as infinitely different).
+    float max_difference = 0.0f;
+
+    for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+        for (size_t i = 0; i < count; ++i) {
+            const float difference = std::fabs(scalar_output.channels[c][i] - vector_output.channels[c][i]);
+            max_difference = (std::isnan(difference) ? INFINITY : std::max(max_difference, difference));
+        }
+    }
+
+    std::printf("Profile: %s, grid: %zu x %zu, samples: %zu, best of %zu\n", profile_name, grid_size, grid_size, count, iterations);
+    std::printf("Scalar: %8.3f ms (%7.2f Msamples/s)\n", (scalar_seconds * 1000.0), (double(count) / scalar_seconds / 1.0e6));
+    std::printf("%-6s: %8.3f ms (%7.2f Msamples/s)\n", DistortionLUT::batch_kernel_name(), (vector_seconds * 1000.0), (double(count) / vector_seconds / 1.0e6));
+    std::printf("Speedup: %.2fx, max difference: %g\n", (scalar_seconds / vector_seconds), double(max_difference));
+
+    return ((max_difference <= 1.0e-5f) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
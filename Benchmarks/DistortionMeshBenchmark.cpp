@@ -0,0 +1,198 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Builds adaptive DistortionMeshes over a range of error bounds and uniform
+// grids for all built-in synthetic profiles and reports measured error versus
+// vertex count. Errors are given in pixels of the recommended render target.
+// Checks that meshes are free of T-junctions, that the measured error stays
+// close to the bound and that hidden triangles are culled.
+//
+// Usage: DistortionMeshBenchmark [error subdivisions]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionMesh.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // True if every edge is either shared by exactly two triangles in opposite
+    // directions or lies on the border of the display, i.e. the mesh covers the
+    // display without cracks or T-junctions.
+    bool is_watertight(const DistortionMesh& mesh)
+    {
+        const std::vector<DistortionMesh::Vertex>& vertices = mesh.vertices();
+        const std::vector<uint16_t>& indices = mesh.indices();
+
+        std::map<std::pair<uint16_t, uint16_t>, int> edges;
+
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            for (size_t i = 0; i < 3; ++i) {
+                const uint16_t a = indices[t + i];
+                const uint16_t b = indices[t + ((i + 1) % 3)];
+
+                if (++edges[{ a, b }] > 1) {
+                    return false;
+                }
+            }
+        }
+
+        const auto on_border = [&](uint16_t a, uint16_t b) {
+            for (size_t k = 0; k < 2; ++k) {
+                const float pa = vertices[a].position.v[k];
+                const float pb = vertices[b].position.v[k];
+
+                if ((pa == pb) && ((pa == 0.0f) || (pa == 1.0f))) {
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        for (const auto& edge : edges) {
+            const uint16_t a = edge.first.first;
+            const uint16_t b = edge.first.second;
+
+            if ((edges.count({ b, a }) == 0) && (not on_border(a, b))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t subdivisions = ((argc > 1) ? size_t(std::atol(argv[1])) : 4);
+
+    const float error_bounds[] = { 4.0e-3f, 2.0e-3f, 1.0e-3f, 5.0e-4f, 2.5e-4f };
+    const uint32_t uniform_depths[] = { 4, 5, 6 };
+
+    int status = EXIT_SUCCESS;
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        system.GetRecommendedRenderTargetSize(&width, &height);
+
+        const float pixels = float(std::max(width, height));
+
+        std::printf("%s (%u x %u), left eye\n", profile.name.c_str(), width, height);
+        std::printf("    %-16s %9s %9s %7s %7s %10s %10s %9s\n", "mesh", "vertices", "triangles", "culled", "depth", "max px", "mean px", "build ms");
+
+        const auto run = [&](const char* const name, const DistortionMesh::Settings& settings, bool check_bound) {
+            const auto start = std::chrono::steady_clock::now();
+            const DistortionMesh mesh(&system, vr::Eye_Left, settings);
+            const auto end = std::chrono::steady_clock::now();
+
+            const DistortionMesh::Statistics& statistics = mesh.statistics();
+            const DistortionMesh::ErrorReport report = mesh.compute_error_report(&system, subdivisions);
+
+            std::printf("    %-16s %9zu %9zu %7zu %7u %10.4f %10.4f %9.2f\n",
+                        name, statistics.num_vertices, statistics.num_triangles, statistics.num_culled_triangles, statistics.depth,
+                        double(report.max_error * pixels), double(report.mean_error * pixels),
+                        (std::chrono::duration<double>(end - start).count() * 1000.0));
+
+            if (check_bound && (statistics.max_cell_error <= settings.max_error) && (report.max_error > (2.0f * settings.max_error))) {
+                std::printf("ERROR: %s: %s: measured error %g exceeds twice the bound!\n", profile.name.c_str(), name, double(report.max_error));
+                status = EXIT_FAILURE;
+            }
+
+            return statistics;
+        };
+
+        for (const float max_error : error_bounds) {
+            DistortionMesh::Settings settings;
+            settings.max_error = max_error;
+            settings.max_depth = DistortionMesh::MAX_DEPTH;
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "adaptive %.4f", double(max_error * pixels));
+
+            const DistortionMesh::Statistics statistics = run(name, settings, true);
+
+            if ((max_error == error_bounds[0]) && (statistics.num_culled_triangles == 0)) {
+                std::printf("ERROR: %s: no triangles culled!\n", profile.name.c_str());
+                status = EXIT_FAILURE;
+            }
+        }
+
+        for (const uint32_t depth : uniform_depths) {
+            DistortionMesh::Settings settings;
+            settings.min_depth = depth;
+            settings.max_depth = depth;
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "uniform %ux%u", (1u << depth), (1u << depth));
+
+            run(name, settings, false);
+        }
+
+        //------------------------------------------------------------------------------
+        // Without culling the mesh must cover the display seamlessly.
+        {
+            DistortionMesh::Settings settings;
+            settings.max_depth = DistortionMesh::MAX_DEPTH;
+            settings.cull_hidden = false;
+
+            if (not is_watertight(DistortionMesh(&system, vr::Eye_Left, settings))) {
+                std::printf("ERROR: %s: mesh has cracks or T-junctions!\n", profile.name.c_str());
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
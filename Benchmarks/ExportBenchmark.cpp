@@ -0,0 +1,204 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares the throughput of the distortion sample exports: the original
+// std::ofstream based CSV writer, the std::to_chars based CSV writer and the
+// binary format (writing and reading back through a memory mapping).
+//
+// Usage: ExportBenchmark [grid size] [output directory] [profile]
+//
+// The samples come from a SyntheticVRSystem with the given built-in profile
+// (default: vive-like).
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+#include "ExportFormat.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // The CSV writer as it was before BufferedFileWriter.
+    void write_distortion_samples_with_ofstream(std::ofstream& csv_stream, const DistortionLUT& lut, vr::EVREye eye)
+    {
+        const size_t width = lut.width();
+        const size_t height = lut.height();
+
+        for (size_t y = 0; y < height; ++y) {
+            const float v = (float(y) / float(height - 1));
+
+            for (size_t x = 0; x < width; ++x) {
+                const float u = (float(x) / float(width - 1));
+                const size_t index = ((y * width) + x);
+
+                csv_stream << u << "\t";
+                csv_stream << v << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_RedU)[index]   << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_RedV)[index]   << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_GreenU)[index] << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_GreenV)[index] << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_BlueU)[index]  << "\t";
+                csv_stream << lut.channel(eye, DistortionLUT::Channel_BlueV)[index]  << "\n";
+            }
+        }
+    }
+
+    template <typename Function>
+    double seconds_of(Function&& function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    size_t file_size(const std::string& path)
+    {
+        struct stat file_stat;
+        return ((::stat(path.c_str(), &file_stat) == 0) ? size_t(file_stat.st_size) : 0);
+    }
+
+    void print_result(const char* const name, double seconds, size_t bytes)
+    {
+        std::printf("%-16s %9.3f ms %10zu bytes %9.2f MB/s\n", name, (seconds * 1000.0), bytes, (double(bytes) / seconds / 1.0e6));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t grid_size = ((argc > 1) ? size_t(std::atol(argv[1])) : 1025);
+    const std::string directory = ((argc > 2) ? argv[2] : "/tmp");
+
+    const char* const profile_name = ((argc > 3) ? argv[3] : "vive-like");
+
+    const SyntheticHMDProfile* const profile = SyntheticVRSystem::find_builtin_profile(profile_name);
+
+    if (not profile) {
+        std::fprintf(stderr, "Unknown profile: %s\n", profile_name);
+        return EXIT_FAILURE;
+    }
+
+    SyntheticVRSystem system(*profile);
+    const DistortionLUT lut(&system, grid_size, grid_size);
+
+    const std::string ofstream_path = (directory + "/distortion_ofstream.csv");
+    const std::string to_chars_path = (directory + "/distortion_to_chars.csv");
+    const std::string binary_path = (directory + "/distortion.bin");
+
+    std::printf("Profile: %s, grid: %zu x %zu per eye\n", profile_name, grid_size, grid_size);
+
+    //------------------------------------------------------------------------------
+    // std::ofstream CSV.
+    const double ofstream_seconds = seconds_of([&]() {
+        std::ofstream csv_stream(ofstream_path, (std::ios::out | std::ios::trunc));
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            write_distortion_samples_with_ofstream(csv_stream, lut, eye);
+        }
+    });
+
+    print_result("ofstream CSV", ofstream_seconds, file_size(ofstream_path));
+
+    //------------------------------------------------------------------------------
+    // std::to_chars CSV.
+    const double to_chars_seconds = seconds_of([&]() {
+        BufferedFileWriter writer;
+        writer.open(to_chars_path.c_str(), true);
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            ExportFormat::write_distortion_samples_as_csv(writer, lut, eye);
+        }
+    });
+
+    print_result("to_chars CSV", to_chars_seconds, file_size(to_chars_path));
+
+    //------------------------------------------------------------------------------
+    // Binary.
+    const double binary_seconds = seconds_of([&]() {
+        BufferedFileWriter writer;
+        writer.open(binary_path.c_str(), true);
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            ExportFormat::write_distortion_samples_as_binary(writer, lut, eye, "");
+        }
+    });
+
+    print_result("binary", binary_seconds, file_size(binary_path));
+
+    //------------------------------------------------------------------------------
+    // Reading the binary file back, touching every value.
+    double sum = 0.0;
+
+    const double mapped_seconds = seconds_of([&]() {
+        const MappedExportFile file(binary_path.c_str());
+
+        for (const MappedExportFile::Section& section : file.sections()) {
+            for (size_t c = 0; c < ExportColumn_Count; ++c) {
+                const float* const column = section.column(ExportColumn(c));
+
+                for (size_t i = 0; i < section.num_values(); ++i) {
+                    sum += column[i];
+                }
+            }
+        }
+    });
+
+    print_result("binary (mmap)", mapped_seconds, file_size(binary_path));
+    std::printf("Checksum: %g\n", sum);
+
+    std::remove(ofstream_path.c_str());
+    std::remove(to_chars_path.c_str());
+    std::remove(binary_path.c_str());
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,256 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Simulates a render loop with dynamic resolution scaling on EyeTexturePool with
+// the CPU backend: the resolution scale random walks over a few levels and the
+// GPU finishes each frame a fixed number of frames later. Reports hit rates,
+// allocations and evictions with and without a memory budget, compares against
+// creating the eye textures every frame, and checks that no buffer is handed
+// out while in flight and that nothing is allocated once all sizes have been
+// seen.
+//
+// Usage: EyeTexturePoolBenchmark [frames] [buffers] [GPU latency in frames]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "EyeTexturePool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr uint32_t BASE_WIDTH = 1512;
+    constexpr uint32_t BASE_HEIGHT = 1680;
+    constexpr uint32_t FORMAT = 80;             // MTLPixelFormatBGRA8Unorm
+    constexpr size_t NUM_LEVELS = 9;            // Scales 0.6 to 1.4
+    constexpr size_t FRAMES_PER_CHANGE = 30;
+
+    EyeTextureKey key_for_level(size_t level)
+    {
+        const double scale = (0.6 + (0.1 * double(level)));
+
+        EyeTextureKey key;
+        key.format = FORMAT;
+        key.width = uint32_t(double(BASE_WIDTH) * scale);
+        key.height = uint32_t(double(BASE_HEIGHT) * scale);
+        return key;
+    }
+
+    //------------------------------------------------------------------------------
+    // The resolution level of every frame (random walk).
+    std::vector<size_t> make_levels(size_t num_frames)
+    {
+        std::mt19937 generator(1);
+        std::vector<size_t> levels(num_frames);
+        size_t level = (NUM_LEVELS / 2);
+
+        for (size_t frame = 0; frame < num_frames; ++frame) {
+            if ((frame % FRAMES_PER_CHANGE) == 0) {
+                const bool up = ((generator() & 1) != 0);
+                level = (up ? std::min((level + 1), (NUM_LEVELS - 1)) : ((level > 0) ? (level - 1) : 0));
+            }
+
+            levels[frame] = level;
+        }
+
+        return levels;
+    }
+
+    struct RunResult
+    {
+        EyeTexturePool::Statistics  statistics;
+        size_t                      num_created = 0;
+        size_t                      num_created_after_warm_up = 0;
+        size_t                      num_in_flight_violations = 0;
+        double                      seconds = 0.0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Frame N's fence value is N + 1 and is signaled 'latency' frames later.
+    RunResult run(const std::vector<size_t>& levels, size_t num_buffers, size_t latency, size_t budget_in_bytes)
+    {
+        CPUEyeTextureBackend backend;
+        RunResult result;
+
+        std::map<void*, uint64_t> fences;       // Texture to the fence of its last use
+        std::vector<bool> seen(NUM_LEVELS, false);
+        size_t num_seen = 0;
+        size_t num_created_at_warm_up = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        {
+            EyeTexturePool pool(backend, num_buffers, budget_in_bytes);
+
+            for (size_t frame = 0; frame < levels.size(); ++frame) {
+                const uint64_t completed_fence = ((frame >= latency) ? uint64_t(frame - latency + 1) : 0);
+                const EyeTexturePool::Lease lease = pool.acquire(key_for_level(levels[frame]), completed_fence);
+
+                if (lease) {
+                    for (void* const texture : lease.textures) {
+                        const auto found = fences.find(texture);
+
+                        if ((found != fences.end()) && (found->second > completed_fence)) {
+                            ++result.num_in_flight_violations;
+                        }
+
+                        fences[texture] = uint64_t(frame + 1);
+                    }
+
+                    pool.release(lease, uint64_t(frame + 1));
+                }
+
+                //------------------------------------------------------------------------------
+                // Warmed up once every level has been used for a full interval.
+                if ((frame % FRAMES_PER_CHANGE) == (FRAMES_PER_CHANGE - 1)) {
+                    if ((num_seen < NUM_LEVELS) && not seen[levels[frame]]) {
+                        seen[levels[frame]] = true;
+
+                        if (++num_seen == NUM_LEVELS) {
+                            num_created_at_warm_up = backend.num_created();
+                        }
+                    }
+                }
+
+                //------------------------------------------------------------------------------
+                // Freed memory may be reused for new textures.
+                for (auto texture = fences.begin(); texture != fences.end(); ) {
+                    texture = ((texture->second <= completed_fence) ? fences.erase(texture) : std::next(texture));
+                }
+            }
+
+            result.statistics = pool.statistics();
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.num_created = backend.num_created();
+        result.num_created_after_warm_up = ((num_seen == NUM_LEVELS) ? (backend.num_created() - num_created_at_warm_up) : 0);
+
+        return result;
+    }
+
+    void print_result(const char* const name, const RunResult& result, size_t num_frames)
+    {
+        const EyeTexturePool::Statistics& s = result.statistics;
+        const size_t num_acquires = (s.num_hits + s.num_misses + s.num_stalls);
+
+        std::printf("%-12s hit rate %6.2f%%, %zu stalls, %zu textures created (%zu after warm-up), %zu evictions, peak %.1f MB, %.2f us/frame\n",
+                    name, (100.0 * double(s.num_hits) / double(std::max<size_t>(num_acquires, 1))), s.num_stalls,
+                    result.num_created, result.num_created_after_warm_up, s.num_evictions,
+                    (double(s.peak_size_in_bytes) / (1024.0 * 1024.0)), (result.seconds / double(num_frames) * 1.0e6));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_frames = ((argc > 1) ? size_t(std::atol(argv[1])) : 20000);
+    const size_t num_buffers = ((argc > 2) ? size_t(std::atol(argv[2])) : 3);
+    const size_t latency = ((argc > 3) ? size_t(std::atol(argv[3])) : 2);
+
+    const std::vector<size_t> levels = make_levels(num_frames);
+
+    //------------------------------------------------------------------------------
+    // A budget fitting the buffers of the largest size and a few more.
+    CPUEyeTextureBackend sizes;
+    const size_t largest_set = (2 * num_buffers * sizes.texture_size_in_bytes(key_for_level(NUM_LEVELS - 1)));
+    const size_t budget = (largest_set * 2);
+
+    const RunResult unlimited = run(levels, num_buffers, latency, 0);
+    const RunResult budgeted = run(levels, num_buffers, latency, budget);
+
+    //------------------------------------------------------------------------------
+    // Baseline: new textures every frame.
+    CPUEyeTextureBackend backend;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        const EyeTextureKey key = key_for_level(levels[frame]);
+        void* const textures[2] = { backend.create_texture(key), backend.create_texture(key) };
+
+        for (void* const texture : textures) {
+            backend.destroy_texture(texture);
+        }
+    }
+
+    const double per_frame_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Frames: %zu, buffers: %zu, GPU latency: %zu frames, budget %.1f MB\n",
+                num_frames, num_buffers, latency, (double(budget) / (1024.0 * 1024.0)));
+    print_result("Unlimited", unlimited, num_frames);
+    print_result("Budget", budgeted, num_frames);
+    std::printf("%-12s %zu textures created, %.2f us/frame\n", "Per frame", backend.num_created(), (per_frame_seconds / double(num_frames) * 1.0e6));
+
+    //------------------------------------------------------------------------------
+    // Checks.
+    size_t num_errors = 0;
+
+    for (const RunResult* const result : { &unlimited, &budgeted }) {
+        if (result->num_in_flight_violations != 0) {
+            std::printf("ERROR: %zu textures handed out while in flight\n", result->num_in_flight_violations);
+            ++num_errors;
+        }
+
+        if ((num_buffers > latency) && (result->statistics.num_stalls != 0)) {
+            std::printf("ERROR: %zu stalls\n", result->statistics.num_stalls);
+            ++num_errors;
+        }
+    }
+
+    if (unlimited.num_created_after_warm_up != 0) {
+        std::printf("ERROR: %zu textures created in steady state\n", unlimited.num_created_after_warm_up);
+        ++num_errors;
+    }
+
+    if (budgeted.statistics.peak_size_in_bytes > budget) {
+        std::printf("ERROR: budget exceeded\n");
+        ++num_errors;
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
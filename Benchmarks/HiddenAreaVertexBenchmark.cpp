@@ -0,0 +1,292 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Times the conversion of hidden area vertices into the GPU vertex formats of
+// HiddenAreaVertexFormat.h (vectorized against scalar) and checks that both
+// produce identical results, that quantized components are rounded away from
+// the center by at most one step, and that quantized standard/inverse meshes of
+// the built-in synthetic profiles never hide more/show less pixels than the
+// original when rasterized at the recommended render target size.
+//
+// Usage: HiddenAreaVertexBenchmark [iterations] [number of vertices]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+#include "HiddenAreaVertexFormat.h"
+#include "MeshProcessing.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    template <typename Vertex>
+    std::vector<vr::HmdVector2_t> quantize(const vr::HmdVector2_t* const vertices, size_t count)
+    {
+        std::vector<Vertex> converted(count);
+        Vertex::convert(vertices, count, converted.data());
+
+        std::vector<vr::HmdVector2_t> decoded(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            decoded[i] = converted[i].decode();
+        }
+
+        return decoded;
+    }
+
+    //------------------------------------------------------------------------------
+    // The largest step of the format at the given component.
+    float half_step(float component)
+    {
+        return std::max((std::fabs(component) / 1024.0f), (1.0f / 16777216.0f));
+    }
+
+    float unorm16_step(float)
+    {
+        return (1.0f / 65535.0f);
+    }
+
+    //------------------------------------------------------------------------------
+    // Time both conversions and return the number of components that differ
+    // between them, are rounded towards the center or by more than one step.
+    template <typename Vertex, typename Clamp, typename Step>
+    size_t benchmark_format(const char* const name,
+                            const char* const kernel_name,
+                            const std::vector<vr::HmdVector2_t>& vertices,
+                            size_t iterations,
+                            Clamp&& clamp,
+                            Step&& step)
+    {
+        const size_t count = vertices.size();
+
+        std::vector<Vertex> vectorized(count);
+        std::vector<Vertex> scalar(count);
+
+        const double vectorized_seconds = best_seconds_of(iterations, [&]() {
+            Vertex::convert(vertices.data(), count, vectorized.data());
+        });
+
+        const double scalar_seconds = best_seconds_of(iterations, [&]() {
+            Vertex::convert_scalar(vertices.data(), count, scalar.data());
+        });
+
+        size_t num_mismatches = 0;
+        size_t num_wrong_direction = 0;
+        size_t num_too_far = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            num_mismatches += ((std::memcmp(&vectorized[i], &scalar[i], sizeof(Vertex)) != 0) ? 1 : 0);
+
+            const vr::HmdVector2_t decoded = vectorized[i].decode();
+
+            for (size_t c = 0; c < 2; ++c) {
+                const float component = clamp(vertices[i].v[c]);
+                const float delta = (decoded.v[c] - component);
+
+                num_wrong_direction += ((((component >= 0.5f) && (delta < 0.0f)) || ((component < 0.5f) && (delta > 0.0f))) ? 1 : 0);
+                num_too_far += ((std::fabs(delta) > (step(component) * 1.0001f)) ? 1 : 0);
+            }
+        }
+
+        std::printf("  %-24s %-7s %8.3f ms (%6.2f ns/vertex)  scalar %8.3f ms (%6.2f ns/vertex)  %.2fx\n",
+                    name, kernel_name,
+                    (vectorized_seconds * 1000.0), ((vectorized_seconds / double(count)) * 1.0e9),
+                    (scalar_seconds * 1000.0), ((scalar_seconds / double(count)) * 1.0e9),
+                    (scalar_seconds / vectorized_seconds));
+
+        if (num_mismatches || num_wrong_direction || num_too_far) {
+            std::printf("ERROR: %s: %zu mismatches, %zu rounded towards the center, %zu more than one step!\n",
+                        name, num_mismatches, num_wrong_direction, num_too_far);
+        }
+
+        return (num_mismatches + num_wrong_direction + num_too_far);
+    }
+
+    //------------------------------------------------------------------------------
+    // The number of pixels covered by 'a' but not by 'b'.
+    size_t count_excess_pixels(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b)
+    {
+        size_t count = 0;
+
+        for (size_t i = 0; i < a.size(); ++i) {
+            count += size_t(__builtin_popcountll(a[i] & ~b[i]));
+        }
+
+        return count;
+    }
+
+    //------------------------------------------------------------------------------
+    // Rasterize the quantized mesh and return the number of violations, i.e.
+    // hidden pixels that are not hidden by the original standard mesh or visible
+    // pixels not covered by the quantized inverse mesh.
+    template <typename Vertex>
+    size_t check_mesh(const char* const name,
+                      const vr::HiddenAreaMesh_t& mesh,
+                      vr::EHiddenAreaMeshType type,
+                      uint32_t width,
+                      uint32_t height,
+                      const std::vector<uint64_t>& original_coverage,
+                      size_t num_indexed_vertices)
+    {
+        const std::vector<vr::HmdVector2_t> decoded = quantize<Vertex>(mesh.pVertexData, (3 * size_t(mesh.unTriangleCount)));
+
+        std::vector<uint64_t> coverage;
+        HiddenAreaTileMask::rasterize_coverage({ decoded.data(), mesh.unTriangleCount }, width, height, coverage);
+
+        const bool is_standard = (type == vr::k_eHiddenAreaMesh_Standard);
+        const size_t num_violations = (is_standard ? count_excess_pixels(coverage, original_coverage) : count_excess_pixels(original_coverage, coverage));
+        const size_t num_changed = (is_standard ? count_excess_pixels(original_coverage, coverage) : count_excess_pixels(coverage, original_coverage));
+
+        std::printf("    %-8s %-24s %6zu bytes, %5zu pixels %s, %zu violations\n",
+                    (is_standard ? "Standard" : "Inverse"), name, (sizeof(Vertex) * num_indexed_vertices), num_changed,
+                    (is_standard ? "unhidden" : "added"), num_violations);
+
+        return num_violations;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t iterations = ((argc > 1) ? size_t(std::atol(argv[1])) : 10);
+    const size_t num_vertices = ((argc > 2) ? size_t(std::atol(argv[2])) : (1024 * 1024));
+
+    size_t num_errors = 0;
+
+    //------------------------------------------------------------------------------
+    // Random UVs, mostly in [0, 1] with some outside and a few special values. The
+    // odd count leaves a remainder for the scalar path.
+    {
+        std::vector<vr::HmdVector2_t> vertices((num_vertices | 1));
+
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> uv(-0.05f, 1.05f);
+        std::uniform_real_distribution<float> tiny(-1.0e-4f, 1.0e-4f);
+
+        for (vr::HmdVector2_t& vertex : vertices) {
+            vertex = {{ uv(generator), uv(generator) }};
+        }
+
+        const float special[] = { 0.0f, -0.0f, 0.5f, 1.0f, std::nextafter(0.5f, 0.0f), std::nextafter(1.0f, 0.0f), 1.0e-7f, -1.0e-7f, 6.1e-5f };
+
+        for (size_t i = 0; i < std::min(vertices.size(), size_t(1024)); ++i) {
+            vertices[i] = {{ special[i % (sizeof(special) / sizeof(special[0]))], tiny(generator) }};
+        }
+
+        std::printf("%zu vertices\n", vertices.size());
+
+        num_errors += benchmark_format<HiddenAreaVertexFloat2>("HiddenAreaVertexFloat2", "Copy", vertices, iterations,
+                                                               [](float x) { return x; }, [](float) { return 0.0f; });
+
+        num_errors += benchmark_format<HiddenAreaVertexHalf2>("HiddenAreaVertexHalf2", HiddenAreaVertexHalf2::kernel_name(), vertices, iterations,
+                                                              [](float x) { return x; }, half_step);
+
+        num_errors += benchmark_format<HiddenAreaVertexUShort2Normalized>("UShort2Normalized", HiddenAreaVertexUShort2Normalized::kernel_name(), vertices, iterations,
+                                                                          [](float x) { return std::max(0.0f, std::min(x, 1.0f)); }, unorm16_step);
+    }
+
+    //------------------------------------------------------------------------------
+    // Coverage of the quantized meshes.
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        const uint32_t width = profile.render_target_width;
+        const uint32_t height = profile.render_target_height;
+
+        std::printf("%s (%u x %u)\n", profile.name.c_str(), width, height);
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            std::printf("  %s eye\n", ((eye == vr::Eye_Left) ? "Left" : "Right"));
+
+            for (const vr::EHiddenAreaMeshType type : { vr::k_eHiddenAreaMesh_Standard, vr::k_eHiddenAreaMesh_Inverse }) {
+                const vr::HiddenAreaMesh_t mesh = system.GetHiddenAreaMesh(eye, type);
+
+                if (mesh.unTriangleCount == 0) {
+                    continue;
+                }
+
+                IndexedMesh indexed_mesh;
+                const size_t num_indexed_vertices = (MeshProcessing::make_indexed_mesh(mesh, indexed_mesh) ?
+                                                     indexed_mesh.vertices.size() : (3 * size_t(mesh.unTriangleCount)));
+
+                std::vector<uint64_t> original_coverage;
+                HiddenAreaTileMask::rasterize_coverage(mesh, width, height, original_coverage);
+
+                num_errors += check_mesh<HiddenAreaVertexFloat2>("HiddenAreaVertexFloat2", mesh, type, width, height, original_coverage, num_indexed_vertices);
+                num_errors += check_mesh<HiddenAreaVertexHalf2>("HiddenAreaVertexHalf2", mesh, type, width, height, original_coverage, num_indexed_vertices);
+                num_errors += check_mesh<HiddenAreaVertexUShort2Normalized>("UShort2Normalized", mesh, type, width, height, original_coverage, num_indexed_vertices);
+            }
+        }
+    }
+
+    if (num_errors) {
+        std::printf("ERROR: %zu errors!\n", num_errors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
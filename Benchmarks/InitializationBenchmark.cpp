@@ -0,0 +1,430 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares initializing the VR derived resources serially against running a
+// VRInitializer graph on a thread pool, for systems simulating the round trip
+// latency of OpenVR calls. Checks that both produce the same resources (also
+// when building and then loading a calibration cache), that tasks never start
+// before their dependencies completed, that a calibration cache hit is faster
+// than the graph without a cache, and that a failing task skips its dependents
+// without affecting independent tasks.
+//
+// Usage: InitializationBenchmark [call latency in ms] [threads] [iterations] [directory]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SyntheticVRSystem.h"
+#include "ThreadPool.h"
+#include "VRInitializer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t DISTORTION_LUT_SIZE = 64;
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // A synthetic system whose startup queries take a fixed time, like round trips
+    // to the OpenVR server. Distortion is computed in process by the OpenVR client
+    // and not delayed.
+    class LatentVRSystem : public SyntheticVRSystem
+    {
+    public:
+
+        LatentVRSystem(const SyntheticHMDProfile& profile, double latency_seconds)
+            : SyntheticVRSystem(profile)
+            , m_latency(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(latency_seconds)))
+        {
+        }
+
+        void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override
+        {
+            wait();
+            SyntheticVRSystem::GetRecommendedRenderTargetSize(pnWidth, pnHeight);
+        }
+
+        float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override
+        {
+            wait();
+            return SyntheticVRSystem::GetFloatTrackedDeviceProperty(unDeviceIndex, prop, pError);
+        }
+
+        uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                                vr::ETrackedDeviceProperty prop,
+                                                char* pchValue,
+                                                uint32_t unBufferSize,
+                                                vr::ETrackedPropertyError* pError) override
+        {
+            wait();
+            return SyntheticVRSystem::GetStringTrackedDeviceProperty(unDeviceIndex, prop, pchValue, unBufferSize, pError);
+        }
+
+        vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type) override
+        {
+            wait();
+            return SyntheticVRSystem::GetHiddenAreaMesh(eEye, type);
+        }
+
+    private:
+
+        void wait() const
+        {
+            if (m_latency.count() > 0) {
+                std::this_thread::sleep_for(m_latency);
+            }
+        }
+
+        const std::chrono::steady_clock::duration   m_latency;
+    };
+
+    //------------------------------------------------------------------------------
+    // The resources VRInitializer produces, created one after the other on the
+    // calling thread.
+    struct SerialResources
+    {
+        uint32_t                                width = 0;
+        uint32_t                                height = 0;
+        VRInitializer::EyeResources             eyes[2];
+        std::unique_ptr<DistortionLUT>          distortion_lut;
+    };
+
+    void initialize_serially(vr::IVRSystem* const system, const VRInitializer::Settings& settings, SerialResources& resources)
+    {
+        system->GetRecommendedRenderTargetSize(&resources.width, &resources.height);
+
+        TrackedDevicePropertyCache property_cache(system);
+
+        for (const vr::TrackedDeviceProperty property : settings.string_properties) {
+            property_cache.get_string(vr::k_unTrackedDeviceIndex_Hmd, property);
+        }
+
+        for (const vr::TrackedDeviceProperty property : settings.float_properties) {
+            property_cache.get_float(vr::k_unTrackedDeviceIndex_Hmd, property);
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            VRInitializer::EyeResources& eye_resources = resources.eyes[eye];
+
+            for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                const vr::HiddenAreaMesh_t mesh = system->GetHiddenAreaMesh(eye, vr::EHiddenAreaMeshType(type));
+                const size_t num_vertices = ((type == vr::k_eHiddenAreaMesh_LineLoop) ? mesh.unTriangleCount : (3 * size_t(mesh.unTriangleCount)));
+
+                eye_resources.hidden_area_meshes[type].vertices.assign(mesh.pVertexData, (mesh.pVertexData + num_vertices));
+                eye_resources.hidden_area_meshes[type].count = mesh.unTriangleCount;
+
+                if (settings.index_meshes && (type != vr::k_eHiddenAreaMesh_LineLoop)) {
+                    MeshProcessing::make_indexed_mesh(mesh, eye_resources.indexed_meshes[type]);
+                }
+            }
+
+            eye_resources.tile_mask = std::make_unique<HiddenAreaTileMask>(eye_resources.hidden_area_meshes[vr::k_eHiddenAreaMesh_Standard].as_hidden_area_mesh(),
+                                                                           resources.width, resources.height, settings.tile_size);
+
+            eye_resources.visible_region = std::make_unique<VisibleRegion>(eye_resources.hidden_area_meshes[vr::k_eHiddenAreaMesh_Inverse].as_hidden_area_mesh(),
+                                                                           vr::k_eHiddenAreaMesh_Inverse, resources.width, resources.height);
+        }
+
+        resources.distortion_lut = std::make_unique<DistortionLUT>(system, settings.distortion_lut_size, settings.distortion_lut_size);
+    }
+
+    bool same_vertices(const std::vector<vr::HmdVector2_t>& a, const std::vector<vr::HmdVector2_t>& b)
+    {
+        return ((a.size() == b.size()) && (a.empty() || (std::memcmp(a.data(), b.data(), (sizeof(vr::HmdVector2_t) * a.size())) == 0)));
+    }
+
+    bool same_resources(const VRInitializer& initializer, const SerialResources& resources)
+    {
+        if ((initializer.render_target_width() != resources.width) || (initializer.render_target_height() != resources.height)) {
+            return false;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const VRInitializer::EyeResources& a = initializer.eye(eye);
+            const VRInitializer::EyeResources& b = resources.eyes[eye];
+
+            for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                if ((a.hidden_area_meshes[type].count != b.hidden_area_meshes[type].count) ||
+                    (not same_vertices(a.hidden_area_meshes[type].vertices, b.hidden_area_meshes[type].vertices)) ||
+                    (not same_vertices(a.indexed_meshes[type].vertices, b.indexed_meshes[type].vertices)) ||
+                    (a.indexed_meshes[type].indices != b.indexed_meshes[type].indices))
+                {
+                    return false;
+                }
+            }
+
+            if ((not a.tile_mask) || (not a.visible_region) ||
+                (a.tile_mask->hidden_tile_bits() != b.tile_mask->hidden_tile_bits()) ||
+                (a.tile_mask->partial_tile_bits() != b.tile_mask->partial_tile_bits()) ||
+                (a.visible_region->num_visible_pixels() != b.visible_region->num_visible_pixels()))
+            {
+                return false;
+            }
+        }
+
+        const DistortionLUT* const lut = initializer.distortion_lut();
+
+        if ((not lut) || (lut->size_in_bytes() != resources.distortion_lut->size_in_bytes())) {
+            return false;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            if (std::memcmp(lut->channel(eye, DistortionLUT::Channel_RedU), resources.distortion_lut->channel(eye, DistortionLUT::Channel_RedU), (lut->size_in_bytes() / 2)) != 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    // The number of tasks that started before one of their dependencies ended.
+    size_t count_order_violations(const TaskGraph& graph)
+    {
+        size_t num_violations = 0;
+
+        for (TaskGraph::task_t task = 0; task < TaskGraph::task_t(graph.num_tasks()); ++task) {
+            for (const TaskGraph::task_t dependency : graph.dependencies(task)) {
+                num_violations += ((graph.timing(task).start_time < graph.timing(dependency).end_time) ? 1 : 0);
+            }
+        }
+
+        return num_violations;
+    }
+
+    //------------------------------------------------------------------------------
+    // A -> B -> C with A throwing and an independent D.
+    bool check_failure_propagation(ThreadPool& pool)
+    {
+        TaskGraph graph;
+        bool ran_dependent = false;
+        bool ran_independent = false;
+        std::exception_ptr completion_exception;
+
+        const TaskGraph::task_t a = graph.add("a", []() { throw std::runtime_error("Invalid a!"); });
+        const TaskGraph::task_t b = graph.add("b", [&]() { ran_dependent = true; }, { a });
+        const TaskGraph::task_t c = graph.add("c", [&]() { ran_dependent = true; }, { b });
+        const TaskGraph::task_t d = graph.add("d", [&]() { ran_independent = true; });
+
+        graph.start(pool, [&](std::exception_ptr exception) { completion_exception = exception; });
+
+        bool rethrown = false;
+
+        try {
+            graph.wait();
+        }
+        catch (const std::runtime_error&) {
+            rethrown = true;
+        }
+
+        bool future_failed = false;
+
+        try {
+            graph.future(c).get();
+        }
+        catch (const std::runtime_error&) {
+            future_failed = true;
+        }
+
+        graph.future(d).get();
+
+        return (rethrown && future_failed && completion_exception && ran_independent && (not ran_dependent) &&
+                graph.timing(b).skipped && graph.timing(c).skipped && (not graph.timing(d).skipped));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const double latency_ms = ((argc > 1) ? std::atof(argv[1]) : 2.0);
+    const size_t num_threads = ((argc > 2) ? size_t(std::atol(argv[2])) : 8);
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 3);
+    const std::string directory = ((argc > 4) ? argv[4] : "/tmp");
+
+    ThreadPool pool(num_threads);
+
+    VRInitializer::Settings settings = VRInitializer::Settings::defaults();
+    settings.distortion_lut_size = DISTORTION_LUT_SIZE;
+
+    size_t num_errors = 0;
+
+    if (not check_failure_propagation(pool)) {
+        std::printf("ERROR: failures are not propagated as expected!\n");
+        ++num_errors;
+    }
+
+    std::printf("Call latency %.2f ms, %zu threads, best of %zu\n", latency_ms, pool.num_threads(), iterations);
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        LatentVRSystem system(profile, (latency_ms / 1000.0));
+
+        SerialResources serial_resources;
+
+        const double serial_seconds = best_seconds_of(iterations, [&]() {
+            serial_resources = SerialResources();
+            initialize_serially(&system, settings, serial_resources);
+        });
+
+        std::unique_ptr<VRInitializer> initializer;
+        std::unique_ptr<VRInitializer> best_initializer;
+        double graph_seconds = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+
+            initializer = std::make_unique<VRInitializer>(&system, settings);
+            initializer->start(pool);
+            initializer->wait();
+
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (seconds < graph_seconds) {
+                graph_seconds = seconds;
+                best_initializer = std::move(initializer);
+            }
+        }
+
+        const TaskGraph& graph = best_initializer->graph();
+
+        std::vector<TaskGraph::task_t> critical_path;
+        const double critical_path_seconds = graph.critical_path_seconds(&critical_path);
+
+        std::printf("%s: serial %.2f ms, graph %.2f ms (%.2fx), %zu tasks, run time %.2f ms, critical path %.2f ms\n",
+                    profile.name.c_str(), (serial_seconds * 1000.0), (graph_seconds * 1000.0), (serial_seconds / graph_seconds),
+                    graph.num_tasks(), (graph.total_run_seconds() * 1000.0), (critical_path_seconds * 1000.0));
+
+        for (TaskGraph::task_t task = 0; task < TaskGraph::task_t(graph.num_tasks()); ++task) {
+            const TaskGraph::Timing& timing = graph.timing(task);
+            const bool is_critical = (std::find(critical_path.begin(), critical_path.end(), task) != critical_path.end());
+
+            std::printf("  %c %-36s ready %7.3f ms, queued %7.3f ms, ran %7.3f ms\n",
+                        (is_critical ? '*' : ' '), graph.name(task).c_str(),
+                        (timing.ready_time * 1000.0), (timing.queue_seconds() * 1000.0), (timing.run_seconds() * 1000.0));
+        }
+
+        if (not same_resources(*best_initializer, serial_resources)) {
+            std::printf("ERROR: %s: resources differ from serial initialization!\n", profile.name.c_str());
+            ++num_errors;
+        }
+
+        if (const size_t num_violations = count_order_violations(graph)) {
+            std::printf("ERROR: %s: %zu tasks started before their dependencies completed!\n", profile.name.c_str(), num_violations);
+            ++num_errors;
+        }
+
+        if ((latency_ms > 0.0) && (pool.num_threads() > 1) && (graph_seconds >= serial_seconds)) {
+            std::printf("ERROR: %s: graph initialization is not faster than serial!\n", profile.name.c_str());
+            ++num_errors;
+        }
+
+        //------------------------------------------------------------------------------
+        // The first run with a calibration cache builds it, the second loads it.
+        VRInitializer::Settings cached_settings = settings;
+        cached_settings.calibration_cache_path = (directory + "/InitializationBenchmark-" + CalibrationCache::file_name(CalibrationKey::query(&system)));
+
+        ::unlink(cached_settings.calibration_cache_path.c_str());
+
+        double cached_seconds[2] = {};
+
+        for (size_t run = 0; run < 2; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+
+            VRInitializer cached_initializer(&system, cached_settings);
+            cached_initializer.start(pool);
+            cached_initializer.wait();
+
+            cached_seconds[run] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            //------------------------------------------------------------------------------
+            // The first run misses (and writes the cache), the second maps it.
+            const CalibrationCache* const cache = cached_initializer.calibration_cache();
+
+            if (((cache != nullptr) != (run == 1)) || (cache && (not cache->is_mapped())) || (not same_resources(cached_initializer, serial_resources))) {
+                std::printf("ERROR: %s: resources differ with a calibration cache!\n", profile.name.c_str());
+                ++num_errors;
+            }
+        }
+
+        ::unlink(cached_settings.calibration_cache_path.c_str());
+
+        std::printf("  calibration cache: miss %.2f ms, hit %.2f ms (%.2fx the graph without cache)\n",
+                    (cached_seconds[0] * 1000.0), (cached_seconds[1] * 1000.0), (cached_seconds[1] / graph_seconds));
+
+        if ((latency_ms > 0.0) && (pool.num_threads() > 1) && (cached_seconds[1] >= graph_seconds)) {
+            std::printf("ERROR: %s: initialization with a calibration cache hit is not faster than without a cache!\n", profile.name.c_str());
+            ++num_errors;
+        }
+    }
+
+    if (num_errors) {
+        std::printf("ERROR: %zu errors!\n", num_errors);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
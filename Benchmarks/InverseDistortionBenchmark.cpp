@@ -0,0 +1,214 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Solves InverseDistortionMaps for all built-in synthetic profiles on one thread
+// and on a thread pool, and checks convergence and round trip error.
+//
+// Usage: InverseDistortionBenchmark [map size] [lut size] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+#include "InverseDistortionMap.h"
+#include "SyntheticVRSystem.h"
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    bool tables_equal(const InverseDistortionMap& a, const InverseDistortionMap& b)
+    {
+        const size_t plane_size = (a.width() * a.height());
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+                const InverseDistortionMap::Channel channel = InverseDistortionMap::Channel(c);
+
+                if (std::memcmp(a.channel(eye, channel), b.channel(eye, channel), (sizeof(float) * plane_size)) != 0) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    // Random display UVs through ComputeDistortion() and back through the green
+    // channel of the map. Returns the maximum error in display UV, skipping render
+    // target UVs next to unconverged samples.
+    float round_trip_error(vr::IVRSystem* const system, const InverseDistortionMap& map, vr::EVREye eye, size_t count)
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+        float max_error = 0.0f;
+
+        for (size_t i = 0; i < count; ++i) {
+            const float u = distribution(generator);
+            const float v = distribution(generator);
+
+            vr::DistortionCoordinates_t xy;
+
+            if (not system->ComputeDistortion(eye, u, v, &xy)) {
+                continue;
+            }
+
+            if ((xy.rfGreen[0] < 0.0f) || (xy.rfGreen[0] > 1.0f) || (xy.rfGreen[1] < 0.0f) || (xy.rfGreen[1] > 1.0f)) {
+                continue;
+            }
+
+            const vr::DistortionCoordinates_t uv = map.lookup(eye, xy.rfGreen[0], xy.rfGreen[1]);
+
+            const float fx = (xy.rfGreen[0] * float(map.width() - 1));
+            const float fy = (xy.rfGreen[1] * float(map.height() - 1));
+            const size_t x0 = std::min(size_t(fx), (map.width() - 2));
+            const size_t y0 = std::min(size_t(fy), (map.height() - 2));
+            const float* const plane = map.channel(eye, DistortionLUT::Channel_GreenU);
+            const size_t index = ((y0 * map.width()) + x0);
+
+            if ((plane[index] < 0.0f) || (plane[index + 1] < 0.0f) ||
+                (plane[index + map.width()] < 0.0f) || (plane[index + map.width() + 1] < 0.0f))
+            {
+                continue;
+            }
+
+            max_error = std::max(max_error, std::hypot((uv.rfGreen[0] - u), (uv.rfGreen[1] - v)));
+        }
+
+        return max_error;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t map_size = ((argc > 1) ? size_t(std::atol(argv[1])) : 512);
+    const size_t lut_size = ((argc > 2) ? size_t(std::atol(argv[2])) : 513);
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 3);
+
+    ThreadPool pool;
+
+    std::printf("Map: %zu x %zu, forward LUT: %zu x %zu, threads: %zu, batch kernel: %s, best of %zu\n",
+                map_size, map_size, lut_size, lut_size, pool.num_threads(), DistortionLUT::batch_kernel_name(), iterations);
+
+    int status = EXIT_SUCCESS;
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+        const DistortionLUT forward(&system, lut_size, lut_size, &pool);
+
+        std::unique_ptr<InverseDistortionMap> single;
+        std::unique_ptr<InverseDistortionMap> pooled;
+
+        const double single_seconds = best_seconds_of(iterations, [&]() {
+            single.reset(new InverseDistortionMap(forward, map_size, map_size));
+        });
+
+        const double pooled_seconds = best_seconds_of(iterations, [&]() {
+            pooled.reset(new InverseDistortionMap(forward, map_size, map_size, &pool));
+        });
+
+        std::printf("%-12s single: %8.2f ms, pool: %7.2f ms (%.2fx)\n",
+                    profile.name.c_str(), (single_seconds * 1000.0), (pooled_seconds * 1000.0), (single_seconds / pooled_seconds));
+
+        if (not tables_equal(*single, *pooled)) {
+            std::printf("ERROR: %s: single threaded and pooled results differ!\n", profile.name.c_str());
+            status = EXIT_FAILURE;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const InverseDistortionMap::Statistics& statistics = pooled->statistics(eye);
+            const InverseDistortionMap::ErrorReport report = pooled->compute_error_report(&system, eye, 4);
+            const float round_trip = round_trip_error(&system, *pooled, eye, 100000);
+
+            const double converged = (double(statistics.num_converged) / double(statistics.num_samples));
+
+            std::printf("    eye %d: converged %6.2f %%, iterations mean %.2f max %u, residual %.2e, "
+                        "error max %.2e mean %.2e (%.3f px), round trip %.2e\n",
+                        int(eye), (converged * 100.0), statistics.mean_iterations, statistics.max_iterations,
+                        double(statistics.max_residual), double(report.max_error), double(report.mean_error),
+                        double(report.max_error * float(map_size)), double(round_trip));
+
+            if (converged < 0.5) {
+                std::printf("ERROR: %s: only %.2f %% of samples converged!\n", profile.name.c_str(), (converged * 100.0));
+                status = EXIT_FAILURE;
+            }
+
+            if ((report.max_error * float(map_size)) > 0.1f) {
+                std::printf("ERROR: %s: converged samples are off by more than 0.1 px!\n", profile.name.c_str());
+                status = EXIT_FAILURE;
+            }
+
+            if (round_trip > 1.0e-3f) {
+                std::printf("ERROR: %s: round trip error %g exceeds 1e-3!\n", profile.name.c_str(), double(round_trip));
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,152 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares MatrixUtils::simd_from_hmd_matrix() against an element-wise
+// transposition, e.g. for converting the poses of all tracked devices per frame.
+//
+// Usage: MatrixBenchmark [matrix count] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // Element-wise references. The last row of a 3x4 matrix is (0, 0, 0, 1).
+    __attribute__((noinline)) void reference_from_hmd_matrix(const vr::HmdMatrix34_t& m, float* const columns)
+    {
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                columns[(c * 4) + r] = ((r < 3) ? m.m[r][c] : ((c == 3) ? 1.0f : 0.0f));
+            }
+        }
+    }
+
+    __attribute__((noinline)) void reference_from_hmd_matrix(const vr::HmdMatrix44_t& m, float* const columns)
+    {
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                columns[(c * 4) + r] = m.m[r][c];
+            }
+        }
+    }
+
+    template <typename Matrix>
+    bool run(const char* const name, size_t count, size_t iterations, std::mt19937& generator)
+    {
+        std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+        std::vector<Matrix> input(count);
+
+        for (Matrix& m : input) {
+            float* const values = &m.m[0][0];
+
+            for (size_t i = 0; i < (sizeof(m.m) / sizeof(float)); ++i) {
+                values[i] = distribution(generator);
+            }
+        }
+
+        std::vector<float> reference(count * 16);
+        std::vector<simd_float4x4> output(count);
+
+        const double reference_seconds = best_seconds_of(iterations, [&]() {
+            for (size_t i = 0; i < count; ++i) {
+                reference_from_hmd_matrix(input[i], &reference[i * 16]);
+            }
+        });
+
+        const double simd_seconds = best_seconds_of(iterations, [&]() {
+            for (size_t i = 0; i < count; ++i) {
+                output[i] = MatrixUtils::simd_from_hmd_matrix(input[i]);
+            }
+        });
+
+        const bool is_equal = (std::memcmp(output.data(), reference.data(), (sizeof(float) * reference.size())) == 0);
+
+        std::printf("%s: element-wise %8.3f ms, MatrixUtils %8.3f ms (%.2fx), %s\n",
+                    name, (reference_seconds * 1000.0), (simd_seconds * 1000.0),
+                    (reference_seconds / simd_seconds), (is_equal ? "equal" : "DIFFERENT"));
+
+        return is_equal;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t count = ((argc > 1) ? size_t(std::atol(argv[1])) : 1000000);
+    const size_t iterations = ((argc > 2) ? size_t(std::atol(argv[2])) : 5);
+
+    std::mt19937 generator(1);
+    std::printf("Matrices: %zu, best of %zu\n", count, iterations);
+
+    const bool is_equal_34 = run<vr::HmdMatrix34_t>("HmdMatrix34_t", count, iterations, generator);
+    const bool is_equal_44 = run<vr::HmdMatrix44_t>("HmdMatrix44_t", count, iterations, generator);
+
+    return ((is_equal_34 && is_equal_44) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
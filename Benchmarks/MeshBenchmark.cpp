@@ -0,0 +1,204 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Times the hidden area mesh processing stages (indexing, simplification, tile
+// mask, visible region) on the hidden area meshes of the built-in synthetic
+// profiles and checks their results against each other.
+//
+// Usage: MeshBenchmark [iterations] [simplification tolerance in pixels]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+#include "MeshProcessing.h"
+#include "MeshSimplification.h"
+#include "SyntheticVRSystem.h"
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    void print_result(const char* const stage, double seconds, const char* const details)
+    {
+        std::printf("  %-16s %9.3f ms  %s\n", stage, (seconds * 1000.0), details);
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t iterations = ((argc > 1) ? size_t(std::atol(argv[1])) : 10);
+    const float tolerance_in_pixels = ((argc > 2) ? float(std::atof(argv[2])) : 1.0f);
+
+    size_t num_errors = 0;
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        const uint32_t width = profile.render_target_width;
+        const uint32_t height = profile.render_target_height;
+        const vr::HiddenAreaMesh_t mesh = system.GetHiddenAreaMesh(vr::Eye_Left, vr::k_eHiddenAreaMesh_Standard);
+
+        std::printf("%s (%u x %u, %u triangles)\n", profile.name.c_str(), width, height, mesh.unTriangleCount);
+
+        char details[256];
+
+        //------------------------------------------------------------------------------
+        // Indexing.
+        IndexedMesh indexed_mesh;
+        MeshProcessing::Statistics indexing_statistics;
+
+        const double indexing_seconds = best_seconds_of(iterations, [&]() {
+            MeshProcessing::make_indexed_mesh(mesh, indexed_mesh, 16, &indexing_statistics);
+        });
+
+        std::snprintf(details, sizeof(details), "%zu vertices, %zu indices, ACMR %.2f -> %.2f",
+                      indexing_statistics.num_vertices, indexed_mesh.indices.size(),
+                      double(indexing_statistics.acmr_before), double(indexing_statistics.acmr_after));
+        print_result("Indexing", indexing_seconds, details);
+
+        //------------------------------------------------------------------------------
+        // Simplification.
+        const float tolerance = (tolerance_in_pixels / float(std::max(width, height)));
+
+        HiddenAreaMeshData simplified;
+        MeshSimplification::Statistics simplification_statistics;
+
+        const double simplification_seconds = best_seconds_of(iterations, [&]() {
+            simplified = MeshSimplification::simplify(mesh, vr::k_eHiddenAreaMesh_Standard, tolerance, &simplification_statistics);
+        });
+
+        std::snprintf(details, sizeof(details), "%zu -> %zu triangles, max error %.2f px",
+                      simplification_statistics.num_input_primitives, simplification_statistics.num_output_primitives,
+                      (double(simplification_statistics.max_error) * double(std::max(width, height))));
+        print_result("Simplification", simplification_seconds, details);
+
+        //------------------------------------------------------------------------------
+        // Tile mask.
+        const double tile_mask_seconds = best_seconds_of(iterations, [&]() {
+            HiddenAreaTileMask(mesh, width, height, 16);
+        });
+
+        const HiddenAreaTileMask tile_mask(mesh, width, height, 16);
+
+        std::snprintf(details, sizeof(details), "%zu hidden, %zu partial of %u tiles (%s)",
+                      tile_mask.hidden_tiles().size(), tile_mask.partial_tiles().size(), tile_mask.num_tiles(),
+                      HiddenAreaTileMask::rasterizer_kernel_name());
+        print_result("Tile mask", tile_mask_seconds, details);
+
+        //------------------------------------------------------------------------------
+        // Visible region.
+        const vr::HiddenAreaMesh_t inverse_mesh = system.GetHiddenAreaMesh(vr::Eye_Left, vr::k_eHiddenAreaMesh_Inverse);
+
+        const double visible_region_seconds = best_seconds_of(iterations, [&]() {
+            VisibleRegion(inverse_mesh, vr::k_eHiddenAreaMesh_Inverse, width, height);
+        });
+
+        const VisibleRegion visible_region(inverse_mesh, vr::k_eHiddenAreaMesh_Inverse, width, height);
+        const PixelRect bounds = visible_region.bounds();
+
+        std::snprintf(details, sizeof(details), "%zu visible pixels, bounds %u x %u",
+                      visible_region.num_visible_pixels(), bounds.width, bounds.height);
+        print_result("Visible region", visible_region_seconds, details);
+
+        //------------------------------------------------------------------------------
+        // Checks: the Standard and Inverse meshes partition the frame, and the
+        // simplified mesh hides no pixel the original leaves visible.
+        if ((tile_mask.num_hidden_pixels() + visible_region.num_visible_pixels()) != (size_t(width) * size_t(height))) {
+            std::printf("  ERROR: hidden and visible pixels do not add up\n");
+            ++num_errors;
+        }
+
+        //------------------------------------------------------------------------------
+        // Texture bounds must be valid for the compositor: within [0, 1], min < max.
+        for (const PixelRect& rect : { bounds, PixelRect{ 0, 0, width, height } }) {
+            const vr::VRTextureBounds_t texture_bounds = visible_region.texture_bounds(rect);
+
+            if (not ((texture_bounds.uMin >= 0.0f) && (texture_bounds.uMin < texture_bounds.uMax) && (texture_bounds.uMax <= 1.0f) &&
+                     (texture_bounds.vMin >= 0.0f) && (texture_bounds.vMin < texture_bounds.vMax) && (texture_bounds.vMax <= 1.0f)))
+            {
+                std::printf("  ERROR: invalid texture bounds\n");
+                ++num_errors;
+            }
+        }
+
+        std::vector<uint64_t> original_coverage;
+        std::vector<uint64_t> simplified_coverage;
+        HiddenAreaTileMask::rasterize_coverage(mesh, width, height, original_coverage);
+        HiddenAreaTileMask::rasterize_coverage(simplified.as_hidden_area_mesh(), width, height, simplified_coverage);
+
+        size_t num_violations = 0;
+
+        for (size_t i = 0; i < original_coverage.size(); ++i) {
+            num_violations += size_t(__builtin_popcountll(simplified_coverage[i] & ~original_coverage[i]));
+        }
+
+        if (num_violations != 0) {
+            std::printf("  ERROR: simplified mesh hides %zu visible pixels\n", num_violations);
+            ++num_errors;
+        }
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,242 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Plans MultiResLayouts for both eyes of all built-in synthetic profiles at a few
+// quality tolerances and reports the shaded pixel savings. Checks that the
+// regions tile the render target and the packed texture, that map_to_texture()
+// is monotonic, and that an independent, finer sampling of the distortion
+// never needs more density than the layout provides (beyond the tolerance).
+//
+// Usage: MultiResBenchmark [samples]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MultiResLayout.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_CHECK_SAMPLES = 301;       // Not a multiple of the planner's grid
+    constexpr float CHECK_SLACK = 0.02f;            // Relative, for the finite differences
+
+    bool check_tiling(const MultiResLayout& layout)
+    {
+        size_t source_area = 0;
+        size_t texture_area = 0;
+
+        for (const MultiResLayout::Region& region : layout.regions()) {
+            if (((region.rect.x + region.rect.width) > layout.texture_width()) ||
+                ((region.rect.y + region.rect.height) > layout.texture_height()) ||
+                ((region.source.x + region.source.width) > layout.width()) ||
+                ((region.source.y + region.source.height) > layout.height()))
+            {
+                return false;
+            }
+
+            source_area += region.source.area();
+            texture_area += region.rect.area();
+        }
+
+        return ((source_area == layout.num_pixels()) && (texture_area == layout.num_shaded_pixels()));
+    }
+
+    bool check_mapping(const MultiResLayout& layout)
+    {
+        float previous_u = -1.0f;
+        float previous_v = -1.0f;
+
+        for (size_t i = 0; i <= 1000; ++i) {
+            const float t = (float(i) / 1000.0f);
+            float u = 0.0f, v = 0.0f;
+
+            layout.map_to_texture(t, t, u, v);
+
+            if ((u < previous_u) || (v < previous_v) || (u < 0.0f) || (u > 1.0f) || (v < 0.0f) || (v > 1.0f)) {
+                return false;
+            }
+
+            previous_u = u;
+            previous_v = v;
+        }
+
+        return ((previous_u == 1.0f) && (previous_v == 1.0f));
+    }
+
+    //------------------------------------------------------------------------------
+    // The number of check cells whose needed density (normalized by the densest
+    // check cell) exceeds the scale of the region they map to.
+    size_t count_undersampled(vr::IVRSystem* const system, vr::EVREye eye, const MultiResLayout& layout, float tolerance, float min_scale)
+    {
+        const size_t n = NUM_CHECK_SAMPLES;
+        const double w = layout.width();
+        const double h = layout.height();
+
+        struct Cell { double x, y, needed_x, needed_y; };
+        std::vector<Cell> cells;
+        double max_x = 0.0, max_y = 0.0;
+
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t i = 0; i < n; ++i) {
+                const float u = (float(i) / float(n));
+                const float v = (float(j) / float(n));
+                const float step = (1.0f / float(n));
+
+                vr::DistortionCoordinates_t p, pu, pv;
+                system->ComputeDistortion(eye, u, v, &p);
+                system->ComputeDistortion(eye, (u + step), v, &pu);
+                system->ComputeDistortion(eye, u, (v + step), &pv);
+
+                const double a = (pu.rfGreen[0] - p.rfGreen[0]);
+                const double b = (pv.rfGreen[0] - p.rfGreen[0]);
+                const double c = (pu.rfGreen[1] - p.rfGreen[1]);
+                const double d = (pv.rfGreen[1] - p.rfGreen[1]);
+                const double determinant = std::fabs((a * d) - (b * c));
+
+                Cell cell;
+                cell.x = p.rfGreen[0];
+                cell.y = p.rfGreen[1];
+                cell.needed_x = (std::hypot((d * w), (c * h)) / determinant);
+                cell.needed_y = (std::hypot((b * w), (a * h)) / determinant);
+
+                if ((cell.x < 0.0) || (cell.x >= 1.0) || (cell.y < 0.0) || (cell.y >= 1.0)) {
+                    continue;
+                }
+
+                max_x = std::max(max_x, cell.needed_x);
+                max_y = std::max(max_y, cell.needed_y);
+                cells.push_back(cell);
+            }
+        }
+
+        size_t num_undersampled = 0;
+
+        for (const Cell& cell : cells) {
+            const uint32_t x = uint32_t(cell.x * w);
+            const uint32_t y = uint32_t(cell.y * h);
+
+            for (const MultiResLayout::Region& region : layout.regions()) {
+                if ((x < region.source.x) || (x >= (region.source.x + region.source.width)) ||
+                    (y < region.source.y) || (y >= (region.source.y + region.source.height)))
+                {
+                    continue;
+                }
+
+                const double required_x = std::min(std::max((cell.needed_x / max_x * (1.0 - tolerance)), double(min_scale)), 1.0);
+                const double required_y = std::min(std::max((cell.needed_y / max_y * (1.0 - tolerance)), double(min_scale)), 1.0);
+
+                if ((region.scale_x < (required_x * (1.0 - CHECK_SLACK))) || (region.scale_y < (required_y * (1.0 - CHECK_SLACK)))) {
+                    ++num_undersampled;
+                }
+            }
+        }
+
+        return num_undersampled;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t num_samples = ((argc > 1) ? uint32_t(std::atol(argv[1])) : 128);
+    const float min_scale = 0.25f;
+
+    size_t num_errors = 0;
+
+    std::printf("%-12s %-9s %-6s %-13s %-13s %-22s %-9s %s\n",
+                "Profile", "Tolerance", "Eye", "Full", "Packed", "Edge scales (x, y)", "Savings", "Time");
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        uint32_t width = 0, height = 0;
+        system.GetRecommendedRenderTargetSize(&width, &height);
+
+        for (const float tolerance : { 0.0f, 0.1f, 0.25f }) {
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                const auto start = std::chrono::steady_clock::now();
+                const MultiResLayout layout(&system, eye, width, height, tolerance, min_scale, num_samples);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                const MultiResLayout::Region& left = layout.regions()[3];
+                const MultiResLayout::Region& right = layout.regions()[5];
+                const MultiResLayout::Region& top = layout.regions()[1];
+                const MultiResLayout::Region& bottom = layout.regions()[7];
+
+                char full[32], packed[32], scales[64];
+                std::snprintf(full, sizeof(full), "%ux%u", layout.width(), layout.height());
+                std::snprintf(packed, sizeof(packed), "%ux%u", layout.texture_width(), layout.texture_height());
+                std::snprintf(scales, sizeof(scales), "%.2f/%.2f, %.2f/%.2f",
+                              double(left.scale_x), double(right.scale_x), double(top.scale_y), double(bottom.scale_y));
+
+                std::printf("%-12s %-9.2f %-6s %-13s %-13s %-22s %6.1f%%   %.2f ms\n",
+                            profile.name.c_str(), double(tolerance), ((eye == vr::Eye_Left) ? "left" : "right"), full, packed, scales,
+                            (100.0 * (1.0 - (double(layout.num_shaded_pixels()) / double(layout.num_pixels())))), (seconds * 1.0e3));
+
+                if (not check_tiling(layout)) {
+                    std::printf("ERROR: regions do not tile the render target/texture\n");
+                    ++num_errors;
+                }
+
+                if (not check_mapping(layout)) {
+                    std::printf("ERROR: map_to_texture() not monotonic or not onto [0, 1]\n");
+                    ++num_errors;
+                }
+
+                const size_t num_undersampled = count_undersampled(&system, eye, layout, tolerance, min_scale);
+
+                if (num_undersampled != 0) {
+                    std::printf("ERROR: %zu check samples undersampled\n", num_undersampled);
+                    ++num_errors;
+                }
+            }
+        }
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
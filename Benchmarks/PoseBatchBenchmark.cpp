@@ -0,0 +1,227 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares PoseBatch::convert() against the scalar reference and against
+// converting each pose with MatrixUtils::simd_from_hmd_matrix(), and checks the
+// extracted orientations against the quaternions the poses were built from
+// (including rotations close to 180 degrees).
+//
+// Usage: PoseBatchBenchmark [iterations] [valid pose percentage]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+#include "PoseBatch.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // A pose with the given orientation (unit quaternion w, x, y, z).
+    vr::TrackedDevicePose_t make_pose(const double q[4], std::mt19937& generator, bool is_valid)
+    {
+        std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+
+        const double w = q[0], x = q[1], y = q[2], z = q[3];
+        const double r[3][3] = {
+            { (1.0 - (2.0 * ((y * y) + (z * z)))), (2.0 * ((x * y) - (z * w))), (2.0 * ((x * z) + (y * w))) },
+            { (2.0 * ((x * y) + (z * w))), (1.0 - (2.0 * ((x * x) + (z * z)))), (2.0 * ((y * z) - (x * w))) },
+            { (2.0 * ((x * z) - (y * w))), (2.0 * ((y * z) + (x * w))), (1.0 - (2.0 * ((x * x) + (y * y)))) },
+        };
+
+        vr::TrackedDevicePose_t pose;
+        std::memset(&pose, 0, sizeof(pose));
+
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t column = 0; column < 3; ++column) {
+                pose.mDeviceToAbsoluteTracking.m[row][column] = float(r[row][column]);
+            }
+
+            pose.mDeviceToAbsoluteTracking.m[row][3] = distribution(generator);
+            pose.vVelocity.v[row] = distribution(generator);
+            pose.vAngularVelocity.v[row] = distribution(generator);
+        }
+
+        pose.eTrackingResult = vr::TrackingResult_Running_OK;
+        pose.bPoseIsValid = is_valid;
+        pose.bDeviceIsConnected = true;
+
+        return pose;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t iterations = ((argc > 1) ? size_t(std::atol(argv[1])) : 100000);
+    const double valid_percentage = ((argc > 2) ? std::atof(argv[2]) : 25.0);
+
+    constexpr size_t COUNT = PoseBlock::CAPACITY;
+
+    //------------------------------------------------------------------------------
+    // Random orientations, every fourth one a rotation by nearly 180 degrees (w
+    // close to 0) where extracting via the trace alone is inaccurate.
+    std::mt19937 generator(1);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 100.0);
+
+    vr::TrackedDevicePose_t poses[COUNT];
+    double orientations[COUNT][4];
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        double* const q = orientations[i];
+
+        for (size_t k = 0; k < 4; ++k) {
+            q[k] = normal(generator);
+        }
+
+        if ((i % 4) == 3) {
+            q[0] = 1.0e-4;
+        }
+
+        const double length = std::sqrt((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+
+        for (size_t k = 0; k < 4; ++k) {
+            q[k] /= ((q[0] < 0.0) ? -length : length);
+        }
+
+        poses[i] = make_pose(q, generator, ((i == 0) || (uniform(generator) < valid_percentage)));
+    }
+
+    //------------------------------------------------------------------------------
+    // Timing.
+    std::unique_ptr<PoseBlock> block(new PoseBlock());
+    std::unique_ptr<PoseBlock> reference(new PoseBlock());
+    std::unique_ptr<simd_float4x4[]> matrices(new simd_float4x4[COUNT]);
+
+    const double batch_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            PoseBatch::convert(poses, COUNT, *block);
+        }
+    });
+
+    const double scalar_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            PoseBatch::convert_scalar(poses, COUNT, *reference);
+        }
+    });
+
+    const double per_pose_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            for (size_t p = 0; p < COUNT; ++p) {
+                if (poses[p].bPoseIsValid) {
+                    matrices[p] = MatrixUtils::simd_from_hmd_matrix(poses[p].mDeviceToAbsoluteTracking);
+                }
+            }
+        }
+    });
+
+    //------------------------------------------------------------------------------
+    // Checks.
+    size_t num_errors = 0;
+
+    if (std::memcmp(block.get(), reference.get(), sizeof(PoseBlock)) != 0) {
+        std::printf("ERROR: %s and scalar results differ\n", PoseBatch::kernel_name());
+        ++num_errors;
+    }
+
+    double max_orientation_error = 0.0;
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        if (block->is_valid(i)) {
+            const simd_float4x4 expected = MatrixUtils::simd_from_hmd_matrix(poses[i].mDeviceToAbsoluteTracking);
+            const simd_float4x4 actual = block->matrix(i);
+
+            if (std::memcmp(&expected, &actual, sizeof(expected)) != 0) {
+                std::printf("ERROR: matrix %zu differs\n", i);
+                ++num_errors;
+            }
+
+            for (size_t k = 0; k < 4; ++k) {
+                max_orientation_error = std::max(max_orientation_error, std::fabs(double(block->orientation[k][i]) - orientations[i][k]));
+            }
+        }
+        else if ((block->orientation[0][i] != 1.0f) || (block->position[0][i] != 0.0f) || (block->rotation[4][i] != 1.0f)) {
+            std::printf("ERROR: invalid pose %zu is not the identity\n", i);
+            ++num_errors;
+        }
+    }
+
+    if (max_orientation_error > 1.0e-5) {
+        std::printf("ERROR: orientation error %g\n", max_orientation_error);
+        ++num_errors;
+    }
+
+    const double num_conversions = (double(iterations) * double(COUNT));
+
+    std::printf("Poses: %zu (%d valid), iterations: %zu\n", COUNT, __builtin_popcountll(block->valid_mask), iterations);
+    std::printf("%-8s %8.2f ns/pose\n", PoseBatch::kernel_name(), (batch_seconds / num_conversions * 1.0e9));
+    std::printf("Scalar   %8.2f ns/pose\n", (scalar_seconds / num_conversions * 1.0e9));
+    std::printf("Per pose %8.2f ns/pose (matrix only)\n", (per_pose_seconds / num_conversions * 1.0e9));
+    std::printf("Max orientation error: %g\n", max_orientation_error);
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,333 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Pushes poses of devices moving on known trajectories (constant rotation and
+// circular motion) from a producer thread while reader threads sample them at
+// random times around the newest pose, and checks interpolated and extrapolated
+// poses against the trajectories. Also times the producer and reader paths on a
+// single thread against reading the latest pose under a mutex.
+//
+// Usage: PoseHistoryBenchmark [frames] [readers]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PoseHistory.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_DEVICES = 4;
+    constexpr double FRAME_INTERVAL = 0.001;
+    constexpr double ANGULAR_SPEED = 3.0;           // Radians per second
+    constexpr double RADIUS = 1.0;                  // Meters
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // Device d rotates about a fixed axis and moves on a horizontal circle.
+    void trajectory(size_t device, double t, double orientation[4], double position[3], double velocity[3], double angular_velocity[3])
+    {
+        const double axis_length = std::sqrt(1.0 + double(device * device) + 4.0);
+        const double axis[3] = { (1.0 / axis_length), (double(device) / axis_length), (2.0 / axis_length) };
+        const double half_angle = (0.5 * ANGULAR_SPEED * t);
+
+        orientation[0] = std::cos(half_angle);
+
+        for (size_t k = 0; k < 3; ++k) {
+            orientation[k + 1] = (axis[k] * std::sin(half_angle));
+            angular_velocity[k] = (axis[k] * ANGULAR_SPEED);
+        }
+
+        if (orientation[0] < 0.0) {
+            for (size_t k = 0; k < 4; ++k) {
+                orientation[k] = -orientation[k];
+            }
+        }
+
+        position[0] = (RADIUS * std::cos(t));
+        position[1] = (1.0 + double(device));
+        position[2] = (RADIUS * std::sin(t));
+        velocity[0] = (-RADIUS * std::sin(t));
+        velocity[1] = 0.0;
+        velocity[2] = (RADIUS * std::cos(t));
+    }
+
+    vr::TrackedDevicePose_t make_pose(size_t device, double t)
+    {
+        double q[4], p[3], v[3], w[3];
+        trajectory(device, t, q, p, v, w);
+
+        const float orientation[4] = { float(q[0]), float(q[1]), float(q[2]), float(q[3]) };
+        const float position[3] = { float(p[0]), float(p[1]), float(p[2]) };
+        const simd_float4x4 m = MatrixUtils::rigid_transform(orientation, position);
+
+        vr::TrackedDevicePose_t pose;
+        std::memset(&pose, 0, sizeof(pose));
+
+        for (size_t row = 0; row < 3; ++row) {
+            for (size_t column = 0; column < 4; ++column) {
+                pose.mDeviceToAbsoluteTracking.m[row][column] = m.columns[column][row];
+            }
+
+            pose.vVelocity.v[row] = float(v[row]);
+            pose.vAngularVelocity.v[row] = float(w[row]);
+        }
+
+        pose.eTrackingResult = vr::TrackingResult_Running_OK;
+        pose.bPoseIsValid = true;
+        pose.bDeviceIsConnected = true;
+
+        return pose;
+    }
+
+    //------------------------------------------------------------------------------
+    // Position (meters) and orientation (radians) errors of a sample.
+    void sample_errors(size_t device, const PoseHistory::Sample& sample, double& position_error, double& orientation_error)
+    {
+        double q[4], p[3], v[3], w[3];
+        trajectory(device, sample.timestamp, q, p, v, w);
+
+        position_error = 0.0;
+
+        for (size_t k = 0; k < 3; ++k) {
+            position_error = std::max(position_error, std::fabs(double(sample.position[k]) - p[k]));
+        }
+
+        //------------------------------------------------------------------------------
+        // The distance d between unit quaternions is 2 sin(angle / 4), which unlike
+        // the dot product stays accurate for small angles.
+        double cosine = 0.0;
+
+        for (size_t k = 0; k < 4; ++k) {
+            cosine += (double(sample.orientation[k]) * q[k]);
+        }
+
+        double distance = 0.0;
+
+        for (size_t k = 0; k < 4; ++k) {
+            const double d = (double(sample.orientation[k]) - ((cosine < 0.0) ? -q[k] : q[k]));
+            distance += (d * d);
+        }
+
+        orientation_error = (4.0 * std::asin(std::min(1.0, (0.5 * std::sqrt(distance)))));
+    }
+
+    struct ReaderStatistics
+    {
+        size_t      num_samples[PoseHistory::Status_Clamped + 1] = {};
+        double      max_position_error = 0.0;
+        double      max_orientation_error = 0.0;
+    };
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_frames = ((argc > 1) ? size_t(std::atol(argv[1])) : 200000);
+    const size_t num_readers = ((argc > 2) ? size_t(std::atol(argv[2])) : 3);
+
+    size_t num_errors = 0;
+
+    //------------------------------------------------------------------------------
+    // Concurrent producer and readers.
+    PoseHistory history(64, 0.02);
+    std::atomic<bool> done(false);
+    std::vector<ReaderStatistics> statistics(num_readers);
+    std::vector<std::thread> readers;
+
+    for (size_t r = 0; r < num_readers; ++r) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 generator(uint32_t(r + 1));
+            std::uniform_real_distribution<double> offset(-0.05, 0.01);
+            ReaderStatistics& s = statistics[r];
+
+            while (not done.load(std::memory_order_acquire)) {
+                const size_t device = (generator() % NUM_DEVICES);
+                PoseHistory::Sample latest;
+
+                if (not history.latest(vr::TrackedDeviceIndex_t(device), latest)) {
+                    continue;
+                }
+
+                PoseHistory::Sample sample;
+                const PoseHistory::Status status = history.sample(vr::TrackedDeviceIndex_t(device), (latest.timestamp + offset(generator)), sample);
+
+                ++s.num_samples[status];
+
+                if ((status == PoseHistory::Status_Exact) || (status == PoseHistory::Status_Interpolated) || (status == PoseHistory::Status_Extrapolated)) {
+                    double position_error, orientation_error;
+                    sample_errors(device, sample, position_error, orientation_error);
+
+                    s.max_position_error = std::max(s.max_position_error, position_error);
+                    s.max_orientation_error = std::max(s.max_orientation_error, orientation_error);
+                }
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        vr::TrackedDevicePose_t poses[NUM_DEVICES];
+
+        for (size_t device = 0; device < NUM_DEVICES; ++device) {
+            poses[device] = make_pose(device, (double(frame) * FRAME_INTERVAL));
+        }
+
+        history.push((double(frame) * FRAME_INTERVAL), poses, NUM_DEVICES);
+
+        if ((frame % 256) == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    const double producer_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    done.store(true, std::memory_order_release);
+
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    ReaderStatistics total;
+
+    for (const ReaderStatistics& s : statistics) {
+        for (size_t k = 0; k <= PoseHistory::Status_Clamped; ++k) {
+            total.num_samples[k] += s.num_samples[k];
+        }
+
+        total.max_position_error = std::max(total.max_position_error, s.max_position_error);
+        total.max_orientation_error = std::max(total.max_orientation_error, s.max_orientation_error);
+    }
+
+    std::printf("Frames: %zu (%.2f us/frame including pose generation), readers: %zu\n", num_frames, (producer_seconds / double(num_frames) * 1.0e6), num_readers);
+    std::printf("Samples: %zu exact, %zu interpolated, %zu extrapolated, %zu clamped, %zu none\n",
+                total.num_samples[PoseHistory::Status_Exact], total.num_samples[PoseHistory::Status_Interpolated],
+                total.num_samples[PoseHistory::Status_Extrapolated], total.num_samples[PoseHistory::Status_Clamped],
+                total.num_samples[PoseHistory::Status_None]);
+    std::printf("Max error: position %g m, orientation %g rad\n", total.max_position_error, total.max_orientation_error);
+
+    if ((total.max_position_error > 1.0e-3) || (total.max_orientation_error > 1.0e-3)) {
+        std::printf("ERROR: sampled poses deviate from the trajectories\n");
+        ++num_errors;
+    }
+
+    //------------------------------------------------------------------------------
+    // Single thread timing and edge cases.
+    const size_t iterations = 100000;
+    const double newest = (double(num_frames - 1) * FRAME_INTERVAL);
+
+    PoseHistory::Sample sample;
+    simd_float4x4 matrix;
+    double sink = 0.0;
+
+    const double interpolate_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            history.sample(0, (newest - (0.0005 + (0.03 * double(i % 64) / 64.0))), matrix);
+            sink += double(matrix.columns[3][0]);
+        }
+    });
+
+    const double extrapolate_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            history.sample(0, (newest + (0.01 * double(i % 64) / 64.0) + 0.0001), matrix);
+            sink += double(matrix.columns[3][0]);
+        }
+    });
+
+    std::mutex mutex;
+    vr::TrackedDevicePose_t shared_pose = make_pose(0, newest);
+
+    const double mutex_seconds = best_seconds_of(5, [&]() {
+        for (size_t i = 0; i < iterations; ++i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            matrix = MatrixUtils::simd_from_hmd_matrix(shared_pose.mDeviceToAbsoluteTracking);
+            sink += double(matrix.columns[3][0]);
+        }
+    });
+
+    std::printf("Interpolate  %8.2f ns\n", (interpolate_seconds / double(iterations) * 1.0e9));
+    std::printf("Extrapolate  %8.2f ns\n", (extrapolate_seconds / double(iterations) * 1.0e9));
+    std::printf("Mutex latest %8.2f ns (uncontended, no interpolation)\n", (mutex_seconds / double(iterations) * 1.0e9));
+
+    if (history.sample(0, (newest + 1.0), sample) != PoseHistory::Status_Clamped) {
+        std::printf("ERROR: extrapolation not limited\n");
+        ++num_errors;
+    }
+
+    if (history.sample(0, 0.0, sample) != PoseHistory::Status_Clamped) {
+        std::printf("ERROR: sample before the oldest pose not clamped\n");
+        ++num_errors;
+    }
+
+    if (history.sample(NUM_DEVICES, newest, sample) != PoseHistory::Status_None) {
+        std::printf("ERROR: sample of a device without poses\n");
+        ++num_errors;
+    }
+
+    return ((num_errors == 0) && (sink != HUGE_VAL) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
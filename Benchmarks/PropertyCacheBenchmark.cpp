@@ -0,0 +1,159 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compares per-frame lookups of the string properties of all tracked devices
+// through OpenVRUtils::get_tracked_device_string() and through
+// TrackedDevicePropertyCache. The synthetic system answers in-process, so the
+// uncached numbers do not include the IPC round trips of the real runtime.
+// Then fills a fresh cache from several threads at once (misses overlap) and
+// checks it returns the same strings.
+//
+// Usage: PropertyCacheBenchmark [frames]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "OpenVRUtils.h"
+#include "SyntheticVRSystem.h"
+#include "TrackedDevicePropertyCache.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    const vr::TrackedDeviceProperty PROPERTIES[] = {
+        vr::Prop_TrackingSystemName_String,
+        vr::Prop_ModelNumber_String,
+        vr::Prop_SerialNumber_String,
+        vr::Prop_ManufacturerName_String,
+    };
+
+    template <typename Function>
+    double seconds_of(Function&& function)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_frames = ((argc > 1) ? size_t(std::atol(argv[1])) : 1000);
+
+    SyntheticVRSystem system(SyntheticVRSystem::builtin_profiles().front());
+    TrackedDevicePropertyCache cache(&system);
+
+    size_t uncached_length = 0;
+    size_t cached_length = 0;
+
+    const double uncached_seconds = seconds_of([&]() {
+        for (size_t frame = 0; frame < num_frames; ++frame) {
+            for (vr::TrackedDeviceIndex_t device_index = 0; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index) {
+                for (const vr::TrackedDeviceProperty property : PROPERTIES) {
+                    uncached_length += OpenVRUtils::get_tracked_device_string(&system, device_index, property).size();
+                }
+            }
+        }
+    });
+
+    const double cached_seconds = seconds_of([&]() {
+        for (size_t frame = 0; frame < num_frames; ++frame) {
+            for (vr::TrackedDeviceIndex_t device_index = 0; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index) {
+                for (const vr::TrackedDeviceProperty property : PROPERTIES) {
+                    cached_length += cache.get_string(device_index, property).size();
+                }
+            }
+        }
+    });
+
+    const double num_lookups = (double(num_frames) * double(vr::k_unMaxTrackedDeviceCount) * double(sizeof(PROPERTIES) / sizeof(PROPERTIES[0])));
+
+    std::printf("Frames: %zu, lookups per frame: %zu\n", num_frames, size_t(num_lookups / double(num_frames)));
+    std::printf("Uncached: %9.3f ms (%7.1f ns/lookup)\n", (uncached_seconds * 1000.0), (uncached_seconds / num_lookups * 1.0e9));
+    std::printf("Cached:   %9.3f ms (%7.1f ns/lookup), %zu system queries\n", (cached_seconds * 1000.0), (cached_seconds / num_lookups * 1.0e9), cache.num_queries());
+
+    //------------------------------------------------------------------------------
+    // Concurrent misses.
+    TrackedDevicePropertyCache concurrent_cache(&system);
+    std::vector<std::thread> threads;
+    std::vector<size_t> concurrent_lengths(4, 0);
+
+    for (size_t thread_index = 0; thread_index < concurrent_lengths.size(); ++thread_index) {
+        threads.emplace_back([&, thread_index]() {
+            for (vr::TrackedDeviceIndex_t device_index = 0; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index) {
+                for (const vr::TrackedDeviceProperty property : PROPERTIES) {
+                    concurrent_lengths[thread_index] += concurrent_cache.get_string(device_index, property).size();
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    size_t num_errors = ((uncached_length == cached_length) ? 0 : 1);
+
+    for (const size_t length : concurrent_lengths) {
+        if ((length * num_frames) != uncached_length) {
+            std::printf("ERROR: concurrent lookups returned different strings\n");
+            ++num_errors;
+        }
+    }
+
+    if (concurrent_cache.size() != (size_t(vr::k_unMaxTrackedDeviceCount) * (sizeof(PROPERTIES) / sizeof(PROPERTIES[0])))) {
+        std::printf("ERROR: %zu keys cached after concurrent lookups\n", concurrent_cache.size());
+        ++num_errors;
+    }
+
+    std::printf("Concurrent: %zu threads, %zu system queries\n", concurrent_lengths.size(), concurrent_cache.num_queries());
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
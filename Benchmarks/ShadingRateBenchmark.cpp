@@ -0,0 +1,259 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Builds ShadingRateMaps for all built-in synthetic profiles with and without
+// fixed foveation and reports the tiles per rate and the fragments shaded
+// relative to shading every pixel. Checks that hidden tiles are culled, that an
+// independent, finer sampling of the distortion never needs a finer rate than
+// the map gives (beyond the tolerance), that maps are only rebuilt on size or
+// lens changes, and exports the maps of the first profile as CSV.
+//
+// Usage: ShadingRateBenchmark [tile size] [export directory]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ExportFormat.h"
+#include "HiddenAreaTileMask.h"
+#include "ShadingRateMap.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_CHECK_SAMPLES = 701;       // Not a multiple of the map's grid
+    constexpr float CHECK_SLACK = 0.02f;            // Relative, for the finite differences
+
+    //------------------------------------------------------------------------------
+    // The number of check cells whose needed density (normalized by the densest
+    // check cell) is not met by the rate of the tile they map to.
+    size_t count_undersampled(vr::IVRSystem* const system, vr::EVREye eye, const ShadingRateMap& map)
+    {
+        const size_t n = NUM_CHECK_SAMPLES;
+        const double w = map.width();
+        const double h = map.height();
+        const double quality = (1.0 - map.settings().tolerance);
+
+        struct Cell { double x, y, needed_x, needed_y; };
+        std::vector<Cell> cells;
+        double max_x = 0.0, max_y = 0.0;
+
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t i = 0; i < n; ++i) {
+                const float u = (float(i) / float(n));
+                const float v = (float(j) / float(n));
+                const float step = (1.0f / float(n));
+
+                vr::DistortionCoordinates_t p, pu, pv;
+                system->ComputeDistortion(eye, u, v, &p);
+                system->ComputeDistortion(eye, (u + step), v, &pu);
+                system->ComputeDistortion(eye, u, (v + step), &pv);
+
+                const double a = (pu.rfGreen[0] - p.rfGreen[0]);
+                const double b = (pv.rfGreen[0] - p.rfGreen[0]);
+                const double c = (pu.rfGreen[1] - p.rfGreen[1]);
+                const double d = (pv.rfGreen[1] - p.rfGreen[1]);
+                const double determinant = std::fabs((a * d) - (b * c));
+
+                Cell cell;
+                cell.x = p.rfGreen[0];
+                cell.y = p.rfGreen[1];
+                cell.needed_x = (std::hypot((d * w), (c * h)) / determinant);
+                cell.needed_y = (std::hypot((b * w), (a * h)) / determinant);
+
+                if ((cell.x < 0.0) || (cell.x >= 1.0) || (cell.y < 0.0) || (cell.y >= 1.0)) {
+                    continue;
+                }
+
+                max_x = std::max(max_x, cell.needed_x);
+                max_y = std::max(max_y, cell.needed_y);
+                cells.push_back(cell);
+            }
+        }
+
+        size_t num_undersampled = 0;
+
+        for (const Cell& cell : cells) {
+            const uint32_t tile_x = uint32_t(cell.x * w / map.settings().tile_size);
+            const uint32_t tile_y = uint32_t(cell.y * h / map.settings().tile_size);
+            const ShadingRate rate = map.rate(eye, tile_x, tile_y);
+
+            if (rate == ShadingRate_Culled) {
+                continue;
+            }
+
+            const double spacing_x = ShadingRateMap::rate_width(rate);
+            const double spacing_y = ShadingRateMap::rate_height(rate);
+
+            if (((spacing_x * cell.needed_x / max_x * quality) > (1.0 + CHECK_SLACK)) ||
+                ((spacing_y * cell.needed_y / max_y * quality) > (1.0 + CHECK_SLACK)))
+            {
+                ++num_undersampled;
+            }
+        }
+
+        return num_undersampled;
+    }
+
+    void print_statistics(const char* const name, const char* const mode, vr::EVREye eye, const ShadingRateMap& map, double seconds)
+    {
+        const ShadingRateMap::Statistics statistics = map.compute_statistics(eye);
+
+        std::printf("%-12s %-10s %-6s %4ux%-4u %7zu %7zu %7zu %7zu %7zu %8.1f%% %8.2f ms\n",
+                    name, mode, ((eye == vr::Eye_Left) ? "left" : "right"), map.num_tiles_x(), map.num_tiles_y(),
+                    statistics.num_1x1, statistics.num_1x2, statistics.num_2x2, statistics.num_4x4, statistics.num_culled,
+                    (100.0 * statistics.shaded_fraction), (seconds * 1.0e3));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t tile_size = ((argc > 1) ? uint32_t(std::atol(argv[1])) : 16);
+    const std::string directory = ((argc > 2) ? argv[2] : "/tmp");
+
+    size_t num_errors = 0;
+
+    std::printf("%-12s %-10s %-6s %-9s %7s %7s %7s %7s %7s %9s %11s\n",
+                "Profile", "Mode", "Eye", "Tiles", "1x1", "1x2/2x1", "2x2", "4x4", "Culled", "Shaded", "Build");
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+
+        uint32_t width = 0, height = 0;
+        system.GetRecommendedRenderTargetSize(&width, &height);
+
+        for (const bool foveation : { false, true }) {
+            ShadingRateMap::Settings settings;
+            settings.tile_size = tile_size;
+            settings.foveation_enabled = foveation;
+
+            ShadingRateMap map(&system, settings);
+
+            const auto start = std::chrono::steady_clock::now();
+            map.update(width, height);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                print_statistics(profile.name.c_str(), (foveation ? "foveated" : "lens"), eye, map, seconds);
+
+                //------------------------------------------------------------------------------
+                // Hidden tiles are culled, nothing else is.
+                const HiddenAreaTileMask mask(system.GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard), width, height, tile_size);
+
+                if (map.compute_statistics(eye).num_culled != mask.hidden_tiles().size()) {
+                    std::printf("ERROR: %zu tiles culled, %zu hidden\n", map.compute_statistics(eye).num_culled, mask.hidden_tiles().size());
+                    ++num_errors;
+                }
+
+                if (not foveation) {
+                    const size_t num_undersampled = count_undersampled(&system, eye, map);
+
+                    if (num_undersampled != 0) {
+                        std::printf("ERROR: %zu check samples undersampled\n", num_undersampled);
+                        ++num_errors;
+                    }
+                }
+            }
+
+            //------------------------------------------------------------------------------
+            // Rebuilds.
+            vr::VREvent_t event = {};
+            event.eventType = vr::VREvent_LensDistortionChanged;
+
+            const bool rebuilt_same_size = map.update(width, height);
+            const bool rebuilt_new_size = map.update((width / 2), (height / 2));
+            const bool invalidated = map.handle_event(event);
+            const bool rebuilt_after_event = map.update((width / 2), (height / 2));
+
+            if (rebuilt_same_size || not rebuilt_new_size || not invalidated || not rebuilt_after_event || (map.num_builds() != 3)) {
+                std::printf("ERROR: unexpected rebuilds (%zu builds)\n", map.num_builds());
+                ++num_errors;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Export of the first profile's maps.
+    {
+        SyntheticVRSystem system(SyntheticVRSystem::builtin_profiles().front());
+
+        uint32_t width = 0, height = 0;
+        system.GetRecommendedRenderTargetSize(&width, &height);
+
+        ShadingRateMap::Settings settings;
+        settings.tile_size = tile_size;
+
+        ShadingRateMap map(&system, settings);
+        map.update(width, height);
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const std::string path = (directory + ((eye == vr::Eye_Left) ? "/shading_rates_left.csv" : "/shading_rates_right.csv"));
+
+            BufferedFileWriter writer;
+
+            if (not writer.open(path.c_str(), true)) {
+                std::printf("ERROR: failed to open %s\n", path.c_str());
+                ++num_errors;
+                continue;
+            }
+
+            ExportFormat::write_shading_rate_map_as_csv(writer, map, eye);
+
+            if (not writer.close()) {
+                std::printf("ERROR: failed to write %s\n", path.c_str());
+                ++num_errors;
+                continue;
+            }
+
+            std::printf("Exported %s\n", path.c_str());
+        }
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
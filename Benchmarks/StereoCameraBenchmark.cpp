@@ -0,0 +1,255 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Times StereoCamera::update() against querying and converting the eye
+// transforms and projections every frame, and checks the per-frame matrices
+// (view-projection times its inverse is the identity, both eye frusta lie
+// inside the union frustum) on the built-in synthetic profiles.
+//
+// Usage: StereoCameraBenchmark [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+#include "StereoCamera.h"
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // A head pose at a random position with a random orientation.
+    simd_float4x4 make_head_to_world(std::mt19937& generator)
+    {
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::uniform_real_distribution<float> uniform(-2.0f, 2.0f);
+
+        float q[4];
+
+        for (float& component : q) {
+            component = normal(generator);
+        }
+
+        const float length = std::sqrt((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+        const float w = (q[0] / length), x = (q[1] / length), y = (q[2] / length), z = (q[3] / length);
+
+        simd_float4x4 m;
+        m.columns[0] = simd_float4 { (1.0f - (2.0f * ((y * y) + (z * z)))), (2.0f * ((x * y) + (z * w))), (2.0f * ((x * z) - (y * w))), 0.0f };
+        m.columns[1] = simd_float4 { (2.0f * ((x * y) - (z * w))), (1.0f - (2.0f * ((x * x) + (z * z)))), (2.0f * ((y * z) + (x * w))), 0.0f };
+        m.columns[2] = simd_float4 { (2.0f * ((x * z) + (y * w))), (2.0f * ((y * z) - (x * w))), (1.0f - (2.0f * ((x * x) + (y * y)))), 0.0f };
+        m.columns[3] = simd_float4 { uniform(generator), (1.7f + uniform(generator)), uniform(generator), 1.0f };
+
+        return m;
+    }
+
+    //------------------------------------------------------------------------------
+    // The largest absolute deviation of a * b from the identity.
+    float identity_error(const simd_float4x4& a, const simd_float4x4& b)
+    {
+        const simd_float4x4 product = MatrixUtils::multiply(a, b);
+        float error = 0.0f;
+
+        for (size_t column = 0; column < 4; ++column) {
+            for (size_t row = 0; row < 4; ++row) {
+                error = std::max(error, std::fabs(product.columns[column][row] - ((row == column) ? 1.0f : 0.0f)));
+            }
+        }
+
+        return error;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t iterations = ((argc > 1) ? size_t(std::atol(argv[1])) : 100000);
+
+    constexpr float NEAR_Z = 0.1f;
+    constexpr float FAR_Z = 100.0f;
+    constexpr size_t NUM_POSES = 64;
+
+    size_t num_errors = 0;
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        SyntheticVRSystem system(profile);
+        StereoCamera camera(&system, NEAR_Z, FAR_Z);
+
+        std::mt19937 generator(1);
+        std::vector<simd_float4x4> head_poses(NUM_POSES);
+
+        for (simd_float4x4& head_to_world : head_poses) {
+            head_to_world = make_head_to_world(generator);
+        }
+
+        //------------------------------------------------------------------------------
+        // Timing.
+        StereoCamera::Frame frame;
+
+        const double cached_seconds = best_seconds_of(5, [&]() {
+            for (size_t i = 0; i < iterations; ++i) {
+                camera.update(head_poses[i % NUM_POSES], frame);
+            }
+        });
+
+        const double requery_seconds = best_seconds_of(5, [&]() {
+            for (size_t i = 0; i < iterations; ++i) {
+                const simd_float4x4& head_to_world = head_poses[i % NUM_POSES];
+                const simd_float4x4 world_to_head = MatrixUtils::inverse_rigid(head_to_world);
+
+                for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                    const simd_float4x4 eye_to_head = MatrixUtils::simd_from_hmd_matrix(system.GetEyeToHeadTransform(eye));
+                    const simd_float4x4 projection = MatrixUtils::simd_from_hmd_matrix(system.GetProjectionMatrix(eye, NEAR_Z, FAR_Z));
+                    const simd_float4x4 inverse_projection = MatrixUtils::inverse(projection);
+
+                    StereoCamera::EyeMatrices& matrices = frame.eyes[eye];
+                    matrices.view = MatrixUtils::multiply(MatrixUtils::inverse_rigid(eye_to_head), world_to_head);
+                    matrices.projection = projection;
+                    matrices.view_projection = MatrixUtils::multiply(projection, matrices.view);
+                    matrices.inverse_view = MatrixUtils::multiply(head_to_world, eye_to_head);
+                    matrices.inverse_projection = inverse_projection;
+                    matrices.inverse_view_projection = MatrixUtils::multiply(matrices.inverse_view, inverse_projection);
+                }
+            }
+        });
+
+        std::printf("%s\n", profile.name.c_str());
+        std::printf("  Cached   %8.2f ns/frame (including union frustum)\n", (cached_seconds / double(iterations) * 1.0e9));
+        std::printf("  Requery  %8.2f ns/frame (eyes only)\n", (requery_seconds / double(iterations) * 1.0e9));
+
+        //------------------------------------------------------------------------------
+        // Checks.
+        float max_inverse_error = 0.0f;
+        float min_plane_distance = HUGE_VALF;
+
+        for (const simd_float4x4& head_to_world : head_poses) {
+            camera.update(head_to_world, frame);
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                const StereoCamera::EyeMatrices& matrices = frame.eyes[eye];
+
+                max_inverse_error = std::max(max_inverse_error, identity_error(matrices.view, matrices.inverse_view));
+                max_inverse_error = std::max(max_inverse_error, identity_error(matrices.view_projection, matrices.inverse_view_projection));
+
+                //------------------------------------------------------------------------------
+                // Corners of the eye frustum in world space, scaled by the distance
+                // from the eye so near and far corners get the same tolerance.
+                for (size_t i = 0; i < 8; ++i) {
+                    const simd_float4 ndc = { ((i & 1) ? 1.0f : -1.0f), ((i & 2) ? 1.0f : -1.0f), ((i & 4) ? 1.0f : 0.0f), 1.0f };
+                    simd_float4 corner = MatrixUtils::multiply(matrices.inverse_view_projection, ndc);
+                    corner = (corner * (1.0f / corner[3]));
+
+                    const simd_float4 offset = (corner - matrices.inverse_view.columns[3]);
+                    const float distance = std::sqrt((offset[0] * offset[0]) + (offset[1] * offset[1]) + (offset[2] * offset[2]));
+
+                    for (const simd_float4& plane : frame.union_planes) {
+                        const float d = ((plane[0] * corner[0]) + (plane[1] * corner[1]) + (plane[2] * corner[2]) + plane[3]);
+                        min_plane_distance = std::min(min_plane_distance, (d / distance));
+                    }
+                }
+            }
+        }
+
+        std::printf("  Max inverse error %g, min relative plane distance %g\n", double(max_inverse_error), double(min_plane_distance));
+
+        if (max_inverse_error > 1.0e-3f) {
+            std::printf("  ERROR: inverse error %g\n", double(max_inverse_error));
+            ++num_errors;
+        }
+
+        if (min_plane_distance < -5.0e-4f) {
+            std::printf("  ERROR: eye frustum outside of the union frustum\n");
+            ++num_errors;
+        }
+
+        //------------------------------------------------------------------------------
+        // Pose and event handling.
+        vr::TrackedDevicePose_t pose;
+        std::memset(&pose, 0, sizeof(pose));
+
+        if (camera.update(pose, frame)) {
+            std::printf("  ERROR: invalid pose accepted\n");
+            ++num_errors;
+        }
+
+        vr::VREvent_t event;
+        std::memset(&event, 0, sizeof(event));
+
+        const size_t num_refreshes = camera.num_refreshes();
+
+        event.eventType = vr::VREvent_PropertyChanged;
+        event.data.property.prop = vr::Prop_ManufacturerName_String;
+        camera.handle_event(event);
+        event.eventType = vr::VREvent_IpdChanged;
+        camera.handle_event(event);
+
+        if (camera.num_refreshes() != (num_refreshes + 1)) {
+            std::printf("  ERROR: unexpected number of refreshes\n");
+            ++num_errors;
+        }
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,166 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Stress test of ThreadPool: several external threads submit tasks and run
+// (nested) parallel_for() loops on the same pool at once, so workers pop, steal
+// and help out concurrently with submission. Checks every task and iteration
+// ran exactly once and reports submit and parallel_for() throughput. Built
+// with asserts enabled (see CMakeLists.txt) so the pool's internal consistency
+// checks run too.
+//
+// Usage: ThreadPoolBenchmark [rounds] [threads]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_SUBMITTERS = 4;
+    constexpr size_t NUM_TASKS_PER_ROUND = 256;
+    constexpr size_t NUM_OUTER_ITERATIONS = 64;
+    constexpr size_t NUM_INNER_ITERATIONS = 32;
+
+    struct Counters
+    {
+        std::atomic<size_t>     num_tasks_run { 0 };
+        std::atomic<size_t>     num_iterations_run { 0 };
+        std::atomic<size_t>     num_wrong_sums { 0 };
+    };
+
+    //------------------------------------------------------------------------------
+    // One submitter: per round queue a batch of tasks (some of which submit a
+    // task of their own from the worker), then run a parallel_for() whose
+    // iterations run a nested parallel_for(), while the batch is in flight.
+    void run_submitter(ThreadPool& pool, size_t num_rounds, Counters& counters)
+    {
+        for (size_t round = 0; round < num_rounds; ++round) {
+            for (size_t task = 0; task < NUM_TASKS_PER_ROUND; ++task) {
+                if ((task % 8) == 0) {
+                    pool.submit([&pool, &counters]() {
+                        pool.submit([&counters]() { ++counters.num_tasks_run; });
+                        ++counters.num_tasks_run;
+                    });
+                }
+                else {
+                    pool.submit([&counters]() { ++counters.num_tasks_run; });
+                }
+            }
+
+            pool.parallel_for(NUM_OUTER_ITERATIONS, [&pool, &counters](size_t outer) {
+                std::atomic<size_t> sum(0);
+
+                pool.parallel_for(NUM_INNER_ITERATIONS, [&sum, &counters, outer](size_t inner) {
+                    sum += ((outer * NUM_INNER_ITERATIONS) + inner);
+                    ++counters.num_iterations_run;
+                });
+
+                const size_t base = (outer * NUM_INNER_ITERATIONS);
+                const size_t expected = ((NUM_INNER_ITERATIONS * base) + ((NUM_INNER_ITERATIONS * (NUM_INNER_ITERATIONS - 1)) / 2));
+
+                if (sum != expected) {
+                    ++counters.num_wrong_sums;
+                }
+            });
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_rounds = ((argc > 1) ? size_t(std::atol(argv[1])) : 200);
+    const size_t num_threads = ((argc > 2) ? size_t(std::atol(argv[2])) : 8);
+
+    const size_t num_tasks_per_round = (NUM_TASKS_PER_ROUND + ((NUM_TASKS_PER_ROUND + 7) / 8));
+    const size_t expected_tasks = (NUM_SUBMITTERS * num_rounds * num_tasks_per_round);
+    const size_t expected_iterations = (NUM_SUBMITTERS * num_rounds * NUM_OUTER_ITERATIONS * NUM_INNER_ITERATIONS);
+
+    size_t num_errors = 0;
+    Counters counters;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        ThreadPool pool(num_threads);
+        std::vector<std::thread> submitters;
+
+        for (size_t i = 0; i < NUM_SUBMITTERS; ++i) {
+            submitters.emplace_back(run_submitter, std::ref(pool), num_rounds, std::ref(counters));
+        }
+
+        for (std::thread& submitter : submitters) {
+            submitter.join();
+        }
+
+        //------------------------------------------------------------------------------
+        // Wait for the last submitted tasks (the destructor drains the queues as
+        // well, this bounds the wait).
+        const auto deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(30));
+
+        while ((counters.num_tasks_run != expected_tasks) && (std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::yield();
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("ThreadPool: %zu threads, %zu submitters x %zu rounds: %zu tasks, %zu nested parallel_for iterations in %.1f ms (%.2f us/task+iteration)\n",
+                num_threads, NUM_SUBMITTERS, num_rounds, counters.num_tasks_run.load(), counters.num_iterations_run.load(),
+                (seconds * 1.0e3), (seconds / double(expected_tasks + expected_iterations) * 1.0e6));
+
+    if ((counters.num_tasks_run != expected_tasks) || (counters.num_iterations_run != expected_iterations) || (counters.num_wrong_sums != 0)) {
+        std::printf("ERROR: %zu of %zu tasks, %zu of %zu iterations run, %zu wrong sums\n",
+                    counters.num_tasks_run.load(), expected_tasks, counters.num_iterations_run.load(), expected_iterations, counters.num_wrong_sums.load());
+        ++num_errors;
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,228 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Checks HiddenAreaTileMask on the rectangular debug meshes against the exact
+// expected coverage and compares the scalar and vectorized rasterizers.
+//
+// Usage: TileMaskBenchmark [width] [height] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+#include "MeshProcessing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // The rectangular mesh leaves [p, 1 - p] visible. With vertices snapped to
+    // 1/256 pixel and the top-left rule a pixel is hidden if its center lies left
+    // of or above the visible rectangle, or on or past its right/bottom edge.
+    bool is_hidden(float coverage, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+    {
+        const float p = (coverage / 2.0f);
+        const float q = (1.0f - p);
+
+        const double x0 = (std::nearbyint(double(p) * width * 256.0) / 256.0);
+        const double x1 = (std::nearbyint(double(q) * width * 256.0) / 256.0);
+        const double y0 = (std::nearbyint(double(p) * height * 256.0) / 256.0);
+        const double y1 = (std::nearbyint(double(q) * height * 256.0) / 256.0);
+
+        const double px = (x + 0.5);
+        const double py = (y + 0.5);
+
+        return ((px < x0) || (px >= x1) || (py < y0) || (py >= y1));
+    }
+
+    //------------------------------------------------------------------------------
+    // Returns the number of mismatching pixels and tiles.
+    size_t check_rectangular_mesh(float coverage, uint32_t width, uint32_t height, uint32_t tile_size)
+    {
+        const HiddenAreaMeshData mesh = MeshProcessing::make_rectangular_mesh(coverage);
+        const HiddenAreaTileMask mask(mesh.as_hidden_area_mesh(), width, height, tile_size);
+
+        std::vector<uint64_t> coverage_mask;
+        HiddenAreaTileMask::rasterize_coverage(mesh.as_hidden_area_mesh(), width, height, coverage_mask);
+
+        const size_t row_words = HiddenAreaTileMask::coverage_row_words(width);
+        size_t num_errors = 0;
+
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                const bool hidden = ((coverage_mask[(row_words * y) + (x / 64)] >> (x % 64)) & 1);
+                num_errors += ((hidden != is_hidden(coverage, x, y, width, height)) ? 1 : 0);
+            }
+        }
+
+        for (uint32_t tile_y = 0; tile_y < mask.num_tiles_y(); ++tile_y) {
+            for (uint32_t tile_x = 0; tile_x < mask.num_tiles_x(); ++tile_x) {
+                size_t num_pixels = 0, num_hidden = 0;
+
+                for (uint32_t y = (tile_y * tile_size); y < std::min(((tile_y + 1) * tile_size), height); ++y) {
+                    for (uint32_t x = (tile_x * tile_size); x < std::min(((tile_x + 1) * tile_size), width); ++x) {
+                        num_hidden += (is_hidden(coverage, x, y, width, height) ? 1 : 0);
+                        ++num_pixels;
+                    }
+                }
+
+                const HiddenAreaTileMask::TileState expected = ((num_hidden == 0) ? HiddenAreaTileMask::TileState_Visible :
+                                                                ((num_hidden == num_pixels) ? HiddenAreaTileMask::TileState_Hidden :
+                                                                 HiddenAreaTileMask::TileState_Partial));
+
+                num_errors += ((mask.tile_state(tile_x, tile_y) != expected) ? 1 : 0);
+            }
+        }
+
+        if (mask.num_tiles() != (mask.hidden_tiles().size() + mask.partial_tiles().size() + mask.visible_tiles().size())) {
+            ++num_errors;
+        }
+
+        return num_errors;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t width = ((argc > 1) ? uint32_t(std::atol(argv[1])) : 1512);
+    const uint32_t height = ((argc > 2) ? uint32_t(std::atol(argv[2])) : 1680);
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 5);
+
+    //------------------------------------------------------------------------------
+    // Exactness on the rectangular debug meshes, including odd sizes and tiles
+    // that do not divide the render target.
+    const float coverages[] = { 0.0f, 0.1f, 0.25f, (1.0f / 3.0f), 0.5f, 1.0f };
+    const uint32_t sizes[][2] = { { width, height }, { 999, 1001 }, { 64, 64 }, { 1, 3 } };
+    const uint32_t tile_sizes[] = { 8, 16, 32, 13 };
+
+    size_t num_errors = 0;
+
+    for (const float coverage : coverages) {
+        for (const auto& size : sizes) {
+            for (const uint32_t tile_size : tile_sizes) {
+                const size_t errors = check_rectangular_mesh(coverage, size[0], size[1], tile_size);
+
+                if (errors != 0) {
+                    std::printf("Coverage %.3f, %u x %u, tile size %u: %zu errors\n", double(coverage), size[0], size[1], tile_size, errors);
+                }
+
+                num_errors += errors;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // A fan of thin triangles around the center, similar to lens-shaped meshes,
+    // for timing and for comparing both rasterizers.
+    HiddenAreaMeshData mesh;
+    {
+        const size_t num_segments = 256;
+
+        for (size_t i = 0; i < num_segments; ++i) {
+            const float a0 = (float(i) * 6.2831853f / float(num_segments));
+            const float a1 = (float(i + 1) * 6.2831853f / float(num_segments));
+
+            mesh.vertices.push_back({ { (0.5f + (0.45f * std::cos(a0))), (0.5f + (0.45f * std::sin(a0))) } });
+            mesh.vertices.push_back({ { (0.5f + (0.75f * std::cos(a0))), (0.5f + (0.75f * std::sin(a0))) } });
+            mesh.vertices.push_back({ { (0.5f + (0.45f * std::cos(a1))), (0.5f + (0.45f * std::sin(a1))) } });
+
+            mesh.vertices.push_back({ { (0.5f + (0.45f * std::cos(a1))), (0.5f + (0.45f * std::sin(a1))) } });
+            mesh.vertices.push_back({ { (0.5f + (0.75f * std::cos(a0))), (0.5f + (0.75f * std::sin(a0))) } });
+            mesh.vertices.push_back({ { (0.5f + (0.75f * std::cos(a1))), (0.5f + (0.75f * std::sin(a1))) } });
+
+            mesh.count += 2;
+        }
+    }
+
+    std::vector<uint64_t> scalar_coverage, vector_coverage;
+
+    const double scalar_seconds = best_seconds_of(iterations, [&]() {
+        HiddenAreaTileMask::rasterize_coverage_scalar(mesh.as_hidden_area_mesh(), width, height, scalar_coverage);
+    });
+
+    const double vector_seconds = best_seconds_of(iterations, [&]() {
+        HiddenAreaTileMask::rasterize_coverage(mesh.as_hidden_area_mesh(), width, height, vector_coverage);
+    });
+
+    const double mask_seconds = best_seconds_of(iterations, [&]() {
+        const HiddenAreaTileMask mask(mesh.as_hidden_area_mesh(), width, height, 16);
+    });
+
+    const size_t num_different_words = size_t(std::inner_product(scalar_coverage.begin(), scalar_coverage.end(), vector_coverage.begin(), size_t(0),
+                                                                 std::plus<size_t>(), std::not_equal_to<uint64_t>()));
+
+    const HiddenAreaTileMask mask(mesh.as_hidden_area_mesh(), width, height, 16);
+
+    std::printf("Render target: %u x %u, best of %zu\n", width, height, iterations);
+    std::printf("Scalar: %8.3f ms\n", (scalar_seconds * 1000.0));
+    std::printf("%-6s: %8.3f ms\n", HiddenAreaTileMask::rasterizer_kernel_name(), (vector_seconds * 1000.0));
+    std::printf("Tile mask (16 x 16): %8.3f ms, %zu hidden / %zu partial / %zu visible tiles, %.1f%% of pixels hidden\n",
+                (mask_seconds * 1000.0), mask.hidden_tiles().size(), mask.partial_tiles().size(), mask.visible_tiles().size(),
+                (100.0 * double(mask.num_hidden_pixels()) / (double(width) * double(height))));
+    std::printf("Speedup: %.2fx, differing words: %zu, rectangular mesh errors: %zu\n", (scalar_seconds / vector_seconds), num_different_words, num_errors);
+
+    return (((num_errors == 0) && (num_different_words == 0)) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,459 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Records a synthetic system's startup queries (VRInitializer with a distortion
+// LUT, projections, a distortion grid) and a sequence of moving pose frames to
+// a trace for all built-in profiles, then replays the trace. Checks that the
+// replayed resources, properties and poses are identical to the recorded ones,
+// that unrecorded distortion falls back to the grid, that pose frames start
+// over after the last one, and that truncated and corrupted traces are handled.
+// Reports recording and replay times and the trace size.
+//
+// Usage: VRTraceBenchmark [pose frames] [directory] [iterations]
+//------------------------------------------------------------------------------
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SyntheticVRSystem.h"
+#include "ThreadPool.h"
+#include "VRInitializer.h"
+#include "VRTrace.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t DISTORTION_LUT_SIZE = 64;
+    constexpr size_t DISTORTION_GRID_SIZE = 32;
+    constexpr uint32_t NUM_POSES = 16;
+    constexpr float NEAR_Z = 0.1f;
+    constexpr float FAR_Z = 100.0f;
+
+    template <typename Function>
+    double best_seconds_of(size_t iterations, Function&& function)
+    {
+        double best = HUGE_VAL;
+
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+
+            best = std::min(best, std::chrono::duration<double>(end - start).count());
+        }
+
+        return best;
+    }
+
+    //------------------------------------------------------------------------------
+    // A synthetic system whose HMD sways and turns a little from frame to frame,
+    // so every pose frame is different.
+    class MovingVRSystem : public SyntheticVRSystem
+    {
+    public:
+
+        explicit MovingVRSystem(const SyntheticHMDProfile& profile)
+            : SyntheticVRSystem(profile)
+            , m_frame(0)
+        {
+        }
+
+        void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                             float fPredictedSecondsToPhotonsFromNow,
+                                             vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                             uint32_t unTrackedDevicePoseArrayCount) override
+        {
+            SyntheticVRSystem::GetDeviceToAbsoluteTrackingPose(eOrigin, fPredictedSecondsToPhotonsFromNow, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+
+            const float t = (float(m_frame.fetch_add(1, std::memory_order_relaxed)) / profile().display_frequency);
+
+            if (unTrackedDevicePoseArrayCount > vr::k_unTrackedDeviceIndex_Hmd) {
+                vr::TrackedDevicePose_t& pose = pTrackedDevicePoseArray[vr::k_unTrackedDeviceIndex_Hmd];
+                const float yaw = (0.5f * std::sin(0.7f * t));
+
+                pose.mDeviceToAbsoluteTracking.m[0][0] = std::cos(yaw);
+                pose.mDeviceToAbsoluteTracking.m[0][2] = std::sin(yaw);
+                pose.mDeviceToAbsoluteTracking.m[2][0] = -std::sin(yaw);
+                pose.mDeviceToAbsoluteTracking.m[2][2] = std::cos(yaw);
+                pose.mDeviceToAbsoluteTracking.m[0][3] = (0.1f * std::sin(1.3f * t));
+                pose.vAngularVelocity.v[1] = (0.35f * std::cos(0.7f * t));
+            }
+        }
+
+    private:
+
+        std::atomic<uint64_t>   m_frame;
+    };
+
+    bool same_bytes(const void* const a, const void* const b, size_t size)
+    {
+        return (std::memcmp(a, b, size) == 0);
+    }
+
+    bool same_vertices(const std::vector<vr::HmdVector2_t>& a, const std::vector<vr::HmdVector2_t>& b)
+    {
+        return ((a.size() == b.size()) && (a.empty() || same_bytes(a.data(), b.data(), (sizeof(vr::HmdVector2_t) * a.size()))));
+    }
+
+    //------------------------------------------------------------------------------
+    // Compared member by member, the padding of the structure is undefined.
+    bool same_pose(const vr::TrackedDevicePose_t& a, const vr::TrackedDevicePose_t& b)
+    {
+        return (same_bytes(&a.mDeviceToAbsoluteTracking, &b.mDeviceToAbsoluteTracking, sizeof(a.mDeviceToAbsoluteTracking)) &&
+                same_bytes(&a.vVelocity, &b.vVelocity, sizeof(a.vVelocity)) &&
+                same_bytes(&a.vAngularVelocity, &b.vAngularVelocity, sizeof(a.vAngularVelocity)) &&
+                (a.eTrackingResult == b.eTrackingResult) &&
+                (a.bPoseIsValid == b.bPoseIsValid) &&
+                (a.bDeviceIsConnected == b.bDeviceIsConnected));
+    }
+
+    bool same_resources(VRInitializer& a, VRInitializer& b, const VRInitializer::Settings& settings)
+    {
+        if ((a.render_target_width() != b.render_target_width()) || (a.render_target_height() != b.render_target_height())) {
+            return false;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            const VRInitializer::EyeResources& ea = a.eye(eye);
+            const VRInitializer::EyeResources& eb = b.eye(eye);
+
+            for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                if ((ea.hidden_area_meshes[type].count != eb.hidden_area_meshes[type].count) ||
+                    (not same_vertices(ea.hidden_area_meshes[type].vertices, eb.hidden_area_meshes[type].vertices)) ||
+                    (not same_vertices(ea.indexed_meshes[type].vertices, eb.indexed_meshes[type].vertices)) ||
+                    (ea.indexed_meshes[type].indices != eb.indexed_meshes[type].indices))
+                {
+                    return false;
+                }
+            }
+
+            if ((not ea.tile_mask) || (not eb.tile_mask) || (not ea.visible_region) || (not eb.visible_region) ||
+                (ea.tile_mask->hidden_tile_bits() != eb.tile_mask->hidden_tile_bits()) ||
+                (ea.tile_mask->partial_tile_bits() != eb.tile_mask->partial_tile_bits()) ||
+                (ea.visible_region->num_visible_pixels() != eb.visible_region->num_visible_pixels()))
+            {
+                return false;
+            }
+        }
+
+        const DistortionLUT* const lut_a = a.distortion_lut();
+        const DistortionLUT* const lut_b = b.distortion_lut();
+
+        if ((not lut_a) || (not lut_b) || (lut_a->size_in_bytes() != lut_b->size_in_bytes())) {
+            return false;
+        }
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            if (not same_bytes(lut_a->channel(eye, DistortionLUT::Channel_RedU), lut_b->channel(eye, DistortionLUT::Channel_RedU), (lut_a->size_in_bytes() / 2))) {
+                return false;
+            }
+        }
+
+        for (const vr::TrackedDeviceProperty property : settings.string_properties) {
+            if (a.property_cache().get_string(vr::k_unTrackedDeviceIndex_Hmd, property) != b.property_cache().get_string(vr::k_unTrackedDeviceIndex_Hmd, property)) {
+                return false;
+            }
+        }
+
+        for (const vr::TrackedDeviceProperty property : settings.float_properties) {
+            const float fa = a.property_cache().get_float(vr::k_unTrackedDeviceIndex_Hmd, property);
+            const float fb = b.property_cache().get_float(vr::k_unTrackedDeviceIndex_Hmd, property);
+
+            if (not same_bytes(&fa, &fb, sizeof(fa))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::unique_ptr<VRInitializer> initialize(vr::IVRSystem* const system, const VRInitializer::Settings& settings, ThreadPool& pool)
+    {
+        std::unique_ptr<VRInitializer> initializer = std::make_unique<VRInitializer>(system, settings);
+        initializer->start(pool);
+        initializer->wait();
+        return initializer;
+    }
+
+    std::vector<char> read_file(const std::string& path)
+    {
+        std::ifstream stream(path, (std::ios::in | std::ios::binary));
+        return std::vector<char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const std::string& path, const std::vector<char>& contents)
+    {
+        std::ofstream stream(path, (std::ios::out | std::ios::binary | std::ios::trunc));
+        stream.write(contents.data(), std::streamsize(contents.size()));
+    }
+
+} // unnamed namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char* argv[])
+{
+    const size_t num_pose_frames = std::max(((argc > 1) ? size_t(std::atol(argv[1])) : 5000), size_t(1));
+    const std::string directory = ((argc > 2) ? argv[2] : "/tmp");
+    const size_t iterations = ((argc > 3) ? size_t(std::atol(argv[3])) : 3);
+
+    ThreadPool pool;
+
+    VRInitializer::Settings settings = VRInitializer::Settings::defaults();
+    settings.distortion_lut_size = DISTORTION_LUT_SIZE;
+
+    size_t num_errors = 0;
+
+    std::printf("%zu pose frames of %u devices, best of %zu\n", num_pose_frames, NUM_POSES, iterations);
+
+    for (const SyntheticHMDProfile& profile : SyntheticVRSystem::builtin_profiles()) {
+        const std::string path = (directory + "/VRTraceBenchmark-" + std::to_string(::getpid()) + ".trace");
+        const char* const name = profile.name.c_str();
+
+        //------------------------------------------------------------------------------
+        // Record.
+        MovingVRSystem system(profile);
+        std::unique_ptr<VRInitializer> recorded;
+        std::vector<vr::TrackedDevicePose_t> poses(NUM_POSES);
+        double record_pose_seconds = 0.0;
+        uint64_t trace_size = 0;
+
+        try {
+            RecordingVRSystem recorder(&system, path.c_str());
+
+            recorded = initialize(&recorder, settings, pool);
+            recorder.record_distortion_grid(DISTORTION_GRID_SIZE, DISTORTION_GRID_SIZE, &pool);
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                recorder.GetProjectionMatrix(eye, NEAR_Z, FAR_Z);
+                recorder.GetProjectionRaw(eye, nullptr, nullptr, nullptr, nullptr);
+                recorder.GetEyeToHeadTransform(eye);
+            }
+
+            recorder.GetTrackedDeviceClass(vr::k_unTrackedDeviceIndex_Hmd);
+
+            const auto start = std::chrono::steady_clock::now();
+
+            for (size_t frame = 0; frame < num_pose_frames; ++frame) {
+                recorder.GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, poses.data(), NUM_POSES);
+            }
+
+            record_pose_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (recorder.num_pose_frames() != num_pose_frames) {
+                std::printf("ERROR: %s: %llu pose frames recorded instead of %zu!\n", name, (unsigned long long)(recorder.num_pose_frames()), num_pose_frames);
+                ++num_errors;
+            }
+
+            trace_size = recorder.num_bytes_written();
+
+            if (not recorder.close()) {
+                std::printf("ERROR: %s: failed to write the trace!\n", name);
+                ++num_errors;
+                continue;
+            }
+        }
+        catch (const std::exception& e) {
+            std::printf("ERROR: %s: %s\n", name, e.what());
+            ++num_errors;
+            continue;
+        }
+
+        //------------------------------------------------------------------------------
+        // Replay.
+        try {
+            std::unique_ptr<ReplayVRSystem> replay;
+
+            const double open_seconds = best_seconds_of(iterations, [&]() {
+                replay.reset();
+                replay = std::make_unique<ReplayVRSystem>(path.c_str());
+            });
+
+            std::unique_ptr<VRInitializer> replayed;
+            const double replay_seconds = best_seconds_of(iterations, [&]() { replayed = initialize(replay.get(), settings, pool); });
+            const double synthetic_seconds = best_seconds_of(iterations, [&]() { initialize(&system, settings, pool); });
+
+            if (not same_resources(*recorded, *replayed, settings)) {
+                std::printf("ERROR: %s: replayed resources differ from the recorded ones!\n", name);
+                ++num_errors;
+            }
+
+            if (replay->num_distortion_misses() != 0) {
+                std::printf("ERROR: %s: %llu recorded distortion samples were not found!\n", name, (unsigned long long)(replay->num_distortion_misses()));
+                ++num_errors;
+            }
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                const vr::HmdMatrix44_t projection_a = system.GetProjectionMatrix(eye, NEAR_Z, FAR_Z);
+                const vr::HmdMatrix44_t projection_b = replay->GetProjectionMatrix(eye, NEAR_Z, FAR_Z);
+                const vr::HmdMatrix34_t eye_to_head_a = system.GetEyeToHeadTransform(eye);
+                const vr::HmdMatrix34_t eye_to_head_b = replay->GetEyeToHeadTransform(eye);
+
+                if ((not same_bytes(&projection_a, &projection_b, sizeof(projection_a))) ||
+                    (not same_bytes(&eye_to_head_a, &eye_to_head_b, sizeof(eye_to_head_a))))
+                {
+                    std::printf("ERROR: %s: replayed projection or eye transform differs!\n", name);
+                    ++num_errors;
+                }
+
+                //------------------------------------------------------------------------------
+                // Not recorded: composed from the raw projection and interpolated from the
+                // grid respectively.
+                const vr::HmdMatrix44_t composed_a = system.GetProjectionMatrix(eye, 0.5f, 50.0f);
+                const vr::HmdMatrix44_t composed_b = replay->GetProjectionMatrix(eye, 0.5f, 50.0f);
+
+                if (not same_bytes(&composed_a, &composed_b, sizeof(composed_a))) {
+                    std::printf("ERROR: %s: composed projection differs!\n", name);
+                    ++num_errors;
+                }
+
+                const DistortionLUT grid(&system, DISTORTION_GRID_SIZE, DISTORTION_GRID_SIZE);
+                const vr::DistortionCoordinates_t expected = grid.lookup(eye, 0.123f, 0.456f);
+                vr::DistortionCoordinates_t interpolated = {};
+
+                if ((not replay->ComputeDistortion(eye, 0.123f, 0.456f, &interpolated)) || (not same_bytes(&expected, &interpolated, sizeof(expected)))) {
+                    std::printf("ERROR: %s: unrecorded distortion does not match the grid!\n", name);
+                    ++num_errors;
+                }
+            }
+
+            if ((replay->num_distortion_misses() != 2) || (replay->GetTrackedDeviceClass(vr::k_unTrackedDeviceIndex_Hmd) != vr::TrackedDeviceClass_HMD)) {
+                std::printf("ERROR: %s: unexpected distortion misses or device class!\n", name);
+                ++num_errors;
+            }
+
+            //------------------------------------------------------------------------------
+            // Poses, compared against a second run of the same system.
+            MovingVRSystem reference(profile);
+            std::vector<vr::TrackedDevicePose_t> expected_poses(NUM_POSES);
+            size_t num_pose_mismatches = 0;
+
+            if (replay->num_pose_frames() != num_pose_frames) {
+                std::printf("ERROR: %s: %zu pose frames replayed instead of %zu!\n", name, replay->num_pose_frames(), num_pose_frames);
+                ++num_errors;
+            }
+
+            for (size_t frame = 0; frame < num_pose_frames; ++frame) {
+                reference.GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, expected_poses.data(), NUM_POSES);
+                replay->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, poses.data(), NUM_POSES);
+
+                for (uint32_t i = 0; i < NUM_POSES; ++i) {
+                    num_pose_mismatches += (same_pose(expected_poses[i], poses[i]) ? 0 : 1);
+                }
+            }
+
+            //------------------------------------------------------------------------------
+            // Starts over after the last frame.
+            MovingVRSystem first(profile);
+            first.GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, expected_poses.data(), NUM_POSES);
+            replay->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, poses.data(), NUM_POSES);
+            num_pose_mismatches += (same_pose(expected_poses[vr::k_unTrackedDeviceIndex_Hmd], poses[vr::k_unTrackedDeviceIndex_Hmd]) ? 0 : 1);
+
+            if (num_pose_mismatches != 0) {
+                std::printf("ERROR: %s: %zu replayed poses differ from the recorded ones!\n", name, num_pose_mismatches);
+                ++num_errors;
+            }
+
+            const double replay_pose_seconds = best_seconds_of(iterations, [&]() {
+                replay->rewind_poses();
+
+                for (size_t frame = 0; frame < num_pose_frames; ++frame) {
+                    replay->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, 0.011f, poses.data(), NUM_POSES);
+                }
+            });
+
+            std::printf("%s: trace %.2f MB (%.0f bytes per pose frame), open %.3f ms, initialize synthetic %.2f ms, replay %.2f ms (%.2fx), "
+                        "poses record %.0f ns, replay %.0f ns per frame\n",
+                        name, (double(trace_size) / (1024.0 * 1024.0)), (double(sizeof(VRTraceRecordHeader) + sizeof(VRTracePoses) + (sizeof(vr::TrackedDevicePose_t) * NUM_POSES))),
+                        (open_seconds * 1000.0), (synthetic_seconds * 1000.0), (replay_seconds * 1000.0), (synthetic_seconds / replay_seconds),
+                        (record_pose_seconds * 1e9 / double(num_pose_frames)), (replay_pose_seconds * 1e9 / double(num_pose_frames)));
+
+            replay.reset();
+
+            //------------------------------------------------------------------------------
+            // A partial last record (interrupted recording) is ignored, a corrupted file
+            // is rejected.
+            std::vector<char> contents = read_file(path);
+            const std::string corrupted_path = (path + ".corrupted");
+
+            contents.resize(contents.size() - 8);
+            write_file(corrupted_path, contents);
+
+            if (ReplayVRSystem(corrupted_path.c_str()).num_pose_frames() != (num_pose_frames - 1)) {
+                std::printf("ERROR: %s: truncated trace not replayed up to the last complete frame!\n", name);
+                ++num_errors;
+            }
+
+            contents[0] = 'X';
+            write_file(corrupted_path, contents);
+
+            try {
+                ReplayVRSystem corrupted(corrupted_path.c_str());
+                std::printf("ERROR: %s: corrupted trace accepted!\n", name);
+                ++num_errors;
+            }
+            catch (const std::runtime_error&) {
+            }
+
+            ::unlink(corrupted_path.c_str());
+        }
+        catch (const std::exception& e) {
+            std::printf("ERROR: %s: %s\n", name, e.what());
+            ++num_errors;
+        }
+
+        ::unlink(path.c_str());
+    }
+
+    return ((num_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
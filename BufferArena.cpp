@@ -0,0 +1,174 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "BufferArena.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BufferArena::BufferArena(uint32_t page_size, uint32_t granularity)
+    : m_page_size(page_size)
+    , m_granularity(granularity)
+    , m_last_upload_page(INVALID_PAGE)
+    , m_last_upload_block_end(0)
+{
+    if ((granularity == 0) || ((granularity & (granularity - 1)) != 0)) {
+        throw std::runtime_error("Invalid granularity!");
+    }
+
+    if (page_size < granularity) {
+        throw std::runtime_error("Invalid page size!");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BufferArena::Range
+BufferArena::allocate(uint32_t size, uint32_t alignment)
+{
+    Range range;
+
+    if (size == 0) {
+        return range;
+    }
+
+    //------------------------------------------------------------------------------
+    // The newest page with room, otherwise a new one (oversized if needed).
+    // Filling the newest page first keeps consecutive uploads adjacent, older
+    // pages are only used for ranges freed in them.
+    for (size_t page = m_pages.size(); page-- > 0; ) {
+        range.allocation = m_pages[page]->allocate(size, alignment);
+
+        if (range.allocation.is_valid()) {
+            range.page = uint32_t(page);
+            break;
+        }
+    }
+
+    if (not range.is_valid()) {
+        const uint64_t page_size = std::max<uint64_t>(m_page_size, OffsetAllocator::min_size_for(size, alignment, m_granularity));
+
+        if (page_size > UINT32_MAX) {
+            return range;
+        }
+
+        std::unique_ptr<OffsetAllocator> page(new OffsetAllocator(uint32_t(page_size), m_granularity));
+        range.allocation = page->allocate(size, alignment);
+
+        if (not range.allocation.is_valid()) {
+            return Range();
+        }
+
+        m_statistics.reserved_bytes += page->size();
+        m_pages.push_back(std::move(page));
+        range.page = uint32_t(m_pages.size() - 1);
+    }
+
+    range.offset = range.allocation.offset;
+    range.size = size;
+
+    ++m_statistics.num_allocations;
+    m_statistics.allocated_bytes += size;
+
+    return range;
+}
+
+BufferArena::Range
+BufferArena::upload(const void* const data, uint32_t size, uint32_t alignment)
+{
+    const Range range = allocate(size, alignment);
+
+    if (not range.is_valid()) {
+        return range;
+    }
+
+    const OffsetAllocator& page = *m_pages[range.page];
+    const uint32_t block_offset = page.block_offset(range.allocation);
+    const bool extends_last_copy = ((not m_copies.empty()) && (range.page == m_last_upload_page) && (block_offset == m_last_upload_block_end));
+
+    m_last_upload_page = range.page;
+    m_last_upload_block_end = (block_offset + page.block_size(range.allocation));
+
+    //------------------------------------------------------------------------------
+    // The bytes between the end of the last copy and this range belong to the
+    // padding of the two blocks and are staged as zeros.
+    const size_t padding = (extends_last_copy ? (range.offset - (m_copies.back().destination_offset + m_copies.back().size)) : 0);
+    const size_t source_offset = (m_staging.size() + padding);
+
+    m_staging.resize(source_offset + size, 0);
+    std::memcpy((m_staging.data() + source_offset), data, size);
+
+    if (extends_last_copy) {
+        m_copies.back().size += uint32_t(padding + size);
+        return range;
+    }
+
+    Copy copy;
+    copy.page = range.page;
+    copy.source_offset = source_offset;
+    copy.destination_offset = range.offset;
+    copy.size = size;
+
+    m_copies.push_back(copy);
+
+    return range;
+}
+
+void
+BufferArena::free(const Range& range)
+{
+    if (not range.is_valid()) {
+        return;
+    }
+
+    m_pages[range.page]->free(range.allocation);
+
+    --m_statistics.num_allocations;
+    m_statistics.allocated_bytes -= range.size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+BufferArena::clear_pending()
+{
+    m_staging.clear();
+    m_copies.clear();
+    m_last_upload_page = INVALID_PAGE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,171 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BUFFER_ARENA_H__
+#define __BUFFER_ARENA_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "OffsetAllocator.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Suballocation of many small static buffers (meshes, constants) from a few
+// large backing buffers ("pages"), with batched uploads.
+//
+// Each page is managed by an OffsetAllocator; a new page is added when no page
+// has room, allocations larger than the page size get a page of their own.
+// upload() stages the data in CPU memory and records a copy to the allocated
+// range. An upload whose block directly follows the previous upload's block
+// extends the previous copy (the padding in between is staged as well), so
+// uploads made back to back into a fresh arena become one copy per page.
+//
+// The arena does not own the backing buffers. A GPU wrapper creates a buffer
+// for each page and encodes the pending copies from the staging memory with a
+// single blit pass, then calls clear_pending().
+//------------------------------------------------------------------------------
+
+class BufferArena
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    static constexpr uint32_t INVALID_PAGE = UINT32_MAX;
+
+    struct Range
+    {
+        uint32_t                        page = INVALID_PAGE;
+        uint32_t                        offset = 0;
+        uint32_t                        size = 0;
+        OffsetAllocator::Allocation     allocation;
+
+        bool is_valid() const { return (page != INVALID_PAGE); }
+    };
+
+    struct Copy
+    {
+        uint32_t    page = 0;
+        size_t      source_offset = 0;          // Into staging()
+        uint32_t    destination_offset = 0;     // Into the page
+        uint32_t    size = 0;
+    };
+
+    struct Statistics
+    {
+        size_t      num_allocations = 0;
+        size_t      allocated_bytes = 0;        // Requested sizes of live allocations
+        size_t      reserved_bytes = 0;         // Sizes of all pages
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the page size is 0 or the granularity is not a power of two.
+    explicit BufferArena(uint32_t page_size = (4 * 1024 * 1024), uint32_t granularity = 16);
+
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Allocation
+public:
+
+    //------------------------------------------------------------------------------
+    // Allocate a range of 'size' bytes aligned to 'alignment' (a power of two).
+    // Returns an invalid range for a size of 0.
+    Range allocate(uint32_t size, uint32_t alignment = 16);
+
+    //------------------------------------------------------------------------------
+    // Allocate a range and stage 'data' for upload into it.
+    Range upload(const void* const data, uint32_t size, uint32_t alignment = 16);
+
+    //------------------------------------------------------------------------------
+    // Free a range (invalid ones are ignored). Pages are kept.
+    void free(const Range& range);
+
+    //------------------------------------------------------------------------------
+    // Pages
+public:
+
+    size_t num_pages() const { return m_pages.size(); }
+    uint32_t page_size(size_t page) const { return m_pages[page]->size(); }
+
+    const Statistics& statistics() const { return m_statistics; }
+
+    //------------------------------------------------------------------------------
+    // Pending Uploads
+public:
+
+    //------------------------------------------------------------------------------
+    // Staged data of the pending copies.
+    const std::vector<uint8_t>& staging() const { return m_staging; }
+
+    //------------------------------------------------------------------------------
+    // The pending copies in upload order.
+    const std::vector<Copy>& pending_copies() const { return m_copies; }
+
+    //------------------------------------------------------------------------------
+    // Drop the staged data and pending copies once they have been encoded.
+    void clear_pending();
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    uint32_t                                        m_page_size;
+    uint32_t                                        m_granularity;
+    std::vector<std::unique_ptr<OffsetAllocator>>   m_pages;
+
+    std::vector<uint8_t>                            m_staging;
+    std::vector<Copy>                               m_copies;
+    uint32_t                                        m_last_upload_page;
+    uint32_t                                        m_last_upload_block_end;
+
+    Statistics                                      m_statistics;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __BUFFER_ARENA_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,598 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CalibrationCache.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ExportFormat.h"
+#include "OpenVRUtils.h"
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t ENTRY_ALIGNMENT = 16;
+    constexpr size_t MAX_NUM_ENTRIES = ((2 * vr::k_eHiddenAreaMesh_Max) + 4);
+
+    size_t align_entry(size_t offset) { return (((offset + ENTRY_ALIGNMENT - 1) / ENTRY_ALIGNMENT) * ENTRY_ALIGNMENT); }
+
+    uint64_t rotate_left(uint64_t value, int bits) { return ((value << bits) | (value >> (64 - bits))); }
+
+    //------------------------------------------------------------------------------
+    // Fast non-cryptographic 64-bit checksum: four independent multiply/rotate
+    // lanes over 32 byte blocks, so validating a large cache costs a fraction of
+    // rebuilding it, with an FNV-1a tail and a final avalanche.
+    uint64_t compute_checksum(const void* const data, size_t size)
+    {
+        constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+        constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+
+        const uint8_t* const bytes = static_cast<const uint8_t*>(data);
+        uint64_t lanes[4] = { PRIME_1, PRIME_2, ~PRIME_1, ~PRIME_2 };
+        size_t offset = 0;
+
+        for (; (offset + 32) <= size; offset += 32) {
+            for (size_t i = 0; i < 4; ++i) {
+                uint64_t word;
+                std::memcpy(&word, (bytes + offset + (8 * i)), sizeof(word));
+                lanes[i] = (rotate_left((lanes[i] + (word * PRIME_2)), 31) * PRIME_1);
+            }
+        }
+
+        uint64_t hash = uint64_t(size);
+
+        for (const uint64_t lane : lanes) {
+            hash = (rotate_left((hash ^ lane), 27) * PRIME_1);
+        }
+
+        for (; offset < size; ++offset) {
+            hash = ((hash ^ bytes[offset]) * 0x100000001B3ull);
+        }
+
+        hash ^= (hash >> 33);
+        hash *= PRIME_2;
+        hash ^= (hash >> 29);
+
+        return hash;
+    }
+
+    void copy_string(char* const destination, size_t capacity, const std::string& source)
+    {
+        const size_t length = std::min(source.size(), (capacity - 1));
+
+        std::memcpy(destination, source.data(), length);
+        std::memset((destination + length), 0, (capacity - length));
+    }
+
+    //------------------------------------------------------------------------------
+    // A nul terminated string of at most (capacity - 1) characters, empty if
+    // there is no terminator.
+    std::string read_string(const char* const source, size_t capacity)
+    {
+        const void* const terminator = std::memchr(source, 0, capacity);
+        return (terminator ? std::string(source) : std::string());
+    }
+
+    //------------------------------------------------------------------------------
+    // The key as it is stored, i.e. with strings truncated to fit the header.
+    CalibrationKey stored_key(const CalibrationKey& key)
+    {
+        CalibrationCacheHeader header;
+
+        copy_string(header.model, sizeof(header.model), key.model);
+        copy_string(header.serial, sizeof(header.serial), key.serial);
+        copy_string(header.driver_version, sizeof(header.driver_version), key.driver_version);
+
+        return { header.model, header.serial, header.driver_version };
+    }
+
+    size_t num_hidden_area_vertices(vr::EHiddenAreaMeshType type, uint32_t count)
+    {
+        return ((type == vr::k_eHiddenAreaMesh_LineLoop) ? size_t(count) : (3 * size_t(count)));
+    }
+
+    size_t visible_region_size(uint32_t height)
+    {
+        return (sizeof(uint64_t) + (2 * sizeof(uint32_t) * size_t(height)));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CalibrationKey
+CalibrationKey::query(vr::IVRSystem* const system)
+{
+    CalibrationKey key;
+
+    key.model = OpenVRUtils::get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String);
+    key.serial = OpenVRUtils::get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String);
+    key.driver_version = OpenVRUtils::get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DriverVersion_String);
+
+    return key;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<CalibrationCache>
+CalibrationCache::load(const char* const path, const CalibrationKey& key, size_t distortion_size)
+{
+    const int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat file_stat;
+
+    if ((::fstat(fd, &file_stat) != 0) || (size_t(file_stat.st_size) < sizeof(CalibrationCacheHeader))) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const size_t size = size_t(file_stat.st_size);
+    void* const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CalibrationCache> cache(new CalibrationCache());
+
+    cache->m_mapping = data;
+    cache->m_size = size;
+
+    if (not cache->attach(data, size)) {
+        return nullptr;
+    }
+
+    if ((cache->m_key != stored_key(key)) ||
+        (cache->m_distortion_lut->width() != distortion_size) ||
+        (cache->m_distortion_lut->height() != distortion_size))
+    {
+        return nullptr;
+    }
+
+    return cache;
+}
+
+std::unique_ptr<CalibrationCache>
+CalibrationCache::build(const char* const path,
+                        vr::IVRSystem* const system,
+                        const CalibrationKey& key,
+                        size_t distortion_size,
+                        ThreadPool* const pool)
+{
+    if ((distortion_size < 2) || (distortion_size > UINT32_MAX)) {
+        throw std::runtime_error("Invalid distortion table size!");
+    }
+
+    const DistortionLUT lut(system, distortion_size, distortion_size, pool);
+
+    vr::HiddenAreaMesh_t meshes[2][vr::k_eHiddenAreaMesh_Max] = {};
+    uint32_t render_target_width = 0;
+    uint32_t render_target_height = 0;
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+            meshes[eye][type] = system->GetHiddenAreaMesh(eye, vr::EHiddenAreaMeshType(type));
+        }
+    }
+
+    system->GetRecommendedRenderTargetSize(&render_target_width, &render_target_height);
+
+    std::unique_ptr<VisibleRegion> regions[2];
+    const VisibleRegion* visible_regions[2] = {};
+
+    if ((render_target_width > 0) && (render_target_height > 0)) {
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            regions[eye] = std::make_unique<VisibleRegion>(meshes[eye][vr::k_eHiddenAreaMesh_Inverse], vr::k_eHiddenAreaMesh_Inverse, render_target_width, render_target_height);
+            visible_regions[eye] = regions[eye].get();
+        }
+    }
+
+    return build(path, key, meshes, lut, render_target_width, render_target_height, visible_regions);
+}
+
+std::unique_ptr<CalibrationCache>
+CalibrationCache::build(const char* const path,
+                        const CalibrationKey& key,
+                        const vr::HiddenAreaMesh_t (&meshes)[2][vr::k_eHiddenAreaMesh_Max],
+                        const DistortionLUT& lut,
+                        uint32_t render_target_width,
+                        uint32_t render_target_height,
+                        const VisibleRegion* const (&visible_regions)[2])
+{
+    if ((lut.width() != lut.height()) || (lut.width() > UINT32_MAX)) {
+        throw std::runtime_error("Invalid distortion table size!");
+    }
+
+    const size_t distortion_size = lut.width();
+
+    //------------------------------------------------------------------------------
+    // The visible regions as stored.
+    std::vector<uint8_t> region_data[2];
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const VisibleRegion* const region = visible_regions[eye];
+
+        if (not region) {
+            continue;
+        }
+
+        if ((region->width() != render_target_width) || (region->height() != render_target_height)) {
+            throw std::runtime_error("Invalid visible region size!");
+        }
+
+        const uint64_t num_visible_pixels = region->num_visible_pixels();
+        const size_t rows_size = (sizeof(uint32_t) * size_t(render_target_height));
+
+        region_data[eye].resize(visible_region_size(render_target_height));
+        std::memcpy(region_data[eye].data(), &num_visible_pixels, sizeof(num_visible_pixels));
+        std::memcpy((region_data[eye].data() + sizeof(num_visible_pixels)), region->row_begin(), rows_size);
+        std::memcpy((region_data[eye].data() + sizeof(num_visible_pixels) + rows_size), region->row_end(), rows_size);
+    }
+
+    //------------------------------------------------------------------------------
+    // Lay out the file.
+    const size_t num_entries_total = ((2 * vr::k_eHiddenAreaMesh_Max) + 2 + (region_data[vr::Eye_Left].empty() ? 0 : 1) + (region_data[vr::Eye_Right].empty() ? 0 : 1));
+
+    CalibrationCacheHeader header = {};
+    CalibrationCacheEntry entries[MAX_NUM_ENTRIES] = {};
+    const void* sources[MAX_NUM_ENTRIES] = {};
+
+    std::memcpy(header.magic, CalibrationCacheHeader::MAGIC, sizeof(header.magic));
+    header.version = CalibrationCacheHeader::VERSION;
+    header.header_size = sizeof(CalibrationCacheHeader);
+    header.num_entries = uint32_t(num_entries_total);
+    header.distortion_width = uint32_t(distortion_size);
+    header.distortion_height = uint32_t(distortion_size);
+
+    header.render_target_width = render_target_width;
+    header.render_target_height = render_target_height;
+
+    copy_string(header.model, sizeof(header.model), key.model);
+    copy_string(header.serial, sizeof(header.serial), key.serial);
+    copy_string(header.driver_version, sizeof(header.driver_version), key.driver_version);
+
+    size_t offset = align_entry(sizeof(CalibrationCacheHeader) + (sizeof(CalibrationCacheEntry) * num_entries_total));
+    size_t num_entries = 0;
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+            const vr::HiddenAreaMesh_t& mesh = meshes[eye][type];
+            const uint32_t count = (mesh.pVertexData ? mesh.unTriangleCount : 0);
+
+            CalibrationCacheEntry& entry = entries[num_entries];
+
+            entry.content = CalibrationContent_HiddenAreaMesh;
+            entry.eye = uint32_t(eye);
+            entry.type = uint32_t(type);
+            entry.count = count;
+            entry.offset = offset;
+            entry.size = (sizeof(vr::HmdVector2_t) * num_hidden_area_vertices(vr::EHiddenAreaMeshType(type), count));
+
+            sources[num_entries++] = mesh.pVertexData;
+            offset = align_entry(offset + entry.size);
+        }
+
+        CalibrationCacheEntry& entry = entries[num_entries];
+
+        entry.content = CalibrationContent_DistortionTable;
+        entry.eye = uint32_t(eye);
+        entry.offset = offset;
+        entry.size = (sizeof(float) * distortion_size * distortion_size * DistortionLUT::Channel_Count);
+
+        sources[num_entries++] = lut.channel(eye, DistortionLUT::Channel_RedU);
+        offset = align_entry(offset + entry.size);
+    }
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        if (region_data[eye].empty()) {
+            continue;
+        }
+
+        CalibrationCacheEntry& entry = entries[num_entries];
+
+        entry.content = CalibrationContent_VisibleRegion;
+        entry.eye = uint32_t(eye);
+        entry.offset = offset;
+        entry.size = region_data[eye].size();
+
+        sources[num_entries++] = region_data[eye].data();
+        offset = align_entry(offset + entry.size);
+    }
+
+    assert(num_entries == num_entries_total);
+
+    //------------------------------------------------------------------------------
+    // Assemble the file image.
+    const size_t size = offset;
+
+    std::unique_ptr<CalibrationCache> cache(new CalibrationCache());
+    cache->m_storage.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+
+    char* const image = reinterpret_cast<char*>(cache->m_storage.data());
+
+    std::memcpy((image + sizeof(CalibrationCacheHeader)), entries, (sizeof(CalibrationCacheEntry) * num_entries));
+
+    for (size_t i = 0; i < num_entries; ++i) {
+        if (entries[i].size > 0) {
+            std::memcpy((image + entries[i].offset), sources[i], size_t(entries[i].size));
+        }
+    }
+
+    header.payload_size = (size - sizeof(CalibrationCacheHeader));
+    header.checksum = compute_checksum((image + sizeof(CalibrationCacheHeader)), size_t(header.payload_size));
+
+    std::memcpy(image, &header, sizeof(header));
+
+    //------------------------------------------------------------------------------
+    // Write the file. Failing to write is not an error, the cache is only rebuilt
+    // at the next launch.
+    if (path) {
+        const std::string temporary_path = (std::string(path) + ".tmp");
+        BufferedFileWriter writer;
+
+        if (writer.open(temporary_path.c_str(), true)) {
+            writer.write_bytes(image, size);
+
+            if ((not writer.close()) || (std::rename(temporary_path.c_str(), path) != 0)) {
+                ::unlink(temporary_path.c_str());
+            }
+        }
+    }
+
+    if (not cache->attach(image, size)) {
+        throw std::runtime_error("Invalid calibration cache!");
+    }
+
+    return cache;
+}
+
+std::unique_ptr<CalibrationCache>
+CalibrationCache::load_or_build(const char* const path,
+                                vr::IVRSystem* const system,
+                                size_t distortion_size,
+                                ThreadPool* const pool)
+{
+    const CalibrationKey key = CalibrationKey::query(system);
+    std::unique_ptr<CalibrationCache> cache = load(path, key, distortion_size);
+
+    //------------------------------------------------------------------------------
+    // The recommended render target size is not covered by the key since it
+    // follows the resolution setting of the runtime, rebuild if it changed.
+    if (cache) {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        system->GetRecommendedRenderTargetSize(&width, &height);
+
+        if ((cache->render_target_width() != width) || (cache->render_target_height() != height)) {
+            cache.reset();
+        }
+    }
+
+    if (not cache) {
+        cache = build(path, system, key, distortion_size, pool);
+    }
+
+    return cache;
+}
+
+std::string
+CalibrationCache::file_name(const CalibrationKey& key)
+{
+    std::string name = ("OpenVRMetal-" + key.model + "-" + key.serial + ".calibration");
+
+    for (char& c : name) {
+        if ((not std::isalnum(static_cast<unsigned char>(c))) && (c != '-') && (c != '_') && (c != '.')) {
+            c = '_';
+        }
+    }
+
+    return name;
+}
+
+CalibrationCache::~CalibrationCache()
+{
+    if (m_mapping) {
+        ::munmap(m_mapping, m_size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::HiddenAreaMesh_t
+CalibrationCache::hidden_area_mesh(vr::EVREye eye, vr::EHiddenAreaMeshType type) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+
+    if ((type < 0) || (type >= vr::k_eHiddenAreaMesh_Max)) {
+        return { nullptr, 0 };
+    }
+
+    return m_hidden_area_meshes[eye][type];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<VisibleRegion>
+CalibrationCache::visible_region(vr::EVREye eye) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+
+    const uint32_t* const data = m_visible_regions[eye];
+
+    if (not data) {
+        return nullptr;
+    }
+
+    const uint32_t height = m_header->render_target_height;
+    uint64_t num_visible_pixels;
+    std::memcpy(&num_visible_pixels, data, sizeof(num_visible_pixels));
+
+    return std::make_unique<VisibleRegion>(m_header->render_target_width, height, (data + 2), (data + 2 + height), size_t(num_visible_pixels));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+CalibrationCache::attach(const void* const data, size_t size)
+{
+    const char* const bytes = static_cast<const char*>(data);
+    const CalibrationCacheHeader* const header = static_cast<const CalibrationCacheHeader*>(data);
+
+    //------------------------------------------------------------------------------
+    // Header and checksum.
+    if ((size < sizeof(CalibrationCacheHeader)) ||
+        (std::memcmp(header->magic, CalibrationCacheHeader::MAGIC, sizeof(header->magic)) != 0) ||
+        (header->version != CalibrationCacheHeader::VERSION) ||
+        (header->header_size != sizeof(CalibrationCacheHeader)) ||
+        (header->payload_size != (size - sizeof(CalibrationCacheHeader))) ||
+        (header->num_entries > (header->payload_size / sizeof(CalibrationCacheEntry))) ||
+        (header->distortion_width < 2) ||
+        (header->distortion_height < 2))
+    {
+        return false;
+    }
+
+    if (compute_checksum((bytes + sizeof(CalibrationCacheHeader)), size_t(header->payload_size)) != header->checksum) {
+        return false;
+    }
+
+    //------------------------------------------------------------------------------
+    // Entries.
+    const CalibrationCacheEntry* const entries = reinterpret_cast<const CalibrationCacheEntry*>(bytes + sizeof(CalibrationCacheHeader));
+    const size_t data_offset = (sizeof(CalibrationCacheHeader) + (sizeof(CalibrationCacheEntry) * header->num_entries));
+    const size_t table_size = (sizeof(float) * size_t(header->distortion_width) * size_t(header->distortion_height) * DistortionLUT::Channel_Count);
+
+    const float* tables[2] = {};
+    const uint32_t* visible_regions[2] = {};
+
+    for (size_t i = 0; i < header->num_entries; ++i) {
+        const CalibrationCacheEntry& entry = entries[i];
+
+        if ((entry.offset < data_offset) || (entry.offset > size) || (entry.size > (size - entry.offset)) ||
+            ((entry.offset % ENTRY_ALIGNMENT) != 0) || (entry.eye > vr::Eye_Right))
+        {
+            return false;
+        }
+
+        const void* const entry_data = (bytes + entry.offset);
+
+        switch (entry.content) {
+            case CalibrationContent_HiddenAreaMesh: {
+                const vr::EHiddenAreaMeshType type = vr::EHiddenAreaMeshType(entry.type);
+
+                if ((entry.type >= uint32_t(vr::k_eHiddenAreaMesh_Max)) ||
+                    (entry.size != (sizeof(vr::HmdVector2_t) * num_hidden_area_vertices(type, entry.count))))
+                {
+                    return false;
+                }
+
+                const vr::HmdVector2_t* const vertices = ((entry.count > 0) ? static_cast<const vr::HmdVector2_t*>(entry_data) : nullptr);
+                m_hidden_area_meshes[entry.eye][type] = { vertices, entry.count };
+                break;
+            }
+
+            case CalibrationContent_DistortionTable:
+                if (entry.size != table_size) {
+                    return false;
+                }
+
+                tables[entry.eye] = static_cast<const float*>(entry_data);
+                break;
+
+            case CalibrationContent_VisibleRegion: {
+                //------------------------------------------------------------------------------
+                // Validated here so visible_region() cannot fail.
+                const uint32_t width = header->render_target_width;
+                const uint32_t height = header->render_target_height;
+                const uint32_t* const rows = (static_cast<const uint32_t*>(entry_data) + 2);
+
+                if ((width == 0) || (height == 0) || (entry.size != visible_region_size(height))) {
+                    return false;
+                }
+
+                for (uint32_t y = 0; y < height; ++y) {
+                    if ((rows[y] > rows[height + y]) || (rows[height + y] > width)) {
+                        return false;
+                    }
+                }
+
+                visible_regions[entry.eye] = static_cast<const uint32_t*>(entry_data);
+                break;
+            }
+
+            default:
+                break;                  // Unknown content is skipped
+        }
+    }
+
+    if ((not tables[vr::Eye_Left]) || (not tables[vr::Eye_Right])) {
+        return false;
+    }
+
+    m_header = header;
+    m_key = { read_string(header->model, sizeof(header->model)),
+              read_string(header->serial, sizeof(header->serial)),
+              read_string(header->driver_version, sizeof(header->driver_version)) };
+    m_distortion_lut.reset(new DistortionLUT(header->distortion_width, header->distortion_height, tables[vr::Eye_Left], tables[vr::Eye_Right]));
+    m_visible_regions[vr::Eye_Left] = visible_regions[vr::Eye_Left];
+    m_visible_regions[vr::Eye_Right] = visible_regions[vr::Eye_Right];
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,258 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CALIBRATION_CACHE_H__
+#define __CALIBRATION_CACHE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+class VisibleRegion;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The headset a calibration cache belongs to. Strings longer than
+// CalibrationCacheHeader allows are truncated.
+//------------------------------------------------------------------------------
+
+struct CalibrationKey
+{
+    std::string     model;                      // Prop_ModelNumber_String
+    std::string     serial;                     // Prop_SerialNumber_String
+    std::string     driver_version;             // Prop_DriverVersion_String
+
+    //------------------------------------------------------------------------------
+    // The key of the HMD of the given system.
+    static CalibrationKey query(vr::IVRSystem* const system);
+
+    bool operator==(const CalibrationKey& other) const
+    {
+        return ((model == other.model) && (serial == other.serial) && (driver_version == other.driver_version));
+    }
+
+    bool operator!=(const CalibrationKey& other) const { return (not (*this == other)); }
+};
+
+//------------------------------------------------------------------------------
+// Calibration cache file format.
+//
+// A file is a CalibrationCacheHeader, 'num_entries' CalibrationCacheEntry
+// records and the data of the entries, each starting at a multiple of 16 bytes
+// from the start of the file so it can be used in place once the file is memory
+// mapped. The checksum covers everything after the header. Values are stored in
+// the byte order of the machine that wrote the file (little-endian on all
+// supported platforms).
+//------------------------------------------------------------------------------
+
+enum CalibrationContent : uint32_t {
+    CalibrationContent_HiddenAreaMesh = 1,      // vr::HmdVector2_t vertices of one eye and mesh type
+    CalibrationContent_DistortionTable = 2,     // DistortionLUT tables (six planes) of one eye
+    CalibrationContent_VisibleRegion = 3,       // VisibleRegion of one eye: uint64_t pixel count, uint32_t row begins and ends
+};
+
+struct CalibrationCacheHeader
+{
+    static constexpr char MAGIC[4] = { 'O', 'V', 'R', 'C' };
+    static constexpr uint16_t VERSION = 1;
+
+    char        magic[4];
+    uint16_t    version;
+    uint16_t    header_size;                    // sizeof(CalibrationCacheHeader)
+    uint32_t    num_entries;
+    uint32_t    distortion_width;               // Size of the distortion tables
+    uint32_t    distortion_height;
+    uint32_t    render_target_width;            // GetRecommendedRenderTargetSize()
+    uint32_t    render_target_height;
+    uint32_t    reserved0;
+    uint64_t    payload_size;                   // Bytes following the header
+    uint64_t    checksum;                       // Of the payload
+    char        model[64];                      // CalibrationKey, nul terminated
+    char        serial[64];
+    char        driver_version[64];
+    uint8_t     reserved[80];
+};
+
+static_assert(sizeof(CalibrationCacheHeader) == 320, "!");
+
+struct CalibrationCacheEntry
+{
+    uint32_t    content;                        // CalibrationContent
+    uint32_t    eye;                            // vr::EVREye
+    uint32_t    type;                           // vr::EHiddenAreaMeshType of hidden area meshes
+    uint32_t    count;                          // HiddenAreaMesh_t::unTriangleCount of hidden area meshes
+    uint64_t    offset;                         // From the start of the file
+    uint64_t    size;                           // In bytes
+};
+
+static_assert(sizeof(CalibrationCacheEntry) == 32, "!");
+
+//------------------------------------------------------------------------------
+// Per-headset calibration data kept on disk to skip querying OpenVR at startup:
+// the hidden area meshes of both eyes and all types, a DistortionLUT, the
+// recommended render target size and the visible regions derived from the
+// inverse meshes at that size.
+//
+// load() maps a cache file and validates it against the headset and the
+// requested distortion table size; the meshes and the LUT then point directly
+// into the mapping. The render target size is not part of the key, callers
+// compare it (load_or_build() does). build() queries the system, or takes data
+// already queried, and writes the file (via a temporary file and rename() so
+// readers never see a partial file). A cache that could not be written is still
+// usable from memory.
+//------------------------------------------------------------------------------
+
+class CalibrationCache
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Map the cache file at the given path. Returns nullptr if it does not exist,
+    // is not a valid cache file (including a checksum mismatch) or was written for
+    // a different key or distortion table size.
+    static std::unique_ptr<CalibrationCache> load(const char* const path,
+                                                  const CalibrationKey& key,
+                                                  size_t distortion_size);
+
+    //------------------------------------------------------------------------------
+    // Query the system for the HMD with the given key and write the cache to the
+    // given path (if not null). The distortion table is sampled on a grid of
+    // (distortion_size x distortion_size), see DistortionLUT. Throws if the size
+    // is invalid.
+    static std::unique_ptr<CalibrationCache> build(const char* const path,
+                                                   vr::IVRSystem* const system,
+                                                   const CalibrationKey& key,
+                                                   size_t distortion_size,
+                                                   ThreadPool* const pool = nullptr);
+
+    //------------------------------------------------------------------------------
+    // build() from data already queried from the system, e.g. by the tasks of a
+    // VRInitializer. Visible regions may be null and are then not cached. Throws
+    // if the LUT is not square or a visible region is not of the render target
+    // size.
+    static std::unique_ptr<CalibrationCache> build(const char* const path,
+                                                   const CalibrationKey& key,
+                                                   const vr::HiddenAreaMesh_t (&meshes)[2][vr::k_eHiddenAreaMesh_Max],
+                                                   const DistortionLUT& lut,
+                                                   uint32_t render_target_width,
+                                                   uint32_t render_target_height,
+                                                   const VisibleRegion* const (&visible_regions)[2]);
+
+    //------------------------------------------------------------------------------
+    // load() for the key of the system's HMD, falling back to build() if there is
+    // no valid cache or the recommended render target size of the system differs
+    // from the cached one (e.g. after changing the resolution setting).
+    static std::unique_ptr<CalibrationCache> load_or_build(const char* const path,
+                                                           vr::IVRSystem* const system,
+                                                           size_t distortion_size,
+                                                           ThreadPool* const pool = nullptr);
+
+    //------------------------------------------------------------------------------
+    // A file name for the key's cache, with characters other than letters, digits,
+    // '-', '_' and '.' replaced by '_'.
+    static std::string file_name(const CalibrationKey& key);
+
+    ~CalibrationCache();
+
+    CalibrationCache(const CalibrationCache&) = delete;
+    CalibrationCache& operator=(const CalibrationCache&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Access
+public:
+
+    const CalibrationKey& key() const { return m_key; }
+
+    //------------------------------------------------------------------------------
+    // True if the data is memory mapped from a file loaded by load().
+    bool is_mapped() const { return (m_mapping != nullptr); }
+
+    size_t size_in_bytes() const { return m_size; }
+
+    //------------------------------------------------------------------------------
+    // Like vr::IVRSystem::GetHiddenAreaMesh(), valid as long as the cache.
+    vr::HiddenAreaMesh_t hidden_area_mesh(vr::EVREye eye, vr::EHiddenAreaMeshType type) const;
+
+    const DistortionLUT& distortion_lut() const { return *m_distortion_lut; }
+
+    //------------------------------------------------------------------------------
+    // A copy of the visible region of an eye (see VisibleRegion, of the inverse mesh
+    // at the render target size), null if the cache has none.
+    std::unique_ptr<VisibleRegion> visible_region(vr::EVREye eye) const;
+
+    //------------------------------------------------------------------------------
+    // The recommended render target size when the cache was built.
+    uint32_t render_target_width() const { return m_header->render_target_width; }
+    uint32_t render_target_height() const { return m_header->render_target_height; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    CalibrationCache() = default;
+
+    //------------------------------------------------------------------------------
+    // Validate the file image and set up the accessors. Returns false if the image
+    // is invalid.
+    bool attach(const void* const data, size_t size);
+
+    void*                               m_mapping = nullptr;
+    std::vector<uint64_t>               m_storage;              // File image if not mapped
+    size_t                              m_size = 0;
+
+    const CalibrationCacheHeader*       m_header = nullptr;
+    CalibrationKey                      m_key;
+    vr::HiddenAreaMesh_t                m_hidden_area_meshes[2][vr::k_eHiddenAreaMesh_Max] = {};
+    std::unique_ptr<DistortionLUT>      m_distortion_lut;
+    const uint32_t*                     m_visible_regions[2] = {};  // CalibrationContent_VisibleRegion data
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __CALIBRATION_CACHE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,405 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CompositorInstrumentation.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ExportFormat.h"
+#include "OpenVRUtils.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    uint64_t milliseconds_to_microseconds(float milliseconds)
+    {
+        return ((milliseconds > 0.0f) ? uint64_t((double(milliseconds) * 1000.0) + 0.5) : 0);
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+CompositorInstrumentation::Snapshot::num_errors(CompositorCall call) const
+{
+    uint64_t count = 0;
+
+    for (size_t slot = 1; slot < NUM_ERROR_SLOTS; ++slot) {
+        count += results[call][slot];
+    }
+
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CompositorInstrumentation::CompositorInstrumentation()
+    : m_start(std::chrono::steady_clock::now())
+    , m_last_frame_index(UINT64_MAX)
+    , m_num_frame_timings(0)
+    , m_num_dropped_frames(0)
+    , m_num_mispresented_frames(0)
+    , m_num_reprojected_frames(0)
+{
+    for (auto& call_results : m_results) {
+        for (std::atomic<uint64_t>& count : call_results) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+CompositorInstrumentation::record_frame_timing(const vr::Compositor_FrameTiming& timing)
+{
+    if (m_last_frame_index.exchange(timing.m_nFrameIndex, std::memory_order_relaxed) == timing.m_nFrameIndex) {
+        return;
+    }
+
+    const float durations[FrameTimingMetric_Count] = {
+        timing.m_flTotalRenderGpuMs,
+        timing.m_flCompositorRenderGpuMs,
+        timing.m_flCompositorRenderCpuMs,
+        timing.m_flClientFrameIntervalMs,
+        timing.m_flSubmitFrameMs,
+        timing.m_flWaitForPresentCpuMs,
+    };
+
+    for (size_t m = 0; m < FrameTimingMetric_Count; ++m) {
+        m_frame_timing[m].record(milliseconds_to_microseconds(durations[m]));
+    }
+
+    m_num_frame_timings.fetch_add(1, std::memory_order_relaxed);
+    m_num_dropped_frames.fetch_add(timing.m_nNumDroppedFrames, std::memory_order_relaxed);
+    m_num_mispresented_frames.fetch_add(timing.m_nNumMisPresented, std::memory_order_relaxed);
+    m_num_reprojected_frames.fetch_add(((timing.m_nReprojectionFlags != 0) ? 1 : 0), std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CompositorInstrumentation::Snapshot
+CompositorInstrumentation::snapshot() const
+{
+    Snapshot snapshot;
+
+    snapshot.time = elapsed_time();
+
+    for (size_t c = 0; c < CompositorCall_Count; ++c) {
+        snapshot.calls[c] = m_calls[c].snapshot();
+
+        for (size_t slot = 0; slot < NUM_ERROR_SLOTS; ++slot) {
+            snapshot.results[c][slot] = m_results[c][slot].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t m = 0; m < FrameTimingMetric_Count; ++m) {
+        snapshot.frame_timing[m] = m_frame_timing[m].snapshot();
+    }
+
+    snapshot.num_frame_timings = m_num_frame_timings.load(std::memory_order_relaxed);
+    snapshot.num_dropped_frames = m_num_dropped_frames.load(std::memory_order_relaxed);
+    snapshot.num_mispresented_frames = m_num_mispresented_frames.load(std::memory_order_relaxed);
+    snapshot.num_reprojected_frames = m_num_reprojected_frames.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+double
+CompositorInstrumentation::elapsed_time() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t
+CompositorInstrumentation::error_slot(vr::EVRCompositorError error)
+{
+    if ((error == vr::VRCompositorError_None) || (error == vr::VRCompositorError_RequestFailed)) {
+        return size_t(error);
+    }
+
+    if ((error >= vr::VRCompositorError_IncompatibleVersion) && (error <= vr::VRCompositorError_InvalidBounds)) {
+        return (2 + size_t(error - vr::VRCompositorError_IncompatibleVersion));
+    }
+
+    return (NUM_ERROR_SLOTS - 1);
+}
+
+vr::EVRCompositorError
+CompositorInstrumentation::error_of_slot(size_t slot)
+{
+    assert(slot < NUM_ERROR_SLOTS);
+
+    if (slot < 2) {
+        return vr::EVRCompositorError(slot);
+    }
+
+    return vr::EVRCompositorError(vr::VRCompositorError_IncompatibleVersion + (slot - 2));
+}
+
+const char*
+CompositorInstrumentation::call_name(CompositorCall call)
+{
+    switch (call) {
+        case CompositorCall_WaitGetPoses:       return "WaitGetPoses";
+        case CompositorCall_Submit:             return "Submit";
+        case CompositorCall_PostPresentHandoff: return "PostPresentHandoff";
+        default:                                return "Unknown";
+    }
+}
+
+const char*
+CompositorInstrumentation::metric_name(FrameTimingMetric metric)
+{
+    switch (metric) {
+        case FrameTimingMetric_TotalRenderGpu:      return "TotalRenderGpu";
+        case FrameTimingMetric_CompositorRenderGpu: return "CompositorRenderGpu";
+        case FrameTimingMetric_CompositorRenderCpu: return "CompositorRenderCpu";
+        case FrameTimingMetric_ClientFrameInterval: return "ClientFrameInterval";
+        case FrameTimingMetric_SubmitFrame:         return "SubmitFrame";
+        case FrameTimingMetric_WaitForPresentCpu:   return "WaitForPresentCpu";
+        default:                                    return "Unknown";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CompositorStatsExporter::CompositorStatsExporter(const CompositorInstrumentation& instrumentation,
+                                                 double interval,
+                                                 size_t capacity,
+                                                 const char* const path)
+    : m_instrumentation(instrumentation)
+    , m_interval(interval)
+    , m_capacity(capacity)
+    , m_stop(false)
+    , m_num_snapshots(0)
+{
+    if (not (interval > 0.0)) {
+        throw std::runtime_error("Invalid interval!");
+    }
+
+    if (capacity == 0) {
+        throw std::runtime_error("Invalid capacity!");
+    }
+
+    if (path) {
+        m_writer.reset(new BufferedFileWriter((1 << 16)));
+
+        if (not m_writer->open(path, true)) {
+            throw std::runtime_error("Failed to open compositor statistics file!");
+        }
+
+        write_snapshot_header_as_csv(*m_writer);
+        m_writer->flush();
+    }
+
+    m_thread = std::thread(&CompositorStatsExporter::run, this);
+}
+
+CompositorStatsExporter::~CompositorStatsExporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+    m_thread.join();
+
+    take_snapshot();
+
+    if (m_writer) {
+        m_writer->close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+CompositorStatsExporter::take_snapshot()
+{
+    const CompositorInstrumentation::Snapshot snapshot = m_instrumentation.snapshot();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_snapshots.size() == m_capacity) {
+        m_snapshots.pop_front();
+    }
+
+    m_snapshots.push_back(snapshot);
+    ++m_num_snapshots;
+
+    //------------------------------------------------------------------------------
+    // Flushed per row so the file can be followed while running.
+    if (m_writer) {
+        write_snapshot_as_csv(*m_writer, snapshot);
+        m_writer->flush();
+    }
+}
+
+std::vector<CompositorInstrumentation::Snapshot>
+CompositorStatsExporter::snapshots() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::vector<CompositorInstrumentation::Snapshot>(m_snapshots.begin(), m_snapshots.end());
+}
+
+uint64_t
+CompositorStatsExporter::num_snapshots() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_snapshots;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+CompositorStatsExporter::write_snapshot_header_as_csv(BufferedFileWriter& writer)
+{
+    writer.write_string("time");
+
+    for (size_t c = 0; c < CompositorCall_Count; ++c) {
+        const char* const name = CompositorInstrumentation::call_name(CompositorCall(c));
+
+        for (const char* const column : { " count", " mean ns", " p50 ns", " p99 ns", " p99.9 ns", " max ns" }) {
+            writer.write_char('\t');
+            writer.write_string(name);
+            writer.write_string(column);
+        }
+
+        for (size_t slot = 1; slot < CompositorInstrumentation::NUM_ERROR_SLOTS; ++slot) {
+            writer.write_char('\t');
+            writer.write_string(name);
+            writer.write_char(' ');
+            writer.write_string(OpenVRUtils::compositor_error_as_english_description(CompositorInstrumentation::error_of_slot(slot)));
+        }
+    }
+
+    for (size_t m = 0; m < FrameTimingMetric_Count; ++m) {
+        const char* const name = CompositorInstrumentation::metric_name(FrameTimingMetric(m));
+
+        for (const char* const column : { " p50 us", " p99 us", " max us" }) {
+            writer.write_char('\t');
+            writer.write_string(name);
+            writer.write_string(column);
+        }
+    }
+
+    writer.write_string("\tframes\tdropped\tmispresented\treprojected\n");
+}
+
+void
+CompositorStatsExporter::write_snapshot_as_csv(BufferedFileWriter& writer, const CompositorInstrumentation::Snapshot& snapshot)
+{
+    writer.write_float(float(snapshot.time));
+
+    for (size_t c = 0; c < CompositorCall_Count; ++c) {
+        const LatencyHistogram::Snapshot& histogram = snapshot.calls[c];
+
+        writer.write_char('\t');
+        writer.write_uint(histogram.count);
+        writer.write_char('\t');
+        writer.write_float(float(histogram.mean()));
+
+        for (const double fraction : { 0.5, 0.99, 0.999 }) {
+            writer.write_char('\t');
+            writer.write_uint(histogram.percentile(fraction));
+        }
+
+        writer.write_char('\t');
+        writer.write_uint(histogram.max);
+
+        for (size_t slot = 1; slot < CompositorInstrumentation::NUM_ERROR_SLOTS; ++slot) {
+            writer.write_char('\t');
+            writer.write_uint(snapshot.results[c][slot]);
+        }
+    }
+
+    for (size_t m = 0; m < FrameTimingMetric_Count; ++m) {
+        const LatencyHistogram::Snapshot& histogram = snapshot.frame_timing[m];
+
+        for (const double fraction : { 0.5, 0.99 }) {
+            writer.write_char('\t');
+            writer.write_uint(histogram.percentile(fraction));
+        }
+
+        writer.write_char('\t');
+        writer.write_uint(histogram.max);
+    }
+
+    for (const uint64_t count : { snapshot.num_frame_timings, snapshot.num_dropped_frames, snapshot.num_mispresented_frames, snapshot.num_reprojected_frames }) {
+        writer.write_char('\t');
+        writer.write_uint(count);
+    }
+
+    writer.write_char('\n');
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+CompositorStatsExporter::run()
+{
+    const auto interval = std::chrono::duration<double>(m_interval);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (not m_stop) {
+        if (m_wake.wait_for(lock, interval, [this]() { return m_stop; })) {
+            break;
+        }
+
+        lock.unlock();
+        take_snapshot();
+        lock.lock();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,383 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __COMPOSITOR_INSTRUMENTATION_H__
+#define __COMPOSITOR_INSTRUMENTATION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LatencyHistogram.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class BufferedFileWriter;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum CompositorCall {
+    CompositorCall_WaitGetPoses = 0,
+    CompositorCall_Submit,
+    CompositorCall_PostPresentHandoff,
+
+    CompositorCall_Count
+};
+
+//------------------------------------------------------------------------------
+// Compositor_FrameTiming durations recorded per frame, in microseconds.
+enum FrameTimingMetric {
+    FrameTimingMetric_TotalRenderGpu = 0,       // m_flTotalRenderGpuMs
+    FrameTimingMetric_CompositorRenderGpu,      // m_flCompositorRenderGpuMs
+    FrameTimingMetric_CompositorRenderCpu,      // m_flCompositorRenderCpuMs
+    FrameTimingMetric_ClientFrameInterval,      // m_flClientFrameIntervalMs
+    FrameTimingMetric_SubmitFrame,              // m_flSubmitFrameMs
+    FrameTimingMetric_WaitForPresentCpu,        // m_flWaitForPresentCpuMs
+
+    FrameTimingMetric_Count
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Compositor call latencies, results and frame timings.
+//
+// Latencies of WaitGetPoses(), Submit() and PostPresentHandoff() are recorded in
+// nanoseconds into LatencyHistograms and the VRCompositorError results of the
+// first two are counted per call and error. Sampled Compositor_FrameTimings are
+// recorded once per frame index. All recording is lock-free and does not
+// allocate, so it can be done on the render thread; snapshot() can be taken
+// from any other thread at the same time. See InstrumentedCompositor for
+// recording around the calls and CompositorStatsExporter for collecting
+// snapshots.
+//------------------------------------------------------------------------------
+
+class CompositorInstrumentation
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // Results are counted in slots: VRCompositorError_None, _RequestFailed, the
+    // errors from _IncompatibleVersion (100) to _InvalidBounds (109) and a last
+    // slot for any other value.
+    static constexpr size_t NUM_ERROR_SLOTS = 13;
+
+    struct Snapshot
+    {
+        double                          time = 0.0;         // Seconds since construction
+        LatencyHistogram::Snapshot      calls[CompositorCall_Count];
+        uint64_t                        results[CompositorCall_Count][NUM_ERROR_SLOTS] = {};
+        LatencyHistogram::Snapshot      frame_timing[FrameTimingMetric_Count];
+        uint64_t                        num_frame_timings = 0;
+        uint64_t                        num_dropped_frames = 0;
+        uint64_t                        num_mispresented_frames = 0;
+        uint64_t                        num_reprojected_frames = 0;
+
+        //------------------------------------------------------------------------------
+        // Calls of the given kind that returned an error other than _None.
+        uint64_t num_errors(CompositorCall call) const;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    CompositorInstrumentation();
+
+    CompositorInstrumentation(const CompositorInstrumentation&) = delete;
+    CompositorInstrumentation& operator=(const CompositorInstrumentation&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Recording
+public:
+
+    void record_call(CompositorCall call, uint64_t nanoseconds) { m_calls[call].record(nanoseconds); }
+
+    void record_result(CompositorCall call, vr::EVRCompositorError error)
+    {
+        m_results[call][error_slot(error)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //------------------------------------------------------------------------------
+    // Record the timing of a frame unless its frame index was recorded last.
+    void record_frame_timing(const vr::Compositor_FrameTiming& timing);
+
+    //------------------------------------------------------------------------------
+    // Access
+public:
+
+    Snapshot snapshot() const;
+
+    //------------------------------------------------------------------------------
+    // Seconds since construction on std::chrono::steady_clock.
+    double elapsed_time() const;
+
+    //------------------------------------------------------------------------------
+    // Names
+public:
+
+    static size_t error_slot(vr::EVRCompositorError error);
+
+    //------------------------------------------------------------------------------
+    // The error counted in the given slot, (VRCompositorError_InvalidBounds + 1)
+    // for the last slot.
+    static vr::EVRCompositorError error_of_slot(size_t slot);
+
+    static const char* call_name(CompositorCall call);
+    static const char* metric_name(FrameTimingMetric metric);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    const std::chrono::steady_clock::time_point     m_start;
+
+    LatencyHistogram                                m_calls[CompositorCall_Count];
+    std::atomic<uint64_t>                           m_results[CompositorCall_Count][NUM_ERROR_SLOTS];
+
+    LatencyHistogram                                m_frame_timing[FrameTimingMetric_Count];
+    std::atomic<uint64_t>                           m_last_frame_index;
+    std::atomic<uint64_t>                           m_num_frame_timings;
+    std::atomic<uint64_t>                           m_num_dropped_frames;
+    std::atomic<uint64_t>                           m_num_mispresented_frames;
+    std::atomic<uint64_t>                           m_num_reprojected_frames;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Forwards the frame loop calls to a compositor and records them into a
+// CompositorInstrumentation.
+//
+// 'Compositor' is vr::IVRCompositor or any type with the same WaitGetPoses(),
+// Submit(), PostPresentHandoff() and GetFrameTiming() methods, e.g.
+// SyntheticCompositor. Every 'frame_timing_interval' WaitGetPoses() calls (0 for
+// never) the timing of the previous frame, which is complete by then, is
+// sampled with GetFrameTiming() outside of the measured latency.
+//------------------------------------------------------------------------------
+
+template <typename Compositor>
+class InstrumentedCompositor
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    InstrumentedCompositor(Compositor* const compositor, CompositorInstrumentation& instrumentation, uint32_t frame_timing_interval = 1)
+        : m_compositor(compositor)
+        , m_instrumentation(instrumentation)
+        , m_frame_timing_interval(frame_timing_interval)
+    {
+    }
+
+    Compositor* compositor() const { return m_compositor; }
+    CompositorInstrumentation& instrumentation() const { return m_instrumentation; }
+
+    //------------------------------------------------------------------------------
+    // Compositor
+public:
+
+    vr::EVRCompositorError WaitGetPoses(vr::TrackedDevicePose_t* const render_poses,
+                                        uint32_t num_render_poses,
+                                        vr::TrackedDevicePose_t* const game_poses,
+                                        uint32_t num_game_poses)
+    {
+        const auto start = Clock::now();
+        const vr::EVRCompositorError error = m_compositor->WaitGetPoses(render_poses, num_render_poses, game_poses, num_game_poses);
+        const auto end = Clock::now();
+
+        record(CompositorCall_WaitGetPoses, start, end);
+        m_instrumentation.record_result(CompositorCall_WaitGetPoses, error);
+
+        if ((m_frame_timing_interval != 0) && ((++m_num_frames % m_frame_timing_interval) == 0)) {
+            sample_frame_timing();
+        }
+
+        return error;
+    }
+
+    vr::EVRCompositorError Submit(vr::EVREye eye,
+                                  const vr::Texture_t* const texture,
+                                  const vr::VRTextureBounds_t* const bounds = nullptr,
+                                  vr::EVRSubmitFlags flags = vr::Submit_Default)
+    {
+        const auto start = Clock::now();
+        const vr::EVRCompositorError error = m_compositor->Submit(eye, texture, bounds, flags);
+        const auto end = Clock::now();
+
+        record(CompositorCall_Submit, start, end);
+        m_instrumentation.record_result(CompositorCall_Submit, error);
+
+        return error;
+    }
+
+    void PostPresentHandoff()
+    {
+        const auto start = Clock::now();
+        m_compositor->PostPresentHandoff();
+        const auto end = Clock::now();
+
+        record(CompositorCall_PostPresentHandoff, start, end);
+    }
+
+    bool GetFrameTiming(vr::Compositor_FrameTiming* const timing, uint32_t frames_ago = 0)
+    {
+        return m_compositor->GetFrameTiming(timing, frames_ago);
+    }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    void record(CompositorCall call, Clock::time_point start, Clock::time_point end)
+    {
+        m_instrumentation.record_call(call, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+
+    void sample_frame_timing()
+    {
+        vr::Compositor_FrameTiming timing = {};
+        timing.m_nSize = sizeof(vr::Compositor_FrameTiming);
+
+        if (m_compositor->GetFrameTiming(&timing, 1)) {
+            m_instrumentation.record_frame_timing(timing);
+        }
+    }
+
+    Compositor*                     m_compositor;
+    CompositorInstrumentation&      m_instrumentation;
+    uint32_t                        m_frame_timing_interval;
+    uint64_t                        m_num_frames = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Takes snapshots of a CompositorInstrumentation on a background thread every
+// 'interval' seconds, keeping the most recent 'capacity' in memory and
+// optionally appending them to a CSV file (see write_snapshot_as_csv()). The
+// recording threads are never blocked; the snapshot ring is guarded by a mutex
+// only taken by the exporter and its readers. A final snapshot is taken on
+// destruction.
+//------------------------------------------------------------------------------
+
+class CompositorStatsExporter
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the interval is not positive, the capacity is 0 or the file can
+    // not be opened.
+    CompositorStatsExporter(const CompositorInstrumentation& instrumentation,
+                            double interval,
+                            size_t capacity,
+                            const char* const path = nullptr);
+
+    ~CompositorStatsExporter();
+
+    CompositorStatsExporter(const CompositorStatsExporter&) = delete;
+    CompositorStatsExporter& operator=(const CompositorStatsExporter&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Access
+public:
+
+    //------------------------------------------------------------------------------
+    // Take a snapshot now, in addition to the periodic ones.
+    void take_snapshot();
+
+    //------------------------------------------------------------------------------
+    // The retained snapshots, oldest first.
+    std::vector<CompositorInstrumentation::Snapshot> snapshots() const;
+
+    //------------------------------------------------------------------------------
+    // The number of snapshots taken so far (including those no longer retained).
+    uint64_t num_snapshots() const;
+
+    //------------------------------------------------------------------------------
+    // CSV Format
+public:
+
+    //------------------------------------------------------------------------------
+    // A snapshot as one tab separated row: the time, per call the count, mean,
+    // 50th/99th/99.9th percentile and maximum latency and the count of each error,
+    // per frame timing metric the 50th/99th percentile and maximum, and the frame
+    // counters. The header row names the columns.
+    static void write_snapshot_header_as_csv(BufferedFileWriter& writer);
+    static void write_snapshot_as_csv(BufferedFileWriter& writer, const CompositorInstrumentation::Snapshot& snapshot);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    void run();
+
+    const CompositorInstrumentation&                    m_instrumentation;
+    const double                                        m_interval;
+    const size_t                                        m_capacity;
+    std::unique_ptr<BufferedFileWriter>                 m_writer;
+
+    mutable std::mutex                                  m_mutex;
+    std::condition_variable                             m_wake;
+    bool                                                m_stop;
+    std::deque<CompositorInstrumentation::Snapshot>     m_snapshots;
+    uint64_t                                            m_num_snapshots;
+    std::thread                                         m_thread;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __COMPOSITOR_INSTRUMENTATION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,643 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    float clamp_distorted(float value)
+    {
+        return std::max(-1.0f, std::min(value, 2.0f));
+    }
+
+    //------------------------------------------------------------------------------
+    // Clamp a UV to [0, 1] before it is converted to a table index. NaN fails both
+    // comparisons and maps to 0.
+    float clamp_uv(float value)
+    {
+        return ((value > 0.0f) ? ((value < 1.0f) ? value : 1.0f) : 0.0f);
+    }
+
+    vr::DistortionCoordinates_t compute_distortion(vr::IVRSystem* const system, vr::EVREye eye, float u, float v)
+    {
+        vr::DistortionCoordinates_t xy;
+
+        if (not system->ComputeDistortion(eye, u, v, &xy)) {
+            xy = {};
+        }
+
+        for (size_t i = 0; i < 2; ++i) {
+            xy.rfRed[i]   = clamp_distorted(xy.rfRed[i]);
+            xy.rfGreen[i] = clamp_distorted(xy.rfGreen[i]);
+            xy.rfBlue[i]  = clamp_distorted(xy.rfBlue[i]);
+        }
+
+        return xy;
+    }
+
+    float distance(const float* const a, const float* const b)
+    {
+        const float du = (a[0] - b[0]);
+        const float dv = (a[1] - b[1]);
+
+        return std::sqrt((du * du) + (dv * dv));
+    }
+
+    //------------------------------------------------------------------------------
+    // Batch lookup of the given planes, one output array per plane. The arithmetic
+    // mirrors DistortionLUT::lookup().
+    void lookup_batch_planes_scalar(const float* const planes[],
+                                    size_t num_planes,
+                                    size_t width,
+                                    size_t height,
+                                    const float* const u,
+                                    const float* const v,
+                                    size_t count,
+                                    float* const output[])
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const float x = (clamp_uv(u[i]) * float(width - 1));
+            const float y = (clamp_uv(v[i]) * float(height - 1));
+
+            const size_t x0 = std::min(size_t(x), (width - 2));
+            const size_t y0 = std::min(size_t(y), (height - 2));
+
+            const float fx = (x - float(x0));
+            const float fy = (y - float(y0));
+
+            const float w00 = ((1.0f - fx) * (1.0f - fy));
+            const float w10 = (fx * (1.0f - fy));
+            const float w01 = ((1.0f - fx) * fy);
+            const float w11 = (fx * fy);
+
+            const size_t i00 = ((y0 * width) + x0);
+            const size_t i10 = (i00 + 1);
+            const size_t i01 = (i00 + width);
+            const size_t i11 = (i01 + 1);
+
+            for (size_t c = 0; c < num_planes; ++c) {
+                const float* const plane = planes[c];
+                output[c][i] = clamp_distorted((plane[i00] * w00) + (plane[i10] * w10) + (plane[i01] * w01) + (plane[i11] * w11));
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Batch lookup kernels. Each kernel processes as many full vectors as fit into
+    // 'count' and returns the number of UVs processed, the remainder is left to
+    // the scalar implementation. The arithmetic mirrors DistortionLUT::lookup().
+
+#if defined(__AVX2__)
+
+    size_t lookup_batch_avx2(const float* const planes[],
+                             size_t num_planes,
+                             size_t width,
+                             size_t height,
+                             const float* const u,
+                             const float* const v,
+                             size_t count,
+                             float* const output[])
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 lower_bound = _mm256_set1_ps(-1.0f);
+        const __m256 upper_bound = _mm256_set1_ps(2.0f);
+
+        const __m256 scale_x = _mm256_set1_ps(float(width - 1));
+        const __m256 scale_y = _mm256_set1_ps(float(height - 1));
+        const __m256 max_x0 = _mm256_set1_ps(float(width - 2));
+        const __m256 max_y0 = _mm256_set1_ps(float(height - 2));
+
+        const __m256i stride = _mm256_set1_epi32(int32_t(width));
+        const __m256i one_i = _mm256_set1_epi32(1);
+
+        size_t i = 0;
+
+        for (; (i + 8) <= count; i += 8) {
+            //------------------------------------------------------------------------------
+            // min/max return their second operand if either is NaN, so NaN passes the
+            // min and is replaced by 0 by the max, like clamp_uv().
+            const __m256 x = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(one, _mm256_loadu_ps(u + i)), zero), scale_x);
+            const __m256 y = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(one, _mm256_loadu_ps(v + i)), zero), scale_y);
+
+            const __m256i x0 = _mm256_cvttps_epi32(_mm256_min_ps(x, max_x0));
+            const __m256i y0 = _mm256_cvttps_epi32(_mm256_min_ps(y, max_y0));
+
+            const __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(x0));
+            const __m256 fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+            const __m256 gx = _mm256_sub_ps(one, fx);
+            const __m256 gy = _mm256_sub_ps(one, fy);
+
+            const __m256 w00 = _mm256_mul_ps(gx, gy);
+            const __m256 w10 = _mm256_mul_ps(fx, gy);
+            const __m256 w01 = _mm256_mul_ps(gx, fy);
+            const __m256 w11 = _mm256_mul_ps(fx, fy);
+
+            const __m256i i00 = _mm256_add_epi32(_mm256_mullo_epi32(y0, stride), x0);
+            const __m256i i10 = _mm256_add_epi32(i00, one_i);
+            const __m256i i01 = _mm256_add_epi32(i00, stride);
+            const __m256i i11 = _mm256_add_epi32(i01, one_i);
+
+            for (size_t c = 0; c < num_planes; ++c) {
+                const float* const plane = planes[c];
+
+                __m256 result = _mm256_mul_ps(_mm256_i32gather_ps(plane, i00, 4), w00);
+                result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_i32gather_ps(plane, i10, 4), w10));
+                result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_i32gather_ps(plane, i01, 4), w01));
+                result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_i32gather_ps(plane, i11, 4), w11));
+
+                _mm256_storeu_ps((output[c] + i), _mm256_max_ps(lower_bound, _mm256_min_ps(result, upper_bound)));
+            }
+        }
+
+        return i;
+    }
+
+#elif defined(__SSE2__)
+
+    size_t lookup_batch_sse2(const float* const planes[],
+                             size_t num_planes,
+                             size_t width,
+                             size_t height,
+                             const float* const u,
+                             const float* const v,
+                             size_t count,
+                             float* const output[])
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 lower_bound = _mm_set1_ps(-1.0f);
+        const __m128 upper_bound = _mm_set1_ps(2.0f);
+
+        const __m128 scale_x = _mm_set1_ps(float(width - 1));
+        const __m128 scale_y = _mm_set1_ps(float(height - 1));
+        const __m128 max_x0 = _mm_set1_ps(float(width - 2));
+        const __m128 max_y0 = _mm_set1_ps(float(height - 2));
+
+        size_t i = 0;
+
+        for (; (i + 4) <= count; i += 4) {
+            //------------------------------------------------------------------------------
+            // min/max return their second operand if either is NaN, so NaN passes the
+            // min and is replaced by 0 by the max, like clamp_uv().
+            const __m128 x = _mm_mul_ps(_mm_max_ps(_mm_min_ps(one, _mm_loadu_ps(u + i)), zero), scale_x);
+            const __m128 y = _mm_mul_ps(_mm_max_ps(_mm_min_ps(one, _mm_loadu_ps(v + i)), zero), scale_y);
+
+            const __m128i x0 = _mm_cvttps_epi32(_mm_min_ps(x, max_x0));
+            const __m128i y0 = _mm_cvttps_epi32(_mm_min_ps(y, max_y0));
+
+            const __m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(x0));
+            const __m128 fy = _mm_sub_ps(y, _mm_cvtepi32_ps(y0));
+            const __m128 gx = _mm_sub_ps(one, fx);
+            const __m128 gy = _mm_sub_ps(one, fy);
+
+            const __m128 w00 = _mm_mul_ps(gx, gy);
+            const __m128 w10 = _mm_mul_ps(fx, gy);
+            const __m128 w01 = _mm_mul_ps(gx, fy);
+            const __m128 w11 = _mm_mul_ps(fx, fy);
+
+            //------------------------------------------------------------------------------
+            // SSE2 has neither a 32-bit multiply nor gathers so the indices are formed
+            // and the samples loaded per lane.
+            alignas(16) int32_t x0s[4];
+            alignas(16) int32_t y0s[4];
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(x0s), x0);
+            _mm_store_si128(reinterpret_cast<__m128i*>(y0s), y0);
+
+            size_t i00[4];
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                i00[lane] = ((size_t(y0s[lane]) * width) + size_t(x0s[lane]));
+            }
+
+            for (size_t c = 0; c < num_planes; ++c) {
+                const float* const p = planes[c];
+
+                const __m128 p00 = _mm_setr_ps(p[i00[0]], p[i00[1]], p[i00[2]], p[i00[3]]);
+                const __m128 p10 = _mm_setr_ps(p[i00[0] + 1], p[i00[1] + 1], p[i00[2] + 1], p[i00[3] + 1]);
+                const __m128 p01 = _mm_setr_ps(p[i00[0] + width], p[i00[1] + width], p[i00[2] + width], p[i00[3] + width]);
+                const __m128 p11 = _mm_setr_ps(p[i00[0] + width + 1], p[i00[1] + width + 1], p[i00[2] + width + 1], p[i00[3] + width + 1]);
+
+                __m128 result = _mm_mul_ps(p00, w00);
+                result = _mm_add_ps(result, _mm_mul_ps(p10, w10));
+                result = _mm_add_ps(result, _mm_mul_ps(p01, w01));
+                result = _mm_add_ps(result, _mm_mul_ps(p11, w11));
+
+                _mm_storeu_ps((output[c] + i), _mm_max_ps(lower_bound, _mm_min_ps(result, upper_bound)));
+            }
+        }
+
+        return i;
+    }
+
+#elif defined(__ARM_NEON)
+
+    size_t lookup_batch_neon(const float* const planes[],
+                             size_t num_planes,
+                             size_t width,
+                             size_t height,
+                             const float* const u,
+                             const float* const v,
+                             size_t count,
+                             float* const output[])
+    {
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t lower_bound = vdupq_n_f32(-1.0f);
+        const float32x4_t upper_bound = vdupq_n_f32(2.0f);
+
+        const float32x4_t scale_x = vdupq_n_f32(float(width - 1));
+        const float32x4_t scale_y = vdupq_n_f32(float(height - 1));
+        const float32x4_t max_x0 = vdupq_n_f32(float(width - 2));
+        const float32x4_t max_y0 = vdupq_n_f32(float(height - 2));
+
+        size_t i = 0;
+
+        for (; (i + 4) <= count; i += 4) {
+            //------------------------------------------------------------------------------
+            // vminq propagates NaN and vmaxnmq replaces it by 0, like clamp_uv().
+            const float32x4_t x = vmulq_f32(vmaxnmq_f32(zero, vminq_f32(vld1q_f32(u + i), one)), scale_x);
+            const float32x4_t y = vmulq_f32(vmaxnmq_f32(zero, vminq_f32(vld1q_f32(v + i), one)), scale_y);
+
+            const int32x4_t x0 = vcvtq_s32_f32(vminq_f32(x, max_x0));
+            const int32x4_t y0 = vcvtq_s32_f32(vminq_f32(y, max_y0));
+
+            const float32x4_t fx = vsubq_f32(x, vcvtq_f32_s32(x0));
+            const float32x4_t fy = vsubq_f32(y, vcvtq_f32_s32(y0));
+            const float32x4_t gx = vsubq_f32(one, fx);
+            const float32x4_t gy = vsubq_f32(one, fy);
+
+            const float32x4_t w00 = vmulq_f32(gx, gy);
+            const float32x4_t w10 = vmulq_f32(fx, gy);
+            const float32x4_t w01 = vmulq_f32(gx, fy);
+            const float32x4_t w11 = vmulq_f32(fx, fy);
+
+            //------------------------------------------------------------------------------
+            // NEON has no gathers so the samples are loaded per lane.
+            int32_t x0s[4];
+            int32_t y0s[4];
+
+            vst1q_s32(x0s, x0);
+            vst1q_s32(y0s, y0);
+
+            size_t i00[4];
+
+            for (size_t lane = 0; lane < 4; ++lane) {
+                i00[lane] = ((size_t(y0s[lane]) * width) + size_t(x0s[lane]));
+            }
+
+            for (size_t c = 0; c < num_planes; ++c) {
+                const float* const p = planes[c];
+
+                const float s00[4] = { p[i00[0]], p[i00[1]], p[i00[2]], p[i00[3]] };
+                const float s10[4] = { p[i00[0] + 1], p[i00[1] + 1], p[i00[2] + 1], p[i00[3] + 1] };
+                const float s01[4] = { p[i00[0] + width], p[i00[1] + width], p[i00[2] + width], p[i00[3] + width] };
+                const float s11[4] = { p[i00[0] + width + 1], p[i00[1] + width + 1], p[i00[2] + width + 1], p[i00[3] + width + 1] };
+
+                float32x4_t result = vmulq_f32(vld1q_f32(s00), w00);
+                result = vaddq_f32(result, vmulq_f32(vld1q_f32(s10), w10));
+                result = vaddq_f32(result, vmulq_f32(vld1q_f32(s01), w01));
+                result = vaddq_f32(result, vmulq_f32(vld1q_f32(s11), w11));
+
+                vst1q_f32((output[c] + i), vmaxq_f32(lower_bound, vminq_f32(result, upper_bound)));
+            }
+        }
+
+        return i;
+    }
+
+#endif
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DistortionLUT::DistortionLUT(vr::IVRSystem* const system, size_t width, size_t height, ThreadPool* const pool)
+    : m_width(width)
+    , m_height(height)
+{
+    if (not system) {
+        throw std::runtime_error("Invalid system!");
+    }
+
+    if ((width < 2) || (height < 2)) {
+        throw std::runtime_error("Invalid distortion LUT size!");
+    }
+
+    const size_t plane_size = (width * height);
+
+    m_tables[vr::Eye_Left].resize(plane_size * Channel_Count);
+    m_tables[vr::Eye_Right].resize(plane_size * Channel_Count);
+
+    //------------------------------------------------------------------------------
+    // One work item per row of either eye.
+    const auto sample_row = [&](size_t row_index) {
+        const vr::EVREye eye = ((row_index < height) ? vr::Eye_Left : vr::Eye_Right);
+        const size_t y = (row_index % height);
+        const float v = (float(y) / float(height - 1));
+
+        float* const table = m_tables[eye].data();
+
+        for (size_t x = 0; x < width; ++x) {
+            const float u = (float(x) / float(width - 1));
+            const vr::DistortionCoordinates_t xy = compute_distortion(system, eye, u, v);
+            const size_t index = ((y * width) + x);
+
+            table[(plane_size * Channel_RedU)   + index] = xy.rfRed[0];
+            table[(plane_size * Channel_RedV)   + index] = xy.rfRed[1];
+            table[(plane_size * Channel_GreenU) + index] = xy.rfGreen[0];
+            table[(plane_size * Channel_GreenV) + index] = xy.rfGreen[1];
+            table[(plane_size * Channel_BlueU)  + index] = xy.rfBlue[0];
+            table[(plane_size * Channel_BlueV)  + index] = xy.rfBlue[1];
+        }
+    };
+
+    if (pool) {
+        pool->parallel_for((2 * height), sample_row);
+    }
+    else {
+        for (size_t row_index = 0; row_index < (2 * height); ++row_index) {
+            sample_row(row_index);
+        }
+    }
+}
+
+DistortionLUT::DistortionLUT(size_t width, size_t height, const float* const left_table, const float* const right_table)
+    : m_width(width)
+    , m_height(height)
+{
+    if ((width < 2) || (height < 2)) {
+        throw std::runtime_error("Invalid distortion LUT size!");
+    }
+
+    if ((not left_table) || (not right_table)) {
+        throw std::runtime_error("Invalid distortion LUT tables!");
+    }
+
+    m_external_tables[vr::Eye_Left] = left_table;
+    m_external_tables[vr::Eye_Right] = right_table;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::DistortionCoordinates_t
+DistortionLUT::lookup(vr::EVREye eye, float u, float v) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+
+    //------------------------------------------------------------------------------
+    // Locate the cell and the weights within it. The last row/column is handled by
+    // clamping the cell index and letting the weight reach 1.
+    const float x = (clamp_uv(u) * float(m_width - 1));
+    const float y = (clamp_uv(v) * float(m_height - 1));
+
+    const size_t x0 = std::min(size_t(x), (m_width - 2));
+    const size_t y0 = std::min(size_t(y), (m_height - 2));
+
+    const float fx = (x - float(x0));
+    const float fy = (y - float(y0));
+
+    const float w00 = ((1.0f - fx) * (1.0f - fy));
+    const float w10 = (fx * (1.0f - fy));
+    const float w01 = ((1.0f - fx) * fy);
+    const float w11 = (fx * fy);
+
+    const size_t i00 = ((y0 * m_width) + x0);
+    const size_t i10 = (i00 + 1);
+    const size_t i01 = (i00 + m_width);
+    const size_t i11 = (i01 + 1);
+
+    //------------------------------------------------------------------------------
+    // Interpolate each plane.
+    float result[Channel_Count];
+
+    for (size_t c = 0; c < Channel_Count; ++c) {
+        const float* const plane = channel(eye, Channel(c));
+        result[c] = ((plane[i00] * w00) + (plane[i10] * w10) + (plane[i01] * w01) + (plane[i11] * w11));
+    }
+
+    vr::DistortionCoordinates_t xy;
+
+    xy.rfRed[0]   = result[Channel_RedU];
+    xy.rfRed[1]   = result[Channel_RedV];
+    xy.rfGreen[0] = result[Channel_GreenU];
+    xy.rfGreen[1] = result[Channel_GreenV];
+    xy.rfBlue[0]  = result[Channel_BlueU];
+    xy.rfBlue[1]  = result[Channel_BlueV];
+
+    return xy;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+DistortionLUT::lookup_batch(vr::EVREye eye,
+                            const float* const u,
+                            const float* const v,
+                            size_t count,
+                            float* const output[Channel_Count]) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+
+    const float* const planes[Channel_Count] = {
+        channel(eye, Channel_RedU),
+        channel(eye, Channel_RedV),
+        channel(eye, Channel_GreenU),
+        channel(eye, Channel_GreenV),
+        channel(eye, Channel_BlueU),
+        channel(eye, Channel_BlueV),
+    };
+
+    lookup_batch_planes(planes, Channel_Count, u, v, count, output);
+}
+
+void
+DistortionLUT::lookup_batch_color(vr::EVREye eye,
+                                  Channel channel_u,
+                                  const float* const u,
+                                  const float* const v,
+                                  size_t count,
+                                  float* const output[2]) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+    assert((channel_u == Channel_RedU) || (channel_u == Channel_GreenU) || (channel_u == Channel_BlueU));
+
+    const float* const planes[2] = {
+        channel(eye, channel_u),
+        channel(eye, Channel(channel_u + 1)),
+    };
+
+    lookup_batch_planes(planes, 2, u, v, count, output);
+}
+
+void
+DistortionLUT::lookup_batch_scalar(vr::EVREye eye,
+                                   const float* const u,
+                                   const float* const v,
+                                   size_t count,
+                                   float* const output[Channel_Count]) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        const vr::DistortionCoordinates_t xy = lookup(eye, u[i], v[i]);
+
+        output[Channel_RedU][i]   = clamp_distorted(xy.rfRed[0]);
+        output[Channel_RedV][i]   = clamp_distorted(xy.rfRed[1]);
+        output[Channel_GreenU][i] = clamp_distorted(xy.rfGreen[0]);
+        output[Channel_GreenV][i] = clamp_distorted(xy.rfGreen[1]);
+        output[Channel_BlueU][i]  = clamp_distorted(xy.rfBlue[0]);
+        output[Channel_BlueV][i]  = clamp_distorted(xy.rfBlue[1]);
+    }
+}
+
+void
+DistortionLUT::lookup_batch_planes(const float* const planes[],
+                                   size_t num_planes,
+                                   const float* const u,
+                                   const float* const v,
+                                   size_t count,
+                                   float* const output[]) const
+{
+    size_t processed = 0;
+
+#if defined(__AVX2__)
+    //------------------------------------------------------------------------------
+    // Gather indices are 32-bit.
+    if ((m_width * m_height) <= size_t(INT32_MAX)) {
+        processed = lookup_batch_avx2(planes, num_planes, m_width, m_height, u, v, count, output);
+    }
+#elif defined(__SSE2__)
+    processed = lookup_batch_sse2(planes, num_planes, m_width, m_height, u, v, count, output);
+#elif defined(__ARM_NEON)
+    processed = lookup_batch_neon(planes, num_planes, m_width, m_height, u, v, count, output);
+#endif
+
+    //------------------------------------------------------------------------------
+    // Remainder.
+    if (processed < count) {
+        float* remaining_output[Channel_Count];
+
+        for (size_t c = 0; c < num_planes; ++c) {
+            remaining_output[c] = (output[c] + processed);
+        }
+
+        lookup_batch_planes_scalar(planes, num_planes, m_width, m_height, (u + processed), (v + processed), (count - processed), remaining_output);
+    }
+}
+
+const char*
+DistortionLUT::batch_kernel_name()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DistortionLUT::ErrorReport
+DistortionLUT::compute_error_report(vr::IVRSystem* const system, vr::EVREye eye, size_t num_samples) const
+{
+    assert(system);
+
+    ErrorReport report;
+
+    if ((not system) || (num_samples == 0)) {
+        return report;
+    }
+
+    double sum_error = 0.0;
+    double sum_squared_error = 0.0;
+
+    for (size_t y = 0; y < num_samples; ++y) {
+        const float v = ((float(y) + 0.5f) / float(num_samples));
+
+        for (size_t x = 0; x < num_samples; ++x) {
+            const float u = ((float(x) + 0.5f) / float(num_samples));
+
+            const vr::DistortionCoordinates_t expected = compute_distortion(system, eye, u, v);
+            const vr::DistortionCoordinates_t actual = lookup(eye, u, v);
+
+            const float error = std::max({ distance(expected.rfRed, actual.rfRed),
+                                           distance(expected.rfGreen, actual.rfGreen),
+                                           distance(expected.rfBlue, actual.rfBlue) });
+
+            sum_error += error;
+            sum_squared_error += (double(error) * double(error));
+
+            if (error > report.max_error) {
+                report.max_error = error;
+                report.max_error_u = u;
+                report.max_error_v = v;
+            }
+        }
+    }
+
+    report.num_samples = (num_samples * num_samples);
+    report.mean_error = float(sum_error / double(report.num_samples));
+    report.rms_error = float(std::sqrt(sum_squared_error / double(report.num_samples)));
+
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,215 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DISTORTION_LUT_H__
+#define __DISTORTION_LUT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Precomputed lens distortion lookup table.
+//
+// Each eye is sampled once via IVRSystem::ComputeDistortion() on a regular grid
+// of (width x height) samples covering [0, 1] x [0, 1]. The distorted red/green/
+// blue coordinates are stored as six separate planes (structure of arrays) per
+// eye and clamped to [-1, 2] like the CSV export in OpenVRUtils. Lookups are
+// bilinearly interpolated from the four surrounding samples and do not touch
+// OpenVR.
+//------------------------------------------------------------------------------
+
+class DistortionLUT
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // The planes stored per eye, in order.
+    enum Channel {
+        Channel_RedU = 0,
+        Channel_RedV,
+        Channel_GreenU,
+        Channel_GreenV,
+        Channel_BlueU,
+        Channel_BlueV,
+
+        Channel_Count
+    };
+
+    //------------------------------------------------------------------------------
+    // Deviation of interpolated lookups from direct ComputeDistortion() results.
+    // Errors are Euclidean distances in distorted UV space, taken as the maximum
+    // over the three color channels of each sample.
+    struct ErrorReport
+    {
+        size_t      num_samples = 0;
+        float       max_error = 0.0f;
+        float       mean_error = 0.0f;
+        float       rms_error = 0.0f;
+        float       max_error_u = 0.0f;     // Location of the maximum error
+        float       max_error_v = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Sample both eyes of the given system on a grid of the given size. Both
+    // dimensions must be at least 2.
+    //
+    // If a thread pool is given the rows of both eyes are sampled concurrently on
+    // the pool, which requires the system to support concurrent calls to
+    // ComputeDistortion(). Each sample is written to a fixed location so the
+    // result does not depend on the number of threads.
+    DistortionLUT(vr::IVRSystem* const system, size_t width, size_t height, ThreadPool* const pool = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Use existing tables of both eyes, each holding the six planes in the layout
+    // of channel(), without copying them (e.g. from a memory mapped file). The
+    // tables must outlive the LUT.
+    DistortionLUT(size_t width, size_t height, const float* const left_table, const float* const right_table);
+
+    //------------------------------------------------------------------------------
+    // Lookup
+public:
+
+    //------------------------------------------------------------------------------
+    // Bilinearly interpolated distortion for the given eye. UVs outside [0, 1] are
+    // clamped to the edge of the table, NaN is treated as 0.
+    vr::DistortionCoordinates_t lookup(vr::EVREye eye, float u, float v) const;
+
+    //------------------------------------------------------------------------------
+    // Batch Lookup
+public:
+
+    //------------------------------------------------------------------------------
+    // Look up 'count' UVs given as separate u/v arrays for the given eye and write
+    // the results to the given per-channel output arrays (indexed by Channel, each
+    // holding 'count' floats). Results are clamped to [-1, 2].
+    //
+    // Uses AVX2, SSE2 or NEON depending on the instruction set the file is compiled
+    // for and falls back to lookup_batch_scalar() otherwise.
+    void lookup_batch(vr::EVREye eye,
+                      const float* const u,
+                      const float* const v,
+                      size_t count,
+                      float* const output[Channel_Count]) const;
+
+    //------------------------------------------------------------------------------
+    // lookup_batch() of the u and v channels of one color only, given by its u
+    // channel (Channel_RedU, Channel_GreenU or Channel_BlueU), written to
+    // output[0] and output[1].
+    void lookup_batch_color(vr::EVREye eye,
+                            Channel channel_u,
+                            const float* const u,
+                            const float* const v,
+                            size_t count,
+                            float* const output[2]) const;
+
+    //------------------------------------------------------------------------------
+    // Scalar implementation of lookup_batch(). Produces the same results (up to
+    // rounding) and is mainly useful as a reference.
+    void lookup_batch_scalar(vr::EVREye eye,
+                             const float* const u,
+                             const float* const v,
+                             size_t count,
+                             float* const output[Channel_Count]) const;
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by lookup_batch() ("AVX2", "SSE2", "NEON" or
+    // "Scalar").
+    static const char* batch_kernel_name();
+
+    //------------------------------------------------------------------------------
+    // Table Access
+public:
+
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+
+    //------------------------------------------------------------------------------
+    // A plane of (width x height) samples in row-major order.
+    const float* channel(vr::EVREye eye, Channel channel) const
+    {
+        const float* const table = (m_tables[eye].empty() ? m_external_tables[eye] : m_tables[eye].data());
+        return (table + (m_width * m_height * channel));
+    }
+
+    //------------------------------------------------------------------------------
+    // The memory used by both eyes' tables in bytes.
+    size_t size_in_bytes() const { return (sizeof(float) * 2 * m_width * m_height * Channel_Count); }
+
+    //------------------------------------------------------------------------------
+    // Error Analysis
+public:
+
+    //------------------------------------------------------------------------------
+    // Compare lookups against ComputeDistortion() at the centers of the cells of a
+    // (num_samples x num_samples) grid over [0, 1]. The samples are independent
+    // of the table layout, they only fall in between table entries where the
+    // grids happen not to align.
+    ErrorReport compute_error_report(vr::IVRSystem* const system, vr::EVREye eye, size_t num_samples) const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    //------------------------------------------------------------------------------
+    // Batch lookup of up to Channel_Count planes of one eye.
+    void lookup_batch_planes(const float* const planes[],
+                             size_t num_planes,
+                             const float* const u,
+                             const float* const v,
+                             size_t count,
+                             float* const output[]) const;
+
+    size_t                  m_width;
+    size_t                  m_height;
+    std::vector<float>      m_tables[2];                        // Empty if the tables are not owned
+    const float*            m_external_tables[2] = {};
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __DISTORTION_LUT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,566 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionMesh.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+#include "MeshProcessing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_VALUES = 6;                // Red, green, blue UV
+    constexpr uint32_t LATTICE_SCALE = 4;           // Lattice steps per finest cell
+    constexpr uint32_t COVERAGE_SIZE = 256;         // Hidden area coverage resolution
+
+    float clamp_distorted(float value) { return std::max(-1.0f, std::min(value, 2.0f)); }
+
+    //------------------------------------------------------------------------------
+    // Distortion of the given display UV in NUM_VALUES layout, clamped to [-1, 2]
+    // like DistortionLUT.
+    void compute_distortion(vr::IVRSystem* const system, vr::EVREye eye, float u, float v, float values[NUM_VALUES])
+    {
+        vr::DistortionCoordinates_t xy;
+
+        if (not system->ComputeDistortion(eye, u, v, &xy)) {
+            xy = {};
+        }
+
+        values[0] = clamp_distorted(xy.rfRed[0]);
+        values[1] = clamp_distorted(xy.rfRed[1]);
+        values[2] = clamp_distorted(xy.rfGreen[0]);
+        values[3] = clamp_distorted(xy.rfGreen[1]);
+        values[4] = clamp_distorted(xy.rfBlue[0]);
+        values[5] = clamp_distorted(xy.rfBlue[1]);
+    }
+
+    //------------------------------------------------------------------------------
+    // The largest distance between two NUM_VALUES sets over the three channels.
+    float channel_distance(const float* const a, const float* const b)
+    {
+        float distance = 0.0f;
+
+        for (size_t c = 0; c < NUM_VALUES; c += 2) {
+            distance = std::max(distance, std::hypot((a[c] - b[c]), (a[c + 1] - b[c + 1])));
+        }
+
+        return distance;
+    }
+
+    //------------------------------------------------------------------------------
+    // Lazily evaluated distortion on a ((size + 1) x (size + 1)) lattice of
+    // display UVs. Every point the tree may test is a lattice point, so each is
+    // evaluated at most once.
+    class DistortionLattice
+    {
+    public:
+
+        DistortionLattice(vr::IVRSystem* const system, vr::EVREye eye, uint32_t size)
+            : m_system(system)
+            , m_eye(eye)
+            , m_size(size)
+            , m_values(((size_t(size) + 1) * (size_t(size) + 1) * NUM_VALUES), 0.0f)
+            , m_evaluated(((size_t(size) + 1) * (size_t(size) + 1)), 0)
+        {
+        }
+
+        uint32_t size() const { return m_size; }
+        size_t num_evaluations() const { return m_num_evaluations; }
+
+        uint32_t index(uint32_t x, uint32_t y) const { return ((y * (m_size + 1)) + x); }
+
+        const float* at(uint32_t index)
+        {
+            float* const values = (m_values.data() + (size_t(index) * NUM_VALUES));
+
+            if (not m_evaluated[index]) {
+                const uint32_t x = (index % (m_size + 1));
+                const uint32_t y = (index / (m_size + 1));
+
+                compute_distortion(m_system, m_eye, (float(x) / float(m_size)), (float(y) / float(m_size)), values);
+                m_evaluated[index] = 1;
+                ++m_num_evaluations;
+            }
+
+            return values;
+        }
+
+        const float* at(uint32_t x, uint32_t y) { return at(index(x, y)); }
+
+    private:
+
+        vr::IVRSystem*          m_system;
+        vr::EVREye              m_eye;
+        uint32_t                m_size;
+        std::vector<float>      m_values;
+        std::vector<uint8_t>    m_evaluated;
+        size_t                  m_num_evaluations = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // A quadtree cell: (x, y) in units of cells at its depth.
+    struct Cell
+    {
+        uint32_t    depth;
+        uint32_t    x;
+        uint32_t    y;
+    };
+
+    //------------------------------------------------------------------------------
+    // Interpolation error of a cell of 'size' lattice steps at (x0, y0), split into
+    // two triangles along the diagonal from the top-left to the bottom-right.
+    float compute_cell_error(DistortionLattice& lattice, uint32_t x0, uint32_t y0, uint32_t size)
+    {
+        const float* const c00 = lattice.at(x0, y0);
+        const float* const c10 = lattice.at((x0 + size), y0);
+        const float* const c01 = lattice.at(x0, (y0 + size));
+        const float* const c11 = lattice.at((x0 + size), (y0 + size));
+
+        const uint32_t step = (size / 4);
+        float error = 0.0f;
+
+        for (uint32_t b = 0; b <= 4; ++b) {
+            for (uint32_t a = 0; a <= 4; ++a) {
+                if (((a == 0) || (a == 4)) && ((b == 0) || (b == 4))) {
+                    continue;
+                }
+
+                const float fx = (float(a) / 4.0f);
+                const float fy = (float(b) / 4.0f);
+                float predicted[NUM_VALUES];
+
+                for (size_t c = 0; c < NUM_VALUES; ++c) {
+                    predicted[c] = ((fx >= fy) ? (c00[c] + (fx * (c10[c] - c00[c])) + (fy * (c11[c] - c10[c])))
+                                               : (c00[c] + (fy * (c01[c] - c00[c])) + (fx * (c11[c] - c01[c]))));
+                }
+
+                error = std::max(error, channel_distance(predicted, lattice.at((x0 + (a * step)), (y0 + (b * step)))));
+            }
+        }
+
+        return error;
+    }
+
+    //------------------------------------------------------------------------------
+    // Depth of the cell covering each of the (size x size) finest cells.
+    class DepthMap
+    {
+    public:
+
+        explicit DepthMap(uint32_t max_depth)
+            : m_size(1u << max_depth)
+            , m_depths((size_t(m_size) * m_size), 0)
+        {
+        }
+
+        uint32_t size() const { return m_size; }
+
+        uint32_t depth(uint32_t x, uint32_t y) const { return m_depths[(size_t(y) * m_size) + x]; }
+
+        //------------------------------------------------------------------------------
+        // The range of finest cells covered by the given cell.
+        uint32_t span(const Cell& cell) const { return (m_size >> cell.depth); }
+
+        void set(const Cell& cell, uint32_t depth)
+        {
+            const uint32_t n = span(cell);
+
+            for (uint32_t y = (cell.y * n); y < ((cell.y + 1) * n); ++y) {
+                std::fill_n((m_depths.begin() + (size_t(y) * m_size) + (cell.x * n)), n, uint8_t(depth));
+            }
+        }
+
+        std::vector<Cell> leaves() const
+        {
+            std::vector<Cell> leaves;
+            std::vector<Cell> stack = { { 0, 0, 0 } };
+
+            while (not stack.empty()) {
+                const Cell cell = stack.back();
+                stack.pop_back();
+
+                const uint32_t n = span(cell);
+
+                if (depth((cell.x * n), (cell.y * n)) == cell.depth) {
+                    leaves.push_back(cell);
+                    continue;
+                }
+
+                for (uint32_t i = 4; i-- > 0; ) {
+                    stack.push_back({ (cell.depth + 1), ((2 * cell.x) + (i % 2)), ((2 * cell.y) + (i / 2)) });
+                }
+            }
+
+            return leaves;
+        }
+
+    private:
+
+        uint32_t                m_size;
+        std::vector<uint8_t>    m_depths;
+    };
+
+    //------------------------------------------------------------------------------
+    // Render target UVs well inside the hidden area: a pixel of the coverage mask
+    // counts only if it and its eight neighbors are hidden, which absorbs the
+    // resolution of the mask and of the edge midpoint test.
+    class HiddenRegion
+    {
+    public:
+
+        explicit HiddenRegion(const vr::HiddenAreaMesh_t& mesh)
+            : m_hidden((COVERAGE_SIZE * COVERAGE_SIZE), 0)
+        {
+            if ((not mesh.pVertexData) || (mesh.unTriangleCount == 0)) {
+                return;
+            }
+
+            std::vector<uint64_t> coverage;
+            HiddenAreaTileMask::rasterize_coverage(mesh, COVERAGE_SIZE, COVERAGE_SIZE, coverage);
+
+            const size_t row_words = HiddenAreaTileMask::coverage_row_words(COVERAGE_SIZE);
+
+            const auto covered = [&](int x, int y) {
+                if ((x < 0) || (y < 0) || (x >= int(COVERAGE_SIZE)) || (y >= int(COVERAGE_SIZE))) {
+                    return true;
+                }
+
+                return (((coverage[(size_t(y) * row_words) + (size_t(x) / 64)] >> (size_t(x) % 64)) & 1) != 0);
+            };
+
+            for (int y = 0; y < int(COVERAGE_SIZE); ++y) {
+                for (int x = 0; x < int(COVERAGE_SIZE); ++x) {
+                    bool hidden = true;
+
+                    for (int dy = -1; (dy <= 1) && hidden; ++dy) {
+                        for (int dx = -1; (dx <= 1) && hidden; ++dx) {
+                            hidden = covered((x + dx), (y + dy));
+                        }
+                    }
+
+                    m_hidden[(size_t(y) * COVERAGE_SIZE) + size_t(x)] = hidden;
+                }
+            }
+        }
+
+        bool contains(float u, float v) const
+        {
+            if ((u < 0.0f) || (u > 1.0f) || (v < 0.0f) || (v > 1.0f)) {
+                return true;
+            }
+
+            const size_t x = std::min(size_t(u * float(COVERAGE_SIZE)), size_t(COVERAGE_SIZE - 1));
+            const size_t y = std::min(size_t(v * float(COVERAGE_SIZE)), size_t(COVERAGE_SIZE - 1));
+
+            return (m_hidden[(y * COVERAGE_SIZE) + x] != 0);
+        }
+
+        bool contains(const float* const values) const
+        {
+            for (size_t c = 0; c < NUM_VALUES; c += 2) {
+                if (not contains(values[c], values[c + 1])) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+
+        std::vector<uint8_t>    m_hidden;
+    };
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DistortionMesh::DistortionMesh(vr::IVRSystem* const system, vr::EVREye eye, const Settings& settings)
+    : m_eye(eye)
+{
+    if (not (settings.max_error > 0.0f)) {
+        throw std::runtime_error("Invalid error bound!");
+    }
+
+    if ((settings.max_depth > MAX_DEPTH) || (settings.min_depth > settings.max_depth)) {
+        throw std::runtime_error("Invalid depth!");
+    }
+
+    DepthMap depth_map(settings.max_depth);
+    DistortionLattice lattice(system, eye, (depth_map.size() * LATTICE_SCALE));
+
+    const auto cell_size = [&](const Cell& cell) { return (lattice.size() >> cell.depth); };
+
+    //------------------------------------------------------------------------------
+    // Subdivide top down until the error bound is met.
+    {
+        std::vector<Cell> stack = { { 0, 0, 0 } };
+
+        while (not stack.empty()) {
+            const Cell cell = stack.back();
+            stack.pop_back();
+
+            const uint32_t size = cell_size(cell);
+            const bool subdivide = ((cell.depth < settings.min_depth) ||
+                                    ((cell.depth < settings.max_depth) &&
+                                     (compute_cell_error(lattice, (cell.x * size), (cell.y * size), size) > settings.max_error)));
+
+            if (not subdivide) {
+                depth_map.set(cell, cell.depth);
+                continue;
+            }
+
+            for (uint32_t i = 0; i < 4; ++i) {
+                stack.push_back({ (cell.depth + 1), ((2 * cell.x) + (i % 2)), ((2 * cell.y) + (i / 2)) });
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Balance: split cells bordering cells more than one level deeper until there
+    // are none.
+    for (bool changed = true; changed; ) {
+        changed = false;
+
+        for (const Cell& cell : depth_map.leaves()) {
+            const uint32_t n = depth_map.span(cell);
+            const uint32_t x0 = (cell.x * n);
+            const uint32_t y0 = (cell.y * n);
+            const uint32_t limit = (cell.depth + 1);
+
+            bool split = false;
+
+            for (uint32_t i = 0; (i < n) && (not split); ++i) {
+                split = (((x0 > 0) && (depth_map.depth((x0 - 1), (y0 + i)) > limit)) ||
+                         (((x0 + n) < depth_map.size()) && (depth_map.depth((x0 + n), (y0 + i)) > limit)) ||
+                         ((y0 > 0) && (depth_map.depth((x0 + i), (y0 - 1)) > limit)) ||
+                         (((y0 + n) < depth_map.size()) && (depth_map.depth((x0 + i), (y0 + n)) > limit)));
+            }
+
+            if (split) {
+                depth_map.set(cell, limit);
+                changed = true;
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Triangulate the cells, as lattice indices.
+    const std::vector<Cell> cells = depth_map.leaves();
+    std::vector<std::array<uint32_t, 3>> triangles;
+
+    for (const Cell& cell : cells) {
+        const uint32_t n = depth_map.span(cell);
+        const uint32_t fx = (cell.x * n);
+        const uint32_t fy = (cell.y * n);
+
+        const uint32_t size = cell_size(cell);
+        const uint32_t half = (size / 2);
+        const uint32_t x0 = (cell.x * size);
+        const uint32_t y0 = (cell.y * size);
+
+        m_statistics.max_cell_error = std::max(m_statistics.max_cell_error, compute_cell_error(lattice, x0, y0, size));
+        m_statistics.depth = std::max(m_statistics.depth, cell.depth);
+
+        const bool top    = ((fy > 0) && (depth_map.depth(fx, (fy - 1)) > cell.depth));
+        const bool right  = (((fx + n) < depth_map.size()) && (depth_map.depth((fx + n), fy) > cell.depth));
+        const bool bottom = (((fy + n) < depth_map.size()) && (depth_map.depth(fx, (fy + n)) > cell.depth));
+        const bool left   = ((fx > 0) && (depth_map.depth((fx - 1), fy) > cell.depth));
+
+        const uint32_t c00 = lattice.index(x0, y0);
+        const uint32_t c10 = lattice.index((x0 + size), y0);
+        const uint32_t c11 = lattice.index((x0 + size), (y0 + size));
+        const uint32_t c01 = lattice.index(x0, (y0 + size));
+
+        if (not (top || right || bottom || left)) {
+            triangles.push_back({ c00, c10, c11 });
+            triangles.push_back({ c00, c11, c01 });
+            continue;
+        }
+
+        //------------------------------------------------------------------------------
+        // Fan around the center through the corners and shared edge midpoints.
+        std::vector<uint32_t> loop;
+
+        loop.push_back(c00);
+        if (top) { loop.push_back(lattice.index((x0 + half), y0)); }
+        loop.push_back(c10);
+        if (right) { loop.push_back(lattice.index((x0 + size), (y0 + half))); }
+        loop.push_back(c11);
+        if (bottom) { loop.push_back(lattice.index((x0 + half), (y0 + size))); }
+        loop.push_back(c01);
+        if (left) { loop.push_back(lattice.index(x0, (y0 + half))); }
+
+        const uint32_t center = lattice.index((x0 + half), (y0 + half));
+
+        for (size_t i = 0; i < loop.size(); ++i) {
+            triangles.push_back({ center, loop[i], loop[(i + 1) % loop.size()] });
+        }
+    }
+
+    m_statistics.num_cells = cells.size();
+
+    //------------------------------------------------------------------------------
+    // Drop hidden triangles, testing the vertices and edge midpoints (all lattice
+    // points as vertex coordinates are multiples of two steps).
+    if (settings.cull_hidden) {
+        const HiddenRegion hidden(system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard));
+        const uint32_t stride = (lattice.size() + 1);
+
+        const auto is_hidden = [&](const std::array<uint32_t, 3>& triangle) {
+            for (size_t i = 0; i < 3; ++i) {
+                const uint32_t a = triangle[i];
+                const uint32_t b = triangle[(i + 1) % 3];
+                const uint32_t midpoint = lattice.index((((a % stride) + (b % stride)) / 2), (((a / stride) + (b / stride)) / 2));
+
+                if ((not hidden.contains(lattice.at(a))) || (not hidden.contains(lattice.at(midpoint)))) {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        const size_t num_triangles = triangles.size();
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(), is_hidden), triangles.end());
+        m_statistics.num_culled_triangles = (num_triangles - triangles.size());
+    }
+
+    //------------------------------------------------------------------------------
+    // Vertices of the remaining triangles.
+    std::vector<uint32_t> vertex_indices(((size_t(lattice.size()) + 1) * (size_t(lattice.size()) + 1)), UINT32_MAX);
+
+    m_indices.reserve(triangles.size() * 3);
+
+    for (const std::array<uint32_t, 3>& triangle : triangles) {
+        for (const uint32_t index : triangle) {
+            if (vertex_indices[index] == UINT32_MAX) {
+                if (m_vertices.size() >= IndexedMesh::MAX_NUM_VERTICES) {
+                    throw std::runtime_error("Too many vertices for 16-bit indices!");
+                }
+
+                const float* const values = lattice.at(index);
+                const uint32_t x = (index % (lattice.size() + 1));
+                const uint32_t y = (index / (lattice.size() + 1));
+
+                Vertex vertex;
+
+                vertex.position = { (float(x) / float(lattice.size())), (float(y) / float(lattice.size())) };
+                vertex.red = { values[0], values[1] };
+                vertex.green = { values[2], values[3] };
+                vertex.blue = { values[4], values[5] };
+
+                vertex_indices[index] = uint32_t(m_vertices.size());
+                m_vertices.push_back(vertex);
+            }
+
+            m_indices.push_back(uint16_t(vertex_indices[index]));
+        }
+    }
+
+    MeshProcessing::optimize_vertex_cache(m_indices, m_vertices.size(), 16);
+
+    m_statistics.num_vertices = m_vertices.size();
+    m_statistics.num_triangles = (m_indices.size() / 3);
+    m_statistics.num_evaluations = lattice.num_evaluations();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DistortionMesh::ErrorReport
+DistortionMesh::compute_error_report(vr::IVRSystem* const system, size_t subdivisions) const
+{
+    ErrorReport report;
+    double sum_error = 0.0;
+
+    subdivisions = std::max<size_t>(subdivisions, 1);
+
+    for (size_t t = 0; t < m_indices.size(); t += 3) {
+        const Vertex* const triangle[3] = { &m_vertices[m_indices[t]], &m_vertices[m_indices[t + 1]], &m_vertices[m_indices[t + 2]] };
+
+        for (size_t a = 0; a <= subdivisions; ++a) {
+            for (size_t b = 0; b <= (subdivisions - a); ++b) {
+                const size_t c = (subdivisions - a - b);
+
+                if ((a == subdivisions) || (b == subdivisions) || (c == subdivisions)) {
+                    continue;       // Vertices are exact
+                }
+
+                const float weights[3] = { (float(a) / float(subdivisions)), (float(b) / float(subdivisions)), (float(c) / float(subdivisions)) };
+
+                float u = 0.0f;
+                float v = 0.0f;
+                float predicted[NUM_VALUES] = {};
+
+                for (size_t i = 0; i < 3; ++i) {
+                    const Vertex& vertex = *triangle[i];
+                    const float values[NUM_VALUES] = {
+                        vertex.red.v[0], vertex.red.v[1], vertex.green.v[0], vertex.green.v[1], vertex.blue.v[0], vertex.blue.v[1]
+                    };
+
+                    u += (weights[i] * vertex.position.v[0]);
+                    v += (weights[i] * vertex.position.v[1]);
+
+                    for (size_t k = 0; k < NUM_VALUES; ++k) {
+                        predicted[k] += (weights[i] * values[k]);
+                    }
+                }
+
+                float actual[NUM_VALUES];
+                compute_distortion(system, m_eye, u, v, actual);
+
+                const float error = channel_distance(predicted, actual);
+
+                report.max_error = std::max(report.max_error, error);
+                sum_error += double(error);
+                ++report.num_samples;
+            }
+        }
+    }
+
+    report.mean_error = ((report.num_samples > 0) ? float(sum_error / double(report.num_samples)) : 0.0f);
+
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
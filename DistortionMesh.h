@@ -0,0 +1,168 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DISTORTION_MESH_H__
+#define __DISTORTION_MESH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Adaptively tessellated lens distortion warp mesh of one eye.
+//
+// Vertex positions are display UVs in [0, 1] x [0, 1] (like hidden area mesh
+// vertices), each with the render target UV of the red, green and blue channel
+// from IVRSystem::ComputeDistortion(). Drawing the mesh over the display and
+// sampling the eye texture per channel at the interpolated UVs applies the
+// distortion.
+//
+// The display is split as a quadtree: a cell is subdivided while the linear
+// interpolation of its corners over two triangles deviates from the actual
+// distortion of any channel by more than the error bound at a 5 x 5 grid of
+// test points, so cells get small where the distortion changes quickly or the
+// channels separate and stay large where the mapping is nearly linear. The
+// tree is then balanced so neighboring cells differ by at most one level, and
+// cells next to finer ones are triangulated as a fan around their center that
+// includes the shared edge midpoints, so the mesh has no T-junctions.
+//
+// Triangles whose vertices and edge midpoints all map to render target UVs
+// well inside the hidden area (or outside [0, 1], which the compositor shows as
+// black) are dropped. Triangles are clockwise on screen (u right, v down) and
+// ordered for the post-transform vertex cache.
+//------------------------------------------------------------------------------
+
+class DistortionMesh
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    static constexpr uint32_t MAX_DEPTH = 7;
+
+    struct Vertex
+    {
+        vr::HmdVector2_t    position;
+        vr::HmdVector2_t    red;
+        vr::HmdVector2_t    green;
+        vr::HmdVector2_t    blue;
+    };
+
+    //------------------------------------------------------------------------------
+    // The error bound is a distance in render target UV. Cells are subdivided at
+    // least to 'min_depth' and at most to 'max_depth' levels (at most MAX_DEPTH),
+    // i.e. into (2^depth x 2^depth) cells. Setting both to the same depth gives a
+    // uniform grid.
+    struct Settings
+    {
+        float       max_error = 1.0e-3f;
+        uint32_t    min_depth = 2;
+        uint32_t    max_depth = 6;
+        bool        cull_hidden = true;
+    };
+
+    //------------------------------------------------------------------------------
+    // 'max_cell_error' is the largest error at the test points of the final cells,
+    // which exceeds the error bound only for cells at the maximum depth.
+    struct Statistics
+    {
+        size_t      num_cells = 0;
+        size_t      num_vertices = 0;
+        size_t      num_triangles = 0;
+        size_t      num_culled_triangles = 0;
+        size_t      num_evaluations = 0;        // Calls to ComputeDistortion()
+        uint32_t    depth = 0;                  // Deepest cell
+        float       max_cell_error = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Deviation of the interpolated UVs from ComputeDistortion() inside the
+    // triangles, in render target UV, taken as the maximum over the three color
+    // channels of each sample.
+    struct ErrorReport
+    {
+        size_t      num_samples = 0;
+        float       max_error = 0.0f;
+        float       mean_error = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Build the mesh of the given eye. Throws if the error bound is not positive
+    // or the depths are invalid.
+    DistortionMesh(vr::IVRSystem* const system, vr::EVREye eye, const Settings& settings);
+
+    //------------------------------------------------------------------------------
+    // Mesh
+public:
+
+    vr::EVREye eye() const { return m_eye; }
+
+    //------------------------------------------------------------------------------
+    // Indexed triangle list.
+    const std::vector<Vertex>& vertices() const { return m_vertices; }
+    const std::vector<uint16_t>& indices() const { return m_indices; }
+
+    size_t size_in_bytes() const { return ((sizeof(Vertex) * m_vertices.size()) + (sizeof(uint16_t) * m_indices.size())); }
+
+    const Statistics& statistics() const { return m_statistics; }
+
+    //------------------------------------------------------------------------------
+    // Error Analysis
+public:
+
+    //------------------------------------------------------------------------------
+    // Compare the interpolated UVs against ComputeDistortion() at the points of a
+    // barycentric grid with 'subdivisions' segments per edge in each triangle.
+    ErrorReport compute_error_report(vr::IVRSystem* const system, size_t subdivisions = 4) const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    vr::EVREye                  m_eye;
+    std::vector<Vertex>         m_vertices;
+    std::vector<uint16_t>       m_indices;
+    Statistics                  m_statistics;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __DISTORTION_MESH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,562 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ExportFormat.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+#include "ShadingRateMap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t COLUMN_ALIGNMENT = 16;
+
+    //------------------------------------------------------------------------------
+    // Longest std::to_chars() result for a float is 15 characters, for a uint64_t
+    // 20 characters.
+    constexpr size_t MAX_FLOAT_CHARS = 32;
+
+    uint64_t column_stride_for(size_t num_values)
+    {
+        const size_t size = (sizeof(float) * num_values);
+        return uint64_t((size + COLUMN_ALIGNMENT - 1) & ~(COLUMN_ALIGNMENT - 1));
+    }
+
+    ExportSectionHeader make_section_header(ExportContent content,
+                                            vr::EVREye eye,
+                                            size_t width,
+                                            size_t height,
+                                            const char* const device_model)
+    {
+        ExportSectionHeader header;
+        std::memset(&header, 0, sizeof(header));
+
+        std::memcpy(header.magic, ExportSectionHeader::MAGIC, sizeof(header.magic));
+        header.version = ExportSectionHeader::VERSION;
+        header.header_size = sizeof(ExportSectionHeader);
+        header.content = content;
+        header.eye = uint32_t(eye);
+        header.width = uint32_t(width);
+        header.height = uint32_t(height);
+        header.num_columns = ExportColumn_Count;
+
+        for (size_t c = 0; c < ExportColumn_Count; ++c) {
+            header.columns[c] = uint8_t(c);
+        }
+
+        header.column_stride = column_stride_for(width * height);
+
+        if (device_model) {
+            std::strncpy(header.device_model, device_model, (sizeof(header.device_model) - 1));
+        }
+
+        return header;
+    }
+
+    void write_column(BufferedFileWriter& writer, const float* const values, size_t num_values)
+    {
+        static const char padding[COLUMN_ALIGNMENT] = {};
+
+        const size_t size = (sizeof(float) * num_values);
+
+        writer.write_bytes(values, size);
+        writer.write_bytes(padding, (column_stride_for(num_values) - size));
+    }
+
+    vr::DistortionCoordinates_t compute_clamped_distortion(vr::IVRSystem* const system, vr::EVREye eye, float u, float v)
+    {
+        vr::DistortionCoordinates_t xy;
+
+        if (not system->ComputeDistortion(eye, u, v, &xy)) {
+            xy = {};
+        }
+
+        for (size_t i = 0; i < 2; ++i) {
+            xy.rfRed[i]   = std::max(-1.0f, std::min(xy.rfRed[i]  , 2.0f));
+            xy.rfGreen[i] = std::max(-1.0f, std::min(xy.rfGreen[i], 2.0f));
+            xy.rfBlue[i]  = std::max(-1.0f, std::min(xy.rfBlue[i] , 2.0f));
+        }
+
+        return xy;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BufferedFileWriter::BufferedFileWriter(size_t capacity)
+    : m_fd(-1)
+    , m_buffer(std::max(capacity, MAX_FLOAT_CHARS))
+    , m_size(0)
+    , m_failed(false)
+{
+}
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+BufferedFileWriter::open(const char* const path, bool overwrite)
+{
+    close();
+
+    m_fd = ::open(path, (O_WRONLY | O_CREAT | (overwrite ? O_TRUNC : O_APPEND)), 0644);
+    m_failed = false;
+
+    if (m_fd < 0) {
+        return false;
+    }
+
+    if (not overwrite && (::lseek(m_fd, 0, SEEK_END) != 0)) {
+        ::close(m_fd);
+        m_fd = -1;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool
+BufferedFileWriter::close()
+{
+    if (m_fd < 0) {
+        return (not m_failed);
+    }
+
+    flush();
+
+    if (::close(m_fd) != 0) {
+        m_failed = true;
+    }
+
+    m_fd = -1;
+
+    return (not m_failed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+BufferedFileWriter::write_bytes(const void* const data, size_t size)
+{
+    if ((m_size + size) > m_buffer.size()) {
+        flush();
+
+        if (size >= m_buffer.size()) {
+            write_to_file(data, size);
+            return;
+        }
+    }
+
+    std::memcpy((m_buffer.data() + m_size), data, size);
+    m_size += size;
+}
+
+void
+BufferedFileWriter::write_string(const char* const string)
+{
+    write_bytes(string, std::strlen(string));
+}
+
+void
+BufferedFileWriter::write_char(char c)
+{
+    if (m_size == m_buffer.size()) {
+        flush();
+    }
+
+    m_buffer[m_size++] = c;
+}
+
+void
+BufferedFileWriter::write_float(float value)
+{
+    if ((m_size + MAX_FLOAT_CHARS) > m_buffer.size()) {
+        flush();
+    }
+
+    char* const begin = (m_buffer.data() + m_size);
+    const std::to_chars_result result = std::to_chars(begin, (begin + MAX_FLOAT_CHARS), value);
+
+    assert(result.ec == std::errc());
+    m_size += size_t(result.ptr - begin);
+}
+
+void
+BufferedFileWriter::write_uint(uint64_t value)
+{
+    if ((m_size + MAX_FLOAT_CHARS) > m_buffer.size()) {
+        flush();
+    }
+
+    char* const begin = (m_buffer.data() + m_size);
+    const std::to_chars_result result = std::to_chars(begin, (begin + MAX_FLOAT_CHARS), value);
+
+    assert(result.ec == std::errc());
+    m_size += size_t(result.ptr - begin);
+}
+
+void
+BufferedFileWriter::flush()
+{
+    if (m_size != 0) {
+        write_to_file(m_buffer.data(), m_size);
+        m_size = 0;
+    }
+}
+
+void
+BufferedFileWriter::write_to_file(const void* const data, size_t size)
+{
+    if ((m_fd < 0) || m_failed) {
+        m_failed = true;
+        return;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+
+    while (size != 0) {
+        const ssize_t written = ::write(m_fd, bytes, size);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            m_failed = true;
+            return;
+        }
+
+        bytes += written;
+        size -= size_t(written);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ExportFormat::write_distortion_samples_as_csv(BufferedFileWriter& writer, const DistortionLUT& lut, vr::EVREye eye)
+{
+    const size_t width = lut.width();
+    const size_t height = lut.height();
+
+    const float* const channels[DistortionLUT::Channel_Count] = {
+        lut.channel(eye, DistortionLUT::Channel_RedU),
+        lut.channel(eye, DistortionLUT::Channel_RedV),
+        lut.channel(eye, DistortionLUT::Channel_GreenU),
+        lut.channel(eye, DistortionLUT::Channel_GreenV),
+        lut.channel(eye, DistortionLUT::Channel_BlueU),
+        lut.channel(eye, DistortionLUT::Channel_BlueV),
+    };
+
+    for (size_t y = 0; y < height; ++y) {
+        const float v = (float(y) / float(height - 1));
+
+        for (size_t x = 0; x < width; ++x) {
+            const float u = (float(x) / float(width - 1));
+            const size_t index = ((y * width) + x);
+
+            writer.write_float(u);
+            writer.write_char('\t');
+            writer.write_float(v);
+
+            for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+                writer.write_char('\t');
+                writer.write_float(channels[c][index]);
+            }
+
+            writer.write_char('\n');
+        }
+    }
+}
+
+void
+ExportFormat::write_distortion_samples_as_binary(BufferedFileWriter& writer,
+                                                 const DistortionLUT& lut,
+                                                 vr::EVREye eye,
+                                                 const char* const device_model)
+{
+    const size_t width = lut.width();
+    const size_t height = lut.height();
+    const size_t num_values = (width * height);
+
+    const ExportSectionHeader header = make_section_header(ExportContent_DistortionSamples, eye, width, height, device_model);
+    writer.write_bytes(&header, sizeof(header));
+
+    //------------------------------------------------------------------------------
+    // The undistorted coordinates are implied by the grid but stored anyway so
+    // that every section has the same columns.
+    std::vector<float> column(num_values);
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            column[(y * width) + x] = (float(x) / float(width - 1));
+        }
+    }
+
+    write_column(writer, column.data(), num_values);
+
+    for (size_t y = 0; y < height; ++y) {
+        std::fill_n((column.begin() + (y * width)), width, (float(y) / float(height - 1)));
+    }
+
+    write_column(writer, column.data(), num_values);
+
+    //------------------------------------------------------------------------------
+    // The distorted coordinates are written straight from the LUT planes.
+    for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+        write_column(writer, lut.channel(eye, DistortionLUT::Channel(c)), num_values);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ExportFormat::write_hidden_area_outline_as_csv(BufferedFileWriter& writer,
+                                               const vr::HiddenAreaMesh_t& mesh,
+                                               vr::EVREye eye,
+                                               vr::IVRSystem* const system)
+{
+    if (mesh.unTriangleCount == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < mesh.unTriangleCount; ++i) {
+        const float u = mesh.pVertexData[i].v[0];
+        const float v = mesh.pVertexData[i].v[1];
+        const vr::DistortionCoordinates_t xy = compute_clamped_distortion(system, eye, u, v);
+
+        writer.write_float(u);              writer.write_char('\t');
+        writer.write_float(v);              writer.write_char('\t');
+        writer.write_float(xy.rfRed[0]);    writer.write_char('\t');
+        writer.write_float(xy.rfRed[1]);    writer.write_char('\t');
+        writer.write_float(xy.rfGreen[0]);  writer.write_char('\t');
+        writer.write_float(xy.rfGreen[1]);  writer.write_char('\t');
+        writer.write_float(xy.rfBlue[0]);   writer.write_char('\t');
+        writer.write_float(xy.rfBlue[1]);   writer.write_char('\n');
+    }
+
+    writer.write_float(mesh.pVertexData[0].v[0]);
+    writer.write_char('\t');
+    writer.write_float(mesh.pVertexData[0].v[1]);
+    writer.write_char('\n');
+}
+
+void
+ExportFormat::write_hidden_area_outline_as_binary(BufferedFileWriter& writer,
+                                                  const vr::HiddenAreaMesh_t& mesh,
+                                                  vr::EVREye eye,
+                                                  vr::IVRSystem* const system,
+                                                  const char* const device_model)
+{
+    const size_t num_values = mesh.unTriangleCount;
+
+    std::vector<float> columns[ExportColumn_Count];
+
+    for (std::vector<float>& column : columns) {
+        column.resize(num_values);
+    }
+
+    for (size_t i = 0; i < num_values; ++i) {
+        const float u = mesh.pVertexData[i].v[0];
+        const float v = mesh.pVertexData[i].v[1];
+        const vr::DistortionCoordinates_t xy = compute_clamped_distortion(system, eye, u, v);
+
+        columns[ExportColumn_U][i]      = u;
+        columns[ExportColumn_V][i]      = v;
+        columns[ExportColumn_RedU][i]   = xy.rfRed[0];
+        columns[ExportColumn_RedV][i]   = xy.rfRed[1];
+        columns[ExportColumn_GreenU][i] = xy.rfGreen[0];
+        columns[ExportColumn_GreenV][i] = xy.rfGreen[1];
+        columns[ExportColumn_BlueU][i]  = xy.rfBlue[0];
+        columns[ExportColumn_BlueV][i]  = xy.rfBlue[1];
+    }
+
+    const ExportSectionHeader header = make_section_header(ExportContent_HiddenAreaOutline, eye, num_values, 1, device_model);
+    writer.write_bytes(&header, sizeof(header));
+
+    for (const std::vector<float>& column : columns) {
+        write_column(writer, column.data(), num_values);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ExportFormat::write_shading_rate_map_as_csv(BufferedFileWriter& writer, const ShadingRateMap& map, vr::EVREye eye)
+{
+    for (uint32_t tile_y = 0; tile_y < map.num_tiles_y(); ++tile_y) {
+        for (uint32_t tile_x = 0; tile_x < map.num_tiles_x(); ++tile_x) {
+            const ShadingRate rate = map.rate(eye, tile_x, tile_y);
+
+            if (tile_x > 0) {
+                writer.write_char('\t');
+            }
+
+            if (rate == ShadingRate_Culled) {
+                writer.write_char('-');
+            }
+            else {
+                writer.write_char(char('0' + ShadingRateMap::rate_width(rate)));
+                writer.write_char('x');
+                writer.write_char(char('0' + ShadingRateMap::rate_height(rate)));
+            }
+        }
+
+        writer.write_char('\n');
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MappedExportFile::MappedExportFile(const char* const path)
+    : m_data(nullptr)
+    , m_size(0)
+{
+    //------------------------------------------------------------------------------
+    // Map the whole file.
+    const int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open export file!");
+    }
+
+    struct stat file_stat;
+
+    if (::fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to open export file!");
+    }
+
+    m_size = size_t(file_stat.st_size);
+
+    if (m_size != 0) {
+        m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    ::close(fd);
+
+    if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw std::runtime_error("Failed to map export file!");
+    }
+
+    //------------------------------------------------------------------------------
+    // Walk the sections. Sections start at multiples of 16 bytes (the header and
+    // the column strides are multiples of 16) so columns are suitably aligned.
+    const char* const bytes = static_cast<const char*>(m_data);
+    size_t offset = 0;
+
+    try {
+        while (offset < m_size) {
+            if ((m_size - offset) < sizeof(ExportSectionHeader)) {
+                throw std::runtime_error("Truncated export file!");
+            }
+
+            const ExportSectionHeader* const header = reinterpret_cast<const ExportSectionHeader*>(bytes + offset);
+
+            if ((std::memcmp(header->magic, ExportSectionHeader::MAGIC, sizeof(header->magic)) != 0) ||
+                (header->version != ExportSectionHeader::VERSION) ||
+                (header->header_size != sizeof(ExportSectionHeader)) ||
+                (header->num_columns > sizeof(header->columns)))
+            {
+                throw std::runtime_error("Invalid export file!");
+            }
+
+            const size_t num_values = (size_t(header->width) * size_t(header->height));
+
+            if ((header->column_stride < (sizeof(float) * num_values)) || ((header->column_stride % COLUMN_ALIGNMENT) != 0)) {
+                throw std::runtime_error("Invalid export file!");
+            }
+
+            offset += sizeof(ExportSectionHeader);
+
+            if ((header->column_stride != 0) && (((m_size - offset) / header->column_stride) < header->num_columns)) {
+                throw std::runtime_error("Truncated export file!");
+            }
+
+            Section section;
+            section.header = header;
+
+            for (size_t c = 0; c < header->num_columns; ++c) {
+                if (header->columns[c] < ExportColumn_Count) {
+                    section.columns[header->columns[c]] = reinterpret_cast<const float*>(bytes + offset);
+                }
+
+                offset += header->column_stride;
+            }
+
+            m_sections.push_back(section);
+        }
+    }
+    catch (...) {
+        ::munmap(m_data, m_size);
+        throw;
+    }
+}
+
+MappedExportFile::~MappedExportFile()
+{
+    if (m_data) {
+        ::munmap(m_data, m_size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
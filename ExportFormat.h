@@ -0,0 +1,259 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EXPORT_FORMAT_H__
+#define __EXPORT_FORMAT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class DistortionLUT;
+class ShadingRateMap;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Write-only file with a large user space buffer.
+//
+// Small writes are collected in the buffer which is handed to the OS with a
+// single write() once full. Writes larger than the buffer bypass it. Floats are
+// formatted with std::to_chars() directly into the buffer (shortest round-trip
+// representation).
+//------------------------------------------------------------------------------
+
+class BufferedFileWriter
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    explicit BufferedFileWriter(size_t capacity = (1 << 20));
+    ~BufferedFileWriter();
+
+    BufferedFileWriter(const BufferedFileWriter&) = delete;
+    BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Opening/Closing
+public:
+
+    //------------------------------------------------------------------------------
+    // Open the file at the given path for writing, truncating it if 'overwrite' is
+    // set and appending to it otherwise. Fails if the file can not be opened or if
+    // 'overwrite' is not set and the file is not empty.
+    bool open(const char* const path, bool overwrite);
+
+    //------------------------------------------------------------------------------
+    // Flush and close the file. Returns false if any write has failed.
+    bool close();
+
+    bool is_open() const { return (m_fd >= 0); }
+    bool failed() const { return m_failed; }
+
+    //------------------------------------------------------------------------------
+    // Writing
+public:
+
+    void write_bytes(const void* const data, size_t size);
+    void write_string(const char* const string);
+    void write_char(char c);
+    void write_float(float value);
+    void write_uint(uint64_t value);
+
+    //------------------------------------------------------------------------------
+    // Write the buffer to the file.
+    void flush();
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    void write_to_file(const void* const data, size_t size);
+
+    int                     m_fd;
+    std::vector<char>       m_buffer;
+    size_t                  m_size;
+    bool                    m_failed;
+};
+
+//------------------------------------------------------------------------------
+// Columnar binary export format.
+//
+// A file is a sequence of sections, each consisting of an ExportSectionHeader
+// followed by 'num_columns' columns of (width x height) floats. Columns start
+// 'column_stride' bytes apart (a multiple of 16) so that they can be used in
+// place once the file is memory mapped. Values are stored in the byte order of
+// the machine that wrote the file (little-endian on all supported platforms).
+//------------------------------------------------------------------------------
+
+enum ExportContent : uint32_t {
+    ExportContent_DistortionSamples = 1,        // Grid of (width x height) samples
+    ExportContent_HiddenAreaOutline = 2,        // Line loop of (width x 1) vertices
+};
+
+enum ExportColumn : uint8_t {
+    ExportColumn_U = 0,
+    ExportColumn_V,
+    ExportColumn_RedU,
+    ExportColumn_RedV,
+    ExportColumn_GreenU,
+    ExportColumn_GreenV,
+    ExportColumn_BlueU,
+    ExportColumn_BlueV,
+
+    ExportColumn_Count
+};
+
+struct ExportSectionHeader
+{
+    static constexpr char MAGIC[4] = { 'O', 'V', 'R', 'X' };
+    static constexpr uint16_t VERSION = 1;
+
+    char        magic[4];
+    uint16_t    version;
+    uint16_t    header_size;                    // sizeof(ExportSectionHeader)
+    uint32_t    content;                        // ExportContent
+    uint32_t    eye;                            // vr::EVREye
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    num_columns;
+    uint8_t     columns[12];                    // ExportColumn of each column in file order
+    uint64_t    column_stride;                  // Bytes from the start of one column to the next
+    char        device_model[64];               // Prop_ModelNumber_String, nul terminated
+    uint8_t     reserved[16];
+};
+
+static_assert(sizeof(ExportSectionHeader) == 128, "!");
+
+//------------------------------------------------------------------------------
+// Writers for the distortion and hidden area exports in CSV and binary format
+// and the shading rate export in CSV format.
+//------------------------------------------------------------------------------
+
+class ExportFormat
+{
+public:
+
+    //------------------------------------------------------------------------------
+    // Grid samples of the given eye as tab separated rows of u, v and the distorted
+    // red/green/blue coordinates.
+    static void write_distortion_samples_as_csv(BufferedFileWriter& writer, const DistortionLUT& lut, vr::EVREye eye);
+
+    //------------------------------------------------------------------------------
+    // Grid samples of the given eye as a section with all ExportColumn columns.
+    static void write_distortion_samples_as_binary(BufferedFileWriter& writer,
+                                                   const DistortionLUT& lut,
+                                                   vr::EVREye eye,
+                                                   const char* const device_model);
+
+    //------------------------------------------------------------------------------
+    // Hidden area line loop vertices of the given eye and their distorted
+    // coordinates as tab separated rows. The first vertex is repeated (without
+    // distortion) to close the loop.
+    static void write_hidden_area_outline_as_csv(BufferedFileWriter& writer,
+                                                 const vr::HiddenAreaMesh_t& mesh,
+                                                 vr::EVREye eye,
+                                                 vr::IVRSystem* const system);
+
+    //------------------------------------------------------------------------------
+    // Hidden area line loop vertices of the given eye and their distorted
+    // coordinates as a section with all ExportColumn columns.
+    static void write_hidden_area_outline_as_binary(BufferedFileWriter& writer,
+                                                    const vr::HiddenAreaMesh_t& mesh,
+                                                    vr::EVREye eye,
+                                                    vr::IVRSystem* const system,
+                                                    const char* const device_model);
+
+    //------------------------------------------------------------------------------
+    // Shading rates of the given eye as one tab separated row per row of tiles,
+    // "1x1", "1x2", "2x1", "2x2", "4x4" or "-" for culled tiles.
+    static void write_shading_rate_map_as_csv(BufferedFileWriter& writer, const ShadingRateMap& map, vr::EVREye eye);
+};
+
+//------------------------------------------------------------------------------
+// Read-only, memory mapped view of a binary export file. Columns point directly
+// into the mapping.
+//------------------------------------------------------------------------------
+
+class MappedExportFile
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    struct Section
+    {
+        const ExportSectionHeader*      header = nullptr;
+        const float*                    columns[ExportColumn_Count] = {};     // Indexed by ExportColumn, null if absent
+
+        size_t num_values() const { return (size_t(header->width) * size_t(header->height)); }
+        const float* column(ExportColumn column) const { return columns[column]; }
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Map the file at the given path. Throws if the file can not be mapped or is
+    // not a valid export file.
+    explicit MappedExportFile(const char* const path);
+    ~MappedExportFile();
+
+    MappedExportFile(const MappedExportFile&) = delete;
+    MappedExportFile& operator=(const MappedExportFile&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Access
+public:
+
+    const std::vector<Section>& sections() const { return m_sections; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    void*                   m_data;
+    size_t                  m_size;
+    std::vector<Section>    m_sections;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __EXPORT_FORMAT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,325 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "EyeTexturePool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void*
+CPUEyeTextureBackend::create_texture(const EyeTextureKey& key)
+{
+    const size_t size = texture_size_in_bytes(key);
+
+    if (size == 0) {
+        return nullptr;
+    }
+
+    void* const texture = std::malloc(size);
+
+    if (texture) {
+        ++m_num_created;
+    }
+
+    return texture;
+}
+
+void
+CPUEyeTextureBackend::destroy_texture(void* const texture)
+{
+    if (texture) {
+        std::free(texture);
+        ++m_num_destroyed;
+    }
+}
+
+size_t
+CPUEyeTextureBackend::texture_size_in_bytes(const EyeTextureKey& key) const
+{
+    return (size_t(key.width) * size_t(key.height) * size_t(key.sample_count) * 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+EyeTexturePool::EyeTexturePool(EyeTextureBackend& backend, size_t num_buffers, size_t budget_in_bytes)
+    : m_backend(backend)
+    , m_num_buffers(num_buffers)
+    , m_budget_in_bytes(budget_in_bytes)
+{
+    if (num_buffers == 0) {
+        throw std::runtime_error("Invalid number of buffers!");
+    }
+}
+
+EyeTexturePool::~EyeTexturePool()
+{
+    for (Set& set : m_sets) {
+        for (Buffer& buffer : set.buffers) {
+            destroy_buffer(set.key, buffer);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+EyeTexturePool::Lease
+EyeTexturePool::acquire(const EyeTextureKey& key, uint64_t completed_fence)
+{
+    //------------------------------------------------------------------------------
+    // Find or add the set and make it the most recently used.
+    const auto found = m_sets_by_key.find(key);
+
+    if (found != m_sets_by_key.end()) {
+        m_sets.splice(m_sets.begin(), m_sets, found->second);
+    }
+    else {
+        m_sets.emplace_front();
+        m_sets.front().key = key;
+        m_sets_by_key.emplace(key, m_sets.begin());
+    }
+
+    Set& set = m_sets.front();
+
+    //------------------------------------------------------------------------------
+    // Reuse an idle buffer, otherwise fill an empty slot.
+    size_t index = set.buffers.size();
+    bool is_hit = false;
+
+    for (size_t i = 0; i < set.buffers.size(); ++i) {
+        const Buffer& buffer = set.buffers[i];
+
+        if (buffer.textures[0] && not is_busy(buffer, completed_fence)) {
+            index = i;
+            is_hit = true;
+            break;
+        }
+
+        if ((not buffer.textures[0]) && (index == set.buffers.size())) {
+            index = i;
+        }
+    }
+
+    Lease lease;
+
+    if (not is_hit) {
+        if (index == m_num_buffers) {
+            ++m_statistics.num_stalls;
+            return lease;
+        }
+
+        if (m_budget_in_bytes != 0) {
+            evict((2 * m_backend.texture_size_in_bytes(key)), completed_fence, &set);
+        }
+
+        Buffer buffer;
+
+        if (not create_buffer(key, buffer)) {
+            return lease;
+        }
+
+        if (index == set.buffers.size()) {
+            set.buffers.push_back(buffer);
+        }
+        else {
+            set.buffers[index] = buffer;
+        }
+
+        ++m_statistics.num_misses;
+    }
+    else {
+        ++m_statistics.num_hits;
+    }
+
+    Buffer& buffer = set.buffers[index];
+    buffer.is_leased = true;
+
+    lease.key = key;
+    lease.buffer_index = index;
+    lease.textures[0] = buffer.textures[0];
+    lease.textures[1] = buffer.textures[1];
+
+    return lease;
+}
+
+void
+EyeTexturePool::release(const Lease& lease, uint64_t completion_fence)
+{
+    if (not lease) {
+        return;
+    }
+
+    const auto found = m_sets_by_key.find(lease.key);
+    assert(found != m_sets_by_key.end());
+
+    Buffer& buffer = found->second->buffers[lease.buffer_index];
+    assert(buffer.is_leased && (buffer.textures[0] == lease.textures[0]));
+
+    buffer.is_leased = false;
+    buffer.fence = completion_fence;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+EyeTexturePool::set_budget(size_t budget_in_bytes, uint64_t completed_fence)
+{
+    m_budget_in_bytes = budget_in_bytes;
+
+    if (m_budget_in_bytes != 0) {
+        evict(0, completed_fence, nullptr);
+    }
+}
+
+void
+EyeTexturePool::trim(uint64_t completed_fence)
+{
+    for (auto set = m_sets.begin(); set != m_sets.end(); ) {
+        bool is_empty = true;
+
+        for (Buffer& buffer : set->buffers) {
+            if (buffer.textures[0] && not is_busy(buffer, completed_fence)) {
+                destroy_buffer(set->key, buffer);
+                ++m_statistics.num_evictions;
+            }
+
+            is_empty = (is_empty && (not buffer.textures[0]));
+        }
+
+        if (is_empty) {
+            m_sets_by_key.erase(set->key);
+            set = m_sets.erase(set);
+        }
+        else {
+            ++set;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t
+EyeTexturePool::KeyHash::operator()(const EyeTextureKey& key) const
+{
+    uint64_t h = ((uint64_t(key.format) << 32) | key.sample_count);
+    h ^= (((uint64_t(key.width) << 32) | key.height) * 0x9e3779b97f4a7c15ull);
+    h ^= (h >> 29);
+
+    return size_t(h);
+}
+
+bool
+EyeTexturePool::is_busy(const Buffer& buffer, uint64_t completed_fence)
+{
+    return (buffer.is_leased || (buffer.fence > completed_fence));
+}
+
+bool
+EyeTexturePool::create_buffer(const EyeTextureKey& key, Buffer& buffer)
+{
+    for (void*& texture : buffer.textures) {
+        texture = m_backend.create_texture(key);
+
+        if (not texture) {
+            destroy_buffer(key, buffer);
+            return false;
+        }
+
+        ++m_statistics.num_textures;
+        m_statistics.size_in_bytes += m_backend.texture_size_in_bytes(key);
+    }
+
+    m_statistics.peak_size_in_bytes = std::max(m_statistics.peak_size_in_bytes, m_statistics.size_in_bytes);
+    return true;
+}
+
+void
+EyeTexturePool::destroy_buffer(const EyeTextureKey& key, Buffer& buffer)
+{
+    for (void*& texture : buffer.textures) {
+        if (texture) {
+            m_backend.destroy_texture(texture);
+            texture = nullptr;
+
+            --m_statistics.num_textures;
+            m_statistics.size_in_bytes -= m_backend.texture_size_in_bytes(key);
+        }
+    }
+
+    buffer.fence = 0;
+    buffer.is_leased = false;
+}
+
+void
+EyeTexturePool::evict(size_t required, uint64_t completed_fence, const Set* const keep)
+{
+    const auto fits = [&]() {
+        return ((m_statistics.size_in_bytes + required) <= m_budget_in_bytes);
+    };
+
+    //------------------------------------------------------------------------------
+    // Least recently used sets first.
+    auto set = m_sets.end();
+
+    while ((set != m_sets.begin()) && not fits()) {
+        --set;
+
+        if (&*set == keep) {
+            continue;
+        }
+
+        bool is_empty = true;
+
+        for (Buffer& buffer : set->buffers) {
+            if (buffer.textures[0] && not is_busy(buffer, completed_fence) && not fits()) {
+                destroy_buffer(set->key, buffer);
+                ++m_statistics.num_evictions;
+            }
+
+            is_empty = (is_empty && (not buffer.textures[0]));
+        }
+
+        if (is_empty) {
+            m_sets_by_key.erase(set->key);
+            set = m_sets.erase(set);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
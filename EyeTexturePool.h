@@ -0,0 +1,256 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EYE_TEXTURE_POOL_H__
+#define __EYE_TEXTURE_POOL_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The properties eye textures are pooled by. The format is backend specific
+// (an MTLPixelFormat for Metal).
+//------------------------------------------------------------------------------
+
+struct EyeTextureKey
+{
+    uint32_t    format = 0;
+    uint32_t    width = 0;
+    uint32_t    height = 0;
+    uint32_t    sample_count = 1;
+
+    bool operator==(const EyeTextureKey& other) const
+    {
+        return ((format == other.format) && (width == other.width) && (height == other.height) && (sample_count == other.sample_count));
+    }
+
+    bool operator!=(const EyeTextureKey& other) const { return (not (*this == other)); }
+};
+
+//------------------------------------------------------------------------------
+// Creates and destroys the textures pooled by EyeTexturePool. Textures are
+// opaque handles to the pool.
+//------------------------------------------------------------------------------
+
+class EyeTextureBackend
+{
+public:
+
+    virtual ~EyeTextureBackend() {}
+
+    //------------------------------------------------------------------------------
+    // Create a texture for the given key. Returns nullptr on failure (e.g. an
+    // unsupported format).
+    virtual void* create_texture(const EyeTextureKey& key) = 0;
+
+    //------------------------------------------------------------------------------
+    // Destroy a texture created by create_texture().
+    virtual void destroy_texture(void* const texture) = 0;
+
+    //------------------------------------------------------------------------------
+    // The memory used by a texture for the given key in bytes.
+    virtual size_t texture_size_in_bytes(const EyeTextureKey& key) const = 0;
+};
+
+//------------------------------------------------------------------------------
+// Backend allocating plain memory (four bytes per pixel and sample) instead of
+// textures, to exercise the pool's policies on any platform.
+//------------------------------------------------------------------------------
+
+class CPUEyeTextureBackend : public EyeTextureBackend
+{
+public:
+
+    void* create_texture(const EyeTextureKey& key) override;
+    void destroy_texture(void* const texture) override;
+    size_t texture_size_in_bytes(const EyeTextureKey& key) const override;
+
+    size_t num_created() const { return m_num_created; }
+    size_t num_destroyed() const { return m_num_destroyed; }
+    size_t num_live() const { return (m_num_created - m_num_destroyed); }
+
+private:
+
+    size_t      m_num_created = 0;
+    size_t      m_num_destroyed = 0;
+};
+
+//------------------------------------------------------------------------------
+// Pool of N-buffered eye textures (a texture per eye and buffer).
+//
+// Each key has a set of up to 'num_buffers' buffers. acquire() hands out a
+// buffer of the key that is neither leased nor still in use by the GPU, which
+// is tracked with monotonically increasing fence values (e.g. the signaled
+// value of an MTLSharedEvent): release() records the value signaled once the
+// GPU is done with a buffer, acquire() is given the value signaled so far.
+// Buffers are created on demand and kept when the key changes so switching
+// between recently used resolutions (dynamic resolution scaling) does not
+// allocate once every size has been seen.
+//
+// Sets of keys not used for the longest time are evicted to stay within the
+// memory budget, except for buffers leased or in flight. The budget is soft:
+// if nothing can be evicted acquire() allocates anyway and the excess shows in
+// the statistics.
+//
+// The pool is not thread safe; use it from the thread submitting frames.
+//------------------------------------------------------------------------------
+
+class EyeTexturePool
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // A buffer handed out by acquire(). Invalid (textures null) if all buffers of
+    // the key are busy or the backend failed to create a texture.
+    struct Lease
+    {
+        EyeTextureKey   key;
+        size_t          buffer_index = 0;
+        void*           textures[2] = { nullptr, nullptr };     // Left, right
+
+        explicit operator bool() const { return (textures[0] != nullptr); }
+    };
+
+    struct Statistics
+    {
+        size_t      num_hits = 0;               // Acquires served by an existing buffer
+        size_t      num_misses = 0;             // Acquires that created a buffer
+        size_t      num_stalls = 0;             // Acquires failing as all buffers were busy
+        size_t      num_evictions = 0;          // Buffers destroyed by the budget or trim()
+        size_t      num_textures = 0;
+        size_t      size_in_bytes = 0;
+        size_t      peak_size_in_bytes = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the number of buffers is 0. A budget of 0 means unlimited. The
+    // destructor destroys all textures, the GPU must be done with them.
+    EyeTexturePool(EyeTextureBackend& backend, size_t num_buffers = 3, size_t budget_in_bytes = 0);
+    ~EyeTexturePool();
+
+    EyeTexturePool(const EyeTexturePool&) = delete;
+    EyeTexturePool& operator=(const EyeTexturePool&) = delete;
+
+    size_t num_buffers() const { return m_num_buffers; }
+    size_t budget_in_bytes() const { return m_budget_in_bytes; }
+
+    //------------------------------------------------------------------------------
+    // Leasing
+public:
+
+    //------------------------------------------------------------------------------
+    // Lease a buffer for the given key. 'completed_fence' is the highest fence value
+    // the GPU has signaled.
+    Lease acquire(const EyeTextureKey& key, uint64_t completed_fence);
+
+    //------------------------------------------------------------------------------
+    // Return a leased buffer. It is reused once 'completion_fence' is signaled.
+    void release(const Lease& lease, uint64_t completion_fence);
+
+    //------------------------------------------------------------------------------
+    // Memory Management
+public:
+
+    //------------------------------------------------------------------------------
+    // Change the budget and evict down to it as far as possible.
+    void set_budget(size_t budget_in_bytes, uint64_t completed_fence);
+
+    //------------------------------------------------------------------------------
+    // Destroy all buffers not leased or in flight.
+    void trim(uint64_t completed_fence);
+
+    const Statistics& statistics() const { return m_statistics; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    //------------------------------------------------------------------------------
+    // Evicted buffers of a set with other buffers still busy stay as empty slots
+    // (null textures) so the indices of leased buffers remain valid.
+    struct Buffer
+    {
+        void*       textures[2] = { nullptr, nullptr };
+        uint64_t    fence = 0;                  // Free once signaled
+        bool        is_leased = false;
+    };
+
+    struct Set
+    {
+        EyeTextureKey           key;
+        std::vector<Buffer>     buffers;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const EyeTextureKey& key) const;
+    };
+
+    typedef std::list<Set> set_list_t;          // Most recently used first
+
+    static bool is_busy(const Buffer& buffer, uint64_t completed_fence);
+
+    bool create_buffer(const EyeTextureKey& key, Buffer& buffer);
+    void destroy_buffer(const EyeTextureKey& key, Buffer& buffer);
+
+    //------------------------------------------------------------------------------
+    // Destroy idle buffers of the least recently used sets (other than 'keep')
+    // until 'required' more bytes fit into the budget or nothing idle is left.
+    void evict(size_t required, uint64_t completed_fence, const Set* const keep);
+
+    EyeTextureBackend&                                                  m_backend;
+    const size_t                                                        m_num_buffers;
+    size_t                                                              m_budget_in_bytes;
+
+    set_list_t                                                          m_sets;
+    std::unordered_map<EyeTextureKey, set_list_t::iterator, KeyHash>    m_sets_by_key;
+
+    Statistics                                                          m_statistics;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __EYE_TEXTURE_POOL_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,487 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Vertices are snapped to 1/256 pixel. Edge function values are then multiples
+    // of 1/65536 (at pixel centers) and are computed exactly in double precision,
+    // both directly and incrementally.
+    constexpr double SUBPIXELS = 256.0;
+    constexpr double MIN_EDGE_VALUE = (1.0 / (SUBPIXELS * SUBPIXELS));
+
+    //------------------------------------------------------------------------------
+    // A triangle oriented such that its edge functions (a * x + b * y + c) are
+    // positive inside. A pixel center is covered if all edge functions are at
+    // least the edge's threshold, which is 0 for top/left edges and the smallest
+    // positive value otherwise.
+    struct TriangleSetup
+    {
+        double      a[3];
+        double      b[3];
+        double      c[3];
+        double      threshold[3];
+
+        uint32_t    x_begin;    // Pixels whose centers lie in the bounding box
+        uint32_t    x_end;
+        uint32_t    y_begin;
+        uint32_t    y_end;
+    };
+
+    bool setup_triangle(const vr::HmdVector2_t* const vertices, uint32_t width, uint32_t height, TriangleSetup& setup)
+    {
+        double x[3], y[3];
+
+        for (size_t k = 0; k < 3; ++k) {
+            if ((not std::isfinite(vertices[k].v[0])) || (not std::isfinite(vertices[k].v[1]))) {
+                return false;
+            }
+
+            x[k] = (std::nearbyint(double(vertices[k].v[0]) * double(width) * SUBPIXELS) / SUBPIXELS);
+            y[k] = (std::nearbyint(double(vertices[k].v[1]) * double(height) * SUBPIXELS) / SUBPIXELS);
+        }
+
+        const double area = (((x[1] - x[0]) * (y[2] - y[0])) - ((y[1] - y[0]) * (x[2] - x[0])));
+
+        if (area == 0.0) {
+            return false;
+        }
+        else if (area < 0.0) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            const size_t i = k;
+            const size_t j = ((k + 1) % 3);
+
+            setup.a[k] = -(y[j] - y[i]);
+            setup.b[k] = (x[j] - x[i]);
+            setup.c[k] = -((setup.a[k] * x[i]) + (setup.b[k] * y[i]));
+
+            //------------------------------------------------------------------------------
+            // Left edges have the inside towards +x, top edges are horizontal with the
+            // inside towards +y (down).
+            const bool is_top_left = ((y[j] < y[i]) || ((y[j] == y[i]) && (x[j] > x[i])));
+            setup.threshold[k] = (is_top_left ? 0.0 : MIN_EDGE_VALUE);
+        }
+
+        const double min_x = std::min({ x[0], x[1], x[2] });
+        const double max_x = std::max({ x[0], x[1], x[2] });
+        const double min_y = std::min({ y[0], y[1], y[2] });
+        const double max_y = std::max({ y[0], y[1], y[2] });
+
+        const auto first_center = [](double min, uint32_t size) {
+            return uint32_t(std::min(std::max(std::ceil(min - 0.5), 0.0), double(size)));
+        };
+
+        const auto end_center = [](double max, uint32_t size) {
+            return uint32_t(std::min(std::max((std::floor(max - 0.5) + 1.0), 0.0), double(size)));
+        };
+
+        setup.x_begin = first_center(min_x, width);
+        setup.x_end = end_center(max_x, width);
+        setup.y_begin = first_center(min_y, height);
+        setup.y_end = end_center(max_y, height);
+
+        return ((setup.x_begin < setup.x_end) && (setup.y_begin < setup.y_end));
+    }
+
+    void rasterize_triangle_scalar(const TriangleSetup& t, size_t row_words, uint64_t* const coverage)
+    {
+        for (uint32_t y = t.y_begin; y < t.y_end; ++y) {
+            const double py = (double(y) + 0.5);
+            uint64_t* const row = (coverage + (row_words * y));
+
+            for (uint32_t x = t.x_begin; x < t.x_end; ++x) {
+                const double px = (double(x) + 0.5);
+                bool is_covered = true;
+
+                for (size_t k = 0; k < 3; ++k) {
+                    is_covered &= ((((t.a[k] * px) + (t.b[k] * py)) + t.c[k]) >= t.threshold[k]);
+                }
+
+                if (is_covered) {
+                    row[x / 64] |= (uint64_t(1) << (x % 64));
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Vectorized kernels evaluate the edge functions for a group of horizontally
+    // adjacent pixels, starting at a multiple of the group size so that groups
+    // never straddle coverage words. Lanes outside the bounding box are outside
+    // the triangle except past the right edge of the render target, which is
+    // masked.
+
+#if defined(__AVX__)
+
+    constexpr uint32_t GROUP_SIZE = 4;
+
+    void rasterize_triangle_avx(const TriangleSetup& t, size_t row_words, uint64_t* const coverage)
+    {
+        const __m256d lanes = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+        const uint32_t x_first = (t.x_begin & ~(GROUP_SIZE - 1));
+
+        __m256d a[3], step[3], threshold[3];
+
+        for (size_t k = 0; k < 3; ++k) {
+            a[k] = _mm256_set1_pd(t.a[k]);
+            step[k] = _mm256_set1_pd(t.a[k] * GROUP_SIZE);
+            threshold[k] = _mm256_set1_pd(t.threshold[k]);
+        }
+
+        for (uint32_t y = t.y_begin; y < t.y_end; ++y) {
+            const double py = (double(y) + 0.5);
+            const double px = (double(x_first) + 0.5);
+            uint64_t* const row = (coverage + (row_words * y));
+
+            __m256d e[3];
+
+            for (size_t k = 0; k < 3; ++k) {
+                const double e_first = (((t.a[k] * px) + (t.b[k] * py)) + t.c[k]);
+                e[k] = _mm256_add_pd(_mm256_set1_pd(e_first), _mm256_mul_pd(lanes, a[k]));
+            }
+
+            for (uint32_t x = x_first; x < t.x_end; x += GROUP_SIZE) {
+                const __m256d inside = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(e[0], threshold[0], _CMP_GE_OQ),
+                                                                   _mm256_cmp_pd(e[1], threshold[1], _CMP_GE_OQ)),
+                                                     _mm256_cmp_pd(e[2], threshold[2], _CMP_GE_OQ));
+
+                uint32_t bits = uint32_t(_mm256_movemask_pd(inside));
+
+                if ((x + GROUP_SIZE) > t.x_end) {
+                    bits &= ((1u << (t.x_end - x)) - 1);
+                }
+
+                row[x / 64] |= (uint64_t(bits) << (x % 64));
+
+                for (size_t k = 0; k < 3; ++k) {
+                    e[k] = _mm256_add_pd(e[k], step[k]);
+                }
+            }
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    constexpr uint32_t GROUP_SIZE = 2;
+
+    void rasterize_triangle_sse2(const TriangleSetup& t, size_t row_words, uint64_t* const coverage)
+    {
+        const __m128d lanes = _mm_set_pd(1.0, 0.0);
+        const uint32_t x_first = (t.x_begin & ~(GROUP_SIZE - 1));
+
+        __m128d a[3], step[3], threshold[3];
+
+        for (size_t k = 0; k < 3; ++k) {
+            a[k] = _mm_set1_pd(t.a[k]);
+            step[k] = _mm_set1_pd(t.a[k] * GROUP_SIZE);
+            threshold[k] = _mm_set1_pd(t.threshold[k]);
+        }
+
+        for (uint32_t y = t.y_begin; y < t.y_end; ++y) {
+            const double py = (double(y) + 0.5);
+            const double px = (double(x_first) + 0.5);
+            uint64_t* const row = (coverage + (row_words * y));
+
+            __m128d e[3];
+
+            for (size_t k = 0; k < 3; ++k) {
+                const double e_first = (((t.a[k] * px) + (t.b[k] * py)) + t.c[k]);
+                e[k] = _mm_add_pd(_mm_set1_pd(e_first), _mm_mul_pd(lanes, a[k]));
+            }
+
+            for (uint32_t x = x_first; x < t.x_end; x += GROUP_SIZE) {
+                const __m128d inside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(e[0], threshold[0]),
+                                                             _mm_cmpge_pd(e[1], threshold[1])),
+                                                  _mm_cmpge_pd(e[2], threshold[2]));
+
+                uint32_t bits = uint32_t(_mm_movemask_pd(inside));
+
+                if ((x + GROUP_SIZE) > t.x_end) {
+                    bits &= ((1u << (t.x_end - x)) - 1);
+                }
+
+                row[x / 64] |= (uint64_t(bits) << (x % 64));
+
+                for (size_t k = 0; k < 3; ++k) {
+                    e[k] = _mm_add_pd(e[k], step[k]);
+                }
+            }
+        }
+    }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+    constexpr uint32_t GROUP_SIZE = 2;
+
+    void rasterize_triangle_neon(const TriangleSetup& t, size_t row_words, uint64_t* const coverage)
+    {
+        const float64x2_t lanes = { 0.0, 1.0 };
+        const uint32_t x_first = (t.x_begin & ~(GROUP_SIZE - 1));
+
+        float64x2_t a[3], step[3], threshold[3];
+
+        for (size_t k = 0; k < 3; ++k) {
+            a[k] = vdupq_n_f64(t.a[k]);
+            step[k] = vdupq_n_f64(t.a[k] * GROUP_SIZE);
+            threshold[k] = vdupq_n_f64(t.threshold[k]);
+        }
+
+        for (uint32_t y = t.y_begin; y < t.y_end; ++y) {
+            const double py = (double(y) + 0.5);
+            const double px = (double(x_first) + 0.5);
+            uint64_t* const row = (coverage + (row_words * y));
+
+            float64x2_t e[3];
+
+            for (size_t k = 0; k < 3; ++k) {
+                const double e_first = (((t.a[k] * px) + (t.b[k] * py)) + t.c[k]);
+                e[k] = vaddq_f64(vdupq_n_f64(e_first), vmulq_f64(lanes, a[k]));
+            }
+
+            for (uint32_t x = x_first; x < t.x_end; x += GROUP_SIZE) {
+                const uint64x2_t inside = vandq_u64(vandq_u64(vcgeq_f64(e[0], threshold[0]),
+                                                              vcgeq_f64(e[1], threshold[1])),
+                                                    vcgeq_f64(e[2], threshold[2]));
+
+                uint32_t bits = uint32_t((vgetq_lane_u64(inside, 0) & 1) | ((vgetq_lane_u64(inside, 1) & 1) << 1));
+
+                if ((x + GROUP_SIZE) > t.x_end) {
+                    bits &= ((1u << (t.x_end - x)) - 1);
+                }
+
+                row[x / 64] |= (uint64_t(bits) << (x % 64));
+
+                for (size_t k = 0; k < 3; ++k) {
+                    e[k] = vaddq_f64(e[k], step[k]);
+                }
+            }
+        }
+    }
+
+#endif
+
+    template<typename RasterizeTriangle>
+    void rasterize(const vr::HiddenAreaMesh_t& mesh,
+                   uint32_t width,
+                   uint32_t height,
+                   std::vector<uint64_t>& coverage,
+                   RasterizeTriangle&& rasterize_triangle)
+    {
+        const size_t row_words = HiddenAreaTileMask::coverage_row_words(width);
+        coverage.assign((row_words * height), 0);
+
+        if (mesh.pVertexData == nullptr) {
+            return;
+        }
+
+        for (uint32_t triangle_index = 0; triangle_index < mesh.unTriangleCount; ++triangle_index) {
+            TriangleSetup setup;
+
+            if (setup_triangle((mesh.pVertexData + (3 * size_t(triangle_index))), width, height, setup)) {
+                rasterize_triangle(setup, row_words, coverage.data());
+            }
+        }
+    }
+
+    size_t count_bits(const uint64_t* const row, uint32_t begin, uint32_t end)
+    {
+        size_t count = 0;
+
+        for (uint32_t word = (begin / 64); word <= ((end - 1) / 64); ++word) {
+            const uint32_t word_begin = std::max(begin, (word * 64)) - (word * 64);
+            const uint32_t word_end = std::min(end, ((word + 1) * 64)) - (word * 64);
+
+            const uint64_t mask = (((word_end == 64) ? ~uint64_t(0) : ((uint64_t(1) << word_end) - 1)) & ~((uint64_t(1) << word_begin) - 1));
+            count += size_t(__builtin_popcountll(row[word] & mask));
+        }
+
+        return count;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HiddenAreaTileMask::HiddenAreaTileMask(const vr::HiddenAreaMesh_t& mesh, uint32_t width, uint32_t height, uint32_t tile_size)
+    : m_width(width)
+    , m_height(height)
+    , m_tile_size(tile_size)
+    , m_num_tiles_x(0)
+    , m_num_tiles_y(0)
+    , m_num_hidden_pixels(0)
+{
+    if ((width == 0) || (height == 0) || (tile_size == 0)) {
+        throw std::runtime_error("Invalid tile mask size!");
+    }
+
+    m_num_tiles_x = (((width - 1) / tile_size) + 1);
+    m_num_tiles_y = (((height - 1) / tile_size) + 1);
+
+    std::vector<uint64_t> coverage;
+    rasterize_coverage(mesh, width, height, coverage);
+
+    //------------------------------------------------------------------------------
+    // Count the hidden pixels per tile.
+    const size_t row_words = coverage_row_words(width);
+    std::vector<uint32_t> num_hidden(num_tiles(), 0);
+
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint64_t* const row = (coverage.data() + (row_words * y));
+        uint32_t* const tile_row = (num_hidden.data() + (size_t(y / tile_size) * m_num_tiles_x));
+
+        for (uint32_t tile_x = 0; tile_x < m_num_tiles_x; ++tile_x) {
+            const uint32_t begin = (tile_x * tile_size);
+            const uint32_t end = std::min((begin + tile_size), width);
+
+            tile_row[tile_x] += uint32_t(count_bits(row, begin, end));
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Classify.
+    const size_t num_tile_words = ((size_t(num_tiles()) + 63) / 64);
+
+    m_hidden_tile_bits.assign(num_tile_words, 0);
+    m_partial_tile_bits.assign(num_tile_words, 0);
+
+    for (uint32_t tile_y = 0; tile_y < m_num_tiles_y; ++tile_y) {
+        const uint32_t tile_height = (std::min(((tile_y + 1) * tile_size), height) - (tile_y * tile_size));
+
+        for (uint32_t tile_x = 0; tile_x < m_num_tiles_x; ++tile_x) {
+            const uint32_t tile_width = (std::min(((tile_x + 1) * tile_size), width) - (tile_x * tile_size));
+            const uint32_t tile_index = ((tile_y * m_num_tiles_x) + tile_x);
+            const uint32_t count = num_hidden[tile_index];
+
+            m_num_hidden_pixels += count;
+
+            if (count == 0) {
+                m_visible_tiles.push_back(tile_index);
+            }
+            else if (count == (tile_width * tile_height)) {
+                m_hidden_tiles.push_back(tile_index);
+                m_hidden_tile_bits[tile_index / 64] |= (uint64_t(1) << (tile_index % 64));
+            }
+            else {
+                m_partial_tiles.push_back(tile_index);
+                m_partial_tile_bits[tile_index / 64] |= (uint64_t(1) << (tile_index % 64));
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HiddenAreaTileMask::TileState
+HiddenAreaTileMask::tile_state(uint32_t tile_x, uint32_t tile_y) const
+{
+    assert((tile_x < m_num_tiles_x) && (tile_y < m_num_tiles_y));
+
+    const uint32_t tile_index = ((tile_y * m_num_tiles_x) + tile_x);
+    const uint64_t bit = (uint64_t(1) << (tile_index % 64));
+
+    if (m_hidden_tile_bits[tile_index / 64] & bit) {
+        return TileState_Hidden;
+    }
+    else if (m_partial_tile_bits[tile_index / 64] & bit) {
+        return TileState_Partial;
+    }
+
+    return TileState_Visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+HiddenAreaTileMask::rasterize_coverage(const vr::HiddenAreaMesh_t& mesh,
+                                       uint32_t width,
+                                       uint32_t height,
+                                       std::vector<uint64_t>& coverage)
+{
+#if defined(__AVX__)
+    rasterize(mesh, width, height, coverage, rasterize_triangle_avx);
+#elif defined(__SSE2__)
+    rasterize(mesh, width, height, coverage, rasterize_triangle_sse2);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    rasterize(mesh, width, height, coverage, rasterize_triangle_neon);
+#else
+    rasterize(mesh, width, height, coverage, rasterize_triangle_scalar);
+#endif
+}
+
+void
+HiddenAreaTileMask::rasterize_coverage_scalar(const vr::HiddenAreaMesh_t& mesh,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              std::vector<uint64_t>& coverage)
+{
+    rasterize(mesh, width, height, coverage, rasterize_triangle_scalar);
+}
+
+const char*
+HiddenAreaTileMask::rasterizer_kernel_name()
+{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
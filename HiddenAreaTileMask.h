@@ -0,0 +1,165 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HIDDEN_AREA_TILE_MASK_H__
+#define __HIDDEN_AREA_TILE_MASK_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Tile occupancy of a render target by a k_eHiddenAreaMesh_Standard mesh.
+//
+// The mesh is rasterized on the CPU with the sampling rules of the GPU: a pixel
+// is hidden if its center is covered by a triangle, with the top-left rule for
+// centers exactly on an edge and vertices snapped to 1/256 pixel. Edge functions
+// are evaluated exactly (in double precision) so the classification matches
+// drawing the mesh into the stencil buffer at tile granularity. Tiled passes can
+// skip fully hidden tiles without reading the stencil buffer.
+//
+// Tiles are numbered row-major, (tile_y * num_tiles_x() + tile_x). Tiles at the
+// right and bottom edge are clipped to the render target.
+//------------------------------------------------------------------------------
+
+class HiddenAreaTileMask
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    enum TileState : uint8_t {
+        TileState_Visible = 0,      // No pixel hidden
+        TileState_Partial,
+        TileState_Hidden,           // All pixels hidden
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Classify the tiles of a (width x height) render target, e.g. of the size
+    // returned by VRSystem::GetRecommendedRenderTargetSize(). All sizes must be
+    // non-zero.
+    HiddenAreaTileMask(const vr::HiddenAreaMesh_t& mesh, uint32_t width, uint32_t height, uint32_t tile_size = 16);
+
+    //------------------------------------------------------------------------------
+    // Tiles
+public:
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+    uint32_t tile_size() const { return m_tile_size; }
+
+    uint32_t num_tiles_x() const { return m_num_tiles_x; }
+    uint32_t num_tiles_y() const { return m_num_tiles_y; }
+    uint32_t num_tiles() const { return (m_num_tiles_x * m_num_tiles_y); }
+
+    TileState tile_state(uint32_t tile_x, uint32_t tile_y) const;
+
+    //------------------------------------------------------------------------------
+    // One bit per tile (bit (i % 64) of word (i / 64) for tile i).
+    const std::vector<uint64_t>& hidden_tile_bits() const { return m_hidden_tile_bits; }
+    const std::vector<uint64_t>& partial_tile_bits() const { return m_partial_tile_bits; }
+
+    //------------------------------------------------------------------------------
+    // Tile indices by state, in ascending order.
+    const std::vector<uint32_t>& hidden_tiles() const { return m_hidden_tiles; }
+    const std::vector<uint32_t>& partial_tiles() const { return m_partial_tiles; }
+    const std::vector<uint32_t>& visible_tiles() const { return m_visible_tiles; }
+
+    //------------------------------------------------------------------------------
+    // The number of pixels covered by the mesh.
+    size_t num_hidden_pixels() const { return m_num_hidden_pixels; }
+
+    //------------------------------------------------------------------------------
+    // Rasterization
+public:
+
+    //------------------------------------------------------------------------------
+    // The number of 64-bit words per row of a coverage mask.
+    static size_t coverage_row_words(uint32_t width) { return ((size_t(width) + 63) / 64); }
+
+    //------------------------------------------------------------------------------
+    // Rasterize the triangles of the mesh into a per-pixel coverage mask of
+    // (coverage_row_words(width) * height) words, bit (x % 64) of word (x / 64)
+    // of a row being set for hidden pixels. Bits past the width are zero.
+    //
+    // Uses AVX, SSE2 or NEON depending on the instruction set the file is compiled
+    // for and falls back to rasterize_coverage_scalar() otherwise.
+    static void rasterize_coverage(const vr::HiddenAreaMesh_t& mesh,
+                                   uint32_t width,
+                                   uint32_t height,
+                                   std::vector<uint64_t>& coverage);
+
+    //------------------------------------------------------------------------------
+    // Scalar implementation of rasterize_coverage(). Produces identical results and
+    // is mainly useful as a reference.
+    static void rasterize_coverage_scalar(const vr::HiddenAreaMesh_t& mesh,
+                                          uint32_t width,
+                                          uint32_t height,
+                                          std::vector<uint64_t>& coverage);
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by rasterize_coverage() ("AVX", "SSE2", "NEON"
+    // or "Scalar").
+    static const char* rasterizer_kernel_name();
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    uint32_t                m_width;
+    uint32_t                m_height;
+    uint32_t                m_tile_size;
+    uint32_t                m_num_tiles_x;
+    uint32_t                m_num_tiles_y;
+
+    std::vector<uint64_t>   m_hidden_tile_bits;
+    std::vector<uint64_t>   m_partial_tile_bits;
+
+    std::vector<uint32_t>   m_hidden_tiles;
+    std::vector<uint32_t>   m_partial_tiles;
+    std::vector<uint32_t>   m_visible_tiles;
+
+    size_t                  m_num_hidden_pixels;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __HIDDEN_AREA_TILE_MASK_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,418 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaVertexFormat.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr uint32_t FLOAT_SIGN_MASK = 0x80000000;
+    constexpr uint32_t FLOAT_MIN_NORMAL_HALF = 0x38800000;     // 2^-14 as float bits
+    constexpr uint32_t HALF_EXPONENT_REBIAS = ((127 - 15) << 10);
+    constexpr float MAX_HALF = 65504.0f;
+    constexpr float SUBNORMAL_HALF_SCALE = 16777216.0f;         // 2^24, the inverse of the smallest subnormal half
+    constexpr float UNORM16_SCALE = 65535.0f;
+
+    //------------------------------------------------------------------------------
+    // Components below 0.5 are rounded towards -inf, all others towards +inf. The
+    // magnitude is rounded up (away from zero) for negative components and for
+    // components of at least 0.5.
+    bool rounds_magnitude_up(float component)
+    {
+        return ((component >= 0.5f) || (component < 0.0f));
+    }
+
+    uint16_t half_away_from_center(float component)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &component, sizeof(bits));
+
+        const uint32_t sign = ((bits & FLOAT_SIGN_MASK) >> 16);
+        const float magnitude = std::min(std::fabs(component), MAX_HALF);
+
+        uint32_t magnitude_bits = 0;
+        std::memcpy(&magnitude_bits, &magnitude, sizeof(magnitude_bits));
+
+        //------------------------------------------------------------------------------
+        // Truncate, then step to the next larger magnitude if inexact. Carries from
+        // the mantissa into the exponent yield the correct encoding.
+        uint32_t half = 0;
+        bool is_inexact = false;
+
+        if (magnitude_bits < FLOAT_MIN_NORMAL_HALF) {
+            const float scaled = (magnitude * SUBNORMAL_HALF_SCALE);
+            half = uint32_t(scaled);
+            is_inexact = (float(half) != scaled);
+        }
+        else {
+            half = ((magnitude_bits >> 13) - HALF_EXPONENT_REBIAS);
+            is_inexact = ((magnitude_bits & 0x1FFF) != 0);
+        }
+
+        if (is_inexact && rounds_magnitude_up(component)) {
+            ++half;
+        }
+
+        return uint16_t(sign | half);
+    }
+
+    uint16_t unorm16_away_from_center(float component)
+    {
+        const float scaled = (std::max(0.0f, std::min(component, 1.0f)) * UNORM16_SCALE);
+
+        uint32_t unorm = uint32_t(scaled);
+
+        if ((float(unorm) != scaled) && (component >= 0.5f)) {
+            ++unorm;
+        }
+
+        return uint16_t(unorm);
+    }
+
+    //------------------------------------------------------------------------------
+    // Conversion kernels. Each kernel processes as many full vectors of 8 components
+    // as fit into 'count' and returns the number of components processed, the
+    // remainder is left to the scalar implementation. The arithmetic mirrors the
+    // scalar functions above.
+
+#if defined(__SSE2__)
+
+    __m128i select_si128(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    //------------------------------------------------------------------------------
+    // Pack two vectors of 32-bit values in [0, 0xFFFF] into one vector of 16-bit
+    // values (SSE2 only has signed saturating packs).
+    __m128i pack_u16_sse2(__m128i low, __m128i high)
+    {
+        const __m128i bias_32 = _mm_set1_epi32(0x8000);
+        const __m128i bias_16 = _mm_set1_epi16(int16_t(0x8000));
+
+        return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(low, bias_32), _mm_sub_epi32(high, bias_32)), bias_16);
+    }
+
+    __m128i half_away_from_center_sse2(__m128 component)
+    {
+        const __m128i bits = _mm_castps_si128(component);
+        const __m128i sign = _mm_srli_epi32(_mm_and_si128(bits, _mm_set1_epi32(int32_t(FLOAT_SIGN_MASK))), 16);
+        const __m128 magnitude = _mm_min_ps(_mm_andnot_ps(_mm_castsi128_ps(_mm_set1_epi32(int32_t(FLOAT_SIGN_MASK))), component),
+                                            _mm_set1_ps(MAX_HALF));
+        const __m128i magnitude_bits = _mm_castps_si128(magnitude);
+
+        const __m128 scaled = _mm_mul_ps(magnitude, _mm_set1_ps(SUBNORMAL_HALF_SCALE));
+        const __m128i subnormal = _mm_cvttps_epi32(scaled);
+        const __m128i subnormal_is_inexact = _mm_castps_si128(_mm_cmpneq_ps(_mm_cvtepi32_ps(subnormal), scaled));
+
+        const __m128i normal = _mm_sub_epi32(_mm_srli_epi32(magnitude_bits, 13), _mm_set1_epi32(HALF_EXPONENT_REBIAS));
+        const __m128i normal_is_exact = _mm_cmpeq_epi32(_mm_and_si128(magnitude_bits, _mm_set1_epi32(0x1FFF)), _mm_setzero_si128());
+
+        const __m128i is_subnormal = _mm_cmplt_epi32(magnitude_bits, _mm_set1_epi32(FLOAT_MIN_NORMAL_HALF));
+        const __m128i half = select_si128(is_subnormal, subnormal, normal);
+        const __m128i is_inexact = select_si128(is_subnormal, subnormal_is_inexact, _mm_xor_si128(normal_is_exact, _mm_set1_epi32(-1)));
+
+        const __m128i rounds_up = _mm_castps_si128(_mm_or_ps(_mm_cmpge_ps(component, _mm_set1_ps(0.5f)),
+                                                             _mm_cmplt_ps(component, _mm_setzero_ps())));
+
+        //------------------------------------------------------------------------------
+        // Masks are -1, subtracting them increments.
+        return _mm_or_si128(_mm_sub_epi32(half, _mm_and_si128(is_inexact, rounds_up)), sign);
+    }
+
+    __m128i unorm16_away_from_center_sse2(__m128 component)
+    {
+        const __m128 scaled = _mm_mul_ps(_mm_max_ps(_mm_setzero_ps(), _mm_min_ps(component, _mm_set1_ps(1.0f))), _mm_set1_ps(UNORM16_SCALE));
+        const __m128i unorm = _mm_cvttps_epi32(scaled);
+
+        const __m128 is_inexact = _mm_cmpneq_ps(_mm_cvtepi32_ps(unorm), scaled);
+        const __m128 rounds_up = _mm_cmpge_ps(component, _mm_set1_ps(0.5f));
+
+        return _mm_sub_epi32(unorm, _mm_castps_si128(_mm_and_ps(is_inexact, rounds_up)));
+    }
+
+    size_t convert_half_sse2(const float* const input, size_t count, uint16_t* const output)
+    {
+        size_t i = 0;
+
+        for (; (i + 8) <= count; i += 8) {
+            const __m128i low = half_away_from_center_sse2(_mm_loadu_ps(input + i));
+            const __m128i high = half_away_from_center_sse2(_mm_loadu_ps(input + i + 4));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), pack_u16_sse2(low, high));
+        }
+
+        return i;
+    }
+
+    size_t convert_unorm16_sse2(const float* const input, size_t count, uint16_t* const output)
+    {
+        size_t i = 0;
+
+        for (; (i + 8) <= count; i += 8) {
+            const __m128i low = unorm16_away_from_center_sse2(_mm_loadu_ps(input + i));
+            const __m128i high = unorm16_away_from_center_sse2(_mm_loadu_ps(input + i + 4));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), pack_u16_sse2(low, high));
+        }
+
+        return i;
+    }
+
+#elif defined(__ARM_NEON)
+
+    uint32x4_t half_away_from_center_neon(float32x4_t component)
+    {
+        const uint32x4_t bits = vreinterpretq_u32_f32(component);
+        const uint32x4_t sign = vshrq_n_u32(vandq_u32(bits, vdupq_n_u32(FLOAT_SIGN_MASK)), 16);
+        const float32x4_t magnitude = vminq_f32(vabsq_f32(component), vdupq_n_f32(MAX_HALF));
+        const uint32x4_t magnitude_bits = vreinterpretq_u32_f32(magnitude);
+
+        const float32x4_t scaled = vmulq_f32(magnitude, vdupq_n_f32(SUBNORMAL_HALF_SCALE));
+        const uint32x4_t subnormal = vcvtq_u32_f32(scaled);
+        const uint32x4_t subnormal_is_inexact = vmvnq_u32(vceqq_f32(vcvtq_f32_u32(subnormal), scaled));
+
+        const uint32x4_t normal = vsubq_u32(vshrq_n_u32(magnitude_bits, 13), vdupq_n_u32(HALF_EXPONENT_REBIAS));
+        const uint32x4_t normal_is_inexact = vtstq_u32(magnitude_bits, vdupq_n_u32(0x1FFF));
+
+        const uint32x4_t is_subnormal = vcltq_u32(magnitude_bits, vdupq_n_u32(FLOAT_MIN_NORMAL_HALF));
+        const uint32x4_t half = vbslq_u32(is_subnormal, subnormal, normal);
+        const uint32x4_t is_inexact = vbslq_u32(is_subnormal, subnormal_is_inexact, normal_is_inexact);
+
+        const uint32x4_t rounds_up = vorrq_u32(vcgeq_f32(component, vdupq_n_f32(0.5f)), vcltq_f32(component, vdupq_n_f32(0.0f)));
+
+        return vorrq_u32(vsubq_u32(half, vandq_u32(is_inexact, rounds_up)), sign);
+    }
+
+    uint32x4_t unorm16_away_from_center_neon(float32x4_t component)
+    {
+        const float32x4_t scaled = vmulq_f32(vmaxq_f32(vdupq_n_f32(0.0f), vminq_f32(component, vdupq_n_f32(1.0f))), vdupq_n_f32(UNORM16_SCALE));
+        const uint32x4_t unorm = vcvtq_u32_f32(scaled);
+
+        const uint32x4_t is_inexact = vmvnq_u32(vceqq_f32(vcvtq_f32_u32(unorm), scaled));
+        const uint32x4_t rounds_up = vcgeq_f32(component, vdupq_n_f32(0.5f));
+
+        return vsubq_u32(unorm, vandq_u32(is_inexact, rounds_up));
+    }
+
+    size_t convert_half_neon(const float* const input, size_t count, uint16_t* const output)
+    {
+        size_t i = 0;
+
+        for (; (i + 8) <= count; i += 8) {
+            const uint32x4_t low = half_away_from_center_neon(vld1q_f32(input + i));
+            const uint32x4_t high = half_away_from_center_neon(vld1q_f32(input + i + 4));
+
+            vst1q_u16((output + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+        }
+
+        return i;
+    }
+
+    size_t convert_unorm16_neon(const float* const input, size_t count, uint16_t* const output)
+    {
+        size_t i = 0;
+
+        for (; (i + 8) <= count; i += 8) {
+            const uint32x4_t low = unorm16_away_from_center_neon(vld1q_f32(input + i));
+            const uint32x4_t high = unorm16_away_from_center_neon(vld1q_f32(input + i + 4));
+
+            vst1q_u16((output + i), vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+        }
+
+        return i;
+    }
+
+#endif
+
+    //------------------------------------------------------------------------------
+    // Vertices as flat arrays of components.
+    const float* components_of(const vr::HmdVector2_t* const vertices)
+    {
+        static_assert(sizeof(vr::HmdVector2_t) == (2 * sizeof(float)), "!");
+        return vertices->v;
+    }
+
+    template <typename Vertex>
+    uint16_t* components_of(Vertex* const vertices)
+    {
+        static_assert(sizeof(Vertex) == (2 * sizeof(uint16_t)), "!");
+        return vertices->v;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+HiddenAreaVertexFloat2::convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexFloat2* const output)
+{
+    if (count > 0) {
+        std::memcpy(output, input, (sizeof(HiddenAreaVertexFloat2) * count));
+    }
+}
+
+void
+HiddenAreaVertexFloat2::convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexFloat2* const output)
+{
+    for (size_t i = 0; i < count; ++i) {
+        output[i].v[0] = input[i].v[0];
+        output[i].v[1] = input[i].v[1];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+HiddenAreaVertexHalf2::convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexHalf2* const output)
+{
+    const float* const components = components_of(input);
+    uint16_t* const halves = components_of(output);
+    const size_t num_components = (2 * count);
+
+    size_t processed = 0;
+
+#if defined(__SSE2__)
+    processed = convert_half_sse2(components, num_components, halves);
+#elif defined(__ARM_NEON)
+    processed = convert_half_neon(components, num_components, halves);
+#endif
+
+    //------------------------------------------------------------------------------
+    // Remainder.
+    for (size_t i = processed; i < num_components; ++i) {
+        halves[i] = half_away_from_center(components[i]);
+    }
+}
+
+void
+HiddenAreaVertexHalf2::convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexHalf2* const output)
+{
+    for (size_t i = 0; i < count; ++i) {
+        output[i].v[0] = half_away_from_center(input[i].v[0]);
+        output[i].v[1] = half_away_from_center(input[i].v[1]);
+    }
+}
+
+float
+HiddenAreaVertexHalf2::to_float(uint16_t half)
+{
+    const uint32_t exponent = ((half >> 10) & 0x1F);
+    const uint32_t mantissa = (half & 0x3FF);
+
+    float magnitude = 0.0f;
+
+    if (exponent == 0) {
+        magnitude = (float(mantissa) / SUBNORMAL_HALF_SCALE);
+    }
+    else if (exponent == 0x1F) {
+        magnitude = ((mantissa == 0) ? HUGE_VALF : NAN);
+    }
+    else {
+        magnitude = std::ldexp(float(0x400 | mantissa), (int(exponent) - 25));
+    }
+
+    return ((half & 0x8000) ? -magnitude : magnitude);
+}
+
+const char*
+HiddenAreaVertexHalf2::kernel_name()
+{
+#if defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+HiddenAreaVertexUShort2Normalized::convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexUShort2Normalized* const output)
+{
+    const float* const components = components_of(input);
+    uint16_t* const unorms = components_of(output);
+    const size_t num_components = (2 * count);
+
+    size_t processed = 0;
+
+#if defined(__SSE2__)
+    processed = convert_unorm16_sse2(components, num_components, unorms);
+#elif defined(__ARM_NEON)
+    processed = convert_unorm16_neon(components, num_components, unorms);
+#endif
+
+    //------------------------------------------------------------------------------
+    // Remainder.
+    for (size_t i = processed; i < num_components; ++i) {
+        unorms[i] = unorm16_away_from_center(components[i]);
+    }
+}
+
+void
+HiddenAreaVertexUShort2Normalized::convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexUShort2Normalized* const output)
+{
+    for (size_t i = 0; i < count; ++i) {
+        output[i].v[0] = unorm16_away_from_center(input[i].v[0]);
+        output[i].v[1] = unorm16_away_from_center(input[i].v[1]);
+    }
+}
+
+const char*
+HiddenAreaVertexUShort2Normalized::kernel_name()
+{
+#if defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
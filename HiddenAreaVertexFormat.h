@@ -0,0 +1,118 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HIDDEN_AREA_VERTEX_FORMAT_H__
+#define __HIDDEN_AREA_VERTEX_FORMAT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Vertex formats for uploading hidden area meshes to the GPU.
+//
+// Hidden area vertices are UVs in [0, 1] so 16-bit components (half precision or
+// unsigned normalized) are sufficient and halve the vertex data of the 32-bit
+// floats OpenVR provides. Quantization rounds each component away from the
+// center of the render target (up at or above 0.5, down below). This moves the
+// inner boundary of the standard mesh outward, towards the border of the render
+// target, so the quantized mesh never hides more than the original, and grows
+// the inverse mesh, so it never shows less. Shared vertices are converted
+// identically, so welded meshes stay watertight. 0, 0.5 and 1 are exact in all
+// formats.
+//
+// convert() processes the components as a flat array, uses SSE2 or NEON
+// depending on the instruction set the file is compiled for (see kernel_name())
+// and produces the same results as convert_scalar().
+//------------------------------------------------------------------------------
+
+struct HiddenAreaVertexFloat2
+{
+    float       v[2];
+
+    //------------------------------------------------------------------------------
+    // Same layout as HmdVector2_t, i.e. a copy.
+    static void convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexFloat2* const output);
+    static void convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexFloat2* const output);
+
+    vr::HmdVector2_t decode() const { return {{ v[0], v[1] }}; }
+};
+
+//------------------------------------------------------------------------------
+// IEEE 754 half precision components. Components of up to 2^-14 in magnitude
+// are stored as subnormals, larger magnitudes than the largest finite half are
+// clamped to it.
+struct HiddenAreaVertexHalf2
+{
+    uint16_t    v[2];
+
+    static void convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexHalf2* const output);
+    static void convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexHalf2* const output);
+
+    vr::HmdVector2_t decode() const { return {{ to_float(v[0]), to_float(v[1]) }}; }
+
+    static float to_float(uint16_t half);
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by convert() ("SSE2", "NEON" or "Scalar").
+    static const char* kernel_name();
+};
+
+//------------------------------------------------------------------------------
+// Unsigned normalized 16-bit components (component / 65535). Components outside
+// [0, 1] are clamped.
+struct HiddenAreaVertexUShort2Normalized
+{
+    uint16_t    v[2];
+
+    static void convert(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexUShort2Normalized* const output);
+    static void convert_scalar(const vr::HmdVector2_t* const input, size_t count, HiddenAreaVertexUShort2Normalized* const output);
+
+    vr::HmdVector2_t decode() const { return {{ (float(v[0]) / 65535.0f), (float(v[1]) / 65535.0f) }}; }
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by convert() ("SSE2", "NEON" or "Scalar").
+    static const char* kernel_name();
+};
+
+static_assert(sizeof(HiddenAreaVertexFloat2) == sizeof(vr::HmdVector2_t), "!");
+static_assert(sizeof(HiddenAreaVertexHalf2) == 4, "!");
+static_assert(sizeof(HiddenAreaVertexUShort2Normalized) == 4, "!");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __HIDDEN_AREA_VERTEX_FORMAT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,473 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "InverseDistortionMap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_COLORS = 3;
+    constexpr size_t SEED_GRID_SIZE = 64;           // Cells per axis
+    constexpr size_t SEED_SAMPLES_PER_CELL = 4;     // Forward samples per cell and axis
+    constexpr float MAX_STEP = 0.125f;              // In display UV
+    constexpr float NOT_CONVERGED = -1.0f;
+
+    //------------------------------------------------------------------------------
+    // Display UV seeds of one color channel over a (SEED_GRID_SIZE x
+    // SEED_GRID_SIZE) grid of render target cells.
+    struct SeedGrid
+    {
+        std::vector<float>      u;
+        std::vector<float>      v;
+    };
+
+    //------------------------------------------------------------------------------
+    // Splat a forward sampling of the LUT into the seed grids of all channels,
+    // keeping the sample landing closest to each cell's center, then grow filled
+    // cells into empty ones.
+    void build_seed_grids(const DistortionLUT& forward, vr::EVREye eye, SeedGrid seeds[NUM_COLORS])
+    {
+        const size_t n = (SEED_GRID_SIZE * SEED_SAMPLES_PER_CELL);
+        const size_t num_cells = (SEED_GRID_SIZE * SEED_GRID_SIZE);
+
+        std::vector<float> u(n), v(n);
+        std::vector<float> output_storage(n * DistortionLUT::Channel_Count);
+        float* output[DistortionLUT::Channel_Count];
+
+        for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+            output[c] = (output_storage.data() + (c * n));
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            u[i] = ((float(i) + 0.5f) / float(n));
+        }
+
+        std::vector<float> distances[NUM_COLORS];
+
+        for (size_t color = 0; color < NUM_COLORS; ++color) {
+            seeds[color].u.assign(num_cells, NOT_CONVERGED);
+            seeds[color].v.assign(num_cells, NOT_CONVERGED);
+            distances[color].assign(num_cells, std::numeric_limits<float>::infinity());
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            std::fill(v.begin(), v.end(), ((float(j) + 0.5f) / float(n)));
+            forward.lookup_batch(eye, u.data(), v.data(), n, output);
+
+            for (size_t color = 0; color < NUM_COLORS; ++color) {
+                const float* const x = output[2 * color];
+                const float* const y = output[(2 * color) + 1];
+
+                for (size_t i = 0; i < n; ++i) {
+                    if ((x[i] < 0.0f) || (x[i] >= 1.0f) || (y[i] < 0.0f) || (y[i] >= 1.0f)) {
+                        continue;
+                    }
+
+                    const size_t cell_x = std::min(size_t(x[i] * float(SEED_GRID_SIZE)), (SEED_GRID_SIZE - 1));
+                    const size_t cell_y = std::min(size_t(y[i] * float(SEED_GRID_SIZE)), (SEED_GRID_SIZE - 1));
+                    const size_t cell = ((cell_y * SEED_GRID_SIZE) + cell_x);
+
+                    const float dx = (x[i] - ((float(cell_x) + 0.5f) / float(SEED_GRID_SIZE)));
+                    const float dy = (y[i] - ((float(cell_y) + 0.5f) / float(SEED_GRID_SIZE)));
+                    const float distance = ((dx * dx) + (dy * dy));
+
+                    if (distance < distances[color][cell]) {
+                        distances[color][cell] = distance;
+                        seeds[color].u[cell] = u[i];
+                        seeds[color].v[cell] = v[i];
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // Cells no sample landed in take the seed of a filled neighbor.
+        for (size_t color = 0; color < NUM_COLORS; ++color) {
+            SeedGrid& grid = seeds[color];
+
+            for (bool changed = true; changed; ) {
+                const SeedGrid previous = grid;
+                changed = false;
+
+                for (size_t cell_y = 0; cell_y < SEED_GRID_SIZE; ++cell_y) {
+                    for (size_t cell_x = 0; cell_x < SEED_GRID_SIZE; ++cell_x) {
+                        const size_t cell = ((cell_y * SEED_GRID_SIZE) + cell_x);
+
+                        if (previous.u[cell] != NOT_CONVERGED) {
+                            continue;
+                        }
+
+                        const size_t neighbors[4] = {
+                            ((cell_x > 0) ? (cell - 1) : cell),
+                            ((cell_x < (SEED_GRID_SIZE - 1)) ? (cell + 1) : cell),
+                            ((cell_y > 0) ? (cell - SEED_GRID_SIZE) : cell),
+                            ((cell_y < (SEED_GRID_SIZE - 1)) ? (cell + SEED_GRID_SIZE) : cell),
+                        };
+
+                        for (const size_t neighbor : neighbors) {
+                            if (previous.u[neighbor] != NOT_CONVERGED) {
+                                grid.u[cell] = previous.u[neighbor];
+                                grid.v[cell] = previous.v[neighbor];
+                                changed = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Convergence of one row of one eye.
+    struct RowStatistics
+    {
+        size_t      num_converged = 0;
+        size_t      num_iterations = 0;
+        uint32_t    max_iterations = 0;
+        float       max_residual = 0.0f;
+    };
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+InverseDistortionMap::InverseDistortionMap(const DistortionLUT& forward,
+                                           size_t width,
+                                           size_t height,
+                                           ThreadPool* const pool,
+                                           float tolerance,
+                                           uint32_t max_iterations)
+    : m_width(width)
+    , m_height(height)
+{
+    if ((width < 2) || (height < 2)) {
+        throw std::runtime_error("Invalid inverse distortion map size!");
+    }
+
+    if (not (tolerance > 0.0f)) {
+        throw std::runtime_error("Invalid tolerance!");
+    }
+
+    const size_t plane_size = (width * height);
+
+    SeedGrid seeds[2][NUM_COLORS];
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        m_tables[eye].resize(plane_size * DistortionLUT::Channel_Count);
+        build_seed_grids(forward, eye, seeds[eye]);
+    }
+
+    //------------------------------------------------------------------------------
+    // Finite difference steps of half a forward LUT cell.
+    const float step_u = (0.5f / float(forward.width() - 1));
+    const float step_v = (0.5f / float(forward.height() - 1));
+
+    std::vector<RowStatistics> row_statistics(2 * height);
+
+    //------------------------------------------------------------------------------
+    // One work item per row of either eye.
+    const auto solve_row = [&](size_t row_index) {
+        const vr::EVREye eye = ((row_index < height) ? vr::Eye_Left : vr::Eye_Right);
+        const size_t y = (row_index % height);
+        const float target_y = (float(y) / float(height - 1));
+        const size_t seed_y = std::min(size_t(target_y * float(SEED_GRID_SIZE)), (SEED_GRID_SIZE - 1));
+
+        std::vector<float> target_x(width), u(width), v(width), probe_u(width), probe_v(width);
+        std::vector<float> residual(width);
+        std::vector<uint32_t> iterations(width);
+        std::vector<uint8_t> active(width);
+
+        //------------------------------------------------------------------------------
+        // Distorted u and v of the color being solved for at (u, v) and the probes.
+        std::vector<float> output_storage(3 * 2 * width);
+        float* output[2];
+        float* output_du[2];
+        float* output_dv[2];
+
+        for (size_t c = 0; c < 2; ++c) {
+            output[c] = (output_storage.data() + (c * width));
+            output_du[c] = (output[c] + (2 * width));
+            output_dv[c] = (output_du[c] + (2 * width));
+        }
+
+        for (size_t x = 0; x < width; ++x) {
+            target_x[x] = (float(x) / float(width - 1));
+        }
+
+        float* const table = m_tables[eye].data();
+        RowStatistics& statistics = row_statistics[row_index];
+
+        for (size_t color = 0; color < NUM_COLORS; ++color) {
+            const SeedGrid& grid = seeds[eye][color];
+
+            for (size_t x = 0; x < width; ++x) {
+                const size_t seed_x = std::min(size_t(target_x[x] * float(SEED_GRID_SIZE)), (SEED_GRID_SIZE - 1));
+                const size_t cell = ((seed_y * SEED_GRID_SIZE) + seed_x);
+
+                u[x] = grid.u[cell];
+                v[x] = grid.v[cell];
+                iterations[x] = 0;
+                active[x] = 1;
+            }
+
+            const DistortionLUT::Channel channel_u = DistortionLUT::Channel(2 * color);
+
+            const float* const distorted_x = output[0];
+            const float* const distorted_y = output[1];
+
+            for (uint32_t iteration = 0; ; ++iteration) {
+                forward.lookup_batch_color(eye, channel_u, u.data(), v.data(), width, output);
+
+                //------------------------------------------------------------------------------
+                // Retire converged samples.
+                size_t num_active = 0;
+
+                for (size_t x = 0; x < width; ++x) {
+                    const float fx = (distorted_x[x] - target_x[x]);
+                    const float fy = (distorted_y[x] - target_y);
+
+                    residual[x] = std::sqrt((fx * fx) + (fy * fy));
+
+                    if (active[x] && (residual[x] <= tolerance)) {
+                        active[x] = 0;
+                        iterations[x] = iteration;
+                    }
+
+                    num_active += active[x];
+                }
+
+                if ((num_active == 0) || (iteration == max_iterations)) {
+                    break;
+                }
+
+                //------------------------------------------------------------------------------
+                // Probe away from the upper edges so the differences stay inside the LUT.
+                for (size_t x = 0; x < width; ++x) {
+                    probe_u[x] = ((u[x] > (1.0f - step_u)) ? (u[x] - step_u) : (u[x] + step_u));
+                    probe_v[x] = ((v[x] > (1.0f - step_v)) ? (v[x] - step_v) : (v[x] + step_v));
+                }
+
+                forward.lookup_batch_color(eye, channel_u, probe_u.data(), v.data(), width, output_du);
+                forward.lookup_batch_color(eye, channel_u, u.data(), probe_v.data(), width, output_dv);
+
+                const float* const distorted_x_du = output_du[0];
+                const float* const distorted_y_du = output_du[1];
+                const float* const distorted_x_dv = output_dv[0];
+                const float* const distorted_y_dv = output_dv[1];
+
+                //------------------------------------------------------------------------------
+                // Newton step (branch free apart from the active mask).
+                for (size_t x = 0; x < width; ++x) {
+                    const float hu = (probe_u[x] - u[x]);
+                    const float hv = (probe_v[x] - v[x]);
+
+                    const float a = ((distorted_x_du[x] - distorted_x[x]) / hu);
+                    const float b = ((distorted_x_dv[x] - distorted_x[x]) / hv);
+                    const float c = ((distorted_y_du[x] - distorted_y[x]) / hu);
+                    const float d = ((distorted_y_dv[x] - distorted_y[x]) / hv);
+
+                    const float determinant = ((a * d) - (b * c));
+                    const float inverse_determinant = ((std::fabs(determinant) > 1.0e-12f) ? (1.0f / determinant) : 0.0f);
+
+                    const float fx = (distorted_x[x] - target_x[x]);
+                    const float fy = (distorted_y[x] - target_y);
+
+                    float du = (((d * fx) - (b * fy)) * inverse_determinant);
+                    float dv = (((a * fy) - (c * fx)) * inverse_determinant);
+
+                    const float length = std::sqrt((du * du) + (dv * dv));
+                    const float scale = ((length > MAX_STEP) ? (MAX_STEP / length) : 1.0f);
+
+                    du *= (active[x] ? scale : 0.0f);
+                    dv *= (active[x] ? scale : 0.0f);
+
+                    u[x] = std::max(0.0f, std::min((u[x] - du), 1.0f));
+                    v[x] = std::max(0.0f, std::min((v[x] - dv), 1.0f));
+                }
+            }
+
+            //------------------------------------------------------------------------------
+            // Store the solutions.
+            float* const plane_u = (table + (plane_size * (2 * color)) + (y * width));
+            float* const plane_v = (table + (plane_size * ((2 * color) + 1)) + (y * width));
+
+            for (size_t x = 0; x < width; ++x) {
+                if (active[x]) {
+                    plane_u[x] = NOT_CONVERGED;
+                    plane_v[x] = NOT_CONVERGED;
+                    continue;
+                }
+
+                plane_u[x] = u[x];
+                plane_v[x] = v[x];
+
+                ++statistics.num_converged;
+                statistics.num_iterations += iterations[x];
+                statistics.max_iterations = std::max(statistics.max_iterations, iterations[x]);
+                statistics.max_residual = std::max(statistics.max_residual, residual[x]);
+            }
+        }
+    };
+
+    if (pool) {
+        pool->parallel_for((2 * height), solve_row);
+    }
+    else {
+        for (size_t row_index = 0; row_index < (2 * height); ++row_index) {
+            solve_row(row_index);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Combine the rows' statistics in order.
+    for (size_t row_index = 0; row_index < (2 * height); ++row_index) {
+        const RowStatistics& row = row_statistics[row_index];
+        Statistics& statistics = m_statistics[(row_index < height) ? vr::Eye_Left : vr::Eye_Right];
+
+        statistics.num_converged += row.num_converged;
+        statistics.mean_iterations += double(row.num_iterations);
+        statistics.max_iterations = std::max(statistics.max_iterations, row.max_iterations);
+        statistics.max_residual = std::max(statistics.max_residual, row.max_residual);
+    }
+
+    for (Statistics& statistics : m_statistics) {
+        statistics.num_samples = (plane_size * NUM_COLORS);
+        statistics.mean_iterations = ((statistics.num_converged > 0) ? (statistics.mean_iterations / double(statistics.num_converged)) : 0.0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::DistortionCoordinates_t
+InverseDistortionMap::lookup(vr::EVREye eye, float x, float y) const
+{
+    assert((eye == vr::Eye_Left) || (eye == vr::Eye_Right));
+
+    const float fx_total = (std::max(0.0f, std::min(x, 1.0f)) * float(m_width - 1));
+    const float fy_total = (std::max(0.0f, std::min(y, 1.0f)) * float(m_height - 1));
+
+    const size_t x0 = std::min(size_t(fx_total), (m_width - 2));
+    const size_t y0 = std::min(size_t(fy_total), (m_height - 2));
+
+    const float fx = (fx_total - float(x0));
+    const float fy = (fy_total - float(y0));
+
+    const float w00 = ((1.0f - fx) * (1.0f - fy));
+    const float w10 = (fx * (1.0f - fy));
+    const float w01 = ((1.0f - fx) * fy);
+    const float w11 = (fx * fy);
+
+    const size_t i00 = ((y0 * m_width) + x0);
+    const size_t i10 = (i00 + 1);
+    const size_t i01 = (i00 + m_width);
+    const size_t i11 = (i01 + 1);
+
+    float result[DistortionLUT::Channel_Count];
+
+    for (size_t c = 0; c < DistortionLUT::Channel_Count; ++c) {
+        const float* const plane = channel(eye, Channel(c));
+        result[c] = ((plane[i00] * w00) + (plane[i10] * w10) + (plane[i01] * w01) + (plane[i11] * w11));
+    }
+
+    vr::DistortionCoordinates_t uv;
+
+    uv.rfRed[0]   = result[DistortionLUT::Channel_RedU];
+    uv.rfRed[1]   = result[DistortionLUT::Channel_RedV];
+    uv.rfGreen[0] = result[DistortionLUT::Channel_GreenU];
+    uv.rfGreen[1] = result[DistortionLUT::Channel_GreenV];
+    uv.rfBlue[0]  = result[DistortionLUT::Channel_BlueU];
+    uv.rfBlue[1]  = result[DistortionLUT::Channel_BlueV];
+
+    return uv;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+InverseDistortionMap::ErrorReport
+InverseDistortionMap::compute_error_report(vr::IVRSystem* const system, vr::EVREye eye, size_t step) const
+{
+    ErrorReport report;
+    double sum_error = 0.0;
+
+    step = std::max<size_t>(step, 1);
+
+    for (size_t y = 0; y < m_height; y += step) {
+        for (size_t x = 0; x < m_width; x += step) {
+            const size_t index = ((y * m_width) + x);
+            const float target[2] = { (float(x) / float(m_width - 1)), (float(y) / float(m_height - 1)) };
+
+            for (size_t color = 0; color < NUM_COLORS; ++color) {
+                const float u = channel(eye, Channel(2 * color))[index];
+                const float v = channel(eye, Channel((2 * color) + 1))[index];
+
+                if (u == NOT_CONVERGED) {
+                    continue;
+                }
+
+                vr::DistortionCoordinates_t xy;
+
+                if (not system->ComputeDistortion(eye, u, v, &xy)) {
+                    continue;
+                }
+
+                const float* const distorted = ((color == 0) ? xy.rfRed : ((color == 1) ? xy.rfGreen : xy.rfBlue));
+                const float error = std::hypot((distorted[0] - target[0]), (distorted[1] - target[1]));
+
+                report.max_error = std::max(report.max_error, error);
+                sum_error += double(error);
+                ++report.num_samples;
+            }
+        }
+    }
+
+    report.mean_error = ((report.num_samples > 0) ? float(sum_error / double(report.num_samples)) : 0.0f);
+
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,169 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __INVERSE_DISTORTION_MAP_H__
+#define __INVERSE_DISTORTION_MAP_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Precomputed inverse of the lens distortion.
+//
+// ComputeDistortion() maps a display UV to the render target UV it shows, per
+// color channel. This table stores the inverse on a regular grid of (width x
+// height) render target UVs covering [0, 1] x [0, 1]: for each channel the
+// display UV whose distorted coordinate is the grid point, in the same six
+// plane layout as DistortionLUT.
+//
+// Each grid point is solved by Newton iteration on a forward DistortionLUT, a
+// whole row at a time so the forward evaluations use its batch lookup and the
+// 2 x 2 solves run over plain arrays. The Jacobian is taken by finite
+// differences over half a LUT cell and steps are limited in length. Iteration
+// is seeded from a coarse grid over the render target filled by splatting a
+// coarse forward sampling of the LUT. Render target UVs no display UV maps to
+// do not converge and are stored as (-1, -1).
+//------------------------------------------------------------------------------
+
+class InverseDistortionMap
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    typedef DistortionLUT::Channel Channel;
+
+    //------------------------------------------------------------------------------
+    // Convergence of the Newton iteration of one eye (all channels). Residuals are
+    // distances in render target UV between the forward LUT at the solution and
+    // the grid point, for converged samples.
+    struct Statistics
+    {
+        size_t      num_samples = 0;
+        size_t      num_converged = 0;
+        double      mean_iterations = 0.0;
+        uint32_t    max_iterations = 0;
+        float       max_residual = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Round trip error of converged samples against the system itself: the
+    // distance in render target UV between ComputeDistortion() at the stored
+    // display UV and the grid point.
+    struct ErrorReport
+    {
+        size_t      num_samples = 0;
+        float       max_error = 0.0f;
+        float       mean_error = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Solve both eyes on a (width x height) grid (both at least 2) to the given
+    // tolerance in render target UV, using at most 'max_iterations' iterations per
+    // sample. If a thread pool is given the rows are solved concurrently; the
+    // results do not depend on the number of threads.
+    InverseDistortionMap(const DistortionLUT& forward,
+                         size_t width,
+                         size_t height,
+                         ThreadPool* const pool = nullptr,
+                         float tolerance = 1.0e-5f,
+                         uint32_t max_iterations = 16);
+
+    //------------------------------------------------------------------------------
+    // Lookup
+public:
+
+    //------------------------------------------------------------------------------
+    // Bilinearly interpolated display UVs of the given render target UV (clamped
+    // to [0, 1]). Interpolation next to samples that did not converge mixes in
+    // their (-1, -1).
+    vr::DistortionCoordinates_t lookup(vr::EVREye eye, float x, float y) const;
+
+    //------------------------------------------------------------------------------
+    // Table Access
+public:
+
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+
+    //------------------------------------------------------------------------------
+    // A plane of (width x height) samples in row-major order.
+    const float* channel(vr::EVREye eye, Channel channel) const
+    {
+        return (m_tables[eye].data() + (m_width * m_height * channel));
+    }
+
+    size_t size_in_bytes() const { return (sizeof(float) * (m_tables[0].size() + m_tables[1].size())); }
+
+    const Statistics& statistics(vr::EVREye eye) const { return m_statistics[eye]; }
+
+    //------------------------------------------------------------------------------
+    // Error Analysis
+public:
+
+    //------------------------------------------------------------------------------
+    // Compare every 'step'th sample in each direction against ComputeDistortion().
+    ErrorReport compute_error_report(vr::IVRSystem* const system, vr::EVREye eye, size_t step = 1) const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    size_t                  m_width;
+    size_t                  m_height;
+    std::vector<float>      m_tables[2];
+    Statistics              m_statistics[2];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __INVERSE_DISTORTION_MAP_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LatencyHistogram.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+LatencyHistogram::Snapshot::percentile(double fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    const double clamped_fraction = std::max(0.0, std::min(fraction, 1.0));
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(clamped_fraction * double(count))));
+
+    uint64_t cumulative = 0;
+
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        cumulative += counts[i];
+
+        if (cumulative >= rank) {
+            return std::min(bucket_upper_bound(i), max);
+        }
+    }
+
+    return max;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void
+LatencyHistogram::reset()
+{
+    for (std::atomic<uint64_t>& count : m_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot
+LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        snapshot.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+LatencyHistogram::bucket_lower_bound(size_t index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return uint64_t(index);
+    }
+
+    const size_t shift = ((index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT);
+    const uint64_t mantissa = uint64_t((index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT);
+
+    return ((SUB_BUCKET_COUNT + mantissa) << shift);
+}
+
+uint64_t
+LatencyHistogram::bucket_upper_bound(size_t index)
+{
+    return (((index + 1) < NUM_BUCKETS) ? (bucket_lower_bound(index + 1) - 1) : UINT64_MAX);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
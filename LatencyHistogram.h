@@ -0,0 +1,158 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Lock-free histogram of integer values (e.g. latencies in nanoseconds) with a
+// bounded relative error, in the manner of HdrHistogram.
+//
+// Values below SUB_BUCKET_COUNT have a bucket each. Above, each power of two
+// range is split into SUB_BUCKET_COUNT buckets, so a bucket is at most 1/16th
+// (6.25 %) of its values wide. Values of 2^MAX_EXPONENT and above share the
+// last bucket.
+//
+// record() is a few relaxed atomic operations and may be called from any number
+// of threads. snapshot() may run concurrently and never blocks the recording
+// threads; records in flight may be missing from the sum or the maximum but
+// buckets are never torn.
+//------------------------------------------------------------------------------
+
+class LatencyHistogram
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKET_COUNT = (1u << SUB_BUCKET_BITS);
+    static constexpr uint32_t MAX_EXPONENT = 40;
+    static constexpr size_t NUM_BUCKETS = (SUB_BUCKET_COUNT + ((MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT));
+
+    //------------------------------------------------------------------------------
+    // A copy of the histogram at one point in time.
+    struct Snapshot
+    {
+        std::array<uint64_t, NUM_BUCKETS>   counts = {};
+        uint64_t                            count = 0;      // Sum of the counts
+        uint64_t                            sum = 0;
+        uint64_t                            max = 0;
+
+        double mean() const { return ((count > 0) ? (double(sum) / double(count)) : 0.0); }
+
+        //------------------------------------------------------------------------------
+        // The smallest value that at least the given fraction (in [0, 1]) of the
+        // recorded values are less than or equal to, up to the bucket resolution.
+        // 0 if the histogram is empty.
+        uint64_t percentile(double fraction) const;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Recording
+public:
+
+    void record(uint64_t value)
+    {
+        m_counts[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+
+        while ((value > max) && (not m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))) {
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Clear the histogram. Values recorded concurrently may be lost.
+    void reset();
+
+    Snapshot snapshot() const;
+
+    //------------------------------------------------------------------------------
+    // Buckets
+public:
+
+    static size_t bucket_index(uint64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT) {
+            return size_t(value);
+        }
+
+        const uint32_t exponent = (63 - uint32_t(__builtin_clzll(value)));
+
+        if (exponent >= MAX_EXPONENT) {
+            return (NUM_BUCKETS - 1);
+        }
+
+        const uint32_t shift = (exponent - SUB_BUCKET_BITS);
+        const size_t mantissa = size_t((value >> shift) & (SUB_BUCKET_COUNT - 1));
+
+        return (SUB_BUCKET_COUNT + (size_t(shift) * SUB_BUCKET_COUNT) + mantissa);
+    }
+
+    //------------------------------------------------------------------------------
+    // The range of values of a bucket (inclusive).
+    static uint64_t bucket_lower_bound(size_t index);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    std::atomic<uint64_t>       m_counts[NUM_BUCKETS];
+    std::atomic<uint64_t>       m_sum;
+    std::atomic<uint64_t>       m_max;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __LATENCY_HISTOGRAM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
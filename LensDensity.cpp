@@ -0,0 +1,117 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LensDensity.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<LensDensity::Sample>
+LensDensity::sample(vr::IVRSystem* const system,
+                    vr::EVREye eye,
+                    uint32_t width,
+                    uint32_t height,
+                    uint32_t num_samples)
+{
+    const size_t n = num_samples;
+    const size_t stride = (n + 1);
+
+    std::vector<float> x(stride * stride);
+    std::vector<float> y(stride * stride);
+    std::vector<bool> valid(stride * stride);
+
+    for (size_t j = 0; j <= n; ++j) {
+        for (size_t i = 0; i <= n; ++i) {
+            vr::DistortionCoordinates_t distortion;
+            const size_t index = ((j * stride) + i);
+
+            valid[index] = system->ComputeDistortion(eye, (float(i) / float(n)), (float(j) / float(n)), &distortion);
+            x[index] = distortion.rfGreen[0];
+            y[index] = distortion.rfGreen[1];
+        }
+    }
+
+    std::vector<Sample> samples;
+    float max_density_x = 0.0f;
+    float max_density_y = 0.0f;
+
+    samples.reserve(n * n);
+
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            const size_t index = ((j * stride) + i);
+
+            if (not (valid[index] && valid[index + 1] && valid[index + stride] && valid[index + stride + 1])) {
+                continue;
+            }
+
+            //------------------------------------------------------------------------------
+            // d(x, y) / d(u, v), the grid spacing cancels out in the normalization.
+            const double a = (x[index + 1] - x[index]);
+            const double b = (x[index + stride] - x[index]);
+            const double c = (y[index + 1] - y[index]);
+            const double d = (y[index + stride] - y[index]);
+            const double determinant = std::fabs((a * d) - (b * c));
+
+            if (determinant < 1.0e-12) {
+                continue;
+            }
+
+            Sample sample;
+            sample.x = (0.25f * (x[index] + x[index + 1] + x[index + stride] + x[index + stride + 1]));
+            sample.y = (0.25f * (y[index] + y[index + 1] + y[index + stride] + y[index + stride + 1]));
+
+            if ((sample.x < 0.0f) || (sample.x >= 1.0f) || (sample.y < 0.0f) || (sample.y >= 1.0f)) {
+                continue;
+            }
+
+            sample.density_x = float(std::hypot((d * width), (c * height)) / determinant);
+            sample.density_y = float(std::hypot((b * width), (a * height)) / determinant);
+
+            max_density_x = std::max(max_density_x, sample.density_x);
+            max_density_y = std::max(max_density_y, sample.density_y);
+
+            samples.push_back(sample);
+        }
+    }
+
+    for (Sample& sample : samples) {
+        sample.density_x /= max_density_x;
+        sample.density_y /= max_density_y;
+    }
+
+    return samples;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,89 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __LENS_DENSITY_H__
+#define __LENS_DENSITY_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The render target pixel density the display actually samples through the
+// lens.
+//
+// The display samples the render target at the distorted UV returned by
+// IVRSystem::ComputeDistortion() (green channel), so the render target pixels
+// needed per display pixel along x are given by the first column of the
+// inverse Jacobian of the distortion, along y by the second. The Jacobian is
+// taken by forward differences over the cells of a regular grid in display UV.
+// Display pixels are assumed to have the render target's aspect ratio.
+//------------------------------------------------------------------------------
+
+class LensDensity
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    struct Sample
+    {
+        float       x = 0.0f;               // Render target UV of the cell center
+        float       y = 0.0f;
+        float       density_x = 0.0f;       // Normalized
+        float       density_y = 0.0f;
+    };
+
+    //------------------------------------------------------------------------------
+    // Sampling
+public:
+
+    //------------------------------------------------------------------------------
+    // Sample the (num_samples x num_samples) cells of the given eye for a (width x
+    // height) render target. Cells mapping outside the render target or failing
+    // to compute are dropped. Densities are normalized per axis to 1 at the
+    // densest cell, which is where the recommended render target size is 1:1.
+    static std::vector<Sample> sample(vr::IVRSystem* const system,
+                                      vr::EVREye eye,
+                                      uint32_t width,
+                                      uint32_t height,
+                                      uint32_t num_samples);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __LENS_DENSITY_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,311 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MATRIX_UTILS_H__
+#define __MATRIX_UTILS_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <OpenVR/OpenVR.h>
+
+#if defined(__APPLE__)
+#   include <simd/simd.h>
+#endif
+
+#if defined(__SSE__)
+#   include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if !defined(__APPLE__)
+
+//------------------------------------------------------------------------------
+// Stand-ins for the <simd/simd.h> matrix types used by this library with the
+// same size and layout (column-major, 16-byte columns) so code using them
+// builds on other platforms.
+//------------------------------------------------------------------------------
+
+typedef float simd_float4 __attribute__((__vector_size__(16)));
+typedef simd_float4 simd_float3;    // Like <simd/simd.h>: 3 lanes padded to 16 bytes
+
+struct simd_float3x3 { simd_float3 columns[3]; };
+struct simd_float4x4 { simd_float4 columns[4]; };
+
+#endif // __APPLE__
+
+static_assert(sizeof(simd_float3x3) == (3 * 16), "!");
+static_assert(sizeof(simd_float4x4) == (4 * 16), "!");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Conversion of OpenVR (row-major) matrices to simd (column-major) matrices,
+// i.e. transposition, and the bits of matrix math needed on top of them.
+// Available on all platforms, vr::metal::Utils forwards to these.
+//------------------------------------------------------------------------------
+
+class MatrixUtils
+{
+public:
+
+    //------------------------------------------------------------------------------
+    // Convert a OpenVR 3x3 matrix to a simd 3x3 matrix.
+    static simd_float3x3 simd_from_hmd_matrix(const vr::HmdMatrix33_t& m)
+    {
+        simd_float3x3 result;
+        result.columns[0] = simd_float3 { m.m[0][0], m.m[1][0], m.m[2][0] };
+        result.columns[1] = simd_float3 { m.m[0][1], m.m[1][1], m.m[2][1] };
+        result.columns[2] = simd_float3 { m.m[0][2], m.m[1][2], m.m[2][2] };
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Convert a OpenVR 3x4 matrix to a simd 4x4 matrix.
+    static simd_float4x4 simd_from_hmd_matrix(const vr::HmdMatrix34_t& m)
+    {
+        simd_float4x4 result;
+
+#if defined(__SSE__)
+        __m128 r0 = _mm_loadu_ps(m.m[0]);
+        __m128 r1 = _mm_loadu_ps(m.m[1]);
+        __m128 r2 = _mm_loadu_ps(m.m[2]);
+        __m128 r3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        store(result, r0, r1, r2, r3);
+#else
+        result.columns[0] = simd_float4 { m.m[0][0], m.m[1][0], m.m[2][0], 0.0f };
+        result.columns[1] = simd_float4 { m.m[0][1], m.m[1][1], m.m[2][1], 0.0f };
+        result.columns[2] = simd_float4 { m.m[0][2], m.m[1][2], m.m[2][2], 0.0f };
+        result.columns[3] = simd_float4 { m.m[0][3], m.m[1][3], m.m[2][3], 1.0f };
+#endif
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Convert a OpenVR 4x4 matrix to a simd 4x4 matrix.
+    static simd_float4x4 simd_from_hmd_matrix(const vr::HmdMatrix44_t& m)
+    {
+        simd_float4x4 result;
+
+#if defined(__SSE__)
+        __m128 r0 = _mm_loadu_ps(m.m[0]);
+        __m128 r1 = _mm_loadu_ps(m.m[1]);
+        __m128 r2 = _mm_loadu_ps(m.m[2]);
+        __m128 r3 = _mm_loadu_ps(m.m[3]);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        store(result, r0, r1, r2, r3);
+#elif defined(__ARM_NEON)
+        //------------------------------------------------------------------------------
+        // A de-interleaving load of the rows yields the columns.
+        const float32x4x4_t columns = vld4q_f32(&m.m[0][0]);
+
+        for (size_t c = 0; c < 4; ++c) {
+            vst1q_f32(reinterpret_cast<float*>(&result.columns[c]), columns.val[c]);
+        }
+#else
+        for (size_t c = 0; c < 4; ++c) {
+            result.columns[c] = simd_float4 { m.m[0][c], m.m[1][c], m.m[2][c], m.m[3][c] };
+        }
+#endif
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Matrix Math
+public:
+
+    static simd_float4x4 identity()
+    {
+        simd_float4x4 result;
+        result.columns[0] = simd_float4 { 1.0f, 0.0f, 0.0f, 0.0f };
+        result.columns[1] = simd_float4 { 0.0f, 1.0f, 0.0f, 0.0f };
+        result.columns[2] = simd_float4 { 0.0f, 0.0f, 1.0f, 0.0f };
+        result.columns[3] = simd_float4 { 0.0f, 0.0f, 0.0f, 1.0f };
+        return result;
+    }
+
+    static simd_float4x4 translation(float x, float y, float z)
+    {
+        simd_float4x4 result = identity();
+        result.columns[3] = simd_float4 { x, y, z, 1.0f };
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Rigid transform from a unit quaternion (w, x, y, z) and a position.
+    static simd_float4x4 rigid_transform(const float orientation[4], const float position[3])
+    {
+        const float w = orientation[0], x = orientation[1], y = orientation[2], z = orientation[3];
+
+        simd_float4x4 result;
+        result.columns[0] = simd_float4 { (1.0f - (2.0f * ((y * y) + (z * z)))), (2.0f * ((x * y) + (z * w))), (2.0f * ((x * z) - (y * w))), 0.0f };
+        result.columns[1] = simd_float4 { (2.0f * ((x * y) - (z * w))), (1.0f - (2.0f * ((x * x) + (z * z)))), (2.0f * ((y * z) + (x * w))), 0.0f };
+        result.columns[2] = simd_float4 { (2.0f * ((x * z) + (y * w))), (2.0f * ((y * z) - (x * w))), (1.0f - (2.0f * ((x * x) + (y * y)))), 0.0f };
+        result.columns[3] = simd_float4 { position[0], position[1], position[2], 1.0f };
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Matrix-vector product (m * v).
+    static simd_float4 multiply(const simd_float4x4& m, const simd_float4& v)
+    {
+        return ((m.columns[0] * v[0]) + (m.columns[1] * v[1]) + (m.columns[2] * v[2]) + (m.columns[3] * v[3]));
+    }
+
+    //------------------------------------------------------------------------------
+    // Matrix product (a * b).
+    static simd_float4x4 multiply(const simd_float4x4& a, const simd_float4x4& b)
+    {
+        simd_float4x4 result;
+
+        for (size_t c = 0; c < 4; ++c) {
+            result.columns[c] = multiply(a, b.columns[c]);
+        }
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Inverse of a rigid transform (rotation and translation only).
+    static simd_float4x4 inverse_rigid(const simd_float4x4& m)
+    {
+        simd_float4x4 result;
+
+        for (size_t c = 0; c < 3; ++c) {
+            result.columns[c] = simd_float4 { m.columns[0][c], m.columns[1][c], m.columns[2][c], 0.0f };
+        }
+
+        const simd_float4 t = m.columns[3];
+        result.columns[3] = -((result.columns[0] * t[0]) + (result.columns[1] * t[1]) + (result.columns[2] * t[2]));
+        result.columns[3][3] = 1.0f;
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Inverse of a general matrix (in double precision via cofactors). Returns the
+    // identity for singular matrices.
+    static simd_float4x4 inverse(const simd_float4x4& m)
+    {
+        double a[16];   // Column-major
+
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                a[(c * 4) + r] = double(m.columns[c][r]);
+            }
+        }
+
+        double inv[16];
+
+        inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+        inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+        inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+        inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+        inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+        inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+        inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+        inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+        inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+        inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+        inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+        inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+        inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+        inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+        inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+        inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+        const double determinant = ((a[0] * inv[0]) + (a[1] * inv[4]) + (a[2] * inv[8]) + (a[3] * inv[12]));
+
+        if (determinant == 0.0) {
+            return identity();
+        }
+
+        simd_float4x4 result;
+
+        for (size_t c = 0; c < 4; ++c) {
+            for (size_t r = 0; r < 4; ++r) {
+                result.columns[c][r] = float(inv[(c * 4) + r] / determinant);
+            }
+        }
+
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // Projection from tangents of the half angles like IVRSystem::GetProjectionRaw()
+    // composed the same way as IVRSystem::GetProjectionMatrix() (right-handed, depth
+    // in [0, 1]).
+    static simd_float4x4 projection_from_raw(float left, float right, float top, float bottom, float near_z, float far_z)
+    {
+        const float idx = (1.0f / (right - left));
+        const float idy = (1.0f / (bottom - top));
+        const float idz = (1.0f / (far_z - near_z));
+
+        simd_float4x4 result;
+        result.columns[0] = simd_float4 { (2.0f * idx), 0.0f, 0.0f, 0.0f };
+        result.columns[1] = simd_float4 { 0.0f, (2.0f * idy), 0.0f, 0.0f };
+        result.columns[2] = simd_float4 { ((right + left) * idx), ((bottom + top) * idy), (-far_z * idz), -1.0f };
+        result.columns[3] = simd_float4 { 0.0f, 0.0f, (-far_z * near_z * idz), 0.0f };
+        return result;
+    }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+#if defined(__SSE__)
+    static void store(simd_float4x4& result, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+    {
+        _mm_storeu_ps(reinterpret_cast<float*>(&result.columns[0]), c0);
+        _mm_storeu_ps(reinterpret_cast<float*>(&result.columns[1]), c1);
+        _mm_storeu_ps(reinterpret_cast<float*>(&result.columns[2]), c2);
+        _mm_storeu_ps(reinterpret_cast<float*>(&result.columns[3]), c3);
+    }
+#endif
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __MATRIX_UTILS_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
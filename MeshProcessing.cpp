@@ -0,0 +1,456 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MeshProcessing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    uint64_t vertex_key(const vr::HmdVector2_t& vertex)
+    {
+        //------------------------------------------------------------------------------
+        // Compare bit patterns, except that -0.0 and 0.0 are the same position.
+        const float x = ((vertex.v[0] == 0.0f) ? 0.0f : vertex.v[0]);
+        const float y = ((vertex.v[1] == 0.0f) ? 0.0f : vertex.v[1]);
+
+        uint32_t x_bits, y_bits;
+        std::memcpy(&x_bits, &x, sizeof(x_bits));
+        std::memcpy(&y_bits, &y, sizeof(y_bits));
+
+        return ((uint64_t(x_bits) << 32) | uint64_t(y_bits));
+    }
+
+    uint32_t edge_key(uint16_t from, uint16_t to)
+    {
+        return ((uint32_t(from) << 16) | uint32_t(to));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MeshProcessing::make_indexed_mesh(const vr::HiddenAreaMesh_t& mesh,
+                                  IndexedMesh& indexed_mesh,
+                                  size_t cache_size,
+                                  Statistics* const statistics)
+{
+    const size_t num_input_vertices = (3 * size_t(mesh.unTriangleCount));
+
+    if (not weld_vertices(mesh.pVertexData, num_input_vertices, indexed_mesh)) {
+        return false;
+    }
+
+    const float acmr_before = compute_acmr(indexed_mesh.indices, indexed_mesh.vertices.size(), cache_size);
+
+    optimize_vertex_cache(indexed_mesh.indices, indexed_mesh.vertices.size(), cache_size);
+
+    const float acmr_after = compute_acmr(indexed_mesh.indices, indexed_mesh.vertices.size(), cache_size);
+
+    //------------------------------------------------------------------------------
+    // Prefer strips if they are shorter.
+    const size_t num_list_indices = indexed_mesh.indices.size();
+    const size_t num_triangles = (num_list_indices / 3);
+
+    size_t num_strips = 0;
+    std::vector<uint16_t> strip_indices = make_triangle_strips(indexed_mesh.indices, &num_strips);
+
+    const size_t num_strip_indices = strip_indices.size();
+
+    if (num_strip_indices < num_list_indices) {
+        indexed_mesh.indices.swap(strip_indices);
+        indexed_mesh.is_strip = true;
+    }
+
+    if (statistics) {
+        statistics->num_input_triangles = mesh.unTriangleCount;
+        statistics->num_input_vertices = num_input_vertices;
+
+        statistics->num_triangles = num_triangles;
+        statistics->num_vertices = indexed_mesh.vertices.size();
+        statistics->num_list_indices = num_list_indices;
+        statistics->num_strip_indices = num_strip_indices;
+        statistics->num_strips = num_strips;
+
+        statistics->acmr_before = acmr_before;
+        statistics->acmr_after = acmr_after;
+
+        statistics->bytes_before = (2 * sizeof(float) * num_input_vertices);
+        statistics->bytes_after = ((2 * sizeof(float) * indexed_mesh.vertices.size()) + (sizeof(uint16_t) * indexed_mesh.indices.size()));
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MeshProcessing::weld_vertices(const vr::HmdVector2_t* const vertices,
+                              size_t num_vertices,
+                              IndexedMesh& indexed_mesh)
+{
+    indexed_mesh = IndexedMesh();
+
+    std::unordered_map<uint64_t, uint16_t> vertex_indices;
+    vertex_indices.reserve(num_vertices);
+
+    indexed_mesh.indices.reserve(num_vertices);
+
+    for (size_t i = 0; (i + 3) <= num_vertices; i += 3) {
+        const uint64_t keys[3] = { vertex_key(vertices[i]), vertex_key(vertices[i + 1]), vertex_key(vertices[i + 2]) };
+
+        //------------------------------------------------------------------------------
+        // Triangles with repeated vertices do not cover any pixels.
+        if ((keys[0] == keys[1]) || (keys[1] == keys[2]) || (keys[2] == keys[0])) {
+            continue;
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            const auto inserted = vertex_indices.emplace(keys[k], uint16_t(indexed_mesh.vertices.size()));
+
+            if (inserted.second) {
+                if (indexed_mesh.vertices.size() == IndexedMesh::MAX_NUM_VERTICES) {
+                    indexed_mesh = IndexedMesh();
+                    return false;
+                }
+
+                indexed_mesh.vertices.push_back(vertices[i + k]);
+            }
+
+            indexed_mesh.indices.push_back(inserted.first->second);
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MeshProcessing::optimize_vertex_cache(std::vector<uint16_t>& indices, size_t num_vertices, size_t cache_size)
+{
+    const size_t num_triangles = (indices.size() / 3);
+
+    if (num_triangles == 0) {
+        return;
+    }
+
+    //------------------------------------------------------------------------------
+    // Triangles adjacent to each vertex, in compressed row form.
+    std::vector<uint32_t> num_live_triangles(num_vertices, 0);
+
+    for (const uint16_t index : indices) {
+        ++num_live_triangles[index];
+    }
+
+    std::vector<uint32_t> adjacency_offsets((num_vertices + 1), 0);
+
+    for (size_t v = 0; v < num_vertices; ++v) {
+        adjacency_offsets[v + 1] = (adjacency_offsets[v] + num_live_triangles[v]);
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), (adjacency_offsets.end() - 1));
+
+        for (size_t t = 0; t < num_triangles; ++t) {
+            for (size_t k = 0; k < 3; ++k) {
+                adjacency[fill[indices[(3 * t) + k]]++] = uint32_t(t);
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Tipsify. Fan around a vertex emitting all its remaining triangles, then move
+    // on to the adjacent vertex that will still be in the cache once its remaining
+    // triangles are emitted, or fall back to recently used vertices (dead-end
+    // stack) and finally to scanning.
+    std::vector<int64_t> cache_time(num_vertices, 0);
+    std::vector<bool> emitted(num_triangles, false);
+    std::vector<uint16_t> dead_end_stack;
+    std::vector<uint16_t> candidates;
+
+    std::vector<uint16_t> output;
+    output.reserve(indices.size());
+
+    const int64_t cache_size_i = int64_t(cache_size);
+    int64_t time = (cache_size_i + 1);
+    size_t cursor = 0;
+    int64_t fanning_vertex = indices[0];
+
+    while (fanning_vertex >= 0) {
+        candidates.clear();
+
+        for (uint32_t a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; ++a) {
+            const uint32_t t = adjacency[a];
+
+            if (emitted[t]) {
+                continue;
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                const uint16_t v = indices[(3 * t) + k];
+
+                output.push_back(v);
+                dead_end_stack.push_back(v);
+                candidates.push_back(v);
+                --num_live_triangles[v];
+
+                if ((time - cache_time[v]) > cache_size_i) {
+                    cache_time[v] = time++;
+                }
+            }
+
+            emitted[t] = true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Next fanning vertex.
+        fanning_vertex = -1;
+        int64_t best_priority = -1;
+
+        for (const uint16_t v : candidates) {
+            if (num_live_triangles[v] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+
+            if (((time - cache_time[v]) + (2 * int64_t(num_live_triangles[v]))) <= cache_size_i) {
+                priority = (time - cache_time[v]);
+            }
+
+            if (priority > best_priority) {
+                best_priority = priority;
+                fanning_vertex = v;
+            }
+        }
+
+        while ((fanning_vertex < 0) && not dead_end_stack.empty()) {
+            const uint16_t v = dead_end_stack.back();
+            dead_end_stack.pop_back();
+
+            if (num_live_triangles[v] != 0) {
+                fanning_vertex = v;
+            }
+        }
+
+        while ((fanning_vertex < 0) && (cursor < num_vertices)) {
+            if (num_live_triangles[cursor] != 0) {
+                fanning_vertex = int64_t(cursor);
+            }
+
+            ++cursor;
+        }
+    }
+
+    assert(output.size() == indices.size());
+    indices.swap(output);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint16_t>
+MeshProcessing::make_triangle_strips(const std::vector<uint16_t>& indices, size_t* const num_strips)
+{
+    const size_t num_triangles = (indices.size() / 3);
+
+    //------------------------------------------------------------------------------
+    // Triangles by directed edge (in winding order).
+    std::unordered_multimap<uint32_t, uint32_t> triangles_by_edge;
+    triangles_by_edge.reserve(indices.size());
+
+    for (size_t t = 0; t < num_triangles; ++t) {
+        const uint16_t* const triangle = &indices[3 * t];
+
+        triangles_by_edge.emplace(edge_key(triangle[0], triangle[1]), uint32_t(t));
+        triangles_by_edge.emplace(edge_key(triangle[1], triangle[2]), uint32_t(t));
+        triangles_by_edge.emplace(edge_key(triangle[2], triangle[0]), uint32_t(t));
+    }
+
+    //------------------------------------------------------------------------------
+    // Triangle 'j' of a strip is (s[j], s[j + 1], s[j + 2]) for even 'j' and
+    // (s[j + 1], s[j], s[j + 2]) for odd 'j'. The next triangle must therefore
+    // contain the directed edge s[j + 1] -> s[j + 2] for odd 'j' and the reverse
+    // for even 'j', its third vertex extends the strip.
+    std::vector<uint32_t> visited(num_triangles, 0);        // 1 = used, otherwise the trial that used it
+    uint32_t trial = 1;
+
+    const auto extend = [&](std::vector<uint16_t>& strip, std::vector<uint32_t>& strip_triangles) {
+        for (;;) {
+            const size_t j = (strip.size() - 3);
+            const uint16_t p = strip[j + 1];
+            const uint16_t q = strip[j + 2];
+            const uint32_t key = (((j + 1) % 2) == 0) ? edge_key(p, q) : edge_key(q, p);
+
+            const auto range = triangles_by_edge.equal_range(key);
+            auto it = range.first;
+
+            while ((it != range.second) && ((visited[it->second] == 1) || (visited[it->second] == trial))) {
+                ++it;
+            }
+
+            if (it == range.second) {
+                return;
+            }
+
+            const uint32_t t = it->second;
+            const uint16_t* const triangle = &indices[3 * t];
+
+            uint16_t r = triangle[0];
+
+            for (size_t k = 0; k < 3; ++k) {
+                if ((triangle[k] != p) && (triangle[k] != q)) {
+                    r = triangle[k];
+                }
+            }
+
+            visited[t] = trial;
+            strip.push_back(r);
+            strip_triangles.push_back(t);
+        }
+    };
+
+    std::vector<uint16_t> output;
+    std::vector<uint16_t> strip, best_strip;
+    std::vector<uint32_t> strip_triangles, best_strip_triangles;
+    size_t count = 0;
+
+    for (size_t t = 0; t < num_triangles; ++t) {
+        if (visited[t] == 1) {
+            continue;
+        }
+
+        //------------------------------------------------------------------------------
+        // Try all three rotations of the starting triangle and keep the longest.
+        best_strip.clear();
+        best_strip_triangles.clear();
+
+        for (size_t rotation = 0; rotation < 3; ++rotation) {
+            ++trial;
+
+            strip.assign({ indices[(3 * t) + rotation], indices[(3 * t) + ((rotation + 1) % 3)], indices[(3 * t) + ((rotation + 2) % 3)] });
+            strip_triangles.assign({ uint32_t(t) });
+            visited[t] = trial;
+
+            extend(strip, strip_triangles);
+
+            if (strip.size() > best_strip.size()) {
+                best_strip.swap(strip);
+                best_strip_triangles.swap(strip_triangles);
+            }
+        }
+
+        for (const uint32_t strip_triangle : best_strip_triangles) {
+            visited[strip_triangle] = 1;
+        }
+
+        if (not output.empty()) {
+            output.push_back(IndexedMesh::RESTART_INDEX);
+        }
+
+        output.insert(output.end(), best_strip.begin(), best_strip.end());
+        ++count;
+    }
+
+    if (num_strips) {
+        *num_strips = count;
+    }
+
+    return output;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float
+MeshProcessing::compute_acmr(const std::vector<uint16_t>& indices, size_t num_vertices, size_t cache_size)
+{
+    const size_t num_triangles = (indices.size() / 3);
+
+    if (num_triangles == 0) {
+        return 0.0f;
+    }
+
+    //------------------------------------------------------------------------------
+    // A vertex is in the FIFO cache if fewer than 'cache_size' misses happened
+    // since it was loaded.
+    std::vector<int64_t> load_time(num_vertices, INT64_MIN / 2);
+    int64_t num_misses = 0;
+
+    for (const uint16_t index : indices) {
+        if ((num_misses - load_time[index]) >= int64_t(cache_size)) {
+            load_time[index] = num_misses++;
+        }
+    }
+
+    return (float(num_misses) / float(num_triangles));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HiddenAreaMeshData
+MeshProcessing::make_rectangular_mesh(float coverage)
+{
+    const float coverage_2 = (coverage / 2.0f);
+    const float p[4] = { coverage_2, coverage_2, (1.0f - coverage_2), (1.0f - coverage_2) };
+
+    HiddenAreaMeshData mesh;
+    mesh.count = 8;
+    mesh.vertices = {
+        { { 0.0f, 0.0f } }, { { p[0], p[1] } }, { { 1.0f, 0.0f } },
+        { { 1.0f, 0.0f } }, { { p[0], p[1] } }, { { p[2], p[1] } },
+        { { 1.0f, 0.0f } }, { { p[2], p[1] } }, { { 1.0f, 1.0f } },
+        { { 1.0f, 1.0f } }, { { p[2], p[1] } }, { { p[2], p[3] } },
+        { { 1.0f, 1.0f } }, { { p[2], p[3] } }, { { 0.0f, 1.0f } },
+        { { 0.0f, 1.0f } }, { { p[2], p[3] } }, { { p[0], p[3] } },
+        { { 0.0f, 1.0f } }, { { p[0], p[3] } }, { { 0.0f, 0.0f } },
+        { { 0.0f, 0.0f } }, { { p[0], p[3] } }, { { p[0], p[1] } },
+    };
+
+    assert(mesh.vertices.size() == (3 * size_t(mesh.count)));
+
+    return mesh;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
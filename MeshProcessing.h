@@ -0,0 +1,164 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MESH_PROCESSING_H__
+#define __MESH_PROCESSING_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Owning storage for hidden area mesh data in OpenVR layout, i.e. an unindexed
+// triangle list or the vertices of a line loop. 'count' has the meaning of
+// HiddenAreaMesh_t::unTriangleCount for the respective mesh type.
+//------------------------------------------------------------------------------
+
+struct HiddenAreaMeshData
+{
+    std::vector<vr::HmdVector2_t>   vertices;
+    uint32_t                        count = 0;
+
+    vr::HiddenAreaMesh_t as_hidden_area_mesh() const { return { vertices.data(), count }; }
+};
+
+//------------------------------------------------------------------------------
+// An indexed triangle mesh with 16-bit indices. Indices are either a triangle
+// list or a triangle strip in which strips are separated by RESTART_INDEX.
+//------------------------------------------------------------------------------
+
+struct IndexedMesh
+{
+    static constexpr uint16_t RESTART_INDEX = 0xFFFF;
+    static constexpr size_t MAX_NUM_VERTICES = RESTART_INDEX;
+
+    std::vector<vr::HmdVector2_t>   vertices;
+    std::vector<uint16_t>           indices;
+    bool                            is_strip = false;
+};
+
+//------------------------------------------------------------------------------
+// CPU processing of OpenVR hidden area meshes (k_eHiddenAreaMesh_Standard and
+// k_eHiddenAreaMesh_Inverse, i.e. unindexed triangle lists).
+//------------------------------------------------------------------------------
+
+class MeshProcessing
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // Vertex/index counts before and after processing. ACMR is the average number
+    // of post-transform cache misses per triangle for a FIFO cache of the size
+    // given to make_indexed_mesh(), before and after reordering the triangles of
+    // the welded mesh. An unindexed mesh always has an ACMR of 3.
+    struct Statistics
+    {
+        size_t      num_input_triangles = 0;
+        size_t      num_input_vertices = 0;
+
+        size_t      num_triangles = 0;          // After dropping degenerate triangles
+        size_t      num_vertices = 0;           // Unique vertices
+        size_t      num_list_indices = 0;
+        size_t      num_strip_indices = 0;      // Including restart indices
+        size_t      num_strips = 0;
+
+        float       acmr_before = 0.0f;
+        float       acmr_after = 0.0f;
+
+        size_t      bytes_before = 0;           // Vertex data (simd_float2)
+        size_t      bytes_after = 0;            // Vertex and index data of the chosen layout
+    };
+
+    //------------------------------------------------------------------------------
+    // Indexed Meshes
+public:
+
+    //------------------------------------------------------------------------------
+    // Weld identical vertices of the given triangle list mesh, drop degenerate
+    // triangles, reorder triangles for the post-transform vertex cache and convert
+    // to triangle strips if that results in fewer indices. Triangle winding is
+    // preserved. Returns false (and leaves 'indexed_mesh' empty) if the mesh has
+    // more unique vertices than 16-bit indices can address.
+    static bool make_indexed_mesh(const vr::HiddenAreaMesh_t& mesh,
+                                  IndexedMesh& indexed_mesh,
+                                  size_t cache_size = 16,
+                                  Statistics* const statistics = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Mesh Processing Stages
+public:
+
+    //------------------------------------------------------------------------------
+    // Merge bitwise identical vertices (treating -0.0 as 0.0) of an unindexed
+    // triangle list and drop triangles that become degenerate.
+    static bool weld_vertices(const vr::HmdVector2_t* const vertices,
+                              size_t num_vertices,
+                              IndexedMesh& indexed_mesh);
+
+    //------------------------------------------------------------------------------
+    // Reorder the triangles of an indexed triangle list for a post-transform cache
+    // of the given size (Tipsify, Sander et al. 2007). The vertices of each
+    // triangle keep their order.
+    static void optimize_vertex_cache(std::vector<uint16_t>& indices, size_t num_vertices, size_t cache_size);
+
+    //------------------------------------------------------------------------------
+    // Convert an indexed triangle list to triangle strips joined by RESTART_INDEX.
+    // Triangles are visited in list order and strips extended greedily across
+    // shared edges with matching winding.
+    static std::vector<uint16_t> make_triangle_strips(const std::vector<uint16_t>& indices, size_t* const num_strips = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Average cache misses per triangle of an indexed triangle list for a FIFO
+    // cache of the given size.
+    static float compute_acmr(const std::vector<uint16_t>& indices, size_t num_vertices, size_t cache_size);
+
+    //------------------------------------------------------------------------------
+    // {Debugging}
+public:
+
+    //------------------------------------------------------------------------------
+    // A k_eHiddenAreaMesh_Standard style mesh of 8 triangles hiding a border of
+    // (coverage / 2) on each side, i.e. leaving [coverage / 2, 1 - coverage / 2]
+    // in both dimensions visible.
+    static HiddenAreaMeshData make_rectangular_mesh(float coverage);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __MESH_PROCESSING_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
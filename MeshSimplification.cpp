@@ -0,0 +1,1283 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MeshSimplification.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Geometry is evaluated in double precision so that the conservativeness tests
+    // are not affected by rounding of nearly collinear vertices.
+    struct Point
+    {
+        double x;
+        double y;
+    };
+
+    Point operator+(const Point& a, const Point& b) { return { (a.x + b.x), (a.y + b.y) }; }
+    Point operator-(const Point& a, const Point& b) { return { (a.x - b.x), (a.y - b.y) }; }
+    Point operator*(const Point& a, double s) { return { (a.x * s), (a.y * s) }; }
+
+    bool operator==(const Point& a, const Point& b) { return ((a.x == b.x) && (a.y == b.y)); }
+
+    double dot(const Point& a, const Point& b) { return ((a.x * b.x) + (a.y * b.y)); }
+    double cross(const Point& a, const Point& b) { return ((a.x * b.y) - (a.y * b.x)); }
+
+    //------------------------------------------------------------------------------
+    // Twice the signed area, positive for counter-clockwise triangles.
+    double signed_area(const Point& a, const Point& b, const Point& c) { return cross((b - a), (c - a)); }
+
+    // Triangles smaller than this are considered degenerate.
+    constexpr double MIN_TRIANGLE_AREA = 1e-14;
+
+    // Samples per replacement segment when measuring the deviation from the original outline.
+    constexpr size_t NUM_DEVIATION_SAMPLES = 8;
+
+    // Guards against endless simplification sweeps.
+    constexpr size_t MAX_NUM_SWEEPS = 256;
+
+    // Float steps searched around a new outline vertex for a conservative position.
+    constexpr int MAX_ROUNDING_STEPS = 4;
+
+    //------------------------------------------------------------------------------
+    // All positions are float values, either input vertices or new vertices
+    // rounded by round_towards_hidden(), so the conversion back is exact.
+    Point to_point(const vr::HmdVector2_t& v) { return { double(v.v[0]), double(v.v[1]) }; }
+
+    vr::HmdVector2_t to_vector(const Point& p)
+    {
+        assert((double(float(p.x)) == p.x) && (double(float(p.y)) == p.y));
+        return { { float(p.x), float(p.y) } };
+    }
+
+    double distance_to_segment(const Point& p, const Point& a, const Point& b)
+    {
+        const Point ab = (b - a);
+        const double length_squared = dot(ab, ab);
+        const double t = ((length_squared > 0.0) ? std::min(std::max((dot((p - a), ab) / length_squared), 0.0), 1.0) : 0.0);
+        const Point d = (p - (a + (ab * t)));
+
+        return std::sqrt(dot(d, d));
+    }
+
+    double distance_to_polyline(const Point& p, const std::vector<Point>& polyline)
+    {
+        assert(polyline.size() >= 2);
+
+        double distance = INFINITY;
+
+        for (size_t i = 1; i < polyline.size(); ++i) {
+            distance = std::min(distance, distance_to_segment(p, polyline[i - 1], polyline[i]));
+        }
+
+        return distance;
+    }
+
+    //------------------------------------------------------------------------------
+    // Symmetric deviation of a replacement polyline from a section of the original
+    // outline with the same end points. The replacement is sampled along its
+    // segments since its largest distance from the original outline does not
+    // necessarily occur at a vertex.
+    double deviation(const std::vector<Point>& original, const std::vector<Point>& replacement)
+    {
+        double max_distance = 0.0;
+
+        for (const Point& p : original) {
+            max_distance = std::max(max_distance, distance_to_polyline(p, replacement));
+        }
+
+        for (size_t i = 1; i < replacement.size(); ++i) {
+            for (size_t s = 1; s < NUM_DEVIATION_SAMPLES; ++s) {
+                const double t = (double(s) / double(NUM_DEVIATION_SAMPLES));
+                const Point p = (replacement[i - 1] + ((replacement[i] - replacement[i - 1]) * t));
+
+                max_distance = std::max(max_distance, distance_to_polyline(p, original));
+            }
+        }
+
+        return max_distance;
+    }
+
+    //------------------------------------------------------------------------------
+    // True if the closed segments [a0, a1] and [b0, b1] have a point in common.
+    bool segments_intersect(const Point& a0, const Point& a1, const Point& b0, const Point& b1)
+    {
+        const double d0 = signed_area(a0, a1, b0);
+        const double d1 = signed_area(a0, a1, b1);
+        const double d2 = signed_area(b0, b1, a0);
+        const double d3 = signed_area(b0, b1, a1);
+
+        if ((((d0 > 0.0) && (d1 < 0.0)) || ((d0 < 0.0) && (d1 > 0.0))) &&
+            (((d2 > 0.0) && (d3 < 0.0)) || ((d2 < 0.0) && (d3 > 0.0))))
+        {
+            return true;
+        }
+
+        const auto on_segment = [](const Point& p, const Point& a, const Point& b) {
+            return ((std::min(a.x, b.x) <= p.x) && (p.x <= std::max(a.x, b.x)) &&
+                    (std::min(a.y, b.y) <= p.y) && (p.y <= std::max(a.y, b.y)));
+        };
+
+        return (((d0 == 0.0) && on_segment(b0, a0, a1)) ||
+                ((d1 == 0.0) && on_segment(b1, a0, a1)) ||
+                ((d2 == 0.0) && on_segment(a0, b0, b1)) ||
+                ((d3 == 0.0) && on_segment(a1, b0, b1)));
+    }
+
+    //------------------------------------------------------------------------------
+    // True if the outline edge [e0, e1] does not intersect the new outline segment
+    // [s0, s1]. An edge sharing an end point with the segment may only touch it
+    // there.
+    bool is_edge_clear(const Point& s0, const Point& s1, const Point& e0, const Point& e1)
+    {
+        const bool shares_e0 = ((e0 == s0) || (e0 == s1));
+        const bool shares_e1 = ((e1 == s0) || (e1 == s1));
+
+        if (shares_e0 && shares_e1) {
+            return false;
+        }
+        else if (shares_e0 || shares_e1) {
+            const Point& shared = (shares_e0 ? e0 : e1);
+            const Point& edge_end = (shares_e0 ? e1 : e0);
+            const Point& segment_end = ((shared == s0) ? s1 : s0);
+
+            return ((distance_to_segment(edge_end, s0, s1) != 0.0) && (distance_to_segment(segment_end, e0, e1) != 0.0));
+        }
+
+        return (not segments_intersect(s0, s1, e0, e1));
+    }
+
+    //------------------------------------------------------------------------------
+    // Round a new outline vertex c on the lines through p -> a and b -> q to the
+    // nearest float position on the left of (or on) both lines, i.e. towards the
+    // hidden region, so that the outline through it never hides more than the
+    // outline through c. Returns false if there is none within a few float steps
+    // (for nearly opposite lines).
+    bool round_towards_hidden(const Point& p, const Point& a, const Point& b, const Point& q, Point& c)
+    {
+        const auto float_below = [](double x) {
+            const float f = float(x);
+            return ((double(f) > x) ? std::nextafter(f, -INFINITY) : f);
+        };
+
+        const auto step = [](float f, int n) {
+            for (; (n > 0); --n) { f = std::nextafter(f, INFINITY); }
+            for (; (n < 0); ++n) { f = std::nextafter(f, -INFINITY); }
+            return f;
+        };
+
+        const float x0 = float_below(c.x);
+        const float y0 = float_below(c.y);
+
+        bool found = false;
+        Point best = c;
+        double best_distance = INFINITY;
+
+        for (int i = (1 - MAX_ROUNDING_STEPS); i <= MAX_ROUNDING_STEPS; ++i) {
+            for (int j = (1 - MAX_ROUNDING_STEPS); j <= MAX_ROUNDING_STEPS; ++j) {
+                const Point candidate = { double(step(x0, i)), double(step(y0, j)) };
+                const Point d = (candidate - c);
+
+                if ((signed_area(p, a, candidate) >= 0.0) && (signed_area(b, q, candidate) >= 0.0) && (dot(d, d) < best_distance)) {
+                    best = candidate;
+                    best_distance = dot(d, d);
+                    found = true;
+                }
+            }
+        }
+
+        c = best;
+        return found;
+    }
+
+    //------------------------------------------------------------------------------
+    // The ways of removing the outline edge a -> b from the outline p -> a -> b -> q.
+    // The hidden region is on the left of the outline so removing a vertex where
+    // the outline turns left, or moving the edge to the left, only shrinks it.
+    enum CollapseKind {
+        CollapseKind_RemoveA,       // p -> b, requires a left turn at a
+        CollapseKind_RemoveB,       // a -> q, requires a left turn at b
+        CollapseKind_Extend,        // p -> c -> q with c on the extensions of p -> a and q -> b
+    };
+
+    struct OutlineSection
+    {
+        Point                       p, a, b, q;
+        bool                        a_is_original;
+        bool                        b_is_original;
+
+        // Original outline vertices represented by the current edges.
+        const std::vector<Point>*   chain_pa;
+        const std::vector<Point>*   chain_ab;
+        const std::vector<Point>*   chain_bq;
+    };
+
+    struct OutlineCollapse
+    {
+        CollapseKind                kind;
+        Point                       position;   // Of the remaining vertex
+        double                      error;
+    };
+
+    void append_original(std::vector<Point>& points, const Point& p, bool is_original)
+    {
+        if (is_original) {
+            points.push_back(p);
+        }
+    }
+
+    void append_chain(std::vector<Point>& points, const std::vector<Point>& chain)
+    {
+        points.insert(points.end(), chain.begin(), chain.end());
+    }
+
+    //------------------------------------------------------------------------------
+    // Intersection of the ray from p through a (beyond a) with the ray from q
+    // through b (beyond b), if it lies on the left of a -> b.
+    bool extend_edges(const OutlineSection& section, Point& c)
+    {
+        const Point d0 = (section.a - section.p);
+        const Point d1 = (section.b - section.q);
+        const double denominator = cross(d0, d1);
+
+        if (std::abs(denominator) <= (1e-12 * std::sqrt(dot(d0, d0) * dot(d1, d1)))) {
+            return false;
+        }
+
+        const double t = (cross((section.q - section.p), d1) / denominator);
+        const double u = (cross((section.q - section.p), d0) / denominator);
+
+        if ((t < 1.0) || (u < 1.0)) {
+            return false;
+        }
+
+        c = (section.p + (d0 * t));
+
+        if (not round_towards_hidden(section.p, section.a, section.b, section.q, c)) {
+            return false;
+        }
+
+        return (signed_area(section.a, section.b, c) > 0.0);
+    }
+
+    //------------------------------------------------------------------------------
+    // The cheapest conservative collapse of the section within the tolerance for
+    // which 'is_valid(kind, position)' holds.
+    template<typename IsValid>
+    bool find_outline_collapse(const OutlineSection& section, double tolerance, IsValid&& is_valid, OutlineCollapse& collapse)
+    {
+        bool found = false;
+        collapse.error = INFINITY;
+
+        const auto consider = [&](CollapseKind kind, const Point& position, std::vector<Point>&& original, std::vector<Point>&& replacement) {
+            const double error = deviation(original, replacement);
+
+            if ((error <= tolerance) && (error < collapse.error) && is_valid(kind, position)) {
+                collapse = { kind, position, error };
+                found = true;
+            }
+        };
+
+        if (signed_area(section.p, section.a, section.b) >= 0.0) {
+            std::vector<Point> original = { section.p };
+            append_chain(original, *section.chain_pa);
+            append_original(original, section.a, section.a_is_original);
+            append_chain(original, *section.chain_ab);
+            original.push_back(section.b);
+
+            consider(CollapseKind_RemoveA, section.b, std::move(original), { section.p, section.b });
+        }
+
+        if (signed_area(section.a, section.b, section.q) >= 0.0) {
+            std::vector<Point> original = { section.a };
+            append_chain(original, *section.chain_ab);
+            append_original(original, section.b, section.b_is_original);
+            append_chain(original, *section.chain_bq);
+            original.push_back(section.q);
+
+            consider(CollapseKind_RemoveB, section.a, std::move(original), { section.a, section.q });
+        }
+
+        Point c;
+
+        if (extend_edges(section, c)) {
+            std::vector<Point> original = { section.p };
+            append_chain(original, *section.chain_pa);
+            append_original(original, section.a, section.a_is_original);
+            append_chain(original, *section.chain_ab);
+            append_original(original, section.b, section.b_is_original);
+            append_chain(original, *section.chain_bq);
+            original.push_back(section.q);
+
+            consider(CollapseKind_Extend, c, std::move(original), { section.p, c, section.q });
+        }
+
+        return found;
+    }
+
+    //------------------------------------------------------------------------------
+    // The chains of the edges that replace the section after the given collapse,
+    // i.e. p -> b for RemoveA, a -> q for RemoveB and p -> c, c -> q for Extend.
+    void collapse_chains(const OutlineSection& section,
+                         const OutlineCollapse& collapse,
+                         std::vector<Point>& first,
+                         std::vector<Point>& second)
+    {
+        first.clear();
+        second.clear();
+
+        switch (collapse.kind) {
+            case CollapseKind_RemoveA:
+                append_chain(first, *section.chain_pa);
+                append_original(first, section.a, section.a_is_original);
+                append_chain(first, *section.chain_ab);
+                break;
+
+            case CollapseKind_RemoveB:
+                append_chain(first, *section.chain_ab);
+                append_original(first, section.b, section.b_is_original);
+                append_chain(first, *section.chain_bq);
+                break;
+
+            case CollapseKind_Extend: {
+                std::vector<Point> points(*section.chain_pa);
+                append_original(points, section.a, section.a_is_original);
+                append_chain(points, *section.chain_ab);
+                append_original(points, section.b, section.b_is_original);
+                append_chain(points, *section.chain_bq);
+
+                //------------------------------------------------------------------------------
+                // The points are in outline order, split them where they become closer
+                // to the second segment.
+                size_t split = 0;
+
+                while ((split < points.size()) &&
+                       (distance_to_segment(points[split], section.p, collapse.position) <=
+                        distance_to_segment(points[split], collapse.position, section.q)))
+                {
+                    ++split;
+                }
+
+                first.assign(points.begin(), (points.begin() + split));
+                second.assign((points.begin() + split), points.end());
+                break;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    //------------------------------------------------------------------------------
+    // A triangle mesh with counter-clockwise triangles that supports edge
+    // collapses. The outline of the covered region is formed by the edges that
+    // belong to a single triangle and is oriented with the region on its left.
+    class CollapsibleMesh
+    {
+    public:
+
+        CollapsibleMesh(const IndexedMesh& mesh)
+        {
+            m_positions.reserve(mesh.vertices.size());
+
+            for (const vr::HmdVector2_t& vertex : mesh.vertices) {
+                m_positions.push_back(to_point(vertex));
+            }
+
+            m_is_original.assign(m_positions.size(), true);
+            m_vertex_triangles.resize(m_positions.size());
+
+            for (size_t i = 0; (i + 3) <= mesh.indices.size(); i += 3) {
+                std::array<uint32_t, 3> triangle = { mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2] };
+
+                const double area = signed_area(m_positions[triangle[0]], m_positions[triangle[1]], m_positions[triangle[2]]);
+
+                if (area == 0.0) {
+                    continue;
+                }
+
+                m_signed_area += area;
+
+                if (area < 0.0) {
+                    std::swap(triangle[1], triangle[2]);
+                }
+
+                for (const uint32_t vertex : triangle) {
+                    m_vertex_triangles[vertex].push_back(uint32_t(m_triangles.size()));
+                }
+
+                m_triangles.push_back(triangle);
+            }
+
+            m_is_triangle_alive.assign(m_triangles.size(), true);
+        }
+
+        //------------------------------------------------------------------------------
+        // Apply non-overlapping collapses, cheapest first, and return their number.
+        size_t sweep(double tolerance, double& max_error)
+        {
+            struct Candidate
+            {
+                uint32_t            keep;
+                uint32_t            remove;
+                OutlineSection      section;    // Valid for outline collapses only
+                OutlineCollapse     collapse;
+                bool                is_outline;
+                std::array<uint32_t, 4> vertices;   // p, a, b, q of outline collapses
+            };
+
+            std::vector<Candidate> candidates;
+            update_outline();
+
+            for (uint32_t v = 0; v < m_positions.size(); ++v) {
+                uint32_t prev, next;
+
+                if (m_vertex_triangles[v].empty() || (not classify(v, prev, next))) {
+                    continue;
+                }
+
+                if (prev == INVALID_VERTEX) {
+                    //------------------------------------------------------------------------------
+                    // Merging an interior vertex into a neighbor does not change the
+                    // covered region as long as no triangle flips.
+                    for (const uint32_t neighbor : neighbors(v)) {
+                        if (is_collapse_valid(neighbor, v, m_positions[neighbor])) {
+                            candidates.push_back({ neighbor, v, {}, { CollapseKind_RemoveA, m_positions[neighbor], 0.0 }, false, {} });
+                            break;
+                        }
+                    }
+
+                    continue;
+                }
+
+                //------------------------------------------------------------------------------
+                // Consider the outline edge v -> next.
+                const uint32_t a = v;
+                const uint32_t b = next;
+                uint32_t p = prev;
+                uint32_t q, unused;
+
+                if ((not classify(b, unused, q)) || (q == INVALID_VERTEX) || (p == b) || (q == a)) {
+                    continue;
+                }
+
+                const OutlineSection section = make_section(p, a, b, q);
+                const std::array<uint32_t, 4> vertices = { p, a, b, q };
+
+                OutlineCollapse collapse;
+
+                const auto is_valid = [&](CollapseKind kind, const Point& position) {
+                    return (((kind == CollapseKind_RemoveA) ? is_collapse_valid(b, a, position) : is_collapse_valid(a, b, position)) &&
+                            is_outline_clear(vertices, kind, position));
+                };
+
+                if (find_outline_collapse(section, tolerance, is_valid, collapse)) {
+                    const bool remove_a = (collapse.kind == CollapseKind_RemoveA);
+                    candidates.push_back({ (remove_a ? b : a), (remove_a ? a : b), section, collapse, true, vertices });
+                }
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+                return (lhs.collapse.error < rhs.collapse.error);
+            });
+
+            //------------------------------------------------------------------------------
+            // Collapses only affect the triangles around the two vertices so any number
+            // of collapses with disjoint one-rings can be applied without re-evaluation,
+            // except for the intersection test of outline collapses which depends on the
+            // whole outline.
+            ++m_sweep;
+            m_locked.resize(m_positions.size(), 0);
+
+            size_t num_collapses = 0;
+
+            for (const Candidate& candidate : candidates) {
+                std::vector<uint32_t> affected = neighbors(candidate.keep);
+                const std::vector<uint32_t> removed_neighbors = neighbors(candidate.remove);
+                affected.insert(affected.end(), removed_neighbors.begin(), removed_neighbors.end());
+
+                if (std::any_of(affected.begin(), affected.end(), [&](uint32_t vertex) { return (m_locked[vertex] == m_sweep); })) {
+                    continue;
+                }
+
+                if (candidate.is_outline && (not is_outline_clear(candidate.vertices, candidate.collapse.kind, candidate.collapse.position))) {
+                    continue;
+                }
+
+                for (const uint32_t vertex : affected) {
+                    m_locked[vertex] = m_sweep;
+                }
+
+                if (candidate.is_outline) {
+                    update_chains(candidate.section, candidate.collapse, candidate.keep, candidate.remove);
+                }
+
+                collapse(candidate.keep, candidate.remove, candidate.collapse.position);
+
+                if (candidate.is_outline) {
+                    update_outline();
+                }
+
+                max_error = std::max(max_error, candidate.collapse.error);
+                ++num_collapses;
+            }
+
+            return num_collapses;
+        }
+
+        //------------------------------------------------------------------------------
+        // The remaining triangles with the prevalent winding of the input.
+        HiddenAreaMeshData triangles() const
+        {
+            HiddenAreaMeshData data;
+
+            for (size_t t = 0; t < m_triangles.size(); ++t) {
+                if (not m_is_triangle_alive[t]) {
+                    continue;
+                }
+
+                const std::array<uint32_t, 3>& triangle = m_triangles[t];
+
+                data.vertices.push_back(to_vector(m_positions[triangle[0]]));
+
+                if (m_signed_area >= 0.0) {
+                    data.vertices.push_back(to_vector(m_positions[triangle[1]]));
+                    data.vertices.push_back(to_vector(m_positions[triangle[2]]));
+                }
+                else {
+                    data.vertices.push_back(to_vector(m_positions[triangle[2]]));
+                    data.vertices.push_back(to_vector(m_positions[triangle[1]]));
+                }
+
+                ++data.count;
+            }
+
+            return data;
+        }
+
+        size_t num_vertices() const
+        {
+            return size_t(std::count_if(m_vertex_triangles.begin(), m_vertex_triangles.end(), [](const std::vector<uint32_t>& triangles) {
+                return (not triangles.empty());
+            }));
+        }
+
+    private:
+
+        static constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+
+        static uint64_t edge_key(uint32_t from, uint32_t to) { return ((uint64_t(from) << 32) | uint64_t(to)); }
+
+        //------------------------------------------------------------------------------
+        // The triangle rotated such that it starts with the given vertex.
+        std::array<uint32_t, 3> rotated(uint32_t t, uint32_t v) const
+        {
+            const std::array<uint32_t, 3>& triangle = m_triangles[t];
+
+            if (triangle[1] == v) {
+                return { triangle[1], triangle[2], triangle[0] };
+            }
+            else if (triangle[2] == v) {
+                return { triangle[2], triangle[0], triangle[1] };
+            }
+
+            return triangle;
+        }
+
+        std::vector<uint32_t> neighbors(uint32_t v) const
+        {
+            std::vector<uint32_t> result;
+
+            for (const uint32_t t : m_vertex_triangles[v]) {
+                const std::array<uint32_t, 3> triangle = rotated(t, v);
+
+                for (size_t k = 1; k < 3; ++k) {
+                    if (std::find(result.begin(), result.end(), triangle[k]) == result.end()) {
+                        result.push_back(triangle[k]);
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        //------------------------------------------------------------------------------
+        // Determine whether the triangles around the vertex form a single fan and, if
+        // the vertex is on the outline, its predecessor and successor on the outline
+        // (INVALID_VERTEX for interior vertices). Returns false for non-manifold
+        // vertices which are never collapsed.
+        bool classify(uint32_t v, uint32_t& prev, uint32_t& next) const
+        {
+            prev = INVALID_VERTEX;
+            next = INVALID_VERTEX;
+
+            const std::vector<uint32_t>& triangles = m_vertex_triangles[v];
+
+            //------------------------------------------------------------------------------
+            // Around v the triangle (v, x, y) leads from x to y counter-clockwise.
+            const auto find_from = [&](uint32_t x, uint32_t& y) {
+                size_t count = 0;
+
+                for (const uint32_t t : triangles) {
+                    const std::array<uint32_t, 3> triangle = rotated(t, v);
+
+                    if (triangle[1] == x) {
+                        y = triangle[2];
+                        ++count;
+                    }
+                }
+
+                return count;
+            };
+
+            const auto count_to = [&](uint32_t y) {
+                size_t count = 0;
+
+                for (const uint32_t t : triangles) {
+                    count += ((rotated(t, v)[2] == y) ? 1 : 0);
+                }
+
+                return count;
+            };
+
+            for (const uint32_t t : triangles) {
+                const std::array<uint32_t, 3> triangle = rotated(t, v);
+                uint32_t unused;
+
+                if ((find_from(triangle[1], unused) != 1) || (count_to(triangle[2]) != 1)) {
+                    return false;
+                }
+
+                if (count_to(triangle[1]) == 0) {
+                    if (next != INVALID_VERTEX) {
+                        return false;
+                    }
+
+                    next = triangle[1];
+                }
+
+                if (find_from(triangle[2], unused) == 0) {
+                    if (prev != INVALID_VERTEX) {
+                        return false;
+                    }
+
+                    prev = triangle[2];
+                }
+            }
+
+            if ((prev == INVALID_VERTEX) != (next == INVALID_VERTEX)) {
+                return false;
+            }
+
+            //------------------------------------------------------------------------------
+            // Walk the fan to make sure it covers all triangles.
+            uint32_t x = ((next != INVALID_VERTEX) ? next : rotated(triangles.front(), v)[1]);
+            const uint32_t first = x;
+            size_t num_visited = 0;
+
+            while (num_visited < triangles.size()) {
+                uint32_t y;
+
+                if (find_from(x, y) != 1) {
+                    break;
+                }
+
+                ++num_visited;
+                x = y;
+
+                if (x == first) {
+                    break;
+                }
+            }
+
+            return ((num_visited == triangles.size()) && ((next == INVALID_VERTEX) ? (x == first) : (x == prev)));
+        }
+
+        //------------------------------------------------------------------------------
+        // Merging 'remove' into 'keep' at the given position must not flip or
+        // degenerate any of the remaining triangles and must keep the mesh manifold,
+        // i.e. the vertices adjacent to both must be exactly those opposite to their
+        // common edge.
+        bool is_collapse_valid(uint32_t keep, uint32_t remove, const Point& position) const
+        {
+            std::vector<uint32_t> opposite;
+
+            for (const uint32_t t : m_vertex_triangles[remove]) {
+                const std::array<uint32_t, 3> triangle = rotated(t, remove);
+
+                if (triangle[1] == keep) {
+                    opposite.push_back(triangle[2]);
+                }
+                else if (triangle[2] == keep) {
+                    opposite.push_back(triangle[1]);
+                }
+            }
+
+            if (opposite.empty()) {
+                return false;
+            }
+
+            const std::vector<uint32_t> keep_neighbors = neighbors(keep);
+
+            for (const uint32_t neighbor : neighbors(remove)) {
+                if ((neighbor != keep) &&
+                    (std::find(keep_neighbors.begin(), keep_neighbors.end(), neighbor) != keep_neighbors.end()) &&
+                    (std::find(opposite.begin(), opposite.end(), neighbor) == opposite.end()))
+                {
+                    return false;
+                }
+            }
+
+            for (const uint32_t vertex : { keep, remove }) {
+                for (const uint32_t t : m_vertex_triangles[vertex]) {
+                    const std::array<uint32_t, 3> triangle = rotated(t, vertex);
+
+                    if ((triangle[1] == keep) || (triangle[1] == remove) || (triangle[2] == keep) || (triangle[2] == remove)) {
+                        continue;
+                    }
+
+                    if (signed_area(position, m_positions[triangle[1]], m_positions[triangle[2]]) <= MIN_TRIANGLE_AREA) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------
+        // Collect the outline edges, i.e. the triangle edges without a twin.
+        void update_outline()
+        {
+            std::unordered_set<uint64_t> edges;
+
+            for (size_t t = 0; t < m_triangles.size(); ++t) {
+                if (m_is_triangle_alive[t]) {
+                    const std::array<uint32_t, 3>& triangle = m_triangles[t];
+
+                    for (size_t k = 0; k < 3; ++k) {
+                        edges.insert(edge_key(triangle[k], triangle[(k + 1) % 3]));
+                    }
+                }
+            }
+
+            m_outline.clear();
+
+            for (const uint64_t key : edges) {
+                const uint32_t from = uint32_t(key >> 32);
+                const uint32_t to = uint32_t(key);
+
+                if (edges.find(edge_key(to, from)) == edges.end()) {
+                    m_outline.emplace_back(from, to);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------
+        // True if the outline segments that replace the section p -> a -> b -> q
+        // after the given collapse do not intersect any other outline edge, so that
+        // the collapse does not fold triangles over other parts of the mesh.
+        bool is_outline_clear(const std::array<uint32_t, 4>& vertices, CollapseKind kind, const Point& position) const
+        {
+            const auto [p, a, b, q] = vertices;
+
+            const auto is_segment_clear = [&](const Point& s0, const Point& s1) {
+                for (const auto& [from, to] : m_outline) {
+                    if (((from == p) && (to == a)) || ((from == a) && (to == b)) || ((from == b) && (to == q))) {
+                        continue;
+                    }
+
+                    if (not is_edge_clear(s0, s1, m_positions[from], m_positions[to])) {
+                        return false;
+                    }
+                }
+
+                return true;
+            };
+
+            switch (kind) {
+                case CollapseKind_RemoveA: return is_segment_clear(m_positions[p], m_positions[b]);
+                case CollapseKind_RemoveB: return is_segment_clear(m_positions[a], m_positions[q]);
+                case CollapseKind_Extend: return (is_segment_clear(m_positions[p], position) && is_segment_clear(position, m_positions[q]));
+            }
+
+            return false;
+        }
+
+        OutlineSection make_section(uint32_t p, uint32_t a, uint32_t b, uint32_t q) const
+        {
+            return {
+                m_positions[p], m_positions[a], m_positions[b], m_positions[q],
+                m_is_original[a], m_is_original[b],
+                &chain(p, a), &chain(a, b), &chain(b, q),
+            };
+        }
+
+        const std::vector<Point>& chain(uint32_t from, uint32_t to) const
+        {
+            static const std::vector<Point> empty;
+
+            const auto it = m_chains.find(edge_key(from, to));
+            return ((it != m_chains.end()) ? it->second : empty);
+        }
+
+        void update_chains(const OutlineSection& section, const OutlineCollapse& collapse, uint32_t keep, uint32_t remove)
+        {
+            std::vector<Point> first, second;
+            collapse_chains(section, collapse, first, second);
+
+            //------------------------------------------------------------------------------
+            // Recover the vertex indices of p and q from the outline around the
+            // collapsed edge.
+            const uint32_t a = ((collapse.kind == CollapseKind_RemoveA) ? remove : keep);
+            const uint32_t b = ((collapse.kind == CollapseKind_RemoveA) ? keep : remove);
+
+            uint32_t p, q, unused;
+            classify(a, p, unused);
+            classify(b, unused, q);
+
+            m_chains.erase(edge_key(p, a));
+            m_chains.erase(edge_key(a, b));
+            m_chains.erase(edge_key(b, q));
+
+            switch (collapse.kind) {
+                case CollapseKind_RemoveA: m_chains[edge_key(p, b)] = std::move(first); break;
+                case CollapseKind_RemoveB: m_chains[edge_key(a, q)] = std::move(first); break;
+
+                case CollapseKind_Extend:
+                    m_chains[edge_key(p, a)] = std::move(first);
+                    m_chains[edge_key(a, q)] = std::move(second);
+                    break;
+            }
+        }
+
+        void collapse(uint32_t keep, uint32_t remove, const Point& position)
+        {
+            if (not (position == m_positions[keep])) {
+                m_positions[keep] = position;
+                m_is_original[keep] = false;
+            }
+
+            for (const uint32_t t : m_vertex_triangles[remove]) {
+                std::array<uint32_t, 3>& triangle = m_triangles[t];
+
+                if ((triangle[0] == keep) || (triangle[1] == keep) || (triangle[2] == keep)) {
+                    m_is_triangle_alive[t] = false;
+
+                    for (const uint32_t vertex : triangle) {
+                        std::vector<uint32_t>& triangles = m_vertex_triangles[vertex];
+
+                        if (vertex != remove) {
+                            triangles.erase(std::remove(triangles.begin(), triangles.end(), t), triangles.end());
+                        }
+                    }
+                }
+                else {
+                    std::replace(triangle.begin(), triangle.end(), remove, keep);
+                    m_vertex_triangles[keep].push_back(t);
+                }
+            }
+
+            m_vertex_triangles[remove].clear();
+        }
+
+        std::vector<Point>                                  m_positions;
+        std::vector<bool>                                   m_is_original;
+        std::vector<std::array<uint32_t, 3>>                m_triangles;
+        std::vector<bool>                                   m_is_triangle_alive;
+        std::vector<std::vector<uint32_t>>                  m_vertex_triangles;
+        std::unordered_map<uint64_t, std::vector<Point>>    m_chains;
+        std::vector<std::pair<uint32_t, uint32_t>>          m_outline;
+        double                                              m_signed_area = 0.0;
+
+        std::vector<size_t>                                 m_locked;
+        size_t                                              m_sweep = 0;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    //------------------------------------------------------------------------------
+    // A closed outline, oriented with the hidden region on its left, that supports
+    // edge collapses.
+    class CollapsibleLoop
+    {
+    public:
+
+        CollapsibleLoop(const std::vector<Point>& points)
+            : m_positions(points)
+            , m_is_original(points.size(), true)
+            , m_prev(points.size())
+            , m_next(points.size())
+            , m_chains(points.size())
+            , m_size(points.size())
+        {
+            for (size_t i = 0; i < m_size; ++i) {
+                m_prev[i] = uint32_t((i + m_size - 1) % m_size);
+                m_next[i] = uint32_t((i + 1) % m_size);
+            }
+        }
+
+        size_t sweep(double tolerance, double& max_error)
+        {
+            ++m_sweep;
+            m_locked.resize(m_positions.size(), 0);
+
+            struct Candidate
+            {
+                uint32_t    a;
+                double      error;
+            };
+
+            std::vector<Candidate> candidates;
+            OutlineCollapse collapse;
+
+            for (uint32_t a = m_next[m_first], n = 0; n < m_size; a = m_next[a], ++n) {
+                if (find_collapse(a, tolerance, collapse)) {
+                    candidates.push_back({ a, collapse.error });
+                }
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+                return (lhs.error < rhs.error);
+            });
+
+            //------------------------------------------------------------------------------
+            // Collapses are re-evaluated before being applied since the intersection
+            // test depends on the whole outline.
+            size_t num_collapses = 0;
+
+            for (const Candidate& candidate : candidates) {
+                if (m_size <= 3) {
+                    break;
+                }
+
+                const uint32_t a = candidate.a;
+                const uint32_t span[] = { m_prev[m_prev[a]], m_prev[a], a, m_next[a], m_next[m_next[a]], m_next[m_next[m_next[a]]] };
+
+                if (std::any_of(std::begin(span), std::end(span), [&](uint32_t vertex) { return (m_locked[vertex] == m_sweep); })) {
+                    continue;
+                }
+
+                if (not find_collapse(a, tolerance, collapse)) {
+                    continue;
+                }
+
+                for (const uint32_t vertex : span) {
+                    m_locked[vertex] = m_sweep;
+                }
+
+                apply(a, collapse);
+
+                max_error = std::max(max_error, collapse.error);
+                ++num_collapses;
+            }
+
+            return num_collapses;
+        }
+
+        std::vector<Point> points() const
+        {
+            std::vector<Point> result;
+            result.reserve(m_size);
+
+            for (uint32_t v = m_first, n = 0; n < m_size; v = m_next[v], ++n) {
+                result.push_back(m_positions[v]);
+            }
+
+            return result;
+        }
+
+    private:
+
+        //------------------------------------------------------------------------------
+        // The cheapest collapse of the edge a -> next(a).
+        bool find_collapse(uint32_t a, double tolerance, OutlineCollapse& collapse) const
+        {
+            if (m_size <= 3) {
+                return false;
+            }
+
+            const uint32_t p = m_prev[a];
+            const uint32_t b = m_next[a];
+            const uint32_t q = m_next[b];
+
+            const OutlineSection section = {
+                m_positions[p], m_positions[a], m_positions[b], m_positions[q],
+                m_is_original[a], m_is_original[b],
+                &m_chains[p], &m_chains[a], &m_chains[b],
+            };
+
+            const auto is_valid = [&](CollapseKind kind, const Point& position) {
+                switch (kind) {
+                    case CollapseKind_RemoveA: return is_segment_free(m_positions[p], m_positions[b], p, b);
+                    case CollapseKind_RemoveB: return is_segment_free(m_positions[a], m_positions[q], a, q);
+                    case CollapseKind_Extend: return (is_segment_free(m_positions[p], position, p, q) && is_segment_free(position, m_positions[q], p, q));
+                }
+
+                return false;
+            };
+
+            return find_outline_collapse(section, tolerance, is_valid, collapse);
+        }
+
+        //------------------------------------------------------------------------------
+        // True if the segment does not intersect any edge of the outline outside the
+        // section from 'from' to 'to'. Edges sharing an end point with the segment
+        // may only touch it there.
+        bool is_segment_free(const Point& s0, const Point& s1, uint32_t from, uint32_t to) const
+        {
+            for (uint32_t v = to; v != from; v = m_next[v]) {
+                if (not is_edge_clear(s0, s1, m_positions[v], m_positions[m_next[v]])) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        void apply(uint32_t a, const OutlineCollapse& collapse)
+        {
+            const uint32_t p = m_prev[a];
+            const uint32_t b = m_next[a];
+            const uint32_t q = m_next[b];
+
+            const OutlineSection section = {
+                m_positions[p], m_positions[a], m_positions[b], m_positions[q],
+                m_is_original[a], m_is_original[b],
+                &m_chains[p], &m_chains[a], &m_chains[b],
+            };
+
+            std::vector<Point> first, second;
+            collapse_chains(section, collapse, first, second);
+
+            const auto unlink = [&](uint32_t v) {
+                m_next[m_prev[v]] = m_next[v];
+                m_prev[m_next[v]] = m_prev[v];
+                m_chains[v].clear();
+
+                if (m_first == v) {
+                    m_first = m_next[v];
+                }
+
+                --m_size;
+            };
+
+            switch (collapse.kind) {
+                case CollapseKind_RemoveA:
+                    unlink(a);
+                    m_chains[p] = std::move(first);
+                    break;
+
+                case CollapseKind_RemoveB:
+                    unlink(b);
+                    m_chains[a] = std::move(first);
+                    break;
+
+                case CollapseKind_Extend:
+                    unlink(b);
+                    m_positions[a] = collapse.position;
+                    m_is_original[a] = false;
+                    m_chains[p] = std::move(first);
+                    m_chains[a] = std::move(second);
+                    break;
+            }
+        }
+
+        std::vector<Point>                  m_positions;
+        std::vector<bool>                   m_is_original;
+        std::vector<uint32_t>               m_prev;
+        std::vector<uint32_t>               m_next;
+        std::vector<std::vector<Point>>     m_chains;   // Of the edge starting at the vertex
+        uint32_t                            m_first = 0;
+        size_t                              m_size;
+
+        std::vector<size_t>                 m_locked;
+        size_t                              m_sweep = 0;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    HiddenAreaMeshData copy_mesh(const vr::HiddenAreaMesh_t& mesh, size_t num_vertices)
+    {
+        HiddenAreaMeshData data;
+        data.vertices.assign(mesh.pVertexData, (mesh.pVertexData + num_vertices));
+        data.count = mesh.unTriangleCount;
+
+        return data;
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+HiddenAreaMeshData
+MeshSimplification::simplify(const vr::HiddenAreaMesh_t& mesh,
+                             vr::EHiddenAreaMeshType type,
+                             float tolerance,
+                             Statistics* const statistics)
+{
+    Statistics local_statistics;
+    Statistics& s = (statistics ? *statistics : local_statistics);
+    s = Statistics();
+
+    double max_error = 0.0;
+
+    if (type == vr::k_eHiddenAreaMesh_Standard) {
+        s.num_input_primitives = mesh.unTriangleCount;
+
+        IndexedMesh indexed_mesh;
+
+        //------------------------------------------------------------------------------
+        // Meshes too large for 16-bit indices are passed through unchanged.
+        if ((mesh.pVertexData == nullptr) || (not MeshProcessing::weld_vertices(mesh.pVertexData, (3 * size_t(mesh.unTriangleCount)), indexed_mesh))) {
+            HiddenAreaMeshData data = copy_mesh(mesh, ((mesh.pVertexData != nullptr) ? (3 * size_t(mesh.unTriangleCount)) : 0));
+            s.num_output_primitives = data.count;
+            return data;
+        }
+
+        s.num_input_vertices = indexed_mesh.vertices.size();
+
+        CollapsibleMesh collapsible_mesh(indexed_mesh);
+
+        for (size_t i = 0; i < MAX_NUM_SWEEPS; ++i) {
+            const size_t num_collapses = collapsible_mesh.sweep(tolerance, max_error);
+
+            if (num_collapses == 0) {
+                break;
+            }
+
+            s.num_collapses += num_collapses;
+        }
+
+        HiddenAreaMeshData data = collapsible_mesh.triangles();
+
+        s.num_output_vertices = collapsible_mesh.num_vertices();
+        s.num_output_primitives = data.count;
+        s.max_error = float(max_error);
+
+        return data;
+    }
+    else if (type == vr::k_eHiddenAreaMesh_LineLoop) {
+        s.num_input_primitives = mesh.unTriangleCount;
+
+        //------------------------------------------------------------------------------
+        // The line loop is implicitly closed, drop repeated vertices including a
+        // closing one.
+        std::vector<Point> points;
+        points.reserve(mesh.unTriangleCount);
+
+        for (uint32_t i = 0; ((mesh.pVertexData != nullptr) && (i < mesh.unTriangleCount)); ++i) {
+            const Point p = to_point(mesh.pVertexData[i]);
+
+            if (points.empty() || (not (points.back() == p))) {
+                points.push_back(p);
+            }
+        }
+
+        while ((points.size() > 1) && (points.back() == points.front())) {
+            points.pop_back();
+        }
+
+        s.num_input_vertices = points.size();
+
+        if (points.size() <= 3) {
+            HiddenAreaMeshData data = copy_mesh(mesh, ((mesh.pVertexData != nullptr) ? mesh.unTriangleCount : 0));
+            s.num_output_vertices = s.num_input_vertices;
+            s.num_output_primitives = data.count;
+            return data;
+        }
+
+        //------------------------------------------------------------------------------
+        // The loop encloses the visible region. Orient it with the hidden region on
+        // its left (clockwise) and restore the original orientation afterwards.
+        double area = 0.0;
+
+        for (size_t i = 0; i < points.size(); ++i) {
+            area += cross(points[i], points[(i + 1) % points.size()]);
+        }
+
+        if (area > 0.0) {
+            std::reverse(points.begin(), points.end());
+        }
+
+        CollapsibleLoop loop(points);
+
+        for (size_t i = 0; i < MAX_NUM_SWEEPS; ++i) {
+            const size_t num_collapses = loop.sweep(tolerance, max_error);
+
+            if (num_collapses == 0) {
+                break;
+            }
+
+            s.num_collapses += num_collapses;
+        }
+
+        points = loop.points();
+
+        if (area > 0.0) {
+            std::reverse(points.begin(), points.end());
+        }
+
+        HiddenAreaMeshData data;
+        data.vertices.reserve(points.size());
+
+        for (const Point& p : points) {
+            data.vertices.push_back(to_vector(p));
+        }
+
+        data.count = uint32_t(points.size());
+
+        s.num_output_vertices = points.size();
+        s.num_output_primitives = data.count;
+        s.max_error = float(max_error);
+
+        return data;
+    }
+
+    throw std::runtime_error("Unsupported hidden area mesh type!");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MESH_SIMPLIFICATION_H__
+#define __MESH_SIMPLIFICATION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MeshProcessing.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Conservative simplification of OpenVR hidden area meshes.
+//
+// The simplified mesh never masks a point that the original mesh leaves
+// visible: for k_eHiddenAreaMesh_Standard the hidden region only shrinks, for
+// k_eHiddenAreaMesh_LineLoop (which outlines the visible region) the enclosed
+// region only grows. The outline of the simplified mesh stays within the given
+// tolerance (in UV space) of the original outline.
+//
+// Simplification is a sequence of edge collapses. Interior vertices are merged
+// into a neighbor (which leaves the covered region unchanged), outline vertices
+// are removed where the outline turns away from the visible region and pairs of
+// outline vertices where it turns towards it are replaced by the intersection
+// of the adjacent edges. Collapses that would flip or degenerate a triangle or
+// make the outline self-intersecting are rejected.
+//------------------------------------------------------------------------------
+
+class MeshSimplification
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    struct Statistics
+    {
+        size_t      num_input_vertices = 0;     // Unique vertices
+        size_t      num_input_primitives = 0;   // Triangles or line loop vertices
+        size_t      num_output_vertices = 0;
+        size_t      num_output_primitives = 0;
+        size_t      num_collapses = 0;
+        float       max_error = 0.0f;           // Largest outline deviation of an applied collapse
+    };
+
+    //------------------------------------------------------------------------------
+    // Simplification
+public:
+
+    //------------------------------------------------------------------------------
+    // Simplify a k_eHiddenAreaMesh_Standard or k_eHiddenAreaMesh_LineLoop mesh
+    // within the given tolerance. The result uses the same layout as the input and
+    // can be passed to the HiddenAreaMesh constructor. Throws for other mesh types.
+    static HiddenAreaMeshData simplify(const vr::HiddenAreaMesh_t& mesh,
+                                       vr::EHiddenAreaMeshType type,
+                                       float tolerance,
+                                       Statistics* const statistics = nullptr);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __MESH_SIMPLIFICATION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
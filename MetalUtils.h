@@ -68,6 +68,16 @@
 // the lowest overhead.
 METAL_UTILS_EXTERN id<MTLBuffer> copy_to_private_storage(id<MTLBuffer> buffer, id encoder, bool wait_until_completed);
 
+//------------------------------------------------------------------------------
+// Call the given block with a blit command encoder derived from the given
+// encoder like copy_to_private_storage() does, so any number of blit commands
+// can be encoded in one pass. The block is called synchronously. A command
+// queue for the device is created if the encoder is nil.
+METAL_UTILS_EXTERN void encode_blit_commands(id<MTLDevice> device,
+                                             id encoder,
+                                             bool wait_until_completed,
+                                             void (^encode)(id<MTLBlitCommandEncoder> blit_command_encoder));
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
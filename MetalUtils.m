@@ -68,12 +68,26 @@ id<MTLBuffer> copy_to_private_storage(id<MTLBuffer> buffer, id encoder, bool wai
         return buffer;
     }
 
+    __block id<MTLBuffer> private_buffer = nil;
+
+    encode_blit_commands(buffer.device, encoder, wait_until_completed, ^(id<MTLBlitCommandEncoder> blit_command_encoder) {
+        private_buffer = copy_to_private_storage_internal(blit_command_encoder, buffer);
+    });
+
+    return private_buffer;
+}
+
+void encode_blit_commands(id<MTLDevice> device,
+                          id encoder,
+                          bool wait_until_completed,
+                          void (^encode)(id<MTLBlitCommandEncoder> blit_command_encoder))
+{
     if (encoder == nil) {
-        id<MTLCommandQueue> command_queue = command_queue_for_device(buffer.device);
+        id<MTLCommandQueue> command_queue = command_queue_for_device(device);
         id<MTLCommandBuffer> command_buffer = [command_queue commandBuffer];
         id<MTLBlitCommandEncoder> blit_command_encoder = [command_buffer blitCommandEncoder];
 
-        buffer = copy_to_private_storage_internal(blit_command_encoder, buffer);
+        encode(blit_command_encoder);
 
         [blit_command_encoder endEncoding];
         [command_buffer commit];
@@ -83,12 +97,12 @@ id<MTLBuffer> copy_to_private_storage(id<MTLBuffer> buffer, id encoder, bool wai
         }
     }
     else if ([encoder conformsToProtocol:@protocol(MTLBlitCommandEncoder)]) {
-        buffer = copy_to_private_storage_internal(encoder, buffer);
+        encode(encoder);
     }
     else if ([encoder conformsToProtocol:@protocol(MTLCommandBuffer)]) {
         id<MTLBlitCommandEncoder> blit_command_encoder = [encoder blitCommandEncoder];
 
-        buffer = copy_to_private_storage_internal(blit_command_encoder, buffer);
+        encode(blit_command_encoder);
 
         [blit_command_encoder endEncoding];
     }
@@ -96,7 +110,7 @@ id<MTLBuffer> copy_to_private_storage(id<MTLBuffer> buffer, id encoder, bool wai
         id<MTLCommandBuffer> command_buffer = [encoder commandBuffer];
         id<MTLBlitCommandEncoder> blit_command_encoder = [command_buffer blitCommandEncoder];
 
-        buffer = copy_to_private_storage_internal(blit_command_encoder, buffer);
+        encode(blit_command_encoder);
 
         [blit_command_encoder endEncoding];
         [command_buffer commit];
@@ -108,8 +122,6 @@ id<MTLBuffer> copy_to_private_storage(id<MTLBuffer> buffer, id encoder, bool wai
     else {
         NSCAssert(false, @"Valid encoder object expected!");
     }
-
-    return buffer;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,239 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MultiResLayout.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "LensDensity.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Fill the density profiles (num_samples bins each) with the highest density
+    // of the samples in each column/row. A profile without any samples is all full
+    // rate.
+    void compute_density(vr::IVRSystem* const system,
+                         vr::EVREye eye,
+                         uint32_t width,
+                         uint32_t height,
+                         uint32_t num_samples,
+                         std::vector<float>& density_x,
+                         std::vector<float>& density_y)
+    {
+        const size_t n = num_samples;
+        const std::vector<LensDensity::Sample> samples = LensDensity::sample(system, eye, width, height, num_samples);
+
+        density_x.assign(n, (samples.empty() ? 1.0f : 0.0f));
+        density_y.assign(n, (samples.empty() ? 1.0f : 0.0f));
+
+        for (const LensDensity::Sample& sample : samples) {
+            const size_t bin_x = std::min(size_t(sample.x * float(n)), (n - 1));
+            const size_t bin_y = std::min(size_t(sample.y * float(n)), (n - 1));
+
+            density_x[bin_x] = std::max(density_x[bin_x], sample.density_x);
+            density_y[bin_y] = std::max(density_y[bin_y], sample.density_y);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Find the split positions of one axis minimizing the packed size. Regions are
+    // [boundaries[k], boundaries[k + 1]) in the render target and
+    // [texture[k], texture[k + 1]) in the packed texture.
+    void plan_axis(const std::vector<float>& density,
+                   uint32_t size,
+                   float tolerance,
+                   float min_scale,
+                   uint32_t boundaries[4],
+                   uint32_t texture[4])
+    {
+        const size_t n = density.size();
+
+        std::vector<float> prefix_max(density);
+        std::vector<float> suffix_max(density);
+
+        for (size_t bin = 1; bin < n; ++bin) {
+            prefix_max[bin] = std::max(prefix_max[bin], prefix_max[bin - 1]);
+            suffix_max[n - 1 - bin] = std::max(suffix_max[n - 1 - bin], suffix_max[n - bin]);
+        }
+
+        const auto scaled_length = [&](uint32_t length, float max_density) {
+            const float scale = std::min(std::max((max_density * (1.0f - tolerance)), min_scale), 1.0f);
+            return uint32_t(std::ceil(double(length) * double(scale)));
+        };
+
+        //------------------------------------------------------------------------------
+        // Candidate positions and the packed lengths of the edge regions ending/
+        // starting there. Each edge region also covers the bin past its end as a
+        // margin for the sampling of the profile.
+        std::vector<uint32_t> positions;
+
+        for (uint32_t position = 0; position < size; position += MultiResLayout::ALIGNMENT) {
+            positions.push_back(position);
+        }
+
+        positions.push_back(size);
+
+        std::vector<uint32_t> left_lengths(positions.size());
+        std::vector<uint32_t> right_lengths(positions.size());
+
+        for (size_t k = 0; k < positions.size(); ++k) {
+            const uint32_t position = positions[k];
+            const size_t end_bin = std::min(size_t(std::ceil(double(position) * double(n) / double(size))), (n - 1));
+            const size_t begin_bin = size_t(std::max(((double(position) * double(n) / double(size)) - 1.0), 0.0));
+
+            left_lengths[k] = scaled_length(position, prefix_max[end_bin]);
+            right_lengths[k] = scaled_length((size - position), suffix_max[std::min(begin_bin, (n - 1))]);
+        }
+
+        //------------------------------------------------------------------------------
+        // Exhaustive search over all pairs.
+        size_t best_left = 0;
+        size_t best_right = (positions.size() - 1);
+        uint64_t best_length = UINT64_MAX;
+
+        for (size_t left = 0; left < positions.size(); ++left) {
+            for (size_t right = left; right < positions.size(); ++right) {
+                const uint64_t length = (uint64_t(left_lengths[left]) + (positions[right] - positions[left]) + right_lengths[right]);
+
+                if (length < best_length) {
+                    best_length = length;
+                    best_left = left;
+                    best_right = right;
+                }
+            }
+        }
+
+        boundaries[0] = 0;
+        boundaries[1] = positions[best_left];
+        boundaries[2] = positions[best_right];
+        boundaries[3] = size;
+
+        texture[0] = 0;
+        texture[1] = left_lengths[best_left];
+        texture[2] = (texture[1] + (boundaries[2] - boundaries[1]));
+        texture[3] = (texture[2] + right_lengths[best_right]);
+    }
+
+    //------------------------------------------------------------------------------
+    // Map a position in the render target to the packed texture.
+    double map_axis(double position, const uint32_t boundaries[4], const uint32_t texture[4])
+    {
+        size_t k = 0;
+
+        while ((k < 2) && (position >= double(boundaries[k + 1]))) {
+            ++k;
+        }
+
+        const uint32_t length = (boundaries[k + 1] - boundaries[k]);
+
+        if (length == 0) {
+            return double(texture[k]);
+        }
+
+        return (double(texture[k]) + ((position - double(boundaries[k])) * double(texture[k + 1] - texture[k]) / double(length)));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MultiResLayout::Region::viewport(uint32_t full_width, uint32_t full_height, double viewport[4]) const
+{
+    viewport[0] = (double(rect.x) - (double(source.x) * double(scale_x)));
+    viewport[1] = (double(rect.y) - (double(source.y) * double(scale_y)));
+    viewport[2] = (double(full_width) * double(scale_x));
+    viewport[3] = (double(full_height) * double(scale_y));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MultiResLayout::MultiResLayout(vr::IVRSystem* const system,
+                               vr::EVREye eye,
+                               uint32_t width,
+                               uint32_t height,
+                               float tolerance,
+                               float min_scale,
+                               uint32_t num_samples)
+    : m_width(width)
+    , m_height(height)
+{
+    if ((width == 0) || (height == 0)) {
+        throw std::runtime_error("Invalid multi-resolution layout size!");
+    }
+
+    if (num_samples < 2) {
+        throw std::runtime_error("Invalid number of samples!");
+    }
+
+    if (not ((tolerance >= 0.0f) && (tolerance < 1.0f)) || not ((min_scale > 0.0f) && (min_scale <= 1.0f))) {
+        throw std::runtime_error("Invalid tolerance or minimum scale!");
+    }
+
+    compute_density(system, eye, width, height, num_samples, m_density_x, m_density_y);
+
+    plan_axis(m_density_x, width, tolerance, min_scale, m_source_x, m_texture_x);
+    plan_axis(m_density_y, height, tolerance, min_scale, m_source_y, m_texture_y);
+
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t column = 0; column < 3; ++column) {
+            Region& region = m_regions[(row * 3) + column];
+
+            region.source = { m_source_x[column], m_source_y[row], (m_source_x[column + 1] - m_source_x[column]), (m_source_y[row + 1] - m_source_y[row]) };
+            region.rect = { m_texture_x[column], m_texture_y[row], (m_texture_x[column + 1] - m_texture_x[column]), (m_texture_y[row + 1] - m_texture_y[row]) };
+            region.scale_x = ((region.source.width > 0) ? (float(region.rect.width) / float(region.source.width)) : 1.0f);
+            region.scale_y = ((region.source.height > 0) ? (float(region.rect.height) / float(region.source.height)) : 1.0f);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MultiResLayout::map_to_texture(float u, float v, float& texture_u, float& texture_v) const
+{
+    texture_u = float(map_axis((double(u) * m_width), m_source_x, m_texture_x) / double(texture_width()));
+    texture_v = float(map_axis((double(v) * m_height), m_source_y, m_texture_y) / double(texture_height()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
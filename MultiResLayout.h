@@ -0,0 +1,164 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MULTI_RES_LAYOUT_H__
+#define __MULTI_RES_LAYOUT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Lens matched multi-resolution layout of an eye's render target.
+//
+// The lens magnifies the center of the render target and compresses its edges,
+// so towards the edges fewer rendered pixels end up on the display than are
+// shaded. The pixel density the display actually samples (see LensDensity) is
+// reduced to a horizontal and a vertical profile over the render target.
+//
+// The render target is split into 3 x 3 regions: a full rate center and edge
+// columns/rows rendered at a reduced scale of at least (1 - tolerance) times
+// the highest density needed anywhere in them (and at least the minimum
+// scale). The split positions minimizing the packed texture size are found by
+// exhaustive search over multiples of ALIGNMENT pixels per axis.
+//
+// Each region is rendered into its rect of the smaller packed texture with the
+// eye's regular projection, see Region::viewport(). The packed texture has to
+// be expanded (see map_to_texture()) before it is submitted to the compositor.
+//------------------------------------------------------------------------------
+
+class MultiResLayout
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // Split positions are multiples of this many pixels.
+    static constexpr uint32_t ALIGNMENT = 8;
+
+    struct Region
+    {
+        PixelRect   source;                 // In the full rate render target
+        PixelRect   rect;                   // In the packed texture
+        float       scale_x = 1.0f;         // rect.width / source.width
+        float       scale_y = 1.0f;
+
+        //------------------------------------------------------------------------------
+        // The viewport (x, y, width, height) placing the full rate render target
+        // scaled such that the source rect lands on the rect in the packed texture.
+        // Render the region with this viewport and the rect as scissor rect.
+        void viewport(uint32_t full_width, uint32_t full_height, double viewport[4]) const;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Plan the layout of a (width x height) render target for the given eye from
+    // (num_samples x num_samples) distortion samples. The tolerance is the
+    // fraction of the needed density that may be lost at the edges, in [0, 1).
+    // Throws on an empty size, less than 2 samples or an invalid tolerance or
+    // minimum scale (outside (0, 1]).
+    MultiResLayout(vr::IVRSystem* const system,
+                   vr::EVREye eye,
+                   uint32_t width,
+                   uint32_t height,
+                   float tolerance,
+                   float min_scale = 0.25f,
+                   uint32_t num_samples = 128);
+
+    //------------------------------------------------------------------------------
+    // Layout
+public:
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+
+    //------------------------------------------------------------------------------
+    // The size of the packed texture, e.g. for
+    // Utils::new_texture_desc_for_eye_texture().
+    uint32_t texture_width() const { return m_texture_x[3]; }
+    uint32_t texture_height() const { return m_texture_y[3]; }
+
+    //------------------------------------------------------------------------------
+    // The regions in row-major order, top-left first. Regions at the edges are
+    // empty if reducing their scale does not pay off.
+    const std::array<Region, 9>& regions() const { return m_regions; }
+
+    //------------------------------------------------------------------------------
+    // Map a UV in the full rate render target to the packed texture.
+    void map_to_texture(float u, float v, float& texture_u, float& texture_v) const;
+
+    size_t num_pixels() const { return (size_t(m_width) * size_t(m_height)); }
+    size_t num_shaded_pixels() const { return (size_t(texture_width()) * size_t(texture_height())); }
+
+    //------------------------------------------------------------------------------
+    // Normalized density profiles over the columns/rows of the render target (in
+    // num_samples bins), the highest density needed across the other axis.
+    const std::vector<float>& density_x() const { return m_density_x; }
+    const std::vector<float>& density_y() const { return m_density_y; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    uint32_t                    m_width;
+    uint32_t                    m_height;
+
+    std::vector<float>          m_density_x;
+    std::vector<float>          m_density_y;
+
+    // Region boundaries in the render target and in the packed texture.
+    uint32_t                    m_source_x[4];
+    uint32_t                    m_source_y[4];
+    uint32_t                    m_texture_x[4];
+    uint32_t                    m_texture_y[4];
+
+    std::array<Region, 9>       m_regions;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __MULTI_RES_LAYOUT_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
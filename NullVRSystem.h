@@ -0,0 +1,327 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NULL_VR_SYSTEM_H__
+#define __NULL_VR_SYSTEM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// An IVRSystem without any devices: every method succeeds trivially or reports
+// that nothing is there (identity transforms, no distortion, no hidden area,
+// unknown properties, no events). Meant as a base class for stand-ins that
+// override only what they need, e.g. SyntheticVRSystem, so code taking a
+// vr::IVRSystem can run without a runtime.
+//------------------------------------------------------------------------------
+
+class NullVRSystem : public vr::IVRSystem
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    NullVRSystem() = default;
+    virtual ~NullVRSystem() = default;
+
+    //------------------------------------------------------------------------------
+    // Display
+public:
+
+    void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override
+    {
+        if (pnWidth) { *pnWidth = 0; }
+        if (pnHeight) { *pnHeight = 0; }
+    }
+
+    vr::HmdMatrix44_t GetProjectionMatrix(vr::EVREye, float, float) override
+    {
+        vr::HmdMatrix44_t m = {};
+        m.m[0][0] = m.m[1][1] = m.m[2][2] = m.m[3][3] = 1.0f;
+        return m;
+    }
+
+    void GetProjectionRaw(vr::EVREye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override
+    {
+        if (pfLeft) { *pfLeft = -1.0f; }
+        if (pfRight) { *pfRight = 1.0f; }
+        if (pfTop) { *pfTop = -1.0f; }
+        if (pfBottom) { *pfBottom = 1.0f; }
+    }
+
+    bool ComputeDistortion(vr::EVREye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) override
+    {
+        if (not pDistortionCoordinates) {
+            return false;
+        }
+
+        pDistortionCoordinates->rfRed[0] = pDistortionCoordinates->rfGreen[0] = pDistortionCoordinates->rfBlue[0] = fU;
+        pDistortionCoordinates->rfRed[1] = pDistortionCoordinates->rfGreen[1] = pDistortionCoordinates->rfBlue[1] = fV;
+        return true;
+    }
+
+    vr::HmdMatrix34_t GetEyeToHeadTransform(vr::EVREye) override { return identity34(); }
+
+    bool GetTimeSinceLastVsync(float*, uint64_t*) override { return false; }
+
+    int32_t GetD3D9AdapterIndex() override { return -1; }
+
+    void GetDXGIOutputInfo(int32_t* pnAdapterIndex) override
+    {
+        if (pnAdapterIndex) { *pnAdapterIndex = -1; }
+    }
+
+    void GetOutputDevice(uint64_t* pnDevice, vr::ETextureType, VkInstance_T*) override
+    {
+        if (pnDevice) { *pnDevice = 0; }
+    }
+
+    bool IsDisplayOnDesktop() override { return false; }
+    bool SetDisplayVisibility(bool) override { return false; }
+
+    //------------------------------------------------------------------------------
+    // Tracking
+public:
+
+    void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin,
+                                         float,
+                                         vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                         uint32_t unTrackedDevicePoseArrayCount) override
+    {
+        for (uint32_t i = 0; i < unTrackedDevicePoseArrayCount; ++i) {
+            pTrackedDevicePoseArray[i] = invalid_pose();
+        }
+    }
+
+    void ResetSeatedZeroPose() override {}
+
+    vr::HmdMatrix34_t GetSeatedZeroPoseToStandingAbsoluteTrackingPose() override { return identity34(); }
+    vr::HmdMatrix34_t GetRawZeroPoseToStandingAbsoluteTrackingPose() override { return identity34(); }
+
+    uint32_t GetSortedTrackedDeviceIndicesOfClass(vr::ETrackedDeviceClass eTrackedDeviceClass,
+                                                  vr::TrackedDeviceIndex_t* punTrackedDeviceIndexArray,
+                                                  uint32_t unTrackedDeviceIndexArrayCount,
+                                                  vr::TrackedDeviceIndex_t) override
+    {
+        uint32_t count = 0;
+
+        for (vr::TrackedDeviceIndex_t i = 0; i < vr::k_unMaxTrackedDeviceCount; ++i) {
+            if (GetTrackedDeviceClass(i) == eTrackedDeviceClass) {
+                if (punTrackedDeviceIndexArray && (count < unTrackedDeviceIndexArrayCount)) {
+                    punTrackedDeviceIndexArray[count] = i;
+                }
+
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t) override { return vr::k_EDeviceActivityLevel_Unknown; }
+
+    void ApplyTransform(vr::TrackedDevicePose_t* pOutputPose, const vr::TrackedDevicePose_t* pTrackedDevicePose, const vr::HmdMatrix34_t* pTransform) override
+    {
+        *pOutputPose = *pTrackedDevicePose;
+
+        for (size_t r = 0; r < 3; ++r) {
+            for (size_t c = 0; c < 4; ++c) {
+                const float* const row = pTransform->m[r];
+
+                pOutputPose->mDeviceToAbsoluteTracking.m[r][c] = ((row[0] * pTrackedDevicePose->mDeviceToAbsoluteTracking.m[0][c]) +
+                                                                  (row[1] * pTrackedDevicePose->mDeviceToAbsoluteTracking.m[1][c]) +
+                                                                  (row[2] * pTrackedDevicePose->mDeviceToAbsoluteTracking.m[2][c]) +
+                                                                  ((c == 3) ? row[3] : 0.0f));
+            }
+        }
+    }
+
+    vr::TrackedDeviceIndex_t GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole) override { return vr::k_unTrackedDeviceIndexInvalid; }
+    vr::ETrackedControllerRole GetControllerRoleForTrackedDeviceIndex(vr::TrackedDeviceIndex_t) override { return vr::TrackedControllerRole_Invalid; }
+
+    vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t) override { return vr::TrackedDeviceClass_Invalid; }
+    bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t) override { return false; }
+
+    //------------------------------------------------------------------------------
+    // Properties
+public:
+
+    bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, false);
+    }
+
+    float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, 0.0f);
+    }
+
+    int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, int32_t(0));
+    }
+
+    uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, uint64_t(0));
+    }
+
+    vr::HmdMatrix34_t GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, identity34());
+    }
+
+    uint32_t GetArrayTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, vr::PropertyTypeTag_t, void*, uint32_t, vr::ETrackedPropertyError* pError) override
+    {
+        return fail(pError, uint32_t(0));
+    }
+
+    uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t, vr::ETrackedDeviceProperty, char* pchValue, uint32_t unBufferSize, vr::ETrackedPropertyError* pError) override
+    {
+        if (pchValue && (unBufferSize > 0)) {
+            pchValue[0] = '\0';
+        }
+
+        return fail(pError, uint32_t(0));
+    }
+
+    const char* GetPropErrorNameFromEnum(vr::ETrackedPropertyError error) override
+    {
+        switch (error) {
+            case vr::TrackedProp_Success: return "TrackedProp_Success";
+            case vr::TrackedProp_WrongDataType: return "TrackedProp_WrongDataType";
+            case vr::TrackedProp_WrongDeviceClass: return "TrackedProp_WrongDeviceClass";
+            case vr::TrackedProp_BufferTooSmall: return "TrackedProp_BufferTooSmall";
+            case vr::TrackedProp_UnknownProperty: return "TrackedProp_UnknownProperty";
+            case vr::TrackedProp_InvalidDevice: return "TrackedProp_InvalidDevice";
+            case vr::TrackedProp_ValueNotProvidedByDevice: return "TrackedProp_ValueNotProvidedByDevice";
+            default: return "Unknown";
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Events
+public:
+
+    bool PollNextEvent(vr::VREvent_t*, uint32_t) override { return false; }
+    bool PollNextEventWithPose(vr::ETrackingUniverseOrigin, vr::VREvent_t*, uint32_t, vr::TrackedDevicePose_t*) override { return false; }
+
+    const char* GetEventTypeNameFromEnum(vr::EVREventType) override { return "Unknown"; }
+
+    //------------------------------------------------------------------------------
+    // Rendering Helpers
+public:
+
+    vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye, vr::EHiddenAreaMeshType) override { return { nullptr, 0 }; }
+
+    //------------------------------------------------------------------------------
+    // Controllers
+public:
+
+    bool GetControllerState(vr::TrackedDeviceIndex_t, vr::VRControllerState_t*, uint32_t) override { return false; }
+    bool GetControllerStateWithPose(vr::ETrackingUniverseOrigin, vr::TrackedDeviceIndex_t, vr::VRControllerState_t*, uint32_t, vr::TrackedDevicePose_t*) override { return false; }
+
+    void TriggerHapticPulse(vr::TrackedDeviceIndex_t, uint32_t, unsigned short) override {}
+
+    const char* GetButtonIdNameFromEnum(vr::EVRButtonId) override { return "Unknown"; }
+    const char* GetControllerAxisTypeNameFromEnum(vr::EVRControllerAxisType) override { return "Unknown"; }
+
+    //------------------------------------------------------------------------------
+    // Application State
+public:
+
+    bool IsInputAvailable() override { return true; }
+    bool IsSteamVRDrawingControllers() override { return false; }
+    bool ShouldApplicationPause() override { return false; }
+    bool ShouldApplicationReduceRenderingWork() override { return false; }
+
+    uint32_t DriverDebugRequest(vr::TrackedDeviceIndex_t, const char*, char* pchResponseBuffer, uint32_t unResponseBufferSize) override
+    {
+        if (pchResponseBuffer && (unResponseBufferSize > 0)) {
+            pchResponseBuffer[0] = '\0';
+        }
+
+        return 0;
+    }
+
+    vr::EVRFirmwareError PerformFirmwareUpdate(vr::TrackedDeviceIndex_t) override { return vr::VRFirmwareError_None; }
+
+    void AcknowledgeQuit_Exiting() override {}
+    void AcknowledgeQuit_UserPrompt() override {}
+
+    //------------------------------------------------------------------------------
+    // Helpers for Derived Classes
+protected:
+
+    static vr::HmdMatrix34_t identity34()
+    {
+        vr::HmdMatrix34_t m = {};
+        m.m[0][0] = m.m[1][1] = m.m[2][2] = 1.0f;
+        return m;
+    }
+
+    static vr::TrackedDevicePose_t invalid_pose()
+    {
+        vr::TrackedDevicePose_t pose;
+        std::memset(&pose, 0, sizeof(pose));
+        pose.mDeviceToAbsoluteTracking = identity34();
+        pose.eTrackingResult = vr::TrackingResult_Uninitialized;
+        pose.bPoseIsValid = false;
+        pose.bDeviceIsConnected = false;
+        return pose;
+    }
+
+    //------------------------------------------------------------------------------
+    // Set the error (if requested) and return the given value.
+    template <typename T>
+    static T fail(vr::ETrackedPropertyError* pError, T value, vr::ETrackedPropertyError error = vr::TrackedProp_UnknownProperty)
+    {
+        if (pError) { *pError = error; }
+        return value;
+    }
+
+    template <typename T>
+    static T succeed(vr::ETrackedPropertyError* pError, T value)
+    {
+        if (pError) { *pError = vr::TrackedProp_Success; }
+        return value;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __NULL_VR_SYSTEM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,396 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "OffsetAllocator.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr uint32_t MANTISSA_BITS = 3;
+    constexpr uint32_t MANTISSA_VALUE = (1u << MANTISSA_BITS);
+    constexpr uint32_t MANTISSA_MASK = (MANTISSA_VALUE - 1);
+
+    bool is_power_of_two(uint32_t value)
+    {
+        return ((value != 0) && ((value & (value - 1)) == 0));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t granularity)
+    : m_size(size & ~(granularity - 1))
+    , m_granularity(granularity)
+{
+    static_assert(NUM_LEAF_BINS == MANTISSA_VALUE, "!");
+
+    if (not is_power_of_two(granularity)) {
+        throw std::runtime_error("Invalid granularity!");
+    }
+
+    if (m_size == 0) {
+        throw std::runtime_error("Invalid size!");
+    }
+
+    reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+OffsetAllocator::min_size_for(uint32_t size, uint32_t alignment, uint32_t granularity)
+{
+    uint64_t block_size = ((uint64_t(std::max(size, 1u)) + granularity - 1) & ~uint64_t(granularity - 1));
+
+    if (alignment > granularity) {
+        block_size += (alignment - granularity);
+    }
+
+    if (block_size < MANTISSA_VALUE) {
+        return block_size;
+    }
+
+    //------------------------------------------------------------------------------
+    // Clear the bits below the mantissa, rounding up. The result is still a
+    // multiple of the granularity: either those bits are a multiple of it or the
+    // block size has none set.
+    const uint32_t highest_bit = (63 - uint32_t(__builtin_clzll(block_size)));
+    const uint64_t step = (uint64_t(1) << (highest_bit - MANTISSA_BITS));
+
+    return ((block_size + step - 1) & ~(step - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+OffsetAllocator::Allocation
+OffsetAllocator::allocate(uint32_t size, uint32_t alignment)
+{
+    Allocation allocation;
+
+    if (not is_power_of_two(alignment)) {
+        assert(false);
+        return allocation;
+    }
+
+    //------------------------------------------------------------------------------
+    // The block size, in 64 bits to catch overflows.
+    uint64_t block_size = ((uint64_t(std::max(size, 1u)) + m_granularity - 1) & ~uint64_t(m_granularity - 1));
+
+    if (alignment > m_granularity) {
+        block_size += (alignment - m_granularity);
+    }
+
+    if (block_size > m_size) {
+        return allocation;
+    }
+
+    const uint32_t node = find_free(bin_round_up(uint32_t(block_size)));
+
+    if (node == INVALID_NODE) {
+        return allocation;
+    }
+
+    remove_free(node);
+
+    //------------------------------------------------------------------------------
+    // Return the remainder to the free bins.
+    const uint32_t remainder = (m_nodes[node].size - uint32_t(block_size));
+
+    if (remainder > 0) {
+        const uint32_t split = new_node();
+
+        m_nodes[split].offset = (m_nodes[node].offset + uint32_t(block_size));
+        m_nodes[split].size = remainder;
+        m_nodes[split].neighbor_previous = node;
+        m_nodes[split].neighbor_next = m_nodes[node].neighbor_next;
+
+        if (m_nodes[split].neighbor_next != INVALID_NODE) {
+            m_nodes[m_nodes[split].neighbor_next].neighbor_previous = split;
+        }
+
+        m_nodes[node].neighbor_next = split;
+        m_nodes[node].size = uint32_t(block_size);
+
+        insert_free(split);
+    }
+
+    m_nodes[node].is_used = true;
+    ++m_num_allocations;
+
+    allocation.offset = ((m_nodes[node].offset + (alignment - 1)) & ~(alignment - 1));
+    allocation.node = node;
+
+    return allocation;
+}
+
+void
+OffsetAllocator::free(const Allocation& allocation)
+{
+    if (not allocation.is_valid()) {
+        return;
+    }
+
+    uint32_t node = allocation.node;
+    assert(m_nodes[node].is_used);
+
+    m_nodes[node].is_used = false;
+    --m_num_allocations;
+
+    //------------------------------------------------------------------------------
+    // Merge with the free neighbors.
+    const uint32_t previous = m_nodes[node].neighbor_previous;
+
+    if ((previous != INVALID_NODE) && not m_nodes[previous].is_used) {
+        remove_free(previous);
+
+        m_nodes[previous].size += m_nodes[node].size;
+        m_nodes[previous].neighbor_next = m_nodes[node].neighbor_next;
+
+        if (m_nodes[node].neighbor_next != INVALID_NODE) {
+            m_nodes[m_nodes[node].neighbor_next].neighbor_previous = previous;
+        }
+
+        delete_node(node);
+        node = previous;
+    }
+
+    const uint32_t next = m_nodes[node].neighbor_next;
+
+    if ((next != INVALID_NODE) && not m_nodes[next].is_used) {
+        remove_free(next);
+
+        m_nodes[node].size += m_nodes[next].size;
+        m_nodes[node].neighbor_next = m_nodes[next].neighbor_next;
+
+        if (m_nodes[next].neighbor_next != INVALID_NODE) {
+            m_nodes[m_nodes[next].neighbor_next].neighbor_previous = node;
+        }
+
+        delete_node(next);
+    }
+
+    insert_free(node);
+}
+
+void
+OffsetAllocator::reset()
+{
+    m_num_allocations = 0;
+    m_top_bitmap = 0;
+    std::fill(std::begin(m_leaf_bitmaps), std::end(m_leaf_bitmaps), uint8_t(0));
+    std::fill(std::begin(m_bin_heads), std::end(m_bin_heads), INVALID_NODE);
+
+    m_nodes.clear();
+    m_free_nodes.clear();
+
+    const uint32_t node = new_node();
+    m_nodes[node].size = m_size;
+
+    insert_free(node);
+}
+
+uint32_t
+OffsetAllocator::block_offset(const Allocation& allocation) const
+{
+    return (allocation.is_valid() ? m_nodes[allocation.node].offset : 0);
+}
+
+uint32_t
+OffsetAllocator::block_size(const Allocation& allocation) const
+{
+    return (allocation.is_valid() ? m_nodes[allocation.node].size : 0);
+}
+
+OffsetAllocator::StorageReport
+OffsetAllocator::storage_report() const
+{
+    StorageReport report;
+    report.num_allocations = m_num_allocations;
+
+    for (uint32_t bin = 0; bin < NUM_BINS; ++bin) {
+        for (uint32_t node = m_bin_heads[bin]; node != INVALID_NODE; node = m_nodes[node].bin_next) {
+            report.free_bytes += m_nodes[node].size;
+            report.largest_free_region = std::max(report.largest_free_region, m_nodes[node].size);
+            ++report.num_free_regions;
+        }
+    }
+
+    return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Bins are indexed like small floating point numbers with a 3 bit mantissa:
+// sizes below 8 map to themselves, larger sizes to (exponent << 3 | mantissa)
+// where the exponent counts from the highest set bit.
+uint32_t
+OffsetAllocator::bin_round_down(uint32_t size)
+{
+    if (size < MANTISSA_VALUE) {
+        return size;
+    }
+
+    const uint32_t highest_bit = (31 - uint32_t(__builtin_clz(size)));
+    const uint32_t mantissa_start = (highest_bit - MANTISSA_BITS);
+    const uint32_t exponent = (mantissa_start + 1);
+    const uint32_t mantissa = ((size >> mantissa_start) & MANTISSA_MASK);
+
+    return ((exponent << MANTISSA_BITS) | mantissa);
+}
+
+uint32_t
+OffsetAllocator::bin_round_up(uint32_t size)
+{
+    if (size < MANTISSA_VALUE) {
+        return size;
+    }
+
+    const uint32_t highest_bit = (31 - uint32_t(__builtin_clz(size)));
+    const uint32_t mantissa_start = (highest_bit - MANTISSA_BITS);
+    const uint32_t bin = bin_round_down(size);
+
+    //------------------------------------------------------------------------------
+    // Any bits below the mantissa require the next bin (carrying into the exponent
+    // as needed).
+    return (((size & ((1u << mantissa_start) - 1)) != 0) ? (bin + 1) : bin);
+}
+
+uint32_t
+OffsetAllocator::new_node()
+{
+    if (not m_free_nodes.empty()) {
+        const uint32_t node = m_free_nodes.back();
+        m_free_nodes.pop_back();
+
+        m_nodes[node] = Node();
+        return node;
+    }
+
+    m_nodes.emplace_back();
+    return uint32_t(m_nodes.size() - 1);
+}
+
+void
+OffsetAllocator::delete_node(uint32_t node)
+{
+    m_free_nodes.push_back(node);
+}
+
+void
+OffsetAllocator::insert_free(uint32_t node)
+{
+    const uint32_t bin = bin_round_down(m_nodes[node].size);
+    const uint32_t head = m_bin_heads[bin];
+
+    m_nodes[node].bin_previous = INVALID_NODE;
+    m_nodes[node].bin_next = head;
+
+    if (head != INVALID_NODE) {
+        m_nodes[head].bin_previous = node;
+    }
+
+    m_bin_heads[bin] = node;
+    m_leaf_bitmaps[bin >> MANTISSA_BITS] |= uint8_t(1u << (bin & MANTISSA_MASK));
+    m_top_bitmap |= (1u << (bin >> MANTISSA_BITS));
+}
+
+void
+OffsetAllocator::remove_free(uint32_t node)
+{
+    const Node& n = m_nodes[node];
+
+    if (n.bin_previous != INVALID_NODE) {
+        m_nodes[n.bin_previous].bin_next = n.bin_next;
+    }
+    else {
+        const uint32_t bin = bin_round_down(n.size);
+        m_bin_heads[bin] = n.bin_next;
+
+        if (n.bin_next == INVALID_NODE) {
+            const uint32_t top = (bin >> MANTISSA_BITS);
+            m_leaf_bitmaps[top] &= uint8_t(~(1u << (bin & MANTISSA_MASK)));
+
+            if (m_leaf_bitmaps[top] == 0) {
+                m_top_bitmap &= ~(1u << top);
+            }
+        }
+    }
+
+    if (n.bin_next != INVALID_NODE) {
+        m_nodes[n.bin_next].bin_previous = n.bin_previous;
+    }
+}
+
+uint32_t
+OffsetAllocator::find_free(uint32_t minimum_bin) const
+{
+    const uint32_t top = (minimum_bin >> MANTISSA_BITS);
+
+    if (top >= NUM_TOP_BINS) {
+        return INVALID_NODE;
+    }
+
+    //------------------------------------------------------------------------------
+    // The minimum bin or a larger one with the same exponent, otherwise the
+    // smallest bin of the next larger non-empty exponent.
+    const uint32_t leaf_mask = (m_leaf_bitmaps[top] & (0xFFu << (minimum_bin & MANTISSA_MASK)));
+    uint32_t bin;
+
+    if (leaf_mask != 0) {
+        bin = ((top << MANTISSA_BITS) | uint32_t(__builtin_ctz(leaf_mask)));
+    }
+    else {
+        const uint32_t top_mask = ((top < 31) ? (m_top_bitmap & ~((2u << top) - 1)) : 0);
+
+        if (top_mask == 0) {
+            return INVALID_NODE;
+        }
+
+        const uint32_t larger_top = uint32_t(__builtin_ctz(top_mask));
+        bin = ((larger_top << MANTISSA_BITS) | uint32_t(__builtin_ctz(m_leaf_bitmaps[larger_top])));
+    }
+
+    return m_bin_heads[bin];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,173 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __OFFSET_ALLOCATOR_H__
+#define __OFFSET_ALLOCATOR_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Two-level segregated fit (TLSF) allocator of offsets into a range of 'size'
+// bytes, e.g. a GPU buffer. It never touches the memory it manages.
+//
+// Free blocks are kept in bins by size: the first level is the position of the
+// highest set bit, the second level the next three bits, so bin sizes are
+// within 12.5% of each other. Allocation rounds the size up to a bin that only
+// holds large enough blocks and finds the first non-empty bin with two bitmap
+// scans, freeing merges with free neighbors. Both are O(1).
+//
+// Sizes are rounded up to multiples of the granularity so all offsets are
+// aligned to it. Larger (power of two) alignments are served by allocating the
+// extra bytes needed to align the offset within the block.
+//------------------------------------------------------------------------------
+
+class OffsetAllocator
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+    struct Allocation
+    {
+        uint32_t    offset = 0;
+        uint32_t    node = INVALID_NODE;
+
+        bool is_valid() const { return (node != INVALID_NODE); }
+    };
+
+    struct StorageReport
+    {
+        uint32_t    free_bytes = 0;
+        uint32_t    largest_free_region = 0;
+        uint32_t    num_free_regions = 0;
+        uint32_t    num_allocations = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the size is 0 or the granularity is not a power of two.
+    explicit OffsetAllocator(uint32_t size, uint32_t granularity = 16);
+
+    uint32_t size() const { return m_size; }
+    uint32_t granularity() const { return m_granularity; }
+
+    //------------------------------------------------------------------------------
+    // The smallest allocator size for which allocate(size, alignment) succeeds
+    // when the allocator is empty. Allocations only search bins holding blocks
+    // large enough for any size in the bin, so this is the block size rounded up
+    // to a bin boundary. Computed in 64 bits, it can exceed UINT32_MAX.
+    static uint64_t min_size_for(uint32_t size, uint32_t alignment, uint32_t granularity);
+
+    //------------------------------------------------------------------------------
+    // Allocation
+public:
+
+    //------------------------------------------------------------------------------
+    // Allocate 'size' bytes at an offset aligned to 'alignment' (a power of two).
+    // Returns an invalid allocation if there is no free block large enough.
+    Allocation allocate(uint32_t size, uint32_t alignment = 1);
+
+    //------------------------------------------------------------------------------
+    // Free an allocation (invalid ones are ignored).
+    void free(const Allocation& allocation);
+
+    //------------------------------------------------------------------------------
+    // Free all allocations.
+    void reset();
+
+    //------------------------------------------------------------------------------
+    // The block backing an allocation. It starts at or before the allocation's
+    // offset (if aligned beyond the granularity) and is at least as large as the
+    // size requested.
+    uint32_t block_offset(const Allocation& allocation) const;
+    uint32_t block_size(const Allocation& allocation) const;
+
+    StorageReport storage_report() const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    static constexpr uint32_t NUM_LEAF_BINS = 8;
+    static constexpr uint32_t NUM_TOP_BINS = 32;
+    static constexpr uint32_t NUM_BINS = (NUM_TOP_BINS * NUM_LEAF_BINS);
+
+    //------------------------------------------------------------------------------
+    // A block of the range, free or used. Blocks are linked to their neighbors in
+    // address order and free blocks to the other blocks in their bin.
+    struct Node
+    {
+        uint32_t    offset = 0;
+        uint32_t    size = 0;
+        uint32_t    bin_previous = INVALID_NODE;
+        uint32_t    bin_next = INVALID_NODE;
+        uint32_t    neighbor_previous = INVALID_NODE;
+        uint32_t    neighbor_next = INVALID_NODE;
+        bool        is_used = false;
+    };
+
+    static uint32_t bin_round_down(uint32_t size);
+    static uint32_t bin_round_up(uint32_t size);
+
+    uint32_t new_node();
+    void delete_node(uint32_t node);
+    void insert_free(uint32_t node);
+    void remove_free(uint32_t node);
+    uint32_t find_free(uint32_t minimum_bin) const;
+
+    uint32_t                m_size;
+    uint32_t                m_granularity;
+    uint32_t                m_num_allocations;
+
+    uint32_t                m_top_bitmap;
+    uint8_t                 m_leaf_bitmaps[NUM_TOP_BINS];
+    uint32_t                m_bin_heads[NUM_BINS];
+
+    std::vector<Node>       m_nodes;
+    std::vector<uint32_t>   m_free_nodes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __OFFSET_ALLOCATOR_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
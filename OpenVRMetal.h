@@ -45,6 +45,19 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include "BufferArena.h"
+#include "EyeTexturePool.h"
+#include "HiddenAreaTileMask.h"
+#include "HiddenAreaVertexFormat.h"
+#include "MatrixUtils.h"
+#include "MultiResLayout.h"
+#include "ShadingRateMap.h"
+#include "VisibleRegion.h"
+#include "VRInitializer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #define OPENVR_METAL_EXPORT __attribute__((visibility ("default")))
 #define OPENVR_METAL_EXTERN extern OPENVR_METAL_EXPORT
 
@@ -67,17 +80,115 @@ typedef std::unique_ptr<std::remove_pointer<IOSurfaceRef>::type, void(*)(IOSurfa
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//------------------------------------------------------------------------------
+// BufferArena backed by Metal buffers in GPU private storage.
+//
+// Each arena page is a private buffer of the given device, created when the
+// page is added. Uploads are staged in CPU memory until flush(), which copies
+// the staged data into one shared buffer and encodes all pending copies with a
+// single blit command encoder, so many small static buffers (e.g. hidden area
+// meshes) take a few large allocations and one blit pass instead of a buffer
+// and a blit each. Data must not be read by the GPU before the flush completed.
+//------------------------------------------------------------------------------
+
+class GPUBufferArena
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    explicit GPUBufferArena(id<MTLDevice> device, uint32_t page_size = (4 * 1024 * 1024));
+
+    GPUBufferArena(const GPUBufferArena&) = delete;
+    GPUBufferArena& operator=(const GPUBufferArena&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Allocation
+public:
+
+    //------------------------------------------------------------------------------
+    // Allocate a range and stage the given data for upload into it. The staged
+    // size is rounded up to a multiple of 4 bytes as required for blits.
+    BufferArena::Range upload(const void* const data, uint32_t size, uint32_t alignment = 16);
+
+    //------------------------------------------------------------------------------
+    // Free a range. The backing buffers are kept.
+    void free(const BufferArena::Range& range) { m_arena.free(range); }
+
+    //------------------------------------------------------------------------------
+    // The buffer backing the given range, to be bound at the range's offset. Nil
+    // for invalid ranges (empty or failed uploads).
+    id<MTLBuffer> buffer(const BufferArena::Range& range) const { return (range.is_valid() ? m_buffers[range.page] : nil); }
+
+    //------------------------------------------------------------------------------
+    // Encode the copies of all pending uploads. The encoder may be nil, a command
+    // queue, a command buffer or a blit command encoder, see
+    // copy_to_private_storage() for details.
+    void flush(id encoder, bool wait_until_completed);
+
+    const BufferArena& arena() const { return m_arena; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    id<MTLDevice>                   m_device;
+    BufferArena                     m_arena;
+    std::vector<id<MTLBuffer>>      m_buffers;
+};
+
+//------------------------------------------------------------------------------
+// The Metal vertex format of each hidden area vertex format.
+//------------------------------------------------------------------------------
+
+template <typename Vertex>
+struct HiddenAreaVertexTraits;
+
+template <>
+struct HiddenAreaVertexTraits<HiddenAreaVertexFloat2>
+{
+    static constexpr MTLVertexFormat VERTEX_FORMAT = MTLVertexFormatFloat2;
+};
+
+template <>
+struct HiddenAreaVertexTraits<HiddenAreaVertexHalf2>
+{
+    static constexpr MTLVertexFormat VERTEX_FORMAT = MTLVertexFormatHalf2;
+};
+
+template <>
+struct HiddenAreaVertexTraits<HiddenAreaVertexUShort2Normalized>
+{
+    static constexpr MTLVertexFormat VERTEX_FORMAT = MTLVertexFormatUShort2Normalized;
+};
+
 //------------------------------------------------------------------------------
 // Utility class for generating/drawing hidden area meshes.
 //
-// An internal vertex buffer (array of simd_float2) is created from an OpenVR
-// hidden mesh. The buffer is initially allocated in shared storage on iOS and
-// on macOS if the given Metal device is an integrated GPUs. If the Metal device
-// is a discreet/external GPUs managed storage is used. Optionally the buffer
-// can be moved to private storage after construction.
+// An internal vertex buffer (array of Vertex, one of the formats declared in
+// HiddenAreaVertexFormat.h) is created from an OpenVR hidden mesh. The 16-bit
+// formats halve the vertex data and fetch bandwidth of HiddenAreaVertexFloat2
+// and are rounded conservatively, so they never hide visible pixels. The
+// buffer is initially allocated in shared storage on iOS and on macOS if the
+// given Metal device is an integrated GPUs. If the Metal device is a
+// discreet/external GPUs managed storage is used. Optionally the buffer can be
+// moved to private storage after construction.
+//
+// Triangle meshes (standard/inverse) are welded into an indexed mesh with 16-bit
+// indices, reordered for the post-transform vertex cache and drawn as triangle
+// strips where that needs fewer indices, see MeshProcessing for details. Line
+// loops and meshes exceeding 16-bit indices are drawn unindexed.
+//
+// Meshes constructed from a GPUBufferArena suballocate their vertex/index data
+// from the arena's shared private buffers and bind them at an offset. The arena
+// must be flushed before drawing and outlive the mesh.
+//
+// If the HMD has no hidden area (no vertex data) the mesh has no buffers, zero
+// counts and draws nothing.
 //------------------------------------------------------------------------------
 
-class HiddenAreaMesh
+template <typename Vertex>
+class BasicHiddenAreaMesh
 {
     //------------------------------------------------------------------------------
     // Construction/Destruction
@@ -86,19 +197,40 @@ public:
     //------------------------------------------------------------------------------
     // Construct a Metal hidden area mesh to be used with the given device from the
     // given OpenVR hidden area mesh.
-    HiddenAreaMesh(id<MTLDevice> device, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh);
+    BasicHiddenAreaMesh(id<MTLDevice> device, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh);
+
+    //------------------------------------------------------------------------------
+    // Construct a hidden area mesh with its vertex/index data uploaded to the
+    // given arena.
+    BasicHiddenAreaMesh(GPUBufferArena& arena, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh);
+
+    ~BasicHiddenAreaMesh();
+
+    BasicHiddenAreaMesh(const BasicHiddenAreaMesh&) = delete;
+    BasicHiddenAreaMesh& operator=(const BasicHiddenAreaMesh&) = delete;
 
     //------------------------------------------------------------------------------
     // Vertex Buffer Management
 public:
 
     //------------------------------------------------------------------------------
-    // The vertex buffer containing an array of simd_float2.
+    // The vertex buffer containing an array of Vertex.
     id<MTLBuffer> vertex_buffer() const { return m_vertex_buffer; }
 
     //------------------------------------------------------------------------------
-    // Move the vertex buffer to GPU private storage. See copy_to_private_storage()
-    // for details.
+    // The index buffer containing an array of uint16_t (nil if unindexed).
+    id<MTLBuffer> index_buffer() const { return m_index_buffer; }
+
+    //------------------------------------------------------------------------------
+    // The offsets of the mesh data in the vertex/index buffers (0 unless the mesh
+    // was constructed from an arena).
+    NSUInteger vertex_buffer_offset() const { return m_vertex_offset; }
+    NSUInteger index_buffer_offset() const { return m_index_offset; }
+
+    //------------------------------------------------------------------------------
+    // Move the vertex/index buffers to GPU private storage. See
+    // copy_to_private_storage() for details. Arena backed buffers are private
+    // already.
     void move_to_private_storage(id encoder, bool wait_until_completed);
 
     //------------------------------------------------------------------------------
@@ -107,13 +239,14 @@ public:
 
     //------------------------------------------------------------------------------
     // Add the layout/attribute descriptor required for drawing a hidden area mesh
-    // to the given vertex descriptor.
+    // of this vertex format to the given vertex descriptor.
     static void add_to_vertex_descriptor(MTLVertexDescriptor* const vertex_desciptor,
                                          NSUInteger buffer_index,
                                          NSUInteger position_attribute_index);
 
     //------------------------------------------------------------------------------
-    // The primitive type (triangles/lines) used for the mesh (outline).
+    // The primitive type (triangles/triangle strips/lines) used for the mesh
+    // (outline).
     MTLPrimitiveType primitive_type() const { return m_primitive_type; }
 
     //------------------------------------------------------------------------------
@@ -121,13 +254,31 @@ public:
     NSUInteger num_vertices() const { return m_num_vertices; }
 
     //------------------------------------------------------------------------------
-    // Encode a draw primitives command for the mesh on the given render command
-    // encoder after binding the vertex buffer to the given index. A matching render
-    // pipeline state must have been set.
+    // The number of indices in the index buffer (including strip restart indices).
+    NSUInteger num_indices() const { return m_num_indices; }
+
+    //------------------------------------------------------------------------------
+    // Encode a draw (indexed) primitives command for the mesh on the given render
+    // command encoder after binding the vertex buffer to the given index. A
+    // matching render pipeline state must have been set.
     void draw_primitives(id<MTLRenderCommandEncoder> render_command_encoder, NSUInteger buffer_index)
     {
-        [render_command_encoder setVertexBuffer:m_vertex_buffer offset:0 atIndex:buffer_index];
-        [render_command_encoder drawPrimitives:m_primitive_type vertexStart:0 vertexCount:m_num_vertices];
+        if (not m_vertex_buffer) {
+            return;
+        }
+
+        [render_command_encoder setVertexBuffer:m_vertex_buffer offset:m_vertex_offset atIndex:buffer_index];
+
+        if (m_index_buffer) {
+            [render_command_encoder drawIndexedPrimitives:m_primitive_type
+                                               indexCount:m_num_indices
+                                                indexType:MTLIndexTypeUInt16
+                                              indexBuffer:m_index_buffer
+                                        indexBufferOffset:m_index_offset];
+        }
+        else {
+            [render_command_encoder drawPrimitives:m_primitive_type vertexStart:0 vertexCount:m_num_vertices];
+        }
     }
 
     //------------------------------------------------------------------------------
@@ -142,10 +293,33 @@ public:
 private:
 
     id<MTLBuffer>           m_vertex_buffer;
+    id<MTLBuffer>           m_index_buffer;
+    NSUInteger              m_vertex_offset;
+    NSUInteger              m_index_offset;
     MTLPrimitiveType        m_primitive_type;
     NSUInteger              m_num_vertices;
+    NSUInteger              m_num_indices;
+
+    GPUBufferArena*         m_arena;
+    BufferArena::Range      m_vertex_range;
+    BufferArena::Range      m_index_range;
+
+    //------------------------------------------------------------------------------
+    // Fill in the layout and the vertex/index data (no indices if unindexed).
+    void build(EHiddenAreaMeshType type,
+               const HiddenAreaMesh_t& mesh,
+               std::vector<Vertex>& vertices,
+               std::vector<uint16_t>& indices);
 };
 
+extern template class BasicHiddenAreaMesh<HiddenAreaVertexFloat2>;
+extern template class BasicHiddenAreaMesh<HiddenAreaVertexHalf2>;
+extern template class BasicHiddenAreaMesh<HiddenAreaVertexUShort2Normalized>;
+
+typedef BasicHiddenAreaMesh<HiddenAreaVertexFloat2> HiddenAreaMesh;
+typedef BasicHiddenAreaMesh<HiddenAreaVertexHalf2> HalfHiddenAreaMesh;
+typedef BasicHiddenAreaMesh<HiddenAreaVertexUShort2Normalized> UnormHiddenAreaMesh;
+
 //------------------------------------------------------------------------------
 // Utility class for working with OpenVR and Metal.
 //------------------------------------------------------------------------------
@@ -174,7 +348,33 @@ public:
 
     //------------------------------------------------------------------------------
     // Create a hidden area mesh for the given eye for drawing on the given device.
-    std::unique_ptr<HiddenAreaMesh> GetHiddenAreaMesh(id<MTLDevice> device, EVREye eye, EHiddenAreaMeshType type);
+    // Standard and line loop meshes are conservatively simplified (never masking
+    // visible pixels) if a positive tolerance in UV space is given, see
+    // MeshSimplification. The vertex format defaults to HiddenAreaVertexFloat2,
+    // e.g. GetHiddenAreaMesh<HiddenAreaVertexHalf2>() creates a HalfHiddenAreaMesh.
+    template <typename Vertex = HiddenAreaVertexFloat2>
+    std::unique_ptr<BasicHiddenAreaMesh<Vertex>> GetHiddenAreaMesh(id<MTLDevice> device, EVREye eye, EHiddenAreaMeshType type, float simplification_tolerance = 0.0f);
+
+    //------------------------------------------------------------------------------
+    // Create a hidden area mesh like above with its data uploaded to the given
+    // arena, see GPUBufferArena.
+    template <typename Vertex = HiddenAreaVertexFloat2>
+    std::unique_ptr<BasicHiddenAreaMesh<Vertex>> GetHiddenAreaMesh(GPUBufferArena& arena, EVREye eye, EHiddenAreaMeshType type, float simplification_tolerance = 0.0f);
+
+    //------------------------------------------------------------------------------
+    // Classify the tiles of the recommended render target by how much of them the
+    // hidden area mesh of the given eye covers.
+    HiddenAreaTileMask GetHiddenAreaTileMask(EVREye eye, uint32_t tile_size = 16);
+
+    //------------------------------------------------------------------------------
+    // The region of the recommended render target visible through the lens of the
+    // given eye, derived from the hidden area mesh of the given type.
+    VisibleRegion GetVisibleRegion(EVREye eye, EHiddenAreaMeshType type = k_eHiddenAreaMesh_Inverse);
+
+    //------------------------------------------------------------------------------
+    // Plan a lens matched multi-resolution layout of the recommended render target
+    // for the given eye, see MultiResLayout.
+    MultiResLayout GetMultiResLayout(EVREye eye, float tolerance, float min_scale = 0.25f);
 
     //------------------------------------------------------------------------------
     // {Private}
@@ -196,35 +396,21 @@ public:
     // Convert a OpenVR 3x3 matrix to a simd 3x3 matrix.
     static simd_float3x3 simd_from_hmd_matrix(const HmdMatrix33_t& m)
     {
-        return simd_matrix(vector3(m.m[0][0], m.m[1][0], m.m[2][0]),
-                           vector3(m.m[0][1], m.m[1][1], m.m[2][1]),
-                           vector3(m.m[0][2], m.m[1][2], m.m[2][2]));
+        return MatrixUtils::simd_from_hmd_matrix(m);
     }
 
     //------------------------------------------------------------------------------
     // Convert a OpenVR 3x4 matrix to a simd 4x4 matrix.
     static simd_float4x4 simd_from_hmd_matrix(const HmdMatrix34_t& m)
     {
-        static_assert(sizeof(m.m[0]) == sizeof(simd_packed_float4), "!");
-        static_assert(alignof(decltype(m.m[0])) == alignof(simd_packed_float4), "!");
-
-        return simd_matrix_from_rows((simd_packed_float4&)m.m[0],
-                                     (simd_packed_float4&)m.m[1],
-                                     (simd_packed_float4&)m.m[2],
-                                     vector4(0.0f, 0.0f, 0.0f, 1.0f));
+        return MatrixUtils::simd_from_hmd_matrix(m);
     }
 
     //------------------------------------------------------------------------------
     // Convert a OpenVR 4x4 matrix to a simd 4x4 matrix.
     static simd_float4x4 simd_from_hmd_matrix(const HmdMatrix44_t& m)
     {
-        static_assert(sizeof(m.m[0]) == sizeof(simd_packed_float4), "!");
-        static_assert(alignof(decltype(m.m[0])) == alignof(simd_packed_float4), "!");
-
-        return simd_matrix_from_rows((simd_packed_float4&)m.m[0],
-                                     (simd_packed_float4&)m.m[1],
-                                     (simd_packed_float4&)m.m[2],
-                                     (simd_packed_float4&)m.m[3]);
+        return MatrixUtils::simd_from_hmd_matrix(m);
     }
 
     //------------------------------------------------------------------------------
@@ -241,6 +427,15 @@ public:
                                                                   NSUInteger height,
                                                                   bool array,
                                                                   NSUInteger sample_count = 1);
+
+    //------------------------------------------------------------------------------
+    // Eye texture of the packed size of the given multi-resolution layout. For
+    // array textures both eyes' layouts must have the same packed size, which is
+    // the case for mirrored lenses.
+    static MTLTextureDescriptor* new_texture_desc_for_eye_texture(MTLPixelFormat pixel_format,
+                                                                  const MultiResLayout& layout,
+                                                                  bool array,
+                                                                  NSUInteger sample_count = 1);
 #endif // __MAC_OS_X_VERSION_MIN_REQUIRED
 
     //------------------------------------------------------------------------------
@@ -277,6 +472,122 @@ public:
     static io_surface_wrapper_t new_io_surface_for_eye_texture(MTLPixelFormat pixel_format,
                                                                NSUInteger width,
                                                                NSUInteger height);
+
+    //------------------------------------------------------------------------------
+    // Variable Rate Rasterization
+public:
+
+#if (__MAC_OS_X_VERSION_MIN_REQUIRED >= 101504)
+    //------------------------------------------------------------------------------
+    // Rasterization rate map descriptor for the given eye of a shading rate map.
+    // Metal's rates are separable, so each column/row of tiles gets the finest
+    // rate of its (not culled) tiles. Culled tiles are not skipped by the rate map,
+    // draw the hidden area mesh into the stencil or depth buffer for that.
+    static MTLRasterizationRateMapDescriptor* new_rasterization_rate_map_desc(const ShadingRateMap& map, EVREye eye);
+#endif // __MAC_OS_X_VERSION_MIN_REQUIRED
+};
+
+//------------------------------------------------------------------------------
+// EyeTexturePool backend creating IOSurface backed eye textures (see
+// Utils::new_io_surface_backed_eye_texture()) so they are reused instead of
+// created anew per frame or resolution change. Keys take an MTLPixelFormat as
+// format and a sample count of 1. The pool's handles are retained textures,
+// see texture().
+//------------------------------------------------------------------------------
+
+class IOSurfaceEyeTextureBackend : public EyeTextureBackend
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    explicit IOSurfaceEyeTextureBackend(id<MTLDevice> device) : m_device(device) {}
+
+    //------------------------------------------------------------------------------
+    // The texture of a handle given out by the pool.
+    static id<MTLTexture> texture(void* const handle) { return (__bridge id<MTLTexture>)handle; }
+
+    //------------------------------------------------------------------------------
+    // EyeTextureBackend
+public:
+
+    void* create_texture(const EyeTextureKey& key) override;
+    void destroy_texture(void* const texture) override;
+    size_t texture_size_in_bytes(const EyeTextureKey& key) const override;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    id<MTLDevice>           m_device;
+};
+
+//------------------------------------------------------------------------------
+// VRInitializer extended by the Metal resources: the output device, the hidden
+// area meshes of both eyes and all types uploaded for drawing, and an IOSurface
+// backed eye texture per eye of the recommended render target size. Meshes wait
+// for the device and their VRInitializer mesh task, textures for the device and
+// the render target size, so they are created while other queries are still in
+// flight.
+//
+// HiddenAreaMesh indexes the meshes on its own, so indexing in the settings is
+// only needed if the indexed meshes are also used on the CPU.
+//------------------------------------------------------------------------------
+
+class MetalVRInitializer
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    MetalVRInitializer(IVRSystem* const system, const VRInitializer::Settings& settings, MTLPixelFormat eye_texture_pixel_format);
+
+    MetalVRInitializer(const MetalVRInitializer&) = delete;
+    MetalVRInitializer& operator=(const MetalVRInitializer&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Execution
+public:
+
+    VRInitializer& initializer() { return m_initializer; }
+
+    void start(ThreadPool& pool, TaskGraph::completion_t completion = {}) { m_initializer.start(pool, std::move(completion)); }
+    void wait() { m_initializer.wait(); }
+
+    TaskGraph::task_t output_device_task() const { return m_output_device_task; }
+    TaskGraph::task_t hidden_area_mesh_task(EVREye eye, EHiddenAreaMeshType type) const { return m_hidden_area_mesh_tasks[eye][type]; }
+    TaskGraph::task_t eye_texture_task(EVREye eye) const { return m_eye_texture_tasks[eye]; }
+
+    //------------------------------------------------------------------------------
+    // Resources (valid once their task has completed)
+public:
+
+    id<MTLDevice> output_device() const { return m_output_device; }
+
+    //------------------------------------------------------------------------------
+    // Null if OpenVR provides no mesh of the given type.
+    HiddenAreaMesh* hidden_area_mesh(EVREye eye, EHiddenAreaMeshType type) const { return m_hidden_area_meshes[eye][type].get(); }
+
+    id<MTLTexture> eye_texture(EVREye eye) const { return m_eye_textures[eye]; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    const MTLPixelFormat                m_eye_texture_pixel_format;
+
+    TaskGraph::task_t                   m_output_device_task;
+    TaskGraph::task_t                   m_hidden_area_mesh_tasks[2][k_eHiddenAreaMesh_Max];
+    TaskGraph::task_t                   m_eye_texture_tasks[2];
+
+    id<MTLDevice>                       m_output_device;
+    std::unique_ptr<HiddenAreaMesh>     m_hidden_area_meshes[2][k_eHiddenAreaMesh_Max];
+    id<MTLTexture>                      m_eye_textures[2];
+
+    //------------------------------------------------------------------------------
+    // Last, so its graph is destroyed (waiting for running tasks) before the
+    // resources above.
+    VRInitializer                       m_initializer;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,18 +30,130 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include "MeshProcessing.h"
+#include "MeshSimplification.h"
 #include "MetalUtils.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 METAL_OPENVR_NAMESPACE_BEGIN
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-HiddenAreaMesh::HiddenAreaMesh(id<MTLDevice> device, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh)
+template <typename Vertex>
+BasicHiddenAreaMesh<Vertex>::BasicHiddenAreaMesh(id<MTLDevice> device, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh)
+    : m_vertex_buffer(nil)
+    , m_index_buffer(nil)
+    , m_vertex_offset(0)
+    , m_index_offset(0)
+    , m_num_indices(0)
+    , m_arena(nullptr)
 {
+    const MTLResourceOptions options = (MTLResourceCPUCacheModeWriteCombined | MTLResourceStorageModeManaged);
+
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+
+    build(type, mesh, vertices, indices);
+
+    if (m_num_vertices == 0) {
+        return;
+    }
+
+    m_vertex_buffer = [device newBufferWithBytes:vertices.data() length:(sizeof(Vertex) * m_num_vertices) options:options];
+
+    if (not indices.empty()) {
+        m_index_buffer = [device newBufferWithBytes:indices.data() length:(sizeof(uint16_t) * m_num_indices) options:options];
+    }
+}
+
+template <typename Vertex>
+BasicHiddenAreaMesh<Vertex>::BasicHiddenAreaMesh(GPUBufferArena& arena, EHiddenAreaMeshType type, const HiddenAreaMesh_t& mesh)
+    : m_vertex_buffer(nil)
+    , m_index_buffer(nil)
+    , m_vertex_offset(0)
+    , m_index_offset(0)
+    , m_num_indices(0)
+    , m_arena(&arena)
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+
+    build(type, mesh, vertices, indices);
+
+    //------------------------------------------------------------------------------
+    // An empty mesh (no hidden area) has no buffers, allocating zero bytes from
+    // the arena would fail.
+    if (m_num_vertices == 0) {
+        return;
+    }
+
+    m_vertex_range = arena.upload(vertices.data(), uint32_t(sizeof(Vertex) * m_num_vertices));
+    m_vertex_buffer = arena.buffer(m_vertex_range);
+    m_vertex_offset = m_vertex_range.offset;
+
+    if (not indices.empty()) {
+        m_index_range = arena.upload(indices.data(), uint32_t(sizeof(uint16_t) * m_num_indices));
+        m_index_buffer = arena.buffer(m_index_range);
+        m_index_offset = m_index_range.offset;
+    }
+
+    //------------------------------------------------------------------------------
+    // Not drawable with only part of the data, the destructor does not run.
+    if ((not m_vertex_range.is_valid()) || ((not indices.empty()) && (not m_index_range.is_valid()))) {
+        arena.free(m_vertex_range);
+        arena.free(m_index_range);
+
+        throw std::runtime_error("Failed to allocate hidden area mesh buffers!");
+    }
+}
+
+template <typename Vertex>
+BasicHiddenAreaMesh<Vertex>::~BasicHiddenAreaMesh()
+{
+    if (m_arena) {
+        m_arena->free(m_vertex_range);
+        m_arena->free(m_index_range);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename Vertex>
+void
+BasicHiddenAreaMesh<Vertex>::build(EHiddenAreaMeshType type,
+                                   const HiddenAreaMesh_t& mesh,
+                                   std::vector<Vertex>& vertices,
+                                   std::vector<uint16_t>& indices)
+{
+    //------------------------------------------------------------------------------
+    // Weld and index triangle meshes if possible.
+    IndexedMesh indexed_mesh;
+
+    if (((type == k_eHiddenAreaMesh_Standard) || (type == k_eHiddenAreaMesh_Inverse)) &&
+        MeshProcessing::make_indexed_mesh(mesh, indexed_mesh) &&
+        not indexed_mesh.indices.empty())
+    {
+        m_primitive_type = (indexed_mesh.is_strip ? MTLPrimitiveTypeTriangleStrip : MTLPrimitiveTypeTriangle);
+        m_num_vertices = indexed_mesh.vertices.size();
+        m_num_indices = indexed_mesh.indices.size();
+
+        vertices.resize(m_num_vertices);
+        Vertex::convert(indexed_mesh.vertices.data(), m_num_vertices, vertices.data());
+
+        indices = std::move(indexed_mesh.indices);
+        return;
+    }
+
     //------------------------------------------------------------------------------
     // Evaluate layout.
     switch (type) {
@@ -61,64 +173,62 @@ HiddenAreaMesh::HiddenAreaMesh(id<MTLDevice> device, EHiddenAreaMeshType type, c
             break;
     }
 
-    const NSUInteger buffer_length = (sizeof(simd_float2) * m_num_vertices);
+    if ((not mesh.pVertexData) || (mesh.unTriangleCount == 0)) {
+        m_num_vertices = 0;
+        return;
+    }
 
     //------------------------------------------------------------------------------
-    // Fill the buffer with the vertex data.
-    const MTLResourceOptions options = (MTLResourceCPUCacheModeWriteCombined | MTLResourceStorageModeManaged);
-    m_vertex_buffer = [device newBufferWithLength:buffer_length options:options];
-
-    simd_float2* const vertices = reinterpret_cast<simd_float2*>(m_vertex_buffer.contents);
+    // Convert the vertex data.
+    vertices.resize(m_num_vertices);
 
     switch (type) {
         case k_eHiddenAreaMesh_Standard:
         case k_eHiddenAreaMesh_Inverse:
-            for (size_t vertex_index = 0; vertex_index < m_num_vertices; ++vertex_index) {
-                vertices[vertex_index] = simd_make_float2(mesh.pVertexData[vertex_index].v[0],
-                                                          mesh.pVertexData[vertex_index].v[1]);
-            }
+            Vertex::convert(mesh.pVertexData, m_num_vertices, vertices.data());
             break;
 
         case k_eHiddenAreaMesh_LineLoop:
-            for (size_t vertex_index = 0; vertex_index < (m_num_vertices - 1); ++vertex_index) {
-                vertices[vertex_index] = simd_make_float2(mesh.pVertexData[vertex_index].v[0],
-                                                          mesh.pVertexData[vertex_index].v[1]);
-            }
-
-            vertices[m_num_vertices - 1] = simd_make_float2(mesh.pVertexData[0].v[0],
-                                                            mesh.pVertexData[0].v[1]);
+            Vertex::convert(mesh.pVertexData, (m_num_vertices - 1), vertices.data());
+            vertices[m_num_vertices - 1] = vertices[0];
             break;
 
         default:
             assert(false);
             break;
     }
-
-    [m_vertex_buffer didModifyRange:NSMakeRange(0, m_vertex_buffer.length)];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+template <typename Vertex>
 void
-HiddenAreaMesh::move_to_private_storage(id encoder, bool wait_until_completed)
+BasicHiddenAreaMesh<Vertex>::move_to_private_storage(id encoder, bool wait_until_completed)
 {
-    m_vertex_buffer = copy_to_private_storage(m_vertex_buffer, encoder, wait_until_completed);
+    if (m_vertex_buffer) {
+        m_vertex_buffer = copy_to_private_storage(m_vertex_buffer, encoder, wait_until_completed);
+    }
+
+    if (m_index_buffer) {
+        m_index_buffer = copy_to_private_storage(m_index_buffer, encoder, wait_until_completed);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+template <typename Vertex>
 void
-HiddenAreaMesh::add_to_vertex_descriptor(MTLVertexDescriptor* const vertex_desciptor,
-                                         NSUInteger buffer_index,
-                                         NSUInteger position_attribute_index)
+BasicHiddenAreaMesh<Vertex>::add_to_vertex_descriptor(MTLVertexDescriptor* const vertex_desciptor,
+                                                      NSUInteger buffer_index,
+                                                      NSUInteger position_attribute_index)
 {
-    vertex_desciptor.layouts[buffer_index].stride = sizeof(simd_float2);
+    vertex_desciptor.layouts[buffer_index].stride = sizeof(Vertex);
     vertex_desciptor.layouts[buffer_index].stepRate = 1;
     vertex_desciptor.layouts[buffer_index].stepFunction = MTLVertexStepFunctionPerVertex;
 
-    vertex_desciptor.attributes[position_attribute_index].format = MTLVertexFormatFloat2;
+    vertex_desciptor.attributes[position_attribute_index].format = HiddenAreaVertexTraits<Vertex>::VERTEX_FORMAT;
     vertex_desciptor.attributes[position_attribute_index].offset = 0;
     vertex_desciptor.attributes[position_attribute_index].bufferIndex = buffer_index;
 }
@@ -126,60 +236,24 @@ HiddenAreaMesh::add_to_vertex_descriptor(MTLVertexDescriptor* const vertex_desci
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+template <typename Vertex>
 HiddenAreaMesh_t
-HiddenAreaMesh::create_rectangular_mesh(float coverage)
+BasicHiddenAreaMesh<Vertex>::create_rectangular_mesh(float coverage)
 {
-    const size_t num_vertices = (3 * 8);
-    const float coverage_2 = (coverage / 2.0f);
-    const simd_float4 p = simd_make_float4(coverage_2, coverage_2, (1.0f - coverage_2), (1.0f - coverage_2));
-
-    HmdVector2_t* const vertices = new HmdVector2_t[num_vertices];
-    {
-        size_t vertex_index = 0;
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 0.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.y } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 0.0 } };
+    const HiddenAreaMeshData mesh = MeshProcessing::make_rectangular_mesh(coverage);
 
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 0.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.y } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.y } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 0.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.y } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 1.0 } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 1.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.y } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.w } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 1.0, 1.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.w } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 1.0 } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 1.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.z, p.w } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.w } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 1.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.w } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 0.0 } };
-
-        vertices[vertex_index++] = HmdVector2_t { .v = { 0.0, 0.0 } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.w } };
-        vertices[vertex_index++] = HmdVector2_t { .v = { p.x, p.y } };
-
-        assert(vertex_index == num_vertices);
-    }
+    HmdVector2_t* const vertices = new HmdVector2_t[mesh.vertices.size()];
+    memcpy(vertices, mesh.vertices.data(), (sizeof(HmdVector2_t) * mesh.vertices.size()));
 
     return {
         .pVertexData = vertices,
-        .unTriangleCount = 8,
+        .unTriangleCount = mesh.count,
     };
 }
 
+template <typename Vertex>
 void
-HiddenAreaMesh::destroy_rectangular_mesh(HiddenAreaMesh_t& mesh)
+BasicHiddenAreaMesh<Vertex>::destroy_rectangular_mesh(HiddenAreaMesh_t& mesh)
 {
     delete[] mesh.pVertexData;
 
@@ -187,6 +261,10 @@ HiddenAreaMesh::destroy_rectangular_mesh(HiddenAreaMesh_t& mesh)
     mesh.unTriangleCount = 0;
 }
 
+template class BasicHiddenAreaMesh<HiddenAreaVertexFloat2>;
+template class BasicHiddenAreaMesh<HiddenAreaVertexHalf2>;
+template class BasicHiddenAreaMesh<HiddenAreaVertexUShort2Normalized>;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -213,12 +291,69 @@ VRSystem::GetRecommendedRenderTargetSize(NSUInteger& width, NSUInteger& height)
     height = height_u32;
 }
 
-std::unique_ptr<HiddenAreaMesh>
-VRSystem::GetHiddenAreaMesh(id<MTLDevice> device, EVREye eye, EHiddenAreaMeshType type)
+template <typename Vertex>
+std::unique_ptr<BasicHiddenAreaMesh<Vertex>>
+VRSystem::GetHiddenAreaMesh(id<MTLDevice> device, EVREye eye, EHiddenAreaMeshType type, float simplification_tolerance)
 {
-    return std::make_unique<HiddenAreaMesh>(device, type, m_system->GetHiddenAreaMesh(eye, type));
+    const HiddenAreaMesh_t mesh = m_system->GetHiddenAreaMesh(eye, type);
+
+    if ((simplification_tolerance > 0.0f) && ((type == k_eHiddenAreaMesh_Standard) || (type == k_eHiddenAreaMesh_LineLoop))) {
+        const HiddenAreaMeshData simplified_mesh = MeshSimplification::simplify(mesh, type, simplification_tolerance);
+        return std::make_unique<BasicHiddenAreaMesh<Vertex>>(device, type, simplified_mesh.as_hidden_area_mesh());
+    }
+
+    return std::make_unique<BasicHiddenAreaMesh<Vertex>>(device, type, mesh);
+}
+
+template <typename Vertex>
+std::unique_ptr<BasicHiddenAreaMesh<Vertex>>
+VRSystem::GetHiddenAreaMesh(GPUBufferArena& arena, EVREye eye, EHiddenAreaMeshType type, float simplification_tolerance)
+{
+    const HiddenAreaMesh_t mesh = m_system->GetHiddenAreaMesh(eye, type);
+
+    if ((simplification_tolerance > 0.0f) && ((type == k_eHiddenAreaMesh_Standard) || (type == k_eHiddenAreaMesh_LineLoop))) {
+        const HiddenAreaMeshData simplified_mesh = MeshSimplification::simplify(mesh, type, simplification_tolerance);
+        return std::make_unique<BasicHiddenAreaMesh<Vertex>>(arena, type, simplified_mesh.as_hidden_area_mesh());
+    }
+
+    return std::make_unique<BasicHiddenAreaMesh<Vertex>>(arena, type, mesh);
+}
+
+HiddenAreaTileMask
+VRSystem::GetHiddenAreaTileMask(EVREye eye, uint32_t tile_size)
+{
+    uint32_t width = 0, height = 0;
+    m_system->GetRecommendedRenderTargetSize(&width, &height);
+
+    return HiddenAreaTileMask(m_system->GetHiddenAreaMesh(eye, k_eHiddenAreaMesh_Standard), width, height, tile_size);
 }
 
+VisibleRegion
+VRSystem::GetVisibleRegion(EVREye eye, EHiddenAreaMeshType type)
+{
+    uint32_t width = 0, height = 0;
+    m_system->GetRecommendedRenderTargetSize(&width, &height);
+
+    return VisibleRegion(m_system->GetHiddenAreaMesh(eye, type), type, width, height);
+}
+
+MultiResLayout
+VRSystem::GetMultiResLayout(EVREye eye, float tolerance, float min_scale)
+{
+    uint32_t width = 0, height = 0;
+    m_system->GetRecommendedRenderTargetSize(&width, &height);
+
+    return MultiResLayout(m_system, eye, width, height, tolerance, min_scale);
+}
+
+template std::unique_ptr<HiddenAreaMesh> VRSystem::GetHiddenAreaMesh(id<MTLDevice>, EVREye, EHiddenAreaMeshType, float);
+template std::unique_ptr<HalfHiddenAreaMesh> VRSystem::GetHiddenAreaMesh(id<MTLDevice>, EVREye, EHiddenAreaMeshType, float);
+template std::unique_ptr<UnormHiddenAreaMesh> VRSystem::GetHiddenAreaMesh(id<MTLDevice>, EVREye, EHiddenAreaMeshType, float);
+
+template std::unique_ptr<HiddenAreaMesh> VRSystem::GetHiddenAreaMesh(GPUBufferArena&, EVREye, EHiddenAreaMeshType, float);
+template std::unique_ptr<HalfHiddenAreaMesh> VRSystem::GetHiddenAreaMesh(GPUBufferArena&, EVREye, EHiddenAreaMeshType, float);
+template std::unique_ptr<UnormHiddenAreaMesh> VRSystem::GetHiddenAreaMesh(GPUBufferArena&, EVREye, EHiddenAreaMeshType, float);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -286,6 +421,15 @@ Utils::new_texture_desc_for_eye_texture(MTLPixelFormat pixel_format,
     // ...
     return texture_desc;
 }
+
+MTLTextureDescriptor*
+Utils::new_texture_desc_for_eye_texture(MTLPixelFormat pixel_format,
+                                        const MultiResLayout& layout,
+                                        bool array,
+                                        NSUInteger sample_count)
+{
+    return new_texture_desc_for_eye_texture(pixel_format, layout.texture_width(), layout.texture_height(), array, sample_count);
+}
 #endif // __MAC_OS_X_VERSION_MIN_REQUIRED
 
 MTLTextureDescriptor*
@@ -400,6 +544,195 @@ Utils::new_io_surface_for_eye_texture(MTLPixelFormat pixel_format,
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#if (__MAC_OS_X_VERSION_MIN_REQUIRED >= 101504)
+MTLRasterizationRateMapDescriptor*
+Utils::new_rasterization_rate_map_desc(const ShadingRateMap& map, EVREye eye)
+{
+    if ((map.num_tiles_x() == 0) || (map.num_tiles_y() == 0)) {
+        return nil;
+    }
+
+    //------------------------------------------------------------------------------
+    // Quality is the fraction of the pixels shaded along the axis. Columns/rows
+    // with culled tiles only get the coarsest rate.
+    std::vector<float> horizontal(map.num_tiles_x(), 0.0f);
+    std::vector<float> vertical(map.num_tiles_y(), 0.0f);
+
+    for (uint32_t tile_y = 0; tile_y < map.num_tiles_y(); ++tile_y) {
+        for (uint32_t tile_x = 0; tile_x < map.num_tiles_x(); ++tile_x) {
+            const ShadingRate rate = map.rate(eye, tile_x, tile_y);
+
+            if (rate != ShadingRate_Culled) {
+                horizontal[tile_x] = std::max(horizontal[tile_x], (1.0f / float(ShadingRateMap::rate_width(rate))));
+                vertical[tile_y] = std::max(vertical[tile_y], (1.0f / float(ShadingRateMap::rate_height(rate))));
+            }
+        }
+    }
+
+    for (std::vector<float>* const quality : { &horizontal, &vertical }) {
+        for (float& value : *quality) {
+            value = ((value > 0.0f) ? value : 0.25f);
+        }
+    }
+
+    MTLRasterizationRateLayerDescriptor* const layer_desc =
+        [[MTLRasterizationRateLayerDescriptor alloc] initWithSampleCount:MTLSizeMake(map.num_tiles_x(), map.num_tiles_y(), 0)
+                                                              horizontal:horizontal.data()
+                                                                vertical:vertical.data()];
+
+    return [MTLRasterizationRateMapDescriptor rasterizationRateMapDescriptorWithScreenSize:MTLSizeMake(map.width(), map.height(), 0)
+                                                                                     layer:layer_desc];
+}
+#endif // __MAC_OS_X_VERSION_MIN_REQUIRED
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void*
+IOSurfaceEyeTextureBackend::create_texture(const EyeTextureKey& key)
+{
+    const MTLPixelFormat pixel_format = MTLPixelFormat(key.format);
+
+    if ((key.sample_count != 1) || (Utils::io_surface_pixel_format_from_supported_metal_pixel_format(pixel_format) == 0)) {
+        return nullptr;
+    }
+
+    id<MTLTexture> const texture = Utils::new_io_surface_backed_eye_texture(m_device, pixel_format, key.width, key.height);
+    return (__bridge_retained void*)texture;
+}
+
+void
+IOSurfaceEyeTextureBackend::destroy_texture(void* const texture)
+{
+    if (texture) {
+        CFRelease(texture);
+    }
+}
+
+size_t
+IOSurfaceEyeTextureBackend::texture_size_in_bytes(const EyeTextureKey& key) const
+{
+    //------------------------------------------------------------------------------
+    // Only four bytes/pixel formats are supported, see
+    // new_io_surface_for_eye_texture().
+    return (size_t(key.width) * size_t(key.height) * 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GPUBufferArena::GPUBufferArena(id<MTLDevice> device, uint32_t page_size)
+    : m_device(device)
+    , m_arena(page_size)
+{
+}
+
+BufferArena::Range
+GPUBufferArena::upload(const void* const data, uint32_t size, uint32_t alignment)
+{
+    BufferArena::Range range;
+
+    //------------------------------------------------------------------------------
+    // Blit sizes and offsets must be multiples of 4 on macOS. Offsets are given
+    // the arena's granularity, sizes are padded here.
+    if ((size % 4) != 0) {
+        std::vector<uint8_t> padded((size + 3) & ~uint32_t(3), 0);
+        memcpy(padded.data(), data, size);
+
+        range = m_arena.upload(padded.data(), uint32_t(padded.size()), alignment);
+    }
+    else {
+        range = m_arena.upload(data, size, alignment);
+    }
+
+    //------------------------------------------------------------------------------
+    // Create the buffers for any pages added.
+    while (m_buffers.size() < m_arena.num_pages()) {
+        const uint32_t page_size = m_arena.page_size(m_buffers.size());
+        m_buffers.push_back([m_device newBufferWithLength:page_size options:MTLResourceStorageModePrivate]);
+    }
+
+    return range;
+}
+
+void
+GPUBufferArena::flush(id encoder, bool wait_until_completed)
+{
+    const std::vector<BufferArena::Copy>& copies = m_arena.pending_copies();
+
+    if (copies.empty()) {
+        return;
+    }
+
+    const std::vector<uint8_t>& staging = m_arena.staging();
+    const MTLResourceOptions options = (MTLResourceCPUCacheModeWriteCombined | MTLResourceStorageModeShared);
+
+    id<MTLBuffer> staging_buffer = [m_device newBufferWithBytes:staging.data() length:staging.size() options:options];
+
+    //------------------------------------------------------------------------------
+    // The block is called synchronously so it can refer to the copies/buffers.
+    const BufferArena::Copy* const copies_data = copies.data();
+    const size_t num_copies = copies.size();
+    const std::vector<id<MTLBuffer>>* const buffers = &m_buffers;
+
+    encode_blit_commands(m_device, encoder, wait_until_completed, ^(id<MTLBlitCommandEncoder> blit_command_encoder) {
+        for (size_t copy_index = 0; copy_index < num_copies; ++copy_index) {
+            const BufferArena::Copy& copy = copies_data[copy_index];
+
+            [blit_command_encoder copyFromBuffer:staging_buffer
+                                    sourceOffset:copy.source_offset
+                                        toBuffer:(*buffers)[copy.page]
+                               destinationOffset:copy.destination_offset
+                                            size:copy.size];
+        }
+    });
+
+    m_arena.clear_pending();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MetalVRInitializer::MetalVRInitializer(IVRSystem* const system, const VRInitializer::Settings& settings, MTLPixelFormat eye_texture_pixel_format)
+    : m_eye_texture_pixel_format(eye_texture_pixel_format)
+    , m_output_device(nil)
+    , m_initializer(system, settings)
+{
+    TaskGraph& graph = m_initializer.graph();
+
+    m_output_device_task = graph.add("output device", [this]() {
+        m_output_device = VRSystem(m_initializer.system()).GetOutputDevice();
+
+        if (not m_output_device) {
+            throw std::runtime_error("Invalid output device!");
+        }
+    });
+
+    for (const EVREye eye : { Eye_Left, Eye_Right }) {
+        for (int type_index = 0; type_index < k_eHiddenAreaMesh_Max; ++type_index) {
+            const EHiddenAreaMeshType type = EHiddenAreaMeshType(type_index);
+
+            m_hidden_area_mesh_tasks[eye][type] = graph.add((graph.name(m_initializer.hidden_area_mesh_task(eye, type)) + " upload"), [this, eye, type]() {
+                const HiddenAreaMeshData& mesh = m_initializer.eye(eye).hidden_area_meshes[type];
+
+                if (mesh.count > 0) {
+                    m_hidden_area_meshes[eye][type] = std::make_unique<HiddenAreaMesh>(m_output_device, type, mesh.as_hidden_area_mesh());
+                }
+            }, { m_output_device_task, m_initializer.hidden_area_mesh_task(eye, type) });
+        }
+
+        m_eye_texture_tasks[eye] = graph.add(((eye == Eye_Left) ? "eye texture (left)" : "eye texture (right)"), [this, eye]() {
+            m_eye_textures[eye] = Utils::new_io_surface_backed_eye_texture(m_output_device,
+                                                                           m_eye_texture_pixel_format,
+                                                                           m_initializer.render_target_width(),
+                                                                           m_initializer.render_target_height());
+        }, { m_output_device_task, m_initializer.render_target_size_task() });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 METAL_OPENVR_NAMESPACE_END
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -30,67 +30,14 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#include <fstream>
+#include "DistortionLUT.h"
+#include "ExportFormat.h"
+#include "VisibleRegion.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-namespace {
-
-    void export_hidden_area_outline_as_csv(std::ofstream& csv_stream,
-                                           const vr::HiddenAreaMesh_t& mesh,
-                                           vr::IVRSystem* const system)
-    {
-        vr::DistortionCoordinates_t xy;
-
-        for (size_t i = 0; i < mesh.unTriangleCount; ++i) {
-            csv_stream << mesh.pVertexData[i].v[0] << "\t";
-            csv_stream << mesh.pVertexData[i].v[1] << "\t";
-
-            if (not system->ComputeDistortion(vr::Eye_Left, mesh.pVertexData[i].v[0], mesh.pVertexData[i].v[1], &xy)) {
-                xy = {};
-            }
-
-            csv_stream << std::max(-1.0f, std::min(xy.rfRed[0]  , 2.0f)) << "\t";
-            csv_stream << std::max(-1.0f, std::min(xy.rfRed[1]  , 2.0f)) << "\t";
-            csv_stream << std::max(-1.0f, std::min(xy.rfGreen[0], 2.0f)) << "\t";
-            csv_stream << std::max(-1.0f, std::min(xy.rfGreen[1], 2.0f)) << "\t";
-            csv_stream << std::max(-1.0f, std::min(xy.rfBlue[0] , 2.0f)) << "\t";
-            csv_stream << std::max(-1.0f, std::min(xy.rfBlue[1] , 2.0f)) << "\n";
-        }
-
-        csv_stream << mesh.pVertexData[0].v[0] << "\t";
-        csv_stream << mesh.pVertexData[0].v[1] << "\n";
-    }
-
-    void export_distortion_samples_as_csv(std::ofstream& csv_stream, size_t size, vr::EVREye eye, vr::IVRSystem *system)
-    {
-        vr::DistortionCoordinates_t xy;
-
-        for (size_t y = 0; y < size; ++y) {
-            const float v = (float(y) / float(size - 1));
-
-            for (size_t x = 0; x < size; ++x) {
-                const float u = (float(x) / float(size - 1));
-
-                csv_stream << u << "\t";
-                csv_stream << v << "\t";
-
-                if (not system->ComputeDistortion(eye, u, v, &xy)) {
-                    xy = {};
-                }
-
-                csv_stream << std::max(-1.0f, std::min(xy.rfRed[0]  , 2.0f)) << "\t";
-                csv_stream << std::max(-1.0f, std::min(xy.rfRed[1]  , 2.0f)) << "\t";
-                csv_stream << std::max(-1.0f, std::min(xy.rfGreen[0], 2.0f)) << "\t";
-                csv_stream << std::max(-1.0f, std::min(xy.rfGreen[1], 2.0f)) << "\t";
-                csv_stream << std::max(-1.0f, std::min(xy.rfBlue[0] , 2.0f)) << "\t";
-                csv_stream << std::max(-1.0f, std::min(xy.rfBlue[1] , 2.0f)) << "\n";
-            }
-        }
-    }
-
-}
+#include <cassert>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -152,47 +99,155 @@ OpenVRUtils::get_tracked_device_string(vr::IVRSystem* const system,
 void
 OpenVRUtils::export_hidden_area_outline_as_csv(const char* const path, bool overwrite, vr::IVRSystem* const system)
 {
-    std::ofstream csv_stream(path, (std::ios::out | (overwrite ? std::ios::trunc : std::ios::app)));
+    BufferedFileWriter writer;
 
-    if (not csv_stream.is_open()) {
+    if (not writer.open(path, overwrite)) {
         return;
     }
 
-    if (not overwrite && (csv_stream.tellp() != 0)) {
+    writer.write_string("Left Eye\n");
+
+    const vr::HiddenAreaMesh_t mesh_left = system->GetHiddenAreaMesh(vr::Eye_Left , vr::k_eHiddenAreaMesh_LineLoop);
+    ExportFormat::write_hidden_area_outline_as_csv(writer, mesh_left, vr::Eye_Left, system);
+
+    writer.write_string("Right Eye\n");
+
+    const vr::HiddenAreaMesh_t mesh_right = system->GetHiddenAreaMesh(vr::Eye_Right, vr::k_eHiddenAreaMesh_LineLoop);
+    ExportFormat::write_hidden_area_outline_as_csv(writer, mesh_right, vr::Eye_Right, system);
+}
+
+void
+OpenVRUtils::export_distortion_samples_as_csv(const char* const path,
+                                              bool overwrite,
+                                              vr::IVRSystem* const system,
+                                              size_t size,
+                                              ThreadPool* const pool)
+{
+    if (size < 2) {
         return;
     }
 
-    csv_stream << "Left Eye\n";
+    BufferedFileWriter writer;
 
-    const vr::HiddenAreaMesh_t mesh_left = system->GetHiddenAreaMesh(vr::Eye_Left , vr::k_eHiddenAreaMesh_LineLoop);
-    ::export_hidden_area_outline_as_csv(csv_stream, mesh_left, system);
+    if (not writer.open(path, overwrite)) {
+        return;
+    }
 
-    csv_stream << "Right Eye\n";
+    const DistortionLUT lut(system, size, size, pool);
 
-    const vr::HiddenAreaMesh_t mesh_right = system->GetHiddenAreaMesh(vr::Eye_Right, vr::k_eHiddenAreaMesh_LineLoop);
-    ::export_hidden_area_outline_as_csv(csv_stream, mesh_right, system);
+    writer.write_string("Left Eye\n");
+    ExportFormat::write_distortion_samples_as_csv(writer, lut, vr::Eye_Left);
+
+    writer.write_string("Right Eye\n");
+    ExportFormat::write_distortion_samples_as_csv(writer, lut, vr::Eye_Right);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+OpenVRUtils::export_hidden_area_outline_as_binary(const char* const path, bool overwrite, vr::IVRSystem* const system)
+{
+    BufferedFileWriter writer;
+
+    if (not writer.open(path, overwrite)) {
+        return;
+    }
+
+    const std::string device_model = get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String);
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const vr::HiddenAreaMesh_t mesh = system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_LineLoop);
+        ExportFormat::write_hidden_area_outline_as_binary(writer, mesh, eye, system, device_model.c_str());
+    }
 }
 
 void
-OpenVRUtils::export_distortion_samples_as_csv(const char* const path, bool overwrite, vr::IVRSystem* const system)
+OpenVRUtils::export_distortion_samples_as_binary(const char* const path,
+                                                 bool overwrite,
+                                                 vr::IVRSystem* const system,
+                                                 size_t size,
+                                                 ThreadPool* const pool)
 {
-    constexpr size_t SIZE = (16 + 1);       // 16 x 16 quads
+    if (size < 2) {
+        return;
+    }
+
+    BufferedFileWriter writer;
+
+    if (not writer.open(path, overwrite)) {
+        return;
+    }
+
+    const std::string device_model = get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String);
+    const DistortionLUT lut(system, size, size, pool);
 
-    std::ofstream csv_stream(path, (std::ios::out | (overwrite ? std::ios::trunc : std::ios::app)));
+    ExportFormat::write_distortion_samples_as_binary(writer, lut, vr::Eye_Left, device_model.c_str());
+    ExportFormat::write_distortion_samples_as_binary(writer, lut, vr::Eye_Right, device_model.c_str());
+}
 
-    if (not csv_stream.is_open()) {
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+OpenVRUtils::export_visible_region_report_as_csv(const char* const path,
+                                                 bool overwrite,
+                                                 vr::IVRSystem* const system,
+                                                 size_t max_num_rects,
+                                                 size_t bytes_per_pixel)
+{
+    BufferedFileWriter writer;
+
+    if (not writer.open(path, overwrite)) {
         return;
     }
 
-    if (not overwrite && (csv_stream.tellp() != 0)) {
+    const std::string device_model = get_tracked_device_string(system, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String);
+
+    uint32_t width = 0, height = 0;
+    system->GetRecommendedRenderTargetSize(&width, &height);
+
+    if ((width == 0) || (height == 0)) {
         return;
     }
 
-    csv_stream << "Left Eye\n";
-    ::export_distortion_samples_as_csv(csv_stream, SIZE, vr::Eye_Left, system);
+    writer.write_string("Model,Eye,Width,Height,Visible Pixels,Bounds X,Bounds Y,Bounds Width,Bounds Height,Bounds Pixels,"
+                        "Cover Rects,Cover Pixels,Bytes,Bounds Bytes,Cover Bytes,Bounds Savings,Cover Savings\n");
 
-    csv_stream << "Right Eye\n";
-    ::export_distortion_samples_as_csv(csv_stream, SIZE, vr::Eye_Right, system);
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        //------------------------------------------------------------------------------
+        // Not all drivers provide the inverse mesh.
+        const vr::HiddenAreaMesh_t inverse_mesh = system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Inverse);
+        const bool use_inverse_mesh = ((inverse_mesh.pVertexData != nullptr) && (inverse_mesh.unTriangleCount > 0));
+
+        const VisibleRegion region = (use_inverse_mesh ?
+                                      VisibleRegion(inverse_mesh, vr::k_eHiddenAreaMesh_Inverse, width, height) :
+                                      VisibleRegion(system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard), vr::k_eHiddenAreaMesh_Standard, width, height));
+
+        const VisibleRegion::Savings savings = region.compute_savings(max_num_rects, bytes_per_pixel);
+        const PixelRect& bounds = region.bounds();
+
+        const auto write_value = [&writer](size_t value) {
+            writer.write_string(std::to_string(value).c_str());
+            writer.write_char(',');
+        };
+
+        writer.write_string(device_model.c_str());
+        writer.write_string(((eye == vr::Eye_Left) ? ",Left," : ",Right,"));
+
+        for (const size_t value : { size_t(width), size_t(height), savings.num_visible_pixels,
+                                    size_t(bounds.x), size_t(bounds.y), size_t(bounds.width), size_t(bounds.height), savings.num_bounds_pixels,
+                                    savings.num_cover_rects, savings.num_cover_pixels,
+                                    savings.bytes(), savings.bounds_bytes(), savings.cover_bytes() })
+        {
+            write_value(value);
+        }
+
+        writer.write_float(1.0f - (float(savings.num_bounds_pixels) / float(savings.num_pixels)));
+        writer.write_char(',');
+        writer.write_float(1.0f - (float(savings.num_cover_pixels) / float(savings.num_pixels)));
+        writer.write_char('\n');
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
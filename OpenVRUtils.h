@@ -37,6 +37,11 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 //------------------------------------------------------------------------------
 // Utility class for working with OpenVR.
 //------------------------------------------------------------------------------
@@ -63,8 +68,39 @@ public:
     static void export_hidden_area_outline_as_csv(const char* const path, bool overwrite, vr::IVRSystem* const system);
 
     //------------------------------------------------------------------------------
-    // Export lens-distorted grids to a CSV file (X-Y scatter chart).
-    static void export_distortion_samples_as_csv(const char* const path, bool overwrite, vr::IVRSystem* const system);
+    // Export lens-distorted grids of (size x size) samples to a CSV file (X-Y scatter
+    // chart). Both eyes are sampled concurrently if a thread pool is given, see
+    // DistortionLUT for details.
+    static void export_distortion_samples_as_csv(const char* const path,
+                                                 bool overwrite,
+                                                 vr::IVRSystem* const system,
+                                                 size_t size = (16 + 1),
+                                                 ThreadPool* const pool = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Binary (columnar) variants of the exports above, one section per eye. See
+    // ExportFormat.h for the format and MappedExportFile for reading.
+    static void export_hidden_area_outline_as_binary(const char* const path, bool overwrite, vr::IVRSystem* const system);
+
+    static void export_distortion_samples_as_binary(const char* const path,
+                                                    bool overwrite,
+                                                    vr::IVRSystem* const system,
+                                                    size_t size = (16 + 1),
+                                                    ThreadPool* const pool = nullptr);
+
+public:
+
+    //------------------------------------------------------------------------------
+    // Export the pixels and bytes written (at the given size per pixel) of the
+    // recommended render target, the tight visible bounds and a cover of up to
+    // 'max_num_rects' rects per eye to a CSV file, see VisibleRegion. Rows are
+    // tagged with the device model so reports of several headsets can be
+    // concatenated.
+    static void export_visible_region_report_as_csv(const char* const path,
+                                                    bool overwrite,
+                                                    vr::IVRSystem* const system,
+                                                    size_t max_num_rects = 4,
+                                                    size_t bytes_per_pixel = 4);
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,617 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PoseBatch.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // The first 20 floats of a pose are read as a unit: the 3x4 matrix, velocity,
+    // angular velocity and two floats worth of the remaining members (ignored).
+    constexpr size_t NUM_POSE_FLOATS = 20;
+    constexpr size_t NUM_USED_POSE_FLOATS = 18;
+
+    static_assert(offsetof(vr::TrackedDevicePose_t, mDeviceToAbsoluteTracking) == 0, "!");
+    static_assert(offsetof(vr::TrackedDevicePose_t, vVelocity) == (12 * sizeof(float)), "!");
+    static_assert(offsetof(vr::TrackedDevicePose_t, vAngularVelocity) == (15 * sizeof(float)), "!");
+    static_assert(sizeof(vr::TrackedDevicePose_t) >= (NUM_POSE_FLOATS * sizeof(float)), "!");
+    static_assert((PoseBlock::CAPACITY % 8) == 0, "!");
+
+    //------------------------------------------------------------------------------
+    // Destinations of the pose floats in the block. The ignored floats go to a
+    // scratch lane array.
+    struct PoseFields
+    {
+        PoseFields(PoseBlock& block, float* const scratch)
+        {
+            for (size_t r = 0; r < 3; ++r) {
+                for (size_t c = 0; c < 3; ++c) {
+                    fields[(r * 4) + c] = block.rotation[(r * 3) + c];
+                }
+
+                fields[(r * 4) + 3] = block.position[r];
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                fields[12 + k] = block.velocity[k];
+                fields[15 + k] = block.angular_velocity[k];
+            }
+
+            fields[18] = scratch;
+            fields[19] = scratch;
+        }
+
+        float*      fields[NUM_POSE_FLOATS];
+    };
+
+    void compute_masks(const vr::TrackedDevicePose_t* const poses, size_t count, PoseBlock& block)
+    {
+        uint64_t valid_mask = 0;
+        uint64_t connected_mask = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            valid_mask |= (uint64_t(poses[i].bPoseIsValid) << i);
+            connected_mask |= (uint64_t(poses[i].bDeviceIsConnected) << i);
+        }
+
+        block.count = count;
+        block.valid_mask = valid_mask;
+        block.connected_mask = connected_mask;
+    }
+
+    //------------------------------------------------------------------------------
+    // Orientation of lane 'i' and reset of invalid lanes. Candidate quaternions are
+    // selected in the same order (and the same floating point operations are
+    // used) as in the vectorized versions so that results are identical.
+    void finalize_lane(PoseBlock& block, size_t i)
+    {
+        if (not block.is_valid(i)) {
+            for (size_t k = 0; k < 9; ++k) {
+                block.rotation[k][i] = (((k % 4) == 0) ? 1.0f : 0.0f);
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                block.position[k][i] = 0.0f;
+                block.velocity[k][i] = 0.0f;
+                block.angular_velocity[k][i] = 0.0f;
+            }
+
+            block.orientation[0][i] = 1.0f;
+            block.orientation[1][i] = 0.0f;
+            block.orientation[2][i] = 0.0f;
+            block.orientation[3][i] = 0.0f;
+            return;
+        }
+
+        const float m00 = block.rotation[0][i], m01 = block.rotation[1][i], m02 = block.rotation[2][i];
+        const float m10 = block.rotation[3][i], m11 = block.rotation[4][i], m12 = block.rotation[5][i];
+        const float m20 = block.rotation[6][i], m21 = block.rotation[7][i], m22 = block.rotation[8][i];
+
+        const float t0 = (((1.0f + m00) + m11) + m22);
+        const float t1 = (((1.0f + m00) - m11) - m22);
+        const float t2 = (((1.0f - m00) + m11) - m22);
+        const float t3 = (((1.0f - m00) - m11) + m22);
+
+        const float a = (m21 - m12);
+        const float b = (m02 - m20);
+        const float c = (m10 - m01);
+        const float d = (m01 + m10);
+        const float e = (m02 + m20);
+        const float f = (m12 + m21);
+
+        float t = t0, w = t0, x = a, y = b, z = c;
+
+        if (t1 > t) { t = t1; w = a; x = t1; y = d; z = e; }
+        if (t2 > t) { t = t2; w = b; x = d; y = t2; z = f; }
+        if (t3 > t) { t = t3; w = c; x = e; y = f; z = t3; }
+
+        const float s = (0.5f / std::sqrt(t));
+
+        w *= s;
+        x *= s;
+        y *= s;
+        z *= s;
+
+        if (w < 0.0f) {
+            w = -w;
+            x = -x;
+            y = -y;
+            z = -z;
+        }
+
+        block.orientation[0][i] = w;
+        block.orientation[1][i] = x;
+        block.orientation[2][i] = y;
+        block.orientation[3][i] = z;
+    }
+
+#if defined(__AVX2__)
+
+    //------------------------------------------------------------------------------
+    // Transpose eight poses into lanes [lane, lane + 8) of the block. Poses i and
+    // (i + 4) share a register so that the in-lane shuffles transpose both halves
+    // at once.
+    void transpose_group_avx2(const vr::TrackedDevicePose_t* const poses, const PoseFields& fields, size_t lane)
+    {
+        const float* p[8];
+
+        for (size_t i = 0; i < 8; ++i) {
+            p[i] = reinterpret_cast<const float*>(&poses[i]);
+        }
+
+        for (size_t q = 0; q < NUM_POSE_FLOATS; q += 4) {
+            const __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[0] + q)), _mm_loadu_ps(p[4] + q), 1);
+            const __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[1] + q)), _mm_loadu_ps(p[5] + q), 1);
+            const __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[2] + q)), _mm_loadu_ps(p[6] + q), 1);
+            const __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[3] + q)), _mm_loadu_ps(p[7] + q), 1);
+
+            const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+            const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+            const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+            const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+
+            _mm256_storeu_ps(fields.fields[q + 0] + lane, _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)));
+            _mm256_storeu_ps(fields.fields[q + 1] + lane, _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)));
+            _mm256_storeu_ps(fields.fields[q + 2] + lane, _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)));
+            _mm256_storeu_ps(fields.fields[q + 3] + lane, _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)));
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    //------------------------------------------------------------------------------
+    // Transpose four poses into lanes [lane, lane + 4) of the block.
+    void transpose_group_sse2(const vr::TrackedDevicePose_t* const poses, const PoseFields& fields, size_t lane)
+    {
+        const float* const p0 = reinterpret_cast<const float*>(&poses[0]);
+        const float* const p1 = reinterpret_cast<const float*>(&poses[1]);
+        const float* const p2 = reinterpret_cast<const float*>(&poses[2]);
+        const float* const p3 = reinterpret_cast<const float*>(&poses[3]);
+
+        for (size_t q = 0; q < NUM_POSE_FLOATS; q += 4) {
+            __m128 r0 = _mm_loadu_ps(p0 + q);
+            __m128 r1 = _mm_loadu_ps(p1 + q);
+            __m128 r2 = _mm_loadu_ps(p2 + q);
+            __m128 r3 = _mm_loadu_ps(p3 + q);
+
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+            _mm_storeu_ps(fields.fields[q + 0] + lane, r0);
+            _mm_storeu_ps(fields.fields[q + 1] + lane, r1);
+            _mm_storeu_ps(fields.fields[q + 2] + lane, r2);
+            _mm_storeu_ps(fields.fields[q + 3] + lane, r3);
+        }
+    }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+    void transpose_group_neon(const vr::TrackedDevicePose_t* const poses, const PoseFields& fields, size_t lane)
+    {
+        const float* const p0 = reinterpret_cast<const float*>(&poses[0]);
+        const float* const p1 = reinterpret_cast<const float*>(&poses[1]);
+        const float* const p2 = reinterpret_cast<const float*>(&poses[2]);
+        const float* const p3 = reinterpret_cast<const float*>(&poses[3]);
+
+        for (size_t q = 0; q < NUM_POSE_FLOATS; q += 4) {
+            const float32x4x2_t t01 = vtrnq_f32(vld1q_f32(p0 + q), vld1q_f32(p1 + q));
+            const float32x4x2_t t23 = vtrnq_f32(vld1q_f32(p2 + q), vld1q_f32(p3 + q));
+
+            vst1q_f32(fields.fields[q + 0] + lane, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+            vst1q_f32(fields.fields[q + 1] + lane, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+            vst1q_f32(fields.fields[q + 2] + lane, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+            vst1q_f32(fields.fields[q + 3] + lane, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+        }
+    }
+
+#endif
+
+#if defined(__AVX2__)
+
+    void finalize_avx2(PoseBlock& block)
+    {
+        const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+
+        for (size_t i = 0; i < PoseBlock::CAPACITY; i += 8) {
+            const __m256i bits = _mm256_set1_epi32(int((block.valid_mask >> i) & 0xFF));
+            const __m256 valid = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(bits, lane_bits), lane_bits));
+
+            __m256 m[9];
+
+            for (size_t k = 0; k < 9; ++k) {
+                m[k] = _mm256_load_ps(&block.rotation[k][i]);
+            }
+
+            const __m256 t0 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(one, m[0]), m[4]), m[8]);
+            const __m256 t1 = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(one, m[0]), m[4]), m[8]);
+            const __m256 t2 = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(one, m[0]), m[4]), m[8]);
+            const __m256 t3 = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(one, m[0]), m[4]), m[8]);
+
+            const __m256 a = _mm256_sub_ps(m[7], m[5]);
+            const __m256 b = _mm256_sub_ps(m[2], m[6]);
+            const __m256 c = _mm256_sub_ps(m[3], m[1]);
+            const __m256 d = _mm256_add_ps(m[1], m[3]);
+            const __m256 e = _mm256_add_ps(m[2], m[6]);
+            const __m256 f = _mm256_add_ps(m[5], m[7]);
+
+            //------------------------------------------------------------------------------
+            // Select the candidate with the largest t. Later candidates win only if
+            // strictly larger, like in finalize_lane().
+            __m256 t = t0, w = t0, x = a, y = b, z = c;
+
+            const __m256 k1 = _mm256_cmp_ps(t1, t, _CMP_GT_OQ);
+            t = _mm256_blendv_ps(t, t1, k1);
+            w = _mm256_blendv_ps(w, a, k1);
+            x = _mm256_blendv_ps(x, t1, k1);
+            y = _mm256_blendv_ps(y, d, k1);
+            z = _mm256_blendv_ps(z, e, k1);
+
+            const __m256 k2 = _mm256_cmp_ps(t2, t, _CMP_GT_OQ);
+            t = _mm256_blendv_ps(t, t2, k2);
+            w = _mm256_blendv_ps(w, b, k2);
+            x = _mm256_blendv_ps(x, d, k2);
+            y = _mm256_blendv_ps(y, t2, k2);
+            z = _mm256_blendv_ps(z, f, k2);
+
+            const __m256 k3 = _mm256_cmp_ps(t3, t, _CMP_GT_OQ);
+            t = _mm256_blendv_ps(t, t3, k3);
+            w = _mm256_blendv_ps(w, c, k3);
+            x = _mm256_blendv_ps(x, e, k3);
+            y = _mm256_blendv_ps(y, f, k3);
+            z = _mm256_blendv_ps(z, t3, k3);
+
+            const __m256 s = _mm256_div_ps(half, _mm256_sqrt_ps(t));
+
+            w = _mm256_mul_ps(w, s);
+            x = _mm256_mul_ps(x, s);
+            y = _mm256_mul_ps(y, s);
+            z = _mm256_mul_ps(z, s);
+
+            const __m256 flip = _mm256_and_ps(_mm256_cmp_ps(w, zero, _CMP_LT_OQ), sign_bit);
+
+            //------------------------------------------------------------------------------
+            // Invalid lanes get the identity pose.
+            _mm256_store_ps(&block.orientation[0][i], _mm256_blendv_ps(one, _mm256_xor_ps(w, flip), valid));
+            _mm256_store_ps(&block.orientation[1][i], _mm256_and_ps(_mm256_xor_ps(x, flip), valid));
+            _mm256_store_ps(&block.orientation[2][i], _mm256_and_ps(_mm256_xor_ps(y, flip), valid));
+            _mm256_store_ps(&block.orientation[3][i], _mm256_and_ps(_mm256_xor_ps(z, flip), valid));
+
+            for (size_t k = 0; k < 9; ++k) {
+                const __m256 identity = (((k % 4) == 0) ? one : zero);
+                _mm256_store_ps(&block.rotation[k][i], _mm256_blendv_ps(identity, m[k], valid));
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                _mm256_store_ps(&block.position[k][i], _mm256_and_ps(_mm256_load_ps(&block.position[k][i]), valid));
+                _mm256_store_ps(&block.velocity[k][i], _mm256_and_ps(_mm256_load_ps(&block.velocity[k][i]), valid));
+                _mm256_store_ps(&block.angular_velocity[k][i], _mm256_and_ps(_mm256_load_ps(&block.angular_velocity[k][i]), valid));
+            }
+        }
+    }
+
+#elif defined(__SSE2__)
+
+    __m128 select_sse2(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    }
+
+    void finalize_sse2(PoseBlock& block)
+    {
+        const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 sign_bit = _mm_set1_ps(-0.0f);
+
+        for (size_t i = 0; i < PoseBlock::CAPACITY; i += 4) {
+            const __m128i bits = _mm_set1_epi32(int((block.valid_mask >> i) & 0xF));
+            const __m128 valid = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, lane_bits), lane_bits));
+
+            __m128 m[9];
+
+            for (size_t k = 0; k < 9; ++k) {
+                m[k] = _mm_load_ps(&block.rotation[k][i]);
+            }
+
+            const __m128 t0 = _mm_add_ps(_mm_add_ps(_mm_add_ps(one, m[0]), m[4]), m[8]);
+            const __m128 t1 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(one, m[0]), m[4]), m[8]);
+            const __m128 t2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(one, m[0]), m[4]), m[8]);
+            const __m128 t3 = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(one, m[0]), m[4]), m[8]);
+
+            const __m128 a = _mm_sub_ps(m[7], m[5]);
+            const __m128 b = _mm_sub_ps(m[2], m[6]);
+            const __m128 c = _mm_sub_ps(m[3], m[1]);
+            const __m128 d = _mm_add_ps(m[1], m[3]);
+            const __m128 e = _mm_add_ps(m[2], m[6]);
+            const __m128 f = _mm_add_ps(m[5], m[7]);
+
+            __m128 t = t0, w = t0, x = a, y = b, z = c;
+
+            const __m128 k1 = _mm_cmpgt_ps(t1, t);
+            t = select_sse2(k1, t, t1);
+            w = select_sse2(k1, w, a);
+            x = select_sse2(k1, x, t1);
+            y = select_sse2(k1, y, d);
+            z = select_sse2(k1, z, e);
+
+            const __m128 k2 = _mm_cmpgt_ps(t2, t);
+            t = select_sse2(k2, t, t2);
+            w = select_sse2(k2, w, b);
+            x = select_sse2(k2, x, d);
+            y = select_sse2(k2, y, t2);
+            z = select_sse2(k2, z, f);
+
+            const __m128 k3 = _mm_cmpgt_ps(t3, t);
+            t = select_sse2(k3, t, t3);
+            w = select_sse2(k3, w, c);
+            x = select_sse2(k3, x, e);
+            y = select_sse2(k3, y, f);
+            z = select_sse2(k3, z, t3);
+
+            const __m128 s = _mm_div_ps(half, _mm_sqrt_ps(t));
+
+            w = _mm_mul_ps(w, s);
+            x = _mm_mul_ps(x, s);
+            y = _mm_mul_ps(y, s);
+            z = _mm_mul_ps(z, s);
+
+            const __m128 flip = _mm_and_ps(_mm_cmplt_ps(w, zero), sign_bit);
+
+            _mm_store_ps(&block.orientation[0][i], select_sse2(valid, one, _mm_xor_ps(w, flip)));
+            _mm_store_ps(&block.orientation[1][i], _mm_and_ps(_mm_xor_ps(x, flip), valid));
+            _mm_store_ps(&block.orientation[2][i], _mm_and_ps(_mm_xor_ps(y, flip), valid));
+            _mm_store_ps(&block.orientation[3][i], _mm_and_ps(_mm_xor_ps(z, flip), valid));
+
+            for (size_t k = 0; k < 9; ++k) {
+                const __m128 identity = (((k % 4) == 0) ? one : zero);
+                _mm_store_ps(&block.rotation[k][i], select_sse2(valid, identity, m[k]));
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                _mm_store_ps(&block.position[k][i], _mm_and_ps(_mm_load_ps(&block.position[k][i]), valid));
+                _mm_store_ps(&block.velocity[k][i], _mm_and_ps(_mm_load_ps(&block.velocity[k][i]), valid));
+                _mm_store_ps(&block.angular_velocity[k][i], _mm_and_ps(_mm_load_ps(&block.angular_velocity[k][i]), valid));
+            }
+        }
+    }
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+    void finalize_neon(PoseBlock& block)
+    {
+        const uint32_t lane_bit_values[4] = { 1, 2, 4, 8 };
+        const uint32x4_t lane_bits = vld1q_u32(lane_bit_values);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+
+        for (size_t i = 0; i < PoseBlock::CAPACITY; i += 4) {
+            const uint32x4_t bits = vdupq_n_u32(uint32_t((block.valid_mask >> i) & 0xF));
+            const uint32x4_t valid = vceqq_u32(vandq_u32(bits, lane_bits), lane_bits);
+
+            float32x4_t m[9];
+
+            for (size_t k = 0; k < 9; ++k) {
+                m[k] = vld1q_f32(&block.rotation[k][i]);
+            }
+
+            const float32x4_t t0 = vaddq_f32(vaddq_f32(vaddq_f32(one, m[0]), m[4]), m[8]);
+            const float32x4_t t1 = vsubq_f32(vsubq_f32(vaddq_f32(one, m[0]), m[4]), m[8]);
+            const float32x4_t t2 = vsubq_f32(vaddq_f32(vsubq_f32(one, m[0]), m[4]), m[8]);
+            const float32x4_t t3 = vaddq_f32(vsubq_f32(vsubq_f32(one, m[0]), m[4]), m[8]);
+
+            const float32x4_t a = vsubq_f32(m[7], m[5]);
+            const float32x4_t b = vsubq_f32(m[2], m[6]);
+            const float32x4_t c = vsubq_f32(m[3], m[1]);
+            const float32x4_t d = vaddq_f32(m[1], m[3]);
+            const float32x4_t e = vaddq_f32(m[2], m[6]);
+            const float32x4_t f = vaddq_f32(m[5], m[7]);
+
+            float32x4_t t = t0, w = t0, x = a, y = b, z = c;
+
+            const uint32x4_t k1 = vcgtq_f32(t1, t);
+            t = vbslq_f32(k1, t1, t);
+            w = vbslq_f32(k1, a, w);
+            x = vbslq_f32(k1, t1, x);
+            y = vbslq_f32(k1, d, y);
+            z = vbslq_f32(k1, e, z);
+
+            const uint32x4_t k2 = vcgtq_f32(t2, t);
+            t = vbslq_f32(k2, t2, t);
+            w = vbslq_f32(k2, b, w);
+            x = vbslq_f32(k2, d, x);
+            y = vbslq_f32(k2, t2, y);
+            z = vbslq_f32(k2, f, z);
+
+            const uint32x4_t k3 = vcgtq_f32(t3, t);
+            t = vbslq_f32(k3, t3, t);
+            w = vbslq_f32(k3, c, w);
+            x = vbslq_f32(k3, e, x);
+            y = vbslq_f32(k3, f, y);
+            z = vbslq_f32(k3, t3, z);
+
+            const float32x4_t s = vdivq_f32(half, vsqrtq_f32(t));
+
+            w = vmulq_f32(w, s);
+            x = vmulq_f32(x, s);
+            y = vmulq_f32(y, s);
+            z = vmulq_f32(z, s);
+
+            const uint32x4_t flip = vandq_u32(vcltq_f32(w, zero), vdupq_n_u32(0x80000000u));
+
+            w = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(w), flip));
+            x = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(x), flip));
+            y = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(y), flip));
+            z = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(z), flip));
+
+            vst1q_f32(&block.orientation[0][i], vbslq_f32(valid, w, one));
+            vst1q_f32(&block.orientation[1][i], vbslq_f32(valid, x, zero));
+            vst1q_f32(&block.orientation[2][i], vbslq_f32(valid, y, zero));
+            vst1q_f32(&block.orientation[3][i], vbslq_f32(valid, z, zero));
+
+            for (size_t k = 0; k < 9; ++k) {
+                vst1q_f32(&block.rotation[k][i], vbslq_f32(valid, m[k], (((k % 4) == 0) ? one : zero)));
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                vst1q_f32(&block.position[k][i], vbslq_f32(valid, vld1q_f32(&block.position[k][i]), zero));
+                vst1q_f32(&block.velocity[k][i], vbslq_f32(valid, vld1q_f32(&block.velocity[k][i]), zero));
+                vst1q_f32(&block.angular_velocity[k][i], vbslq_f32(valid, vld1q_f32(&block.angular_velocity[k][i]), zero));
+            }
+        }
+    }
+
+#endif
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PoseBatch::convert(const vr::TrackedDevicePose_t* const poses, size_t count, PoseBlock& block)
+{
+#if defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+    assert(count <= PoseBlock::CAPACITY);
+    assert(poses || (count == 0));
+
+    compute_masks(poses, count, block);
+
+    float scratch[PoseBlock::CAPACITY];
+    const PoseFields fields(block, scratch);
+
+#if defined(__AVX2__)
+    constexpr size_t GROUP_SIZE = 8;
+#else
+    constexpr size_t GROUP_SIZE = 4;
+#endif
+
+    //------------------------------------------------------------------------------
+    // Transpose groups of poses. Groups without valid poses are skipped, a
+    // trailing partial group is padded with invalid poses.
+    for (size_t lane = 0; lane < count; lane += GROUP_SIZE) {
+        if (((block.valid_mask >> lane) & ((uint64_t(1) << GROUP_SIZE) - 1)) == 0) {
+            continue;
+        }
+
+        const vr::TrackedDevicePose_t* group = (poses + lane);
+        vr::TrackedDevicePose_t padded[GROUP_SIZE];
+
+        if ((lane + GROUP_SIZE) > count) {
+            std::memset(padded, 0, sizeof(padded));
+            std::memcpy(padded, group, (sizeof(vr::TrackedDevicePose_t) * (count - lane)));
+            group = padded;
+        }
+
+#if defined(__AVX2__)
+        transpose_group_avx2(group, fields, lane);
+#elif defined(__SSE2__)
+        transpose_group_sse2(group, fields, lane);
+#else
+        transpose_group_neon(group, fields, lane);
+#endif
+    }
+
+#if defined(__AVX2__)
+    finalize_avx2(block);
+#elif defined(__SSE2__)
+    finalize_sse2(block);
+#else
+    finalize_neon(block);
+#endif
+#else
+    convert_scalar(poses, count, block);
+#endif
+}
+
+void
+PoseBatch::convert_scalar(const vr::TrackedDevicePose_t* const poses, size_t count, PoseBlock& block)
+{
+    assert(count <= PoseBlock::CAPACITY);
+    assert(poses || (count == 0));
+
+    compute_masks(poses, count, block);
+
+    float scratch[PoseBlock::CAPACITY];
+    const PoseFields fields(block, scratch);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (not block.is_valid(i)) {
+            continue;
+        }
+
+        float values[NUM_POSE_FLOATS];
+        std::memcpy(values, &poses[i], sizeof(values));
+
+        for (size_t k = 0; k < NUM_USED_POSE_FLOATS; ++k) {
+            fields.fields[k][i] = values[k];
+        }
+    }
+
+    for (size_t i = 0; i < PoseBlock::CAPACITY; ++i) {
+        finalize_lane(block, i);
+    }
+}
+
+const char*
+PoseBatch::kernel_name()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,125 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __POSE_BATCH_H__
+#define __POSE_BATCH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The poses of all tracked devices in structure of arrays layout, indexed by
+// tracked device index. Lanes of invalid poses hold the identity pose (zero
+// position and velocities, identity rotation).
+//------------------------------------------------------------------------------
+
+struct PoseBlock
+{
+    static constexpr size_t CAPACITY = vr::k_unMaxTrackedDeviceCount;
+
+    size_t      count = 0;
+    uint64_t    valid_mask = 0;                                 // Bit i set if pose i is valid (bPoseIsValid)
+    uint64_t    connected_mask = 0;                             // Bit i set if device i is connected (bDeviceIsConnected)
+
+    alignas(32) float rotation[9][CAPACITY] = {};               // Row-major 3x3, element (r, c) at [(r * 3) + c]
+    alignas(32) float position[3][CAPACITY] = {};
+    alignas(32) float orientation[4][CAPACITY] = {};            // Quaternion (w, x, y, z) with w >= 0
+    alignas(32) float velocity[3][CAPACITY] = {};
+    alignas(32) float angular_velocity[3][CAPACITY] = {};
+
+    bool is_valid(size_t index) const { return ((valid_mask >> index) & 1); }
+
+    //------------------------------------------------------------------------------
+    // The device to absolute tracking transform of pose 'index' as a simd matrix,
+    // like Utils::simd_from_hmd_matrix().
+    simd_float4x4 matrix(size_t index) const
+    {
+        simd_float4x4 result;
+
+        for (size_t c = 0; c < 3; ++c) {
+            result.columns[c] = simd_float4 { rotation[c][index], rotation[3 + c][index], rotation[6 + c][index], 0.0f };
+        }
+
+        result.columns[3] = simd_float4 { position[0][index], position[1][index], position[2][index], 1.0f };
+        return result;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Batched conversion of the pose array returned by WaitGetPoses() (or
+// GetDeviceToAbsoluteTrackingPose()) to a PoseBlock.
+//
+// Groups of poses are transposed from the OpenVR layout in registers, groups
+// without valid poses are not read at all. Orientations are extracted from the
+// rotation matrices without per-element branching: all four candidate
+// quaternions (largest w, x, y or z) are computed per lane and the numerically
+// best one is selected with masks.
+//------------------------------------------------------------------------------
+
+class PoseBatch
+{
+public:
+
+    //------------------------------------------------------------------------------
+    // Convert 'count' (at most PoseBlock::CAPACITY) poses. Uses AVX2, SSE2 or NEON
+    // depending on the instruction set the file is compiled for and falls back to
+    // convert_scalar() otherwise.
+    static void convert(const vr::TrackedDevicePose_t* const poses, size_t count, PoseBlock& block);
+
+    //------------------------------------------------------------------------------
+    // Scalar implementation of convert(). Produces identical results and is mainly
+    // useful as a reference.
+    static void convert_scalar(const vr::TrackedDevicePose_t* const poses, size_t count, PoseBlock& block);
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by convert() ("AVX2", "SSE2", "NEON" or
+    // "Scalar").
+    static const char* kernel_name();
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __POSE_BATCH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,391 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PoseHistory.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_DEVICES = vr::k_unMaxTrackedDeviceCount;
+
+    //------------------------------------------------------------------------------
+    // Above this cosine of the angle between two orientations slerp degenerates and
+    // normalized linear interpolation is used instead.
+    constexpr float SLERP_THRESHOLD = 0.9995f;
+
+    void normalize_quaternion(float q[4])
+    {
+        const float length = std::sqrt((q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]));
+
+        for (size_t k = 0; k < 4; ++k) {
+            q[k] /= length;
+        }
+    }
+
+    void lerp(const float* const a, const float* const b, float t, size_t count, float* const result)
+    {
+        for (size_t k = 0; k < count; ++k) {
+            result[k] = (a[k] + ((b[k] - a[k]) * t));
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PoseHistory::PoseHistory(size_t capacity, double max_extrapolation)
+    : m_capacity(capacity)
+    , m_max_extrapolation(max_extrapolation)
+{
+    static_assert(std::is_trivially_copyable<Sample>::value, "!");
+    static_assert(sizeof(Sample) <= (NUM_WORDS * sizeof(uint64_t)), "!");
+
+    if ((capacity < 2) || ((capacity & (capacity - 1)) != 0)) {
+        throw std::runtime_error("Invalid capacity!");
+    }
+
+    if (not (max_extrapolation >= 0.0)) {
+        throw std::runtime_error("Invalid extrapolation limit!");
+    }
+
+    m_rings.reset(new Ring[NUM_DEVICES]);
+
+    for (size_t device = 0; device < NUM_DEVICES; ++device) {
+        Ring& ring = m_rings[device];
+
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.slots.reset(new Slot[capacity]);
+
+        for (size_t i = 0; i < capacity; ++i) {
+            ring.slots[i].sequence.store(0, std::memory_order_relaxed);
+
+            for (std::atomic<uint64_t>& word : ring.slots[i].words) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PoseHistory::push(double timestamp, const vr::TrackedDevicePose_t* const poses, size_t count)
+{
+    assert(count <= NUM_DEVICES);
+
+    PoseBatch::convert(poses, count, m_block);
+
+    for (uint64_t mask = m_block.valid_mask; mask != 0; mask &= (mask - 1)) {
+        const size_t i = size_t(__builtin_ctzll(mask));
+
+        Sample sample;
+        sample.timestamp = timestamp;
+
+        for (size_t k = 0; k < 3; ++k) {
+            sample.position[k] = m_block.position[k][i];
+            sample.velocity[k] = m_block.velocity[k][i];
+            sample.angular_velocity[k] = m_block.angular_velocity[k][i];
+        }
+
+        for (size_t k = 0; k < 4; ++k) {
+            sample.orientation[k] = m_block.orientation[k][i];
+        }
+
+        push(vr::TrackedDeviceIndex_t(i), sample);
+    }
+}
+
+void
+PoseHistory::push(vr::TrackedDeviceIndex_t device, const Sample& sample)
+{
+    assert(device < NUM_DEVICES);
+
+    Ring& ring = m_rings[device];
+
+    const uint64_t index = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[index & (m_capacity - 1)];
+
+    uint64_t words[NUM_WORDS] = {};
+    std::memcpy(words, &sample, sizeof(Sample));
+
+    slot.sequence.store(((2 * index) + 1), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t k = 0; k < NUM_WORDS; ++k) {
+        slot.words[k].store(words[k], std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(((2 * index) + 2), std::memory_order_release);
+    ring.head.store((index + 1), std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t
+PoseHistory::num_samples(vr::TrackedDeviceIndex_t device) const
+{
+    return ((device < NUM_DEVICES) ? m_rings[device].head.load(std::memory_order_acquire) : 0);
+}
+
+bool
+PoseHistory::latest(vr::TrackedDeviceIndex_t device, Sample& sample) const
+{
+    if (device >= NUM_DEVICES) {
+        return false;
+    }
+
+    const Ring& ring = m_rings[device];
+
+    //------------------------------------------------------------------------------
+    // The newest slot can only be overwritten if the producer pushed a full ring's
+    // worth of poses while it was being read, in which case there is a newer one.
+    for (;;) {
+        const uint64_t head = ring.head.load(std::memory_order_acquire);
+
+        if (head == 0) {
+            return false;
+        }
+
+        if (read(ring, (head - 1), sample)) {
+            return true;
+        }
+    }
+}
+
+PoseHistory::Status
+PoseHistory::sample(vr::TrackedDeviceIndex_t device, double timestamp, Sample& sample) const
+{
+    if (device >= NUM_DEVICES) {
+        return Status_None;
+    }
+
+    const Ring& ring = m_rings[device];
+
+    uint64_t head;
+    Sample newer;
+
+    do {
+        head = ring.head.load(std::memory_order_acquire);
+
+        if (head == 0) {
+            return Status_None;
+        }
+    } while (not read(ring, (head - 1), newer));
+
+    //------------------------------------------------------------------------------
+    // Past the newest pose.
+    if (timestamp >= newer.timestamp) {
+        const double interval = (timestamp - newer.timestamp);
+
+        if (interval == 0.0) {
+            sample = newer;
+            return Status_Exact;
+        }
+
+        if (interval > m_max_extrapolation) {
+            sample = extrapolate(newer, m_max_extrapolation);
+            return Status_Clamped;
+        }
+
+        sample = extrapolate(newer, interval);
+        return Status_Extrapolated;
+    }
+
+    //------------------------------------------------------------------------------
+    // Binary search for the oldest pose after the timestamp. A slot failing to read
+    // has been overwritten, as have all older ones, so it counts as before the
+    // timestamp.
+    uint64_t low = ((head > m_capacity) ? (head - m_capacity) : 0);
+    uint64_t high = (head - 1);
+    const uint64_t oldest = low;
+
+    while (low < high) {
+        const uint64_t middle = (low + ((high - low) / 2));
+        Sample candidate;
+
+        if (read(ring, middle, candidate) && (candidate.timestamp > timestamp)) {
+            high = middle;
+            newer = candidate;
+        }
+        else {
+            low = (middle + 1);
+        }
+    }
+
+    Sample older;
+
+    if ((high == oldest) || (not read(ring, (high - 1), older))) {
+        sample = newer;
+        return Status_Clamped;
+    }
+
+    if (older.timestamp == timestamp) {
+        sample = older;
+        return Status_Exact;
+    }
+
+    sample = interpolate(older, newer, ((timestamp - older.timestamp) / (newer.timestamp - older.timestamp)));
+    return Status_Interpolated;
+}
+
+PoseHistory::Status
+PoseHistory::sample(vr::TrackedDeviceIndex_t device, double timestamp, simd_float4x4& device_to_absolute) const
+{
+    Sample result;
+    const Status status = sample(device, timestamp, result);
+
+    device_to_absolute = ((status != Status_None) ? result.matrix() : MatrixUtils::identity());
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PoseHistory::Sample
+PoseHistory::interpolate(const Sample& a, const Sample& b, double fraction)
+{
+    const float t = float(fraction);
+
+    Sample result;
+    result.timestamp = (a.timestamp + ((b.timestamp - a.timestamp) * fraction));
+
+    lerp(a.position, b.position, t, 3, result.position);
+    lerp(a.velocity, b.velocity, t, 3, result.velocity);
+    lerp(a.angular_velocity, b.angular_velocity, t, 3, result.angular_velocity);
+
+    //------------------------------------------------------------------------------
+    // Slerp along the shorter arc.
+    float q[4];
+    std::copy(b.orientation, (b.orientation + 4), q);
+
+    float cosine = ((a.orientation[0] * q[0]) + (a.orientation[1] * q[1]) + (a.orientation[2] * q[2]) + (a.orientation[3] * q[3]));
+
+    if (cosine < 0.0f) {
+        for (float& component : q) {
+            component = -component;
+        }
+
+        cosine = -cosine;
+    }
+
+    if (cosine > SLERP_THRESHOLD) {
+        lerp(a.orientation, q, t, 4, result.orientation);
+    }
+    else {
+        const float angle = std::acos(cosine);
+        const float weight_a = (std::sin((1.0f - t) * angle) / std::sin(angle));
+        const float weight_b = (std::sin(t * angle) / std::sin(angle));
+
+        for (size_t k = 0; k < 4; ++k) {
+            result.orientation[k] = ((a.orientation[k] * weight_a) + (q[k] * weight_b));
+        }
+    }
+
+    normalize_quaternion(result.orientation);
+    return result;
+}
+
+PoseHistory::Sample
+PoseHistory::extrapolate(const Sample& sample, double interval)
+{
+    const float dt = float(interval);
+
+    Sample result = sample;
+    result.timestamp = (sample.timestamp + interval);
+
+    for (size_t k = 0; k < 3; ++k) {
+        result.position[k] += (sample.velocity[k] * dt);
+    }
+
+    //------------------------------------------------------------------------------
+    // Rotate by the angular velocity (tracking space, so applied on the left).
+    const float* const w = sample.angular_velocity;
+    const float speed = std::sqrt((w[0] * w[0]) + (w[1] * w[1]) + (w[2] * w[2]));
+
+    if (speed > 0.0f) {
+        const float half_angle = (0.5f * speed * dt);
+        const float s = (std::sin(half_angle) / speed);
+        const float d[4] = { std::cos(half_angle), (w[0] * s), (w[1] * s), (w[2] * s) };
+        const float* const q = sample.orientation;
+
+        result.orientation[0] = ((d[0] * q[0]) - (d[1] * q[1]) - (d[2] * q[2]) - (d[3] * q[3]));
+        result.orientation[1] = ((d[0] * q[1]) + (d[1] * q[0]) + (d[2] * q[3]) - (d[3] * q[2]));
+        result.orientation[2] = ((d[0] * q[2]) - (d[1] * q[3]) + (d[2] * q[0]) + (d[3] * q[1]));
+        result.orientation[3] = ((d[0] * q[3]) + (d[1] * q[2]) - (d[2] * q[1]) + (d[3] * q[0]));
+
+        normalize_quaternion(result.orientation);
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+PoseHistory::read(const Ring& ring, uint64_t index, Sample& sample) const
+{
+    const Slot& slot = ring.slots[index & (m_capacity - 1)];
+    const uint64_t expected = ((2 * index) + 2);
+
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+        return false;
+    }
+
+    uint64_t words[NUM_WORDS];
+
+    for (size_t k = 0; k < NUM_WORDS; ++k) {
+        words[k] = slot.words[k].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+        return false;
+    }
+
+    std::memcpy(&sample, words, sizeof(Sample));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
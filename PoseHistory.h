@@ -0,0 +1,197 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __POSE_HISTORY_H__
+#define __POSE_HISTORY_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+#include "PoseBatch.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Timestamped pose history of all tracked devices.
+//
+// A single producer (the thread calling WaitGetPoses() or
+// GetDeviceToAbsoluteTrackingPose()) pushes poses, any number of consumers
+// sample them at arbitrary timestamps without locks. Each device has a ring
+// buffer of the most recent 'capacity' valid poses. Each slot is guarded by a
+// sequence number: readers retry (or skip older slots) if the producer
+// overwrote a slot while it was being read, the producer never waits.
+//
+// Between recorded poses positions and velocities are interpolated linearly and
+// orientations spherically. Past the newest pose they are extrapolated from the
+// linear and angular velocities, limited to a maximum interval.
+//
+// Timestamps are in seconds on any clock chosen by the producer and must
+// increase from push to push.
+//------------------------------------------------------------------------------
+
+class PoseHistory
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    struct Sample
+    {
+        double      timestamp = 0.0;
+        float       position[3] = {};
+        float       orientation[4] = { 1.0f, 0.0f, 0.0f, 0.0f };    // Quaternion (w, x, y, z)
+        float       velocity[3] = {};
+        float       angular_velocity[3] = {};                       // Radians per second, tracking space
+
+        //------------------------------------------------------------------------------
+        // The device to absolute tracking transform as a simd matrix, like
+        // Utils::simd_from_hmd_matrix().
+        simd_float4x4 matrix() const { return MatrixUtils::rigid_transform(orientation, position); }
+    };
+
+    //------------------------------------------------------------------------------
+    // How a sampled pose was obtained.
+    enum Status {
+        Status_None = 0,            // No pose recorded (or no consistent read)
+        Status_Exact,               // Timestamp of a recorded pose
+        Status_Interpolated,        // Between two recorded poses
+        Status_Extrapolated,        // Past the newest pose
+        Status_Clamped,             // Before the oldest retained pose or past the extrapolation limit
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Retain 'capacity' poses per device. Throws if the capacity is not a power of
+    // two of at least 2.
+    explicit PoseHistory(size_t capacity = 64, double max_extrapolation = 0.05);
+
+    PoseHistory(const PoseHistory&) = delete;
+    PoseHistory& operator=(const PoseHistory&) = delete;
+
+    size_t capacity() const { return m_capacity; }
+    double max_extrapolation() const { return m_max_extrapolation; }
+
+    //------------------------------------------------------------------------------
+    // Producer
+public:
+
+    //------------------------------------------------------------------------------
+    // Record 'count' (at most k_unMaxTrackedDeviceCount) poses taken at the given
+    // time, indexed by tracked device index. Invalid poses are not recorded.
+    // Orientations are extracted with PoseBatch.
+    void push(double timestamp, const vr::TrackedDevicePose_t* const poses, size_t count);
+
+    //------------------------------------------------------------------------------
+    // Record a single sample for the given device.
+    void push(vr::TrackedDeviceIndex_t device, const Sample& sample);
+
+    //------------------------------------------------------------------------------
+    // Consumers
+public:
+
+    //------------------------------------------------------------------------------
+    // The number of poses recorded for the device so far (including those no
+    // longer retained).
+    uint64_t num_samples(vr::TrackedDeviceIndex_t device) const;
+
+    //------------------------------------------------------------------------------
+    // The newest recorded pose of the device. Returns false if there is none.
+    bool latest(vr::TrackedDeviceIndex_t device, Sample& sample) const;
+
+    //------------------------------------------------------------------------------
+    // The pose of the device at the given time. The sample's timestamp is set to
+    // the requested time unless the result is clamped.
+    Status sample(vr::TrackedDeviceIndex_t device, double timestamp, Sample& sample) const;
+
+    //------------------------------------------------------------------------------
+    // The device to absolute tracking transform at the given time, the identity if
+    // there is no pose.
+    Status sample(vr::TrackedDeviceIndex_t device, double timestamp, simd_float4x4& device_to_absolute) const;
+
+    //------------------------------------------------------------------------------
+    // Interpolation
+public:
+
+    //------------------------------------------------------------------------------
+    // Interpolate between two samples, 'fraction' being in [0, 1].
+    static Sample interpolate(const Sample& a, const Sample& b, double fraction);
+
+    //------------------------------------------------------------------------------
+    // Extrapolate a sample by 'interval' seconds with its velocities.
+    static Sample extrapolate(const Sample& sample, double interval);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    static constexpr size_t NUM_WORDS = 8;
+
+    //------------------------------------------------------------------------------
+    // A sample stored as atomic words so concurrent reads and writes are well
+    // defined. 'sequence' is (2 * n + 1) while sample n is written and (2 * n + 2)
+    // once it is complete.
+    struct Slot
+    {
+        std::atomic<uint64_t>   sequence;
+        std::atomic<uint64_t>   words[NUM_WORDS];
+    };
+
+    struct alignas(64) Ring
+    {
+        std::atomic<uint64_t>       head;               // Number of samples written
+        std::unique_ptr<Slot[]>     slots;
+    };
+
+    bool read(const Ring& ring, uint64_t index, Sample& sample) const;
+
+    size_t                      m_capacity;
+    double                      m_max_extrapolation;
+    std::unique_ptr<Ring[]>     m_rings;
+    PoseBlock                   m_block;                // Producer only
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __POSE_HISTORY_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
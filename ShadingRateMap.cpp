@@ -0,0 +1,296 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ShadingRateMap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+#include "LensDensity.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr float NO_SAMPLE = -1.0f;
+
+    //------------------------------------------------------------------------------
+    // The coarsest rate not exceeding the given fragment spacings (in pixels).
+    ShadingRate coarsest_rate(float max_spacing_x, float max_spacing_y)
+    {
+        if ((max_spacing_x >= 4.0f) && (max_spacing_y >= 4.0f)) {
+            return ShadingRate_4x4;
+        }
+        else if ((max_spacing_x >= 2.0f) && (max_spacing_y >= 2.0f)) {
+            return ShadingRate_2x2;
+        }
+        else if (max_spacing_x >= 2.0f) {
+            return ShadingRate_2x1;
+        }
+        else if (max_spacing_y >= 2.0f) {
+            return ShadingRate_1x2;
+        }
+
+        return ShadingRate_1x1;
+    }
+
+    float foveation_scale(const ShadingRateMap::Foveation& foveation, float u, float v)
+    {
+        const float distance = std::hypot((u - foveation.center_u), (v - foveation.center_v));
+
+        if (distance <= foveation.inner_radius) {
+            return 1.0f;
+        }
+        else if ((distance >= foveation.outer_radius) || (foveation.outer_radius <= foveation.inner_radius)) {
+            return foveation.outer_density;
+        }
+
+        const float t = ((distance - foveation.inner_radius) / (foveation.outer_radius - foveation.inner_radius));
+        return (1.0f + (t * (foveation.outer_density - 1.0f)));
+    }
+
+    //------------------------------------------------------------------------------
+    // Fill tiles without samples with the highest density of their neighbors (with
+    // samples), or 0 if there are none.
+    void fill_empty_tiles(std::vector<float>& density, uint32_t num_tiles_x, uint32_t num_tiles_y)
+    {
+        const std::vector<float> sampled(density);
+
+        for (uint32_t tile_y = 0; tile_y < num_tiles_y; ++tile_y) {
+            for (uint32_t tile_x = 0; tile_x < num_tiles_x; ++tile_x) {
+                float& value = density[(size_t(tile_y) * num_tiles_x) + tile_x];
+
+                if (value != NO_SAMPLE) {
+                    continue;
+                }
+
+                value = 0.0f;
+
+                for (uint32_t y = ((tile_y > 0) ? (tile_y - 1) : 0); y <= std::min((tile_y + 1), (num_tiles_y - 1)); ++y) {
+                    for (uint32_t x = ((tile_x > 0) ? (tile_x - 1) : 0); x <= std::min((tile_x + 1), (num_tiles_x - 1)); ++x) {
+                        value = std::max(value, sampled[(size_t(y) * num_tiles_x) + x]);
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShadingRateMap::ShadingRateMap(vr::IVRSystem* const system, const Settings& settings)
+    : m_system(system)
+    , m_settings(settings)
+    , m_width(0)
+    , m_height(0)
+    , m_num_tiles_x(0)
+    , m_num_tiles_y(0)
+    , m_is_valid(false)
+    , m_num_builds(0)
+{
+    if (settings.tile_size == 0) {
+        throw std::runtime_error("Invalid tile size!");
+    }
+
+    if (not ((settings.tolerance >= 0.0f) && (settings.tolerance < 1.0f))) {
+        throw std::runtime_error("Invalid tolerance!");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ShadingRateMap::update(uint32_t width, uint32_t height)
+{
+    if (m_is_valid && (width == m_width) && (height == m_height)) {
+        return false;
+    }
+
+    if ((width == 0) || (height == 0)) {
+        throw std::runtime_error("Invalid render target size!");
+    }
+
+    m_width = width;
+    m_height = height;
+    m_num_tiles_x = ((width + m_settings.tile_size - 1) / m_settings.tile_size);
+    m_num_tiles_y = ((height + m_settings.tile_size - 1) / m_settings.tile_size);
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        build(eye);
+    }
+
+    m_is_valid = true;
+    ++m_num_builds;
+
+    return true;
+}
+
+bool
+ShadingRateMap::handle_event(const vr::VREvent_t& event)
+{
+    switch (event.eventType) {
+        case vr::VREvent_LensDistortionChanged:
+            invalidate();
+            return true;
+
+        case vr::VREvent_TrackedDeviceActivated:
+            if (event.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd) {
+                invalidate();
+                return true;
+            }
+
+            return false;
+
+        case vr::VREvent_PropertyChanged:
+            if ((event.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd) && (event.data.property.prop == vr::Prop_ModelNumber_String)) {
+                invalidate();
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShadingRateMap::Statistics
+ShadingRateMap::compute_statistics(vr::EVREye eye) const
+{
+    Statistics statistics;
+    double num_fragments = 0.0;
+
+    for (uint32_t tile_y = 0; tile_y < m_num_tiles_y; ++tile_y) {
+        for (uint32_t tile_x = 0; tile_x < m_num_tiles_x; ++tile_x) {
+            const ShadingRate tile_rate = rate(eye, tile_x, tile_y);
+
+            switch (tile_rate) {
+                case ShadingRate_1x1: ++statistics.num_1x1; break;
+                case ShadingRate_1x2:
+                case ShadingRate_2x1: ++statistics.num_1x2; break;
+                case ShadingRate_2x2: ++statistics.num_2x2; break;
+                case ShadingRate_4x4: ++statistics.num_4x4; break;
+                default: ++statistics.num_culled; break;
+            }
+
+            if (tile_rate != ShadingRate_Culled) {
+                const uint32_t tile_width = (std::min(((tile_x + 1) * m_settings.tile_size), m_width) - (tile_x * m_settings.tile_size));
+                const uint32_t tile_height = (std::min(((tile_y + 1) * m_settings.tile_size), m_height) - (tile_y * m_settings.tile_size));
+
+                num_fragments += (double(tile_width) * double(tile_height) / double(rate_width(tile_rate) * rate_height(tile_rate)));
+            }
+        }
+    }
+
+    const double num_pixels = (double(m_width) * double(m_height));
+    statistics.shaded_fraction = ((num_pixels > 0.0) ? (num_fragments / num_pixels) : 1.0);
+
+    return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ShadingRateMap::build(vr::EVREye eye)
+{
+    const size_t num_tiles = (size_t(m_num_tiles_x) * m_num_tiles_y);
+    const uint32_t tile_size = m_settings.tile_size;
+
+    //------------------------------------------------------------------------------
+    // Highest density per tile, sampled at about two cells per tile.
+    const uint32_t num_samples = std::min(std::max((2 * std::max(m_num_tiles_x, m_num_tiles_y)), 64u), 1024u);
+    const std::vector<LensDensity::Sample> samples = LensDensity::sample(m_system, eye, m_width, m_height, num_samples);
+
+    std::vector<float> density_x(num_tiles, NO_SAMPLE);
+    std::vector<float> density_y(num_tiles, NO_SAMPLE);
+
+    for (const LensDensity::Sample& sample : samples) {
+        const uint32_t tile_x = std::min(uint32_t(sample.x * float(m_width) / float(tile_size)), (m_num_tiles_x - 1));
+        const uint32_t tile_y = std::min(uint32_t(sample.y * float(m_height) / float(tile_size)), (m_num_tiles_y - 1));
+        const size_t tile = ((size_t(tile_y) * m_num_tiles_x) + tile_x);
+
+        density_x[tile] = std::max(density_x[tile], sample.density_x);
+        density_y[tile] = std::max(density_y[tile], sample.density_y);
+    }
+
+    fill_empty_tiles(density_x, m_num_tiles_x, m_num_tiles_y);
+    fill_empty_tiles(density_y, m_num_tiles_x, m_num_tiles_y);
+
+    //------------------------------------------------------------------------------
+    // Rates.
+    const HiddenAreaTileMask mask(m_system->GetHiddenAreaMesh(eye, vr::k_eHiddenAreaMesh_Standard), m_width, m_height, tile_size);
+    const uint8_t hidden_rate = (m_settings.cull_hidden ? ShadingRate_Culled : ShadingRate_4x4);
+    const float quality = (1.0f - m_settings.tolerance);
+
+    std::vector<uint8_t>& rates = m_rates[eye];
+    rates.resize(num_tiles);
+
+    for (uint32_t tile_y = 0; tile_y < m_num_tiles_y; ++tile_y) {
+        for (uint32_t tile_x = 0; tile_x < m_num_tiles_x; ++tile_x) {
+            const size_t tile = ((size_t(tile_y) * m_num_tiles_x) + tile_x);
+
+            if (mask.tile_state(tile_x, tile_y) == HiddenAreaTileMask::TileState_Hidden) {
+                rates[tile] = hidden_rate;
+                continue;
+            }
+
+            float scale = quality;
+
+            if (m_settings.foveation_enabled) {
+                const float u = (((float(tile_x) + 0.5f) * float(tile_size)) / float(m_width));
+                const float v = (((float(tile_y) + 0.5f) * float(tile_size)) / float(m_height));
+
+                scale *= foveation_scale(m_settings.foveation, u, v);
+            }
+
+            const float needed_x = (density_x[tile] * scale);
+            const float needed_y = (density_y[tile] * scale);
+
+            rates[tile] = coarsest_rate(((needed_x > 0.0f) ? (1.0f / needed_x) : HUGE_VALF),
+                                        ((needed_y > 0.0f) ? (1.0f / needed_y) : HUGE_VALF));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
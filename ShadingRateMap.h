@@ -0,0 +1,202 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SHADING_RATE_MAP_H__
+#define __SHADING_RATE_MAP_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Shading rate of a tile, encoded like D3D12/Vulkan shading rate images as
+// (log2(width) << 2) | log2(height) of the pixel block one fragment covers.
+//------------------------------------------------------------------------------
+
+enum ShadingRate : uint8_t {
+    ShadingRate_1x1 = 0x0,
+    ShadingRate_1x2 = 0x1,
+    ShadingRate_2x1 = 0x4,
+    ShadingRate_2x2 = 0x5,
+    ShadingRate_4x4 = 0xA,
+
+    ShadingRate_Culled = 0xFF,          // Hidden tile, no fragments at all
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Per-tile shading rates of both eyes' render targets, one byte per tile.
+//
+// The rate of a tile is the coarsest one whose fragment spacing along each axis
+// still provides (1 - tolerance) times the highest pixel density the lens needs
+// in the tile (see LensDensity), optionally further reduced by a fixed foveation
+// falloff. Tiles hidden by the hidden area mesh (see HiddenAreaTileMask) are
+// culled or get the coarsest rate, tiles no distortion sample maps to take the
+// highest density of their neighbors.
+//
+// The maps are built on the CPU by update() and only again when the render
+// target size changes or handle_event() sees a headset/lens change. Tiles are
+// numbered row-major like HiddenAreaTileMask's.
+//------------------------------------------------------------------------------
+
+class ShadingRateMap
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // Fixed foveation: the needed density is scaled by 1 within the inner radius
+    // around the center, falling off linearly to 'outer_density' at the outer
+    // radius and beyond. Distances are in render target UV.
+    struct Foveation
+    {
+        float       center_u = 0.5f;
+        float       center_v = 0.5f;
+        float       inner_radius = 0.25f;
+        float       outer_radius = 0.5f;
+        float       outer_density = 0.25f;
+    };
+
+    struct Settings
+    {
+        uint32_t    tile_size = 16;
+        float       tolerance = 0.1f;           // In [0, 1)
+        bool        cull_hidden = true;         // Otherwise hidden tiles are 4x4
+        bool        foveation_enabled = false;
+        Foveation   foveation;
+    };
+
+    //------------------------------------------------------------------------------
+    // The number of tiles at each rate and the fragments shaded relative to
+    // shading every pixel.
+    struct Statistics
+    {
+        size_t      num_1x1 = 0;
+        size_t      num_1x2 = 0;                // Including 2x1
+        size_t      num_2x2 = 0;
+        size_t      num_4x4 = 0;
+        size_t      num_culled = 0;
+        double      shaded_fraction = 1.0;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // The maps are empty until update() is called. Throws if the tile size is 0
+    // or the tolerance is invalid.
+    ShadingRateMap(vr::IVRSystem* const system, const Settings& settings);
+
+    //------------------------------------------------------------------------------
+    // Updating
+public:
+
+    //------------------------------------------------------------------------------
+    // Build the maps of both eyes for a (width x height) render target, e.g. of the
+    // size returned by VRSystem::GetRecommendedRenderTargetSize(), unless they
+    // were built for this size already and not invalidated since. Returns true if
+    // the maps were built. Throws if the size is empty.
+    bool update(uint32_t width, uint32_t height);
+
+    //------------------------------------------------------------------------------
+    // Invalidate the maps if the event may change the lens or the headset:
+    // VREvent_LensDistortionChanged, VREvent_TrackedDeviceActivated of the HMD
+    // and VREvent_PropertyChanged of the HMD's Prop_ModelNumber_String. Returns
+    // true if invalidated.
+    bool handle_event(const vr::VREvent_t& event);
+
+    //------------------------------------------------------------------------------
+    // Have the next update() build the maps again.
+    void invalidate() { m_is_valid = false; }
+
+    //------------------------------------------------------------------------------
+    // The number of times the maps were built.
+    size_t num_builds() const { return m_num_builds; }
+
+    //------------------------------------------------------------------------------
+    // Tiles
+public:
+
+    const Settings& settings() const { return m_settings; }
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+    uint32_t num_tiles_x() const { return m_num_tiles_x; }
+    uint32_t num_tiles_y() const { return m_num_tiles_y; }
+
+    //------------------------------------------------------------------------------
+    // The (num_tiles_x * num_tiles_y) ShadingRate bytes of the given eye.
+    const std::vector<uint8_t>& rates(vr::EVREye eye) const { return m_rates[eye]; }
+
+    ShadingRate rate(vr::EVREye eye, uint32_t tile_x, uint32_t tile_y) const
+    {
+        return ShadingRate(m_rates[eye][(size_t(tile_y) * m_num_tiles_x) + tile_x]);
+    }
+
+    Statistics compute_statistics(vr::EVREye eye) const;
+
+    //------------------------------------------------------------------------------
+    // The size of the pixel block covered by one fragment (0 if culled).
+    static uint32_t rate_width(ShadingRate rate) { return ((rate == ShadingRate_Culled) ? 0 : (1u << (rate >> 2))); }
+    static uint32_t rate_height(ShadingRate rate) { return ((rate == ShadingRate_Culled) ? 0 : (1u << (rate & 3))); }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    void build(vr::EVREye eye);
+
+    vr::IVRSystem* const    m_system;
+    const Settings          m_settings;
+
+    uint32_t                m_width;
+    uint32_t                m_height;
+    uint32_t                m_num_tiles_x;
+    uint32_t                m_num_tiles_y;
+    bool                    m_is_valid;
+    size_t                  m_num_builds;
+
+    std::vector<uint8_t>    m_rates[2];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __SHADING_RATE_MAP_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,255 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StereoCamera.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    bool are_clip_planes_valid(float near_z, float far_z)
+    {
+        return ((near_z > 0.0f) && (far_z > near_z));
+    }
+
+    simd_float4 row(const simd_float4x4& m, size_t index)
+    {
+        return simd_float4 { m.columns[0][index], m.columns[1][index], m.columns[2][index], m.columns[3][index] };
+    }
+
+    simd_float4 normalize_plane(const simd_float4& plane)
+    {
+        const float length = std::sqrt((plane[0] * plane[0]) + (plane[1] * plane[1]) + (plane[2] * plane[2]));
+        return (plane * (1.0f / length));
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StereoCamera::StereoCamera(vr::IVRSystem* const system, float near_z, float far_z)
+    : m_system(system)
+    , m_near_z(near_z)
+    , m_far_z(far_z)
+    , m_num_refreshes(0)
+{
+    if (not m_system) {
+        throw std::runtime_error("Invalid system!");
+    }
+
+    if (not are_clip_planes_valid(near_z, far_z)) {
+        throw std::runtime_error("Invalid clip planes!");
+    }
+
+    refresh();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StereoCamera::set_clip_planes(float near_z, float far_z)
+{
+    if (not are_clip_planes_valid(near_z, far_z)) {
+        throw std::runtime_error("Invalid clip planes!");
+    }
+
+    m_near_z = near_z;
+    m_far_z = far_z;
+
+    refresh();
+}
+
+bool
+StereoCamera::handle_event(const vr::VREvent_t& event)
+{
+    switch (event.eventType) {
+        case vr::VREvent_IpdChanged:
+        case vr::VREvent_LensDistortionChanged:
+            refresh();
+            return true;
+
+        case vr::VREvent_PropertyChanged:
+            if ((event.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd) && (event.data.property.prop == vr::Prop_UserIpdMeters_Float)) {
+                refresh();
+                return true;
+            }
+
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+void
+StereoCamera::refresh()
+{
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        m_eye_to_head[eye] = MatrixUtils::simd_from_hmd_matrix(m_system->GetEyeToHeadTransform(eye));
+        m_head_to_eye[eye] = MatrixUtils::inverse_rigid(m_eye_to_head[eye]);
+        m_projection[eye] = MatrixUtils::simd_from_hmd_matrix(m_system->GetProjectionMatrix(eye, m_near_z, m_far_z));
+        m_inverse_projection[eye] = MatrixUtils::inverse(m_projection[eye]);
+    }
+
+    //------------------------------------------------------------------------------
+    // Corners of both eye frusta in head space.
+    simd_float4 corners[2][8];
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (size_t i = 0; i < 8; ++i) {
+            const simd_float4 ndc = { ((i & 1) ? 1.0f : -1.0f), ((i & 2) ? 1.0f : -1.0f), ((i & 4) ? 1.0f : 0.0f), 1.0f };
+            const simd_float4 eye_space = MatrixUtils::multiply(m_inverse_projection[eye], ndc);
+
+            corners[eye][i] = MatrixUtils::multiply(m_eye_to_head[eye], (eye_space * (1.0f / eye_space[3])));
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Move the origin back from the center between the eyes until the outer
+    // planes of both eyes pass through it. For the usual parallel eyes this makes
+    // the union frustum's side planes those of the eyes.
+    const simd_float4 left_eye = m_eye_to_head[vr::Eye_Left].columns[3];
+    const simd_float4 right_eye = m_eye_to_head[vr::Eye_Right].columns[3];
+    const simd_float4 center = ((left_eye + right_eye) * 0.5f);
+    const float half_separation = (std::fabs(right_eye[0] - left_eye[0]) * 0.5f);
+
+    float outer_tangents[2] = { 0.0f, 0.0f };
+
+    for (size_t i = 0; i < 8; ++i) {
+        const simd_float4 l = (corners[vr::Eye_Left][i] - left_eye);
+        const simd_float4 r = (corners[vr::Eye_Right][i] - right_eye);
+
+        outer_tangents[vr::Eye_Left] = std::max(outer_tangents[vr::Eye_Left], (-l[0] / -l[2]));
+        outer_tangents[vr::Eye_Right] = std::max(outer_tangents[vr::Eye_Right], (r[0] / -r[2]));
+    }
+
+    float offset = 0.0f;
+
+    for (const float tangent : outer_tangents) {
+        if (tangent > 0.0f) {
+            offset = std::max(offset, (half_separation / tangent));
+        }
+    }
+
+    const simd_float4 origin = { center[0], center[1], (center[2] + offset), 1.0f };
+
+    //------------------------------------------------------------------------------
+    // Tangents and depth range enclosing all corners as seen from the origin.
+    float left = 0.0f, right = 0.0f, top = 0.0f, bottom = 0.0f;
+    float near_z = HUGE_VALF, far_z = 0.0f;
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (size_t i = 0; i < 8; ++i) {
+            const simd_float4 d = (corners[eye][i] - origin);
+            const float depth = -d[2];
+
+            left = std::min(left, (d[0] / depth));
+            right = std::max(right, (d[0] / depth));
+            top = std::min(top, (d[1] / depth));
+            bottom = std::max(bottom, (d[1] / depth));
+            near_z = std::min(near_z, depth);
+            far_z = std::max(far_z, depth);
+        }
+    }
+
+    m_union_to_head = MatrixUtils::translation(origin[0], origin[1], origin[2]);
+    m_head_to_union = MatrixUtils::translation(-origin[0], -origin[1], -origin[2]);
+    m_union_projection = MatrixUtils::projection_from_raw(left, right, top, bottom, near_z, far_z);
+
+    ++m_num_refreshes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StereoCamera::update(const simd_float4x4& head_to_world, Frame& frame) const
+{
+    const simd_float4x4 world_to_head = MatrixUtils::inverse_rigid(head_to_world);
+
+    frame.head_to_world = head_to_world;
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        EyeMatrices& matrices = frame.eyes[eye];
+
+        matrices.view = MatrixUtils::multiply(m_head_to_eye[eye], world_to_head);
+        matrices.projection = m_projection[eye];
+        matrices.view_projection = MatrixUtils::multiply(m_projection[eye], matrices.view);
+        matrices.inverse_view = MatrixUtils::multiply(head_to_world, m_eye_to_head[eye]);
+        matrices.inverse_projection = m_inverse_projection[eye];
+        matrices.inverse_view_projection = MatrixUtils::multiply(matrices.inverse_view, m_inverse_projection[eye]);
+    }
+
+    frame.union_view = MatrixUtils::multiply(m_head_to_union, world_to_head);
+    frame.union_projection = m_union_projection;
+    frame.union_view_projection = MatrixUtils::multiply(m_union_projection, frame.union_view);
+
+    extract_planes(frame.union_view_projection, frame.union_planes);
+}
+
+bool
+StereoCamera::update(const vr::TrackedDevicePose_t& hmd_pose, Frame& frame) const
+{
+    if (not hmd_pose.bPoseIsValid) {
+        return false;
+    }
+
+    update(MatrixUtils::simd_from_hmd_matrix(hmd_pose.mDeviceToAbsoluteTracking), frame);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StereoCamera::extract_planes(const simd_float4x4& view_projection, simd_float4 planes[Plane_Count])
+{
+    const simd_float4 r0 = row(view_projection, 0);
+    const simd_float4 r1 = row(view_projection, 1);
+    const simd_float4 r2 = row(view_projection, 2);
+    const simd_float4 r3 = row(view_projection, 3);
+
+    planes[Plane_Left] = normalize_plane(r3 + r0);
+    planes[Plane_Right] = normalize_plane(r3 - r0);
+    planes[Plane_Bottom] = normalize_plane(r3 + r1);
+    planes[Plane_Top] = normalize_plane(r3 - r1);
+    planes[Plane_Near] = normalize_plane(r2);
+    planes[Plane_Far] = normalize_plane(r3 - r2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
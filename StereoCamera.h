@@ -0,0 +1,192 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __STEREO_CAMERA_H__
+#define __STEREO_CAMERA_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MatrixUtils.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Per-frame camera matrices for both eyes.
+//
+// The eye-to-head transforms and projections are queried from the system and
+// converted once, and again only when handle_event() sees an event that changes
+// them (IPD or lens changes) or the clip planes change. update() then derives
+// all per-frame matrices from the HMD pose without calling into OpenVR.
+//
+// In addition to the two eyes a union frustum is provided that contains both
+// eye frusta: it looks down the head's -Z axis from a point centered between
+// (and, if necessary, behind) the eyes such that its outer planes coincide with
+// the outer planes of the eyes. It can be used to cull once for both eyes.
+//------------------------------------------------------------------------------
+
+class StereoCamera
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    enum Plane {
+        Plane_Left = 0,
+        Plane_Right,
+        Plane_Bottom,
+        Plane_Top,
+        Plane_Near,
+        Plane_Far,
+
+        Plane_Count
+    };
+
+    struct EyeMatrices
+    {
+        simd_float4x4   view;                       // World to eye
+        simd_float4x4   projection;
+        simd_float4x4   view_projection;
+        simd_float4x4   inverse_view;               // Eye to world
+        simd_float4x4   inverse_projection;
+        simd_float4x4   inverse_view_projection;
+    };
+
+    struct Frame
+    {
+        simd_float4x4   head_to_world;
+        EyeMatrices     eyes[2];
+
+        //------------------------------------------------------------------------------
+        // The union frustum as view/projection and as world space planes (a, b, c, d)
+        // with unit normals pointing inside, i.e. a point p is inside a plane if
+        // (a * p.x + b * p.y + c * p.z + d) >= 0.
+        simd_float4x4   union_view;
+        simd_float4x4   union_projection;
+        simd_float4x4   union_view_projection;
+        simd_float4     union_planes[Plane_Count];
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the system is null or the clip planes are invalid (0 < near < far
+    // is required).
+    StereoCamera(vr::IVRSystem* const system, float near_z, float far_z);
+
+    //------------------------------------------------------------------------------
+    // Cached Constants
+public:
+
+    float near_z() const { return m_near_z; }
+    float far_z() const { return m_far_z; }
+
+    //------------------------------------------------------------------------------
+    // Change the clip planes. Queries the projections again. Throws if the clip
+    // planes are invalid.
+    void set_clip_planes(float near_z, float far_z);
+
+    //------------------------------------------------------------------------------
+    // Refresh the cached constants if the event affects them: VREvent_IpdChanged,
+    // VREvent_LensDistortionChanged and VREvent_PropertyChanged of the HMD's
+    // Prop_UserIpdMeters_Float. Returns true if they were refreshed.
+    bool handle_event(const vr::VREvent_t& event);
+
+    //------------------------------------------------------------------------------
+    // Query the eye-to-head transforms and projections again.
+    void refresh();
+
+    const simd_float4x4& eye_to_head(vr::EVREye eye) const { return m_eye_to_head[eye]; }
+    const simd_float4x4& projection(vr::EVREye eye) const { return m_projection[eye]; }
+
+    //------------------------------------------------------------------------------
+    // The union frustum's origin relative to the head.
+    const simd_float4x4& union_to_head() const { return m_union_to_head; }
+
+    //------------------------------------------------------------------------------
+    // The number of times the constants have been queried (including at
+    // construction).
+    size_t num_refreshes() const { return m_num_refreshes; }
+
+    //------------------------------------------------------------------------------
+    // Per-Frame Matrices
+public:
+
+    //------------------------------------------------------------------------------
+    // Compute the matrices for the given HMD pose (head to world, rigid).
+    void update(const simd_float4x4& head_to_world, Frame& frame) const;
+
+    //------------------------------------------------------------------------------
+    // Compute the matrices for the given HMD pose as returned by WaitGetPoses(). An
+    // invalid pose leaves the frame unchanged and returns false.
+    bool update(const vr::TrackedDevicePose_t& hmd_pose, Frame& frame) const;
+
+    //------------------------------------------------------------------------------
+    // Planes
+public:
+
+    //------------------------------------------------------------------------------
+    // Extract the planes of the frustum given by a view-projection matrix with
+    // clip space depth in [0, w]. The planes are in the view-projection's source
+    // space and have unit normals pointing inside (see Frame::union_planes).
+    static void extract_planes(const simd_float4x4& view_projection, simd_float4 planes[Plane_Count]);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    vr::IVRSystem* const    m_system;
+    float                   m_near_z;
+    float                   m_far_z;
+
+    simd_float4x4           m_eye_to_head[2];
+    simd_float4x4           m_head_to_eye[2];
+    simd_float4x4           m_projection[2];
+    simd_float4x4           m_inverse_projection[2];
+
+    simd_float4x4           m_union_to_head;
+    simd_float4x4           m_head_to_union;
+    simd_float4x4           m_union_projection;
+
+    size_t                  m_num_refreshes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __STEREO_CAMERA_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
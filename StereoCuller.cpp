@@ -0,0 +1,460 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StereoCuller.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__)
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t NUM_PLANES = StereoCamera::Plane_Count;
+
+    static_assert((StereoCuller::CHUNK_SIZE % 64) == 0, "!");
+
+    //------------------------------------------------------------------------------
+    // The planes in the order they are tested: union, left eye, right eye.
+    enum PlaneSet {
+        PlaneSet_Union = 0,
+        PlaneSet_Left,
+        PlaneSet_Right,
+
+        PlaneSet_Count
+    };
+
+    //------------------------------------------------------------------------------
+    // Scalar bounds. The plane distance is evaluated as (((a * x) + (b * y)) +
+    // (c * z)) + d, the same order the vector kernels use.
+    struct SphereBounds
+    {
+        typedef SphereArrays arrays_t;
+
+        SphereBounds(const SphereArrays& arrays, size_t index)
+            : x(arrays.center_x[index])
+            , y(arrays.center_y[index])
+            , z(arrays.center_z[index])
+            , negative_radius(-arrays.radius[index])
+        {
+        }
+
+        bool inside(const simd_float4& plane) const
+        {
+            return (((((plane[0] * x) + (plane[1] * y)) + (plane[2] * z)) + plane[3]) >= negative_radius);
+        }
+
+        float x, y, z, negative_radius;
+    };
+
+    //------------------------------------------------------------------------------
+    // Boxes are tested with the corner furthest along the plane normal, selected
+    // per axis as the larger of the two products.
+    struct BoxBounds
+    {
+        typedef BoxArrays arrays_t;
+
+        BoxBounds(const BoxArrays& arrays, size_t index)
+            : min_x(arrays.min_x[index])
+            , min_y(arrays.min_y[index])
+            , min_z(arrays.min_z[index])
+            , max_x(arrays.max_x[index])
+            , max_y(arrays.max_y[index])
+            , max_z(arrays.max_z[index])
+        {
+        }
+
+        bool inside(const simd_float4& plane) const
+        {
+            const float x = std::max((plane[0] * min_x), (plane[0] * max_x));
+            const float y = std::max((plane[1] * min_y), (plane[1] * max_y));
+            const float z = std::max((plane[2] * min_z), (plane[2] * max_z));
+
+            return ((((x + y) + z) + plane[3]) >= 0.0f);
+        }
+
+        float min_x, min_y, min_z, max_x, max_y, max_z;
+    };
+
+    template <typename Bounds>
+    bool inside_all(const Bounds& bounds, const simd_float4 planes[NUM_PLANES])
+    {
+        for (size_t p = 0; p < NUM_PLANES; ++p) {
+            if (not bounds.inside(planes[p])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    // Cull objects [first, last), 'first' being a multiple of 64. Writes all words
+    // touched by the range.
+    template <typename Bounds>
+    void cull_range_scalar(const simd_float4 planes[PlaneSet_Count][NUM_PLANES],
+                           const typename Bounds::arrays_t& arrays,
+                           size_t first,
+                           size_t last,
+                           uint64_t* const left,
+                           uint64_t* const right)
+    {
+        for (size_t word_first = first; word_first < last; word_first += 64) {
+            const size_t word_last = std::min((word_first + 64), last);
+            uint64_t left_bits = 0, right_bits = 0;
+
+            for (size_t i = word_first; i < word_last; ++i) {
+                const Bounds bounds(arrays, i);
+
+                if (inside_all(bounds, planes[PlaneSet_Union])) {
+                    left_bits |= (uint64_t(inside_all(bounds, planes[PlaneSet_Left])) << (i - word_first));
+                    right_bits |= (uint64_t(inside_all(bounds, planes[PlaneSet_Right])) << (i - word_first));
+                }
+            }
+
+            left[word_first / 64] = left_bits;
+            right[word_first / 64] = right_bits;
+        }
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+
+    //------------------------------------------------------------------------------
+    // Vector operations of the target instruction set.
+    struct Lanes
+    {
+#if defined(__AVX2__)
+        typedef __m256 vec_t;
+        typedef __m256 mask_t;
+
+        static constexpr size_t WIDTH = 8;
+
+        static vec_t load(const float* const p) { return _mm256_loadu_ps(p); }
+        static vec_t broadcast(float f) { return _mm256_set1_ps(f); }
+        static vec_t add(vec_t a, vec_t b) { return _mm256_add_ps(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return _mm256_mul_ps(a, b); }
+        static vec_t max(vec_t a, vec_t b) { return _mm256_max_ps(a, b); }
+        static vec_t negate(vec_t a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+        static mask_t greater_equal(vec_t a, vec_t b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static mask_t both(mask_t a, mask_t b) { return _mm256_and_ps(a, b); }
+        static uint64_t bits(mask_t m) { return uint64_t(_mm256_movemask_ps(m)); }
+#elif defined(__SSE2__)
+        typedef __m128 vec_t;
+        typedef __m128 mask_t;
+
+        static constexpr size_t WIDTH = 4;
+
+        static vec_t load(const float* const p) { return _mm_loadu_ps(p); }
+        static vec_t broadcast(float f) { return _mm_set1_ps(f); }
+        static vec_t add(vec_t a, vec_t b) { return _mm_add_ps(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return _mm_mul_ps(a, b); }
+        static vec_t max(vec_t a, vec_t b) { return _mm_max_ps(a, b); }
+        static vec_t negate(vec_t a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+        static mask_t greater_equal(vec_t a, vec_t b) { return _mm_cmpge_ps(a, b); }
+        static mask_t both(mask_t a, mask_t b) { return _mm_and_ps(a, b); }
+        static uint64_t bits(mask_t m) { return uint64_t(_mm_movemask_ps(m)); }
+#else
+        typedef float32x4_t vec_t;
+        typedef uint32x4_t mask_t;
+
+        static constexpr size_t WIDTH = 4;
+
+        static vec_t load(const float* const p) { return vld1q_f32(p); }
+        static vec_t broadcast(float f) { return vdupq_n_f32(f); }
+        static vec_t add(vec_t a, vec_t b) { return vaddq_f32(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return vmulq_f32(a, b); }
+        static vec_t max(vec_t a, vec_t b) { return vmaxq_f32(a, b); }
+        static vec_t negate(vec_t a) { return vnegq_f32(a); }
+        static mask_t greater_equal(vec_t a, vec_t b) { return vcgeq_f32(a, b); }
+        static mask_t both(mask_t a, mask_t b) { return vandq_u32(a, b); }
+
+        static uint64_t bits(mask_t m)
+        {
+            const uint32x4_t weights = { 1, 2, 4, 8 };
+            return uint64_t(vaddvq_u32(vandq_u32(m, weights)));
+        }
+#endif
+    };
+
+    static_assert((64 % Lanes::WIDTH) == 0, "!");
+
+    struct PlaneLanes
+    {
+        Lanes::vec_t    a, b, c, d;
+    };
+
+    struct SphereLanes
+    {
+        typedef SphereArrays arrays_t;
+
+        SphereLanes(const SphereArrays& arrays, size_t index)
+            : x(Lanes::load(arrays.center_x + index))
+            , y(Lanes::load(arrays.center_y + index))
+            , z(Lanes::load(arrays.center_z + index))
+            , negative_radius(Lanes::negate(Lanes::load(arrays.radius + index)))
+        {
+        }
+
+        Lanes::mask_t inside(const PlaneLanes& plane) const
+        {
+            const Lanes::vec_t distance = Lanes::add(Lanes::add(Lanes::add(Lanes::mul(plane.a, x), Lanes::mul(plane.b, y)), Lanes::mul(plane.c, z)), plane.d);
+            return Lanes::greater_equal(distance, negative_radius);
+        }
+
+        Lanes::vec_t x, y, z, negative_radius;
+    };
+
+    struct BoxLanes
+    {
+        typedef BoxArrays arrays_t;
+
+        BoxLanes(const BoxArrays& arrays, size_t index)
+            : min_x(Lanes::load(arrays.min_x + index))
+            , min_y(Lanes::load(arrays.min_y + index))
+            , min_z(Lanes::load(arrays.min_z + index))
+            , max_x(Lanes::load(arrays.max_x + index))
+            , max_y(Lanes::load(arrays.max_y + index))
+            , max_z(Lanes::load(arrays.max_z + index))
+        {
+        }
+
+        Lanes::mask_t inside(const PlaneLanes& plane) const
+        {
+            const Lanes::vec_t x = Lanes::max(Lanes::mul(plane.a, min_x), Lanes::mul(plane.a, max_x));
+            const Lanes::vec_t y = Lanes::max(Lanes::mul(plane.b, min_y), Lanes::mul(plane.b, max_y));
+            const Lanes::vec_t z = Lanes::max(Lanes::mul(plane.c, min_z), Lanes::mul(plane.c, max_z));
+
+            return Lanes::greater_equal(Lanes::add(Lanes::add(Lanes::add(x, y), z), plane.d), Lanes::broadcast(0.0f));
+        }
+
+        Lanes::vec_t min_x, min_y, min_z, max_x, max_y, max_z;
+    };
+
+    template <typename Bounds>
+    Lanes::mask_t inside_all(const Bounds& bounds, const PlaneLanes planes[NUM_PLANES], Lanes::mask_t mask)
+    {
+        for (size_t p = 0; p < NUM_PLANES; ++p) {
+            mask = Lanes::both(mask, bounds.inside(planes[p]));
+        }
+
+        return mask;
+    }
+
+    //------------------------------------------------------------------------------
+    // Cull the objects of words [first_word, last_word), all of which must be full.
+    template <typename Bounds>
+    void cull_words(const PlaneLanes planes[PlaneSet_Count][NUM_PLANES],
+                    const typename Bounds::arrays_t& arrays,
+                    size_t first_word,
+                    size_t last_word,
+                    uint64_t* const left,
+                    uint64_t* const right)
+    {
+        for (size_t word = first_word; word < last_word; ++word) {
+            uint64_t left_bits = 0, right_bits = 0;
+
+            for (size_t shift = 0; shift < 64; shift += Lanes::WIDTH) {
+                const Bounds bounds(arrays, ((word * 64) + shift));
+                const Lanes::mask_t in_union = inside_all(bounds, planes[PlaneSet_Union], bounds.inside(planes[PlaneSet_Union][0]));
+
+                if (Lanes::bits(in_union) == 0) {
+                    continue;
+                }
+
+                left_bits |= (Lanes::bits(inside_all(bounds, planes[PlaneSet_Left], in_union)) << shift);
+                right_bits |= (Lanes::bits(inside_all(bounds, planes[PlaneSet_Right], in_union)) << shift);
+            }
+
+            left[word] = left_bits;
+            right[word] = right_bits;
+        }
+    }
+
+#endif
+
+    //------------------------------------------------------------------------------
+    // Split the objects into chunks and cull them with the vector kernel (full
+    // words) and the scalar one (the final partial word).
+    template <typename ScalarBounds, typename VectorBounds>
+    void cull_chunks(const simd_float4 planes[PlaneSet_Count][NUM_PLANES],
+                     const typename ScalarBounds::arrays_t& arrays,
+                     size_t count,
+                     StereoVisibility& visibility,
+                     ThreadPool* const pool,
+                     bool use_vector_kernel)
+    {
+        const size_t num_words = ((count + 63) / 64);
+        const size_t num_full_words = (count / 64);
+        const size_t num_chunks = ((count + StereoCuller::CHUNK_SIZE - 1) / StereoCuller::CHUNK_SIZE);
+
+        visibility.count = count;
+        visibility.visible[vr::Eye_Left].resize(num_words);
+        visibility.visible[vr::Eye_Right].resize(num_words);
+
+        uint64_t* const left = visibility.visible[vr::Eye_Left].data();
+        uint64_t* const right = visibility.visible[vr::Eye_Right].data();
+
+#if defined(__AVX2__) || defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+        PlaneLanes plane_lanes[PlaneSet_Count][NUM_PLANES];
+
+        for (size_t s = 0; s < PlaneSet_Count; ++s) {
+            for (size_t p = 0; p < NUM_PLANES; ++p) {
+                plane_lanes[s][p].a = Lanes::broadcast(planes[s][p][0]);
+                plane_lanes[s][p].b = Lanes::broadcast(planes[s][p][1]);
+                plane_lanes[s][p].c = Lanes::broadcast(planes[s][p][2]);
+                plane_lanes[s][p].d = Lanes::broadcast(planes[s][p][3]);
+            }
+        }
+#endif
+
+        const auto cull_chunk = [&](size_t chunk) {
+            const size_t first = (chunk * StereoCuller::CHUNK_SIZE);
+            const size_t last = std::min((first + StereoCuller::CHUNK_SIZE), count);
+
+#if defined(__AVX2__) || defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+            if (use_vector_kernel) {
+                const size_t last_full_word = std::min((last / 64), num_full_words);
+
+                cull_words<VectorBounds>(plane_lanes, arrays, (first / 64), last_full_word, left, right);
+                cull_range_scalar<ScalarBounds>(planes, arrays, std::max(first, (last_full_word * 64)), last, left, right);
+                return;
+            }
+#else
+            (void)use_vector_kernel;
+#endif
+
+            cull_range_scalar<ScalarBounds>(planes, arrays, first, last, left, right);
+        };
+
+        if (pool && (num_chunks > 1)) {
+            pool->parallel_for(num_chunks, cull_chunk);
+        }
+        else {
+            for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+                cull_chunk(chunk);
+            }
+        }
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+    typedef SphereLanes SphereKernelBounds;
+    typedef BoxLanes BoxKernelBounds;
+#else
+    typedef SphereBounds SphereKernelBounds;
+    typedef BoxBounds BoxKernelBounds;
+#endif
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t
+StereoVisibility::num_visible(vr::EVREye eye) const
+{
+    size_t num_visible = 0;
+
+    for (const uint64_t word : visible[eye]) {
+        num_visible += size_t(__builtin_popcountll(word));
+    }
+
+    return num_visible;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StereoCuller::StereoCuller(const StereoCamera::Frame& frame)
+{
+    static_assert((PlaneSet_Left == (1 + vr::Eye_Left)) && (PlaneSet_Right == (1 + vr::Eye_Right)), "!");
+
+    std::copy(std::begin(frame.union_planes), std::end(frame.union_planes), m_planes[PlaneSet_Union]);
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        StereoCamera::extract_planes(frame.eyes[eye].view_projection, m_planes[1 + eye]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StereoCuller::cull(const SphereArrays& spheres, size_t count, StereoVisibility& visibility, ThreadPool* const pool) const
+{
+    cull_chunks<SphereBounds, SphereKernelBounds>(m_planes, spheres, count, visibility, pool, true);
+}
+
+void
+StereoCuller::cull(const BoxArrays& boxes, size_t count, StereoVisibility& visibility, ThreadPool* const pool) const
+{
+    cull_chunks<BoxBounds, BoxKernelBounds>(m_planes, boxes, count, visibility, pool, true);
+}
+
+void
+StereoCuller::cull_scalar(const SphereArrays& spheres, size_t count, StereoVisibility& visibility) const
+{
+    cull_chunks<SphereBounds, SphereKernelBounds>(m_planes, spheres, count, visibility, nullptr, false);
+}
+
+void
+StereoCuller::cull_scalar(const BoxArrays& boxes, size_t count, StereoVisibility& visibility) const
+{
+    cull_chunks<BoxBounds, BoxKernelBounds>(m_planes, boxes, count, visibility, nullptr, false);
+}
+
+const char*
+StereoCuller::kernel_name()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "NEON";
+#else
+    return "Scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
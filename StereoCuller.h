@@ -0,0 +1,161 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __STEREO_CULLER_H__
+#define __STEREO_CULLER_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "StereoCamera.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Bounding spheres as separate arrays (structure of arrays), world space.
+struct SphereArrays
+{
+    const float*    center_x = nullptr;
+    const float*    center_y = nullptr;
+    const float*    center_z = nullptr;
+    const float*    radius = nullptr;
+};
+
+//------------------------------------------------------------------------------
+// Axis aligned bounding boxes as separate arrays (structure of arrays), world
+// space.
+struct BoxArrays
+{
+    const float*    min_x = nullptr;
+    const float*    min_y = nullptr;
+    const float*    min_z = nullptr;
+    const float*    max_x = nullptr;
+    const float*    max_y = nullptr;
+    const float*    max_z = nullptr;
+};
+
+//------------------------------------------------------------------------------
+// Per-eye visibility of 'count' objects, one bit per object (bit i % 64 of word
+// i / 64). Bits past 'count' in the last word are zero.
+struct StereoVisibility
+{
+    size_t                  count = 0;
+    std::vector<uint64_t>   visible[2];
+
+    bool is_visible(vr::EVREye eye, size_t index) const { return ((visible[eye][index / 64] >> (index % 64)) & 1); }
+
+    size_t num_visible(vr::EVREye eye) const;
+};
+
+//------------------------------------------------------------------------------
+// Frustum culling for both eyes in a single pass.
+//
+// The planes of both eye frusta and of the union frustum are taken from a
+// StereoCamera::Frame. Each object's bounds are loaded once and tested against
+// the union frustum first; groups of objects entirely outside of it skip the
+// per-eye tests. An object is visible to an eye if it intersects (or is not
+// separated by a single plane from) both the union and that eye's frustum, so
+// results are conservative like any plane based test.
+//
+// Large arrays can be culled on a thread pool. Work is split into chunks of
+// CHUNK_SIZE objects, each writing its own words of the result so the result
+// does not depend on the number of threads.
+//------------------------------------------------------------------------------
+
+class StereoCuller
+{
+    //------------------------------------------------------------------------------
+    // Constants
+public:
+
+    //------------------------------------------------------------------------------
+    // The number of objects per parallel task (a multiple of 64).
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    explicit StereoCuller(const StereoCamera::Frame& frame);
+
+    //------------------------------------------------------------------------------
+    // Culling
+public:
+
+    //------------------------------------------------------------------------------
+    // Cull 'count' spheres or boxes and write the results to 'visibility', which is
+    // resized as needed. A sphere with a negative radius is never visible.
+    //
+    // Uses AVX2, SSE2 or NEON depending on the instruction set the file is compiled
+    // for and falls back to cull_scalar() otherwise.
+    void cull(const SphereArrays& spheres, size_t count, StereoVisibility& visibility, ThreadPool* const pool = nullptr) const;
+    void cull(const BoxArrays& boxes, size_t count, StereoVisibility& visibility, ThreadPool* const pool = nullptr) const;
+
+    //------------------------------------------------------------------------------
+    // Scalar implementations of cull(). They evaluate the plane equations in the
+    // same order and produce the same results; mainly useful as a reference.
+    void cull_scalar(const SphereArrays& spheres, size_t count, StereoVisibility& visibility) const;
+    void cull_scalar(const BoxArrays& boxes, size_t count, StereoVisibility& visibility) const;
+
+    //------------------------------------------------------------------------------
+    // The name of the kernel used by cull() ("AVX2", "SSE2", "NEON" or "Scalar").
+    static const char* kernel_name();
+
+    //------------------------------------------------------------------------------
+    // Planes
+public:
+
+    const simd_float4* union_planes() const { return m_planes[0]; }
+    const simd_float4* eye_planes(vr::EVREye eye) const { return m_planes[1 + eye]; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    simd_float4     m_planes[3][StereoCamera::Plane_Count];     // Union, left eye, right eye
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __STEREO_CULLER_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
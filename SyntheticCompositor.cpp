@@ -0,0 +1,142 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SyntheticCompositor.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    void fill_poses(vr::TrackedDevicePose_t* const poses, uint32_t count)
+    {
+        if (not poses) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            vr::TrackedDevicePose_t& pose = poses[i];
+            std::memset(&pose, 0, sizeof(pose));
+
+            if (i == vr::k_unTrackedDeviceIndex_Hmd) {
+                pose.mDeviceToAbsoluteTracking.m[0][0] = 1.0f;
+                pose.mDeviceToAbsoluteTracking.m[1][1] = 1.0f;
+                pose.mDeviceToAbsoluteTracking.m[2][2] = 1.0f;
+                pose.eTrackingResult = vr::TrackingResult_Running_OK;
+                pose.bPoseIsValid = true;
+                pose.bDeviceIsConnected = true;
+            }
+            else {
+                pose.eTrackingResult = vr::TrackingResult_Uninitialized;
+            }
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::EVRCompositorError
+SyntheticCompositor::WaitGetPoses(vr::TrackedDevicePose_t* const render_poses,
+                                  uint32_t num_render_poses,
+                                  vr::TrackedDevicePose_t* const game_poses,
+                                  uint32_t num_game_poses)
+{
+    fill_poses(render_poses, num_render_poses);
+    fill_poses(game_poses, num_game_poses);
+
+    ++m_frame_index;
+    m_submitted_eyes = 0;
+
+    return vr::VRCompositorError_None;
+}
+
+vr::EVRCompositorError
+SyntheticCompositor::Submit(vr::EVREye eye, const vr::Texture_t* const texture, const vr::VRTextureBounds_t* const, vr::EVRSubmitFlags)
+{
+    ++m_num_submits;
+
+    if (not texture) {
+        return vr::VRCompositorError_InvalidTexture;
+    }
+
+    const uint32_t eye_bit = (1u << uint32_t(eye));
+
+    if (m_submitted_eyes & eye_bit) {
+        return vr::VRCompositorError_AlreadySubmitted;
+    }
+
+    m_submitted_eyes |= eye_bit;
+
+    if ((m_submit_error_interval != 0) && ((m_num_submits % m_submit_error_interval) == 0)) {
+        return m_submit_error;
+    }
+
+    return vr::VRCompositorError_None;
+}
+
+bool
+SyntheticCompositor::GetFrameTiming(vr::Compositor_FrameTiming* const timing, uint32_t frames_ago)
+{
+    if ((not timing) || (timing->m_nSize != sizeof(vr::Compositor_FrameTiming)) || (frames_ago >= m_frame_index)) {
+        return false;
+    }
+
+    const uint32_t frame_index = uint32_t(m_frame_index - frames_ago);
+    const float jitter = (float(frame_index % 7) * 0.25f);
+
+    std::memset(timing, 0, sizeof(*timing));
+
+    timing->m_nSize = sizeof(vr::Compositor_FrameTiming);
+    timing->m_nFrameIndex = frame_index;
+    timing->m_nNumFramePresents = 1;
+    timing->m_nNumMisPresented = (((frame_index % 250) == 0) ? 1 : 0);
+    timing->m_nNumDroppedFrames = (((frame_index % 100) == 0) ? 1 : 0);
+    timing->m_nReprojectionFlags = (((frame_index % 100) == 0) ? 1 : 0);
+
+    timing->m_flPreSubmitGpuMs = (4.0f + jitter);
+    timing->m_flPostSubmitGpuMs = 0.5f;
+    timing->m_flTotalRenderGpuMs = (4.5f + jitter);
+    timing->m_flCompositorRenderGpuMs = 0.8f;
+    timing->m_flCompositorRenderCpuMs = 0.3f;
+    timing->m_flCompositorIdleCpuMs = 9.0f;
+    timing->m_flClientFrameIntervalMs = (11.1f + (((frame_index % 100) == 0) ? 11.1f : 0.0f));
+    timing->m_flPresentCallCpuMs = 0.1f;
+    timing->m_flWaitForPresentCpuMs = 0.2f;
+    timing->m_flSubmitFrameMs = (0.2f + (jitter * 0.1f));
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
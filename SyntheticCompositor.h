@@ -0,0 +1,110 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SYNTHETIC_COMPOSITOR_H__
+#define __SYNTHETIC_COMPOSITOR_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Local stand-in for the frame loop part of vr::IVRCompositor, for running and
+// measuring InstrumentedCompositor without a runtime. It is not derived from
+// vr::IVRCompositor (which has many more methods) but has the same signatures
+// for WaitGetPoses(), Submit(), PostPresentHandoff() and GetFrameTiming().
+//
+// WaitGetPoses() returns immediately with the HMD at the origin and starts a
+// new frame. Submit() fails with VRCompositorError_InvalidTexture for a null
+// texture, VRCompositorError_AlreadySubmitted for a second submit of an eye in
+// the same frame, and otherwise with the configured error every n-th call.
+// Frame timings are a deterministic function of the frame index.
+//------------------------------------------------------------------------------
+
+class SyntheticCompositor
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    SyntheticCompositor() = default;
+
+    //------------------------------------------------------------------------------
+    // Fail every 'interval'th Submit() call (0 for never) with the given error.
+    void inject_submit_error(vr::EVRCompositorError error, uint32_t interval)
+    {
+        m_submit_error = error;
+        m_submit_error_interval = interval;
+    }
+
+    uint64_t frame_index() const { return m_frame_index; }
+
+    //------------------------------------------------------------------------------
+    // Compositor
+public:
+
+    vr::EVRCompositorError WaitGetPoses(vr::TrackedDevicePose_t* const render_poses,
+                                        uint32_t num_render_poses,
+                                        vr::TrackedDevicePose_t* const game_poses,
+                                        uint32_t num_game_poses);
+
+    vr::EVRCompositorError Submit(vr::EVREye eye,
+                                  const vr::Texture_t* const texture,
+                                  const vr::VRTextureBounds_t* const bounds = nullptr,
+                                  vr::EVRSubmitFlags flags = vr::Submit_Default);
+
+    void PostPresentHandoff() { ++m_num_handoffs; }
+
+    //------------------------------------------------------------------------------
+    // Fails for frames that have not started yet and if the size field is not
+    // sizeof(vr::Compositor_FrameTiming).
+    bool GetFrameTiming(vr::Compositor_FrameTiming* const timing, uint32_t frames_ago = 0);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    uint64_t                    m_frame_index = 0;
+    uint64_t                    m_num_submits = 0;
+    uint64_t                    m_num_handoffs = 0;
+    uint32_t                    m_submitted_eyes = 0;
+    vr::EVRCompositorError      m_submit_error = vr::VRCompositorError_None;
+    uint32_t                    m_submit_error_interval = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __SYNTHETIC_COMPOSITOR_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,545 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SyntheticVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Fill in the right eye as the mirror image of the left eye.
+    SyntheticHMDProfile mirrored(SyntheticHMDProfile profile)
+    {
+        profile.projection_raw[vr::Eye_Right][0] = -profile.projection_raw[vr::Eye_Left][1];
+        profile.projection_raw[vr::Eye_Right][1] = -profile.projection_raw[vr::Eye_Left][0];
+        profile.projection_raw[vr::Eye_Right][2] = profile.projection_raw[vr::Eye_Left][2];
+        profile.projection_raw[vr::Eye_Right][3] = profile.projection_raw[vr::Eye_Left][3];
+
+        profile.lens_center[vr::Eye_Right][0] = (1.0f - profile.lens_center[vr::Eye_Left][0]);
+        profile.lens_center[vr::Eye_Right][1] = profile.lens_center[vr::Eye_Left][1];
+
+        return profile;
+    }
+
+    std::vector<SyntheticHMDProfile> make_builtin_profiles()
+    {
+        std::vector<SyntheticHMDProfile> profiles;
+
+        {
+            SyntheticHMDProfile p;
+            p.name = "vive-like";
+            p.model_number = "Synthetic Vive-like";
+            p.serial_number = "SYN-0001";
+            p.render_target_width = 1512;
+            p.render_target_height = 1680;
+            p.display_frequency = 90.0f;
+            p.projection_raw[vr::Eye_Left][0] = -1.396f;
+            p.projection_raw[vr::Eye_Left][1] = 1.245f;
+            p.projection_raw[vr::Eye_Left][2] = -1.473f;
+            p.projection_raw[vr::Eye_Left][3] = 1.461f;
+            p.lens_center[vr::Eye_Left][0] = 0.54f;
+            p.lens_center[vr::Eye_Left][1] = 0.5f;
+            p.k1 = 0.22f;
+            p.k2 = 0.24f;
+            p.red_scale = 0.990f;
+            p.blue_scale = 1.014f;
+            p.visible_radius_u = 0.56f;
+            p.visible_radius_v = 0.52f;
+            p.num_hidden_area_segments = 64;
+            profiles.push_back(mirrored(p));
+        }
+
+        {
+            SyntheticHMDProfile p;
+            p.name = "index-like";
+            p.model_number = "Synthetic Index-like";
+            p.serial_number = "SYN-0002";
+            p.render_target_width = 2016;
+            p.render_target_height = 2240;
+            p.display_frequency = 120.0f;
+            p.projection_raw[vr::Eye_Left][0] = -1.254f;
+            p.projection_raw[vr::Eye_Left][1] = 1.204f;
+            p.projection_raw[vr::Eye_Left][2] = -1.265f;
+            p.projection_raw[vr::Eye_Left][3] = 1.250f;
+            p.lens_center[vr::Eye_Left][0] = 0.52f;
+            p.lens_center[vr::Eye_Left][1] = 0.5f;
+            p.k1 = 0.18f;
+            p.k2 = 0.12f;
+            p.red_scale = 0.994f;
+            p.blue_scale = 1.009f;
+            p.visible_radius_u = 0.60f;
+            p.visible_radius_v = 0.58f;
+            p.num_hidden_area_segments = 96;
+            profiles.push_back(mirrored(p));
+        }
+
+        {
+            SyntheticHMDProfile p;
+            p.name = "rift-like";
+            p.model_number = "Synthetic Rift-like";
+            p.serial_number = "SYN-0003";
+            p.render_target_width = 1344;
+            p.render_target_height = 1600;
+            p.display_frequency = 90.0f;
+            p.projection_raw[vr::Eye_Left][0] = -1.190f;
+            p.projection_raw[vr::Eye_Left][1] = 1.090f;
+            p.projection_raw[vr::Eye_Left][2] = -1.330f;
+            p.projection_raw[vr::Eye_Left][3] = 1.330f;
+            p.lens_center[vr::Eye_Left][0] = 0.54f;
+            p.lens_center[vr::Eye_Left][1] = 0.5f;
+            p.k1 = 0.25f;
+            p.k2 = 0.30f;
+            p.red_scale = 0.988f;
+            p.blue_scale = 1.016f;
+            p.visible_radius_u = 0.53f;
+            p.visible_radius_v = 0.50f;
+            p.num_hidden_area_segments = 48;
+            profiles.push_back(mirrored(p));
+        }
+
+        {
+            SyntheticHMDProfile p;
+            p.name = "wide-fov";
+            p.model_number = "Synthetic Wide FOV";
+            p.serial_number = "SYN-0004";
+            p.render_target_width = 2880;
+            p.render_target_height = 2160;
+            p.display_frequency = 72.0f;
+            p.projection_raw[vr::Eye_Left][0] = -2.000f;
+            p.projection_raw[vr::Eye_Left][1] = 1.600f;
+            p.projection_raw[vr::Eye_Left][2] = -1.500f;
+            p.projection_raw[vr::Eye_Left][3] = 1.500f;
+            p.lens_center[vr::Eye_Left][0] = 0.55f;
+            p.lens_center[vr::Eye_Left][1] = 0.5f;
+            p.k1 = 0.32f;
+            p.k2 = 0.20f;
+            p.red_scale = 0.985f;
+            p.blue_scale = 1.020f;
+            p.visible_radius_u = 0.72f;
+            p.visible_radius_v = 0.66f;
+            p.num_hidden_area_segments = 128;
+            profiles.push_back(mirrored(p));
+        }
+
+        return profiles;
+    }
+
+    //------------------------------------------------------------------------------
+    // Outline of the visible area as pairs of points on rays from the lens center:
+    // the (clipped) ellipse point and the point where the ray leaves the frame.
+    // Rays through the four frame corners are included so that consecutive frame
+    // points always lie on the same edge of the frame.
+    struct Ray
+    {
+        double      angle;
+        double      inner[2];
+        double      outer[2];
+    };
+
+    std::vector<Ray> make_rays(const SyntheticHMDProfile& profile, vr::EVREye eye)
+    {
+        const double cx = double(profile.lens_center[eye][0]);
+        const double cy = double(profile.lens_center[eye][1]);
+        const double ru = double(profile.visible_radius_u);
+        const double rv = double(profile.visible_radius_v);
+
+        std::vector<double> angles;
+
+        for (uint32_t i = 0; i < profile.num_hidden_area_segments; ++i) {
+            angles.push_back((2.0 * M_PI * double(i)) / double(profile.num_hidden_area_segments));
+        }
+
+        for (const double corner_u : { 0.0, 1.0 }) {
+            for (const double corner_v : { 0.0, 1.0 }) {
+                const double angle = std::atan2(((corner_v - cy) / rv), ((corner_u - cx) / ru));
+                angles.push_back((angle < 0.0) ? (angle + (2.0 * M_PI)) : angle);
+            }
+        }
+
+        std::sort(angles.begin(), angles.end());
+        angles.erase(std::unique(angles.begin(), angles.end(), [](double a, double b) { return ((b - a) < 1.0e-9); }), angles.end());
+
+        std::vector<Ray> rays;
+        rays.reserve(angles.size());
+
+        for (const double angle : angles) {
+            const double du = (ru * std::cos(angle));
+            const double dv = (rv * std::sin(angle));
+
+            double t = std::numeric_limits<double>::infinity();
+
+            if (du > 0.0) {
+                t = std::min(t, ((1.0 - cx) / du));
+            }
+
+            if (du < 0.0) {
+                t = std::min(t, (-cx / du));
+            }
+
+            if (dv > 0.0) {
+                t = std::min(t, ((1.0 - cy) / dv));
+            }
+
+            if (dv < 0.0) {
+                t = std::min(t, (-cy / dv));
+            }
+
+            const double s = std::min(1.0, t);
+
+            rays.push_back({ angle, { (cx + (du * s)), (cy + (dv * s)) }, { (cx + (du * t)), (cy + (dv * t)) } });
+        }
+
+        return rays;
+    }
+
+    void add_triangle(std::vector<vr::HmdVector2_t>& vertices, const double a[2], const double b[2], const double c[2])
+    {
+        const double area = (((b[0] - a[0]) * (c[1] - a[1])) - ((b[1] - a[1]) * (c[0] - a[0])));
+
+        if (std::fabs(area) < 1.0e-12) {
+            return;
+        }
+
+        for (const double* p : { a, b, c }) {
+            vertices.push_back({ { float(p[0]), float(p[1]) } });
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<SyntheticHMDProfile>&
+SyntheticVRSystem::builtin_profiles()
+{
+    static const std::vector<SyntheticHMDProfile> profiles = make_builtin_profiles();
+    return profiles;
+}
+
+const SyntheticHMDProfile*
+SyntheticVRSystem::find_builtin_profile(const std::string& name)
+{
+    for (const SyntheticHMDProfile& profile : builtin_profiles()) {
+        if (profile.name == name) {
+            return &profile;
+        }
+    }
+
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SyntheticVRSystem::SyntheticVRSystem(const SyntheticHMDProfile& profile)
+    : m_profile(profile)
+{
+    if ((m_profile.render_target_width == 0) || (m_profile.render_target_height == 0)) {
+        throw std::runtime_error("Invalid render target size!");
+    }
+
+    if (m_profile.num_hidden_area_segments < 3) {
+        throw std::runtime_error("Invalid number of hidden area segments!");
+    }
+
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        const std::vector<Ray> rays = make_rays(m_profile, eye);
+        const double center[2] = { double(m_profile.lens_center[eye][0]), double(m_profile.lens_center[eye][1]) };
+
+        std::vector<vr::HmdVector2_t>& standard = m_hidden_area_meshes[eye][vr::k_eHiddenAreaMesh_Standard];
+        std::vector<vr::HmdVector2_t>& inverse = m_hidden_area_meshes[eye][vr::k_eHiddenAreaMesh_Inverse];
+        std::vector<vr::HmdVector2_t>& line_loop = m_hidden_area_meshes[eye][vr::k_eHiddenAreaMesh_LineLoop];
+
+        for (size_t i = 0; i < rays.size(); ++i) {
+            const Ray& a = rays[i];
+            const Ray& b = rays[(i + 1) % rays.size()];
+
+            add_triangle(standard, a.inner, a.outer, b.outer);
+            add_triangle(standard, a.inner, b.outer, b.inner);
+            add_triangle(inverse, center, a.inner, b.inner);
+
+            line_loop.push_back({ { float(a.inner[0]), float(a.inner[1]) } });
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticVRSystem::GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight)
+{
+    if (pnWidth) {
+        *pnWidth = m_profile.render_target_width;
+    }
+
+    if (pnHeight) {
+        *pnHeight = m_profile.render_target_height;
+    }
+}
+
+vr::HmdMatrix44_t
+SyntheticVRSystem::GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ)
+{
+    //------------------------------------------------------------------------------
+    // Same composition of the raw projection as the runtime (depth in [0, 1]).
+    float left, right, top, bottom;
+    GetProjectionRaw(eEye, &left, &right, &top, &bottom);
+
+    const float idx = (1.0f / (right - left));
+    const float idy = (1.0f / (bottom - top));
+    const float idz = (1.0f / (fFarZ - fNearZ));
+
+    vr::HmdMatrix44_t m = {};
+    m.m[0][0] = (2.0f * idx);
+    m.m[0][2] = ((right + left) * idx);
+    m.m[1][1] = (2.0f * idy);
+    m.m[1][2] = ((bottom + top) * idy);
+    m.m[2][2] = (-fFarZ * idz);
+    m.m[2][3] = (-fFarZ * fNearZ * idz);
+    m.m[3][2] = -1.0f;
+
+    return m;
+}
+
+void
+SyntheticVRSystem::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom)
+{
+    if (pfLeft) {
+        *pfLeft = m_profile.projection_raw[eEye][0];
+    }
+
+    if (pfRight) {
+        *pfRight = m_profile.projection_raw[eEye][1];
+    }
+
+    if (pfTop) {
+        *pfTop = m_profile.projection_raw[eEye][2];
+    }
+
+    if (pfBottom) {
+        *pfBottom = m_profile.projection_raw[eEye][3];
+    }
+}
+
+bool
+SyntheticVRSystem::ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates)
+{
+    if (not pDistortionCoordinates) {
+        return false;
+    }
+
+    const float cu = m_profile.lens_center[eEye][0];
+    const float cv = m_profile.lens_center[eEye][1];
+    const float du = (fU - cu);
+    const float dv = (fV - cv);
+    const float r2 = ((du * du) + (dv * dv));
+    const float s = (1.0f + (r2 * (m_profile.k1 + (r2 * m_profile.k2))));
+
+    const float sr = (s * m_profile.red_scale);
+    const float sb = (s * m_profile.blue_scale);
+
+    pDistortionCoordinates->rfRed[0] = (cu + (du * sr));
+    pDistortionCoordinates->rfRed[1] = (cv + (dv * sr));
+    pDistortionCoordinates->rfGreen[0] = (cu + (du * s));
+    pDistortionCoordinates->rfGreen[1] = (cv + (dv * s));
+    pDistortionCoordinates->rfBlue[0] = (cu + (du * sb));
+    pDistortionCoordinates->rfBlue[1] = (cv + (dv * sb));
+
+    return true;
+}
+
+vr::HmdMatrix34_t
+SyntheticVRSystem::GetEyeToHeadTransform(vr::EVREye eEye)
+{
+    vr::HmdMatrix34_t m = identity34();
+    m.m[0][3] = (((eEye == vr::Eye_Left) ? -0.5f : 0.5f) * m_profile.ipd);
+    return m;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticVRSystem::GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                                   float fPredictedSecondsToPhotonsFromNow,
+                                                   vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                                   uint32_t unTrackedDevicePoseArrayCount)
+{
+    NullVRSystem::GetDeviceToAbsoluteTrackingPose(eOrigin, fPredictedSecondsToPhotonsFromNow, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+
+    //------------------------------------------------------------------------------
+    // The HMD rests at eye height looking down -Z.
+    if (unTrackedDevicePoseArrayCount > vr::k_unTrackedDeviceIndex_Hmd) {
+        vr::TrackedDevicePose_t& pose = pTrackedDevicePoseArray[vr::k_unTrackedDeviceIndex_Hmd];
+        pose.mDeviceToAbsoluteTracking.m[1][3] = ((eOrigin == vr::TrackingUniverseSeated) ? 0.0f : 1.7f);
+        pose.eTrackingResult = vr::TrackingResult_Running_OK;
+        pose.bPoseIsValid = true;
+        pose.bDeviceIsConnected = true;
+    }
+}
+
+vr::ETrackedDeviceClass
+SyntheticVRSystem::GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    return ((unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd) ? vr::TrackedDeviceClass_HMD : vr::TrackedDeviceClass_Invalid);
+}
+
+bool
+SyntheticVRSystem::IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    return (unDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd);
+}
+
+vr::EDeviceActivityLevel
+SyntheticVRSystem::GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId)
+{
+    return ((unDeviceId == vr::k_unTrackedDeviceIndex_Hmd) ? vr::k_EDeviceActivityLevel_UserInteraction : vr::k_EDeviceActivityLevel_Unknown);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+SyntheticVRSystem::GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+        return fail(pError, false, vr::TrackedProp_InvalidDevice);
+    }
+
+    switch (prop) {
+        case vr::Prop_DeviceIsWireless_Bool: return succeed(pError, false);
+        case vr::Prop_DeviceIsCharging_Bool: return succeed(pError, false);
+        default: return fail(pError, false);
+    }
+}
+
+float
+SyntheticVRSystem::GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+        return fail(pError, 0.0f, vr::TrackedProp_InvalidDevice);
+    }
+
+    switch (prop) {
+        case vr::Prop_DisplayFrequency_Float: return succeed(pError, m_profile.display_frequency);
+        case vr::Prop_SecondsFromVsyncToPhotons_Float: return succeed(pError, m_profile.seconds_from_vsync_to_photons);
+        case vr::Prop_UserIpdMeters_Float: return succeed(pError, m_profile.ipd);
+        default: return fail(pError, 0.0f);
+    }
+}
+
+int32_t
+SyntheticVRSystem::GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+        return fail(pError, int32_t(0), vr::TrackedProp_InvalidDevice);
+    }
+
+    switch (prop) {
+        case vr::Prop_DeviceClass_Int32: return succeed(pError, int32_t(vr::TrackedDeviceClass_HMD));
+        default: return fail(pError, int32_t(0));
+    }
+}
+
+uint32_t
+SyntheticVRSystem::GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                                  vr::ETrackedDeviceProperty prop,
+                                                  char* pchValue,
+                                                  uint32_t unBufferSize,
+                                                  vr::ETrackedPropertyError* pError)
+{
+    if (pchValue && (unBufferSize > 0)) {
+        pchValue[0] = '\0';
+    }
+
+    if (unDeviceIndex != vr::k_unTrackedDeviceIndex_Hmd) {
+        return fail(pError, uint32_t(0), vr::TrackedProp_InvalidDevice);
+    }
+
+    const std::string* const value = string_property(prop);
+
+    if (not value) {
+        return fail(pError, uint32_t(0));
+    }
+
+    //------------------------------------------------------------------------------
+    // Like the runtime: return the required size including the terminator and fail
+    // without copying if the buffer is too small.
+    const uint32_t size = uint32_t(value->size() + 1);
+
+    if ((pchValue == nullptr) || (unBufferSize < size)) {
+        return fail(pError, size, vr::TrackedProp_BufferTooSmall);
+    }
+
+    std::memcpy(pchValue, value->c_str(), size);
+    return succeed(pError, size);
+}
+
+const std::string*
+SyntheticVRSystem::string_property(vr::ETrackedDeviceProperty prop) const
+{
+    switch (prop) {
+        case vr::Prop_TrackingSystemName_String: return &m_profile.tracking_system_name;
+        case vr::Prop_ModelNumber_String: return &m_profile.model_number;
+        case vr::Prop_SerialNumber_String: return &m_profile.serial_number;
+        case vr::Prop_ManufacturerName_String: return &m_profile.manufacturer_name;
+        case vr::Prop_DriverVersion_String: return &m_profile.driver_version;
+        default: return nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::HiddenAreaMesh_t
+SyntheticVRSystem::GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type)
+{
+    if ((type < 0) || (type >= vr::k_eHiddenAreaMesh_Max)) {
+        return { nullptr, 0 };
+    }
+
+    const std::vector<vr::HmdVector2_t>& vertices = m_hidden_area_meshes[eEye][type];
+    const uint32_t count = uint32_t((type == vr::k_eHiddenAreaMesh_LineLoop) ? vertices.size() : (vertices.size() / 3));
+
+    return { (vertices.empty() ? nullptr : vertices.data()), count };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
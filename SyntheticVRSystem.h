@@ -0,0 +1,180 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SYNTHETIC_VR_SYSTEM_H__
+#define __SYNTHETIC_VR_SYSTEM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "NullVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Description of a synthetic headset. All UV quantities are in [0, 1] per eye
+// with the origin at the top left, like OpenVR's. Values for the right eye are
+// given explicitly; the built-in profiles mirror the left eye.
+//------------------------------------------------------------------------------
+
+struct SyntheticHMDProfile
+{
+    std::string     name;
+
+    //------------------------------------------------------------------------------
+    // Device strings.
+    std::string     tracking_system_name = "synthetic";
+    std::string     model_number;
+    std::string     manufacturer_name = "OpenVRMetal";
+    std::string     serial_number = "SYN-0000";
+    std::string     driver_version = "1.0";
+
+    //------------------------------------------------------------------------------
+    // Display.
+    uint32_t        render_target_width = 0;
+    uint32_t        render_target_height = 0;
+    float           display_frequency = 90.0f;
+    float           seconds_from_vsync_to_photons = 0.011f;
+    float           ipd = 0.063f;                           // Meters
+
+    //------------------------------------------------------------------------------
+    // Raw projection as tangents of the half angles (left, right, top, bottom),
+    // see IVRSystem::GetProjectionRaw().
+    float           projection_raw[2][4] = {};
+
+    //------------------------------------------------------------------------------
+    // Analytic radial distortion around the lens center: the green channel of a
+    // UV at distance r from the center is scaled by (1 + k1 * r^2 + k2 * r^4),
+    // red and blue additionally by their chromatic scale.
+    float           lens_center[2][2] = { { 0.5f, 0.5f }, { 0.5f, 0.5f } };
+    float           k1 = 0.0f;
+    float           k2 = 0.0f;
+    float           red_scale = 1.0f;
+    float           blue_scale = 1.0f;
+
+    //------------------------------------------------------------------------------
+    // Hidden area: everything outside an ellipse with the given radii around the
+    // lens center, approximated by the given number of segments. Radii reaching
+    // past the edge of the frame are clipped to it.
+    float           visible_radius_u = 0.5f;
+    float           visible_radius_v = 0.5f;
+    uint32_t        num_hidden_area_segments = 64;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// A stand-in IVRSystem presenting a single connected HMD (device 0) described
+// by a SyntheticHMDProfile. Provides the render target size, projections, eye
+// transforms, distortion, hidden area meshes of all three types, and the
+// profile's device strings and display properties. Everything else behaves
+// like NullVRSystem. The profile is fixed at construction so all methods are
+// safe to call concurrently.
+//------------------------------------------------------------------------------
+
+class SyntheticVRSystem : public NullVRSystem
+{
+    //------------------------------------------------------------------------------
+    // Built-in Profiles
+public:
+
+    //------------------------------------------------------------------------------
+    // A few profiles loosely modeled after common headsets (resolution, field of
+    // view, lens shape) plus a wide field of view one whose visible area is
+    // clipped by the frame. They are plausible, not measured.
+    static const std::vector<SyntheticHMDProfile>& builtin_profiles();
+
+    //------------------------------------------------------------------------------
+    // The built-in profile with the given name, nullptr if there is none.
+    static const SyntheticHMDProfile* find_builtin_profile(const std::string& name);
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Throws if the render target size is zero or the hidden area has less than
+    // three segments.
+    explicit SyntheticVRSystem(const SyntheticHMDProfile& profile);
+
+    const SyntheticHMDProfile& profile() const { return m_profile; }
+
+    //------------------------------------------------------------------------------
+    // vr::IVRSystem
+public:
+
+    void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override;
+    vr::HmdMatrix44_t GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ) override;
+    void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override;
+    bool ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) override;
+    vr::HmdMatrix34_t GetEyeToHeadTransform(vr::EVREye eEye) override;
+
+    void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                         float fPredictedSecondsToPhotonsFromNow,
+                                         vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                         uint32_t unTrackedDevicePoseArrayCount) override;
+
+    vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) override;
+
+    bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                            vr::ETrackedDeviceProperty prop,
+                                            char* pchValue,
+                                            uint32_t unBufferSize,
+                                            vr::ETrackedPropertyError* pError) override;
+
+    vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type) override;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    const std::string* string_property(vr::ETrackedDeviceProperty prop) const;
+
+    SyntheticHMDProfile                 m_profile;
+    std::vector<vr::HmdVector2_t>       m_hidden_area_meshes[2][vr::k_eHiddenAreaMesh_Max];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __SYNTHETIC_VR_SYSTEM_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
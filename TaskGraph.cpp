@@ -0,0 +1,354 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TaskGraph.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TaskGraph::TaskGraph()
+    : m_pool(nullptr)
+    , m_is_started(false)
+    , m_num_remaining(0)
+    , m_elapsed_seconds(0.0)
+    , m_is_complete(false)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+    //------------------------------------------------------------------------------
+    // Running tasks reference the graph.
+    if (m_is_started) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_complete.wait(lock, [this]() { return m_is_complete; });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TaskGraph::task_t
+TaskGraph::add(const std::string& name, function_t function, const std::vector<task_t>& dependencies)
+{
+    if (m_is_started) {
+        throw std::runtime_error("Invalid task added to a started graph!");
+    }
+
+    if (not function) {
+        throw std::runtime_error("Invalid task function!");
+    }
+
+    const task_t task = task_t(m_tasks.size());
+
+    for (const task_t dependency : dependencies) {
+        if (dependency >= task) {
+            throw std::runtime_error("Invalid task dependency!");
+        }
+    }
+
+    std::unique_ptr<Task> new_task = std::make_unique<Task>();
+
+    new_task->name = name;
+    new_task->function = std::move(function);
+    new_task->dependencies = dependencies;
+
+    //------------------------------------------------------------------------------
+    // Ignore duplicate dependencies.
+    std::sort(new_task->dependencies.begin(), new_task->dependencies.end());
+    new_task->dependencies.erase(std::unique(new_task->dependencies.begin(), new_task->dependencies.end()), new_task->dependencies.end());
+
+    new_task->num_remaining_dependencies = new_task->dependencies.size();
+    new_task->future = new_task->promise.get_future().share();
+
+    for (const task_t dependency : new_task->dependencies) {
+        m_tasks[dependency]->dependents.push_back(task);
+    }
+
+    m_tasks.push_back(std::move(new_task));
+
+    return task;
+}
+
+const std::string&
+TaskGraph::name(task_t task) const
+{
+    return m_tasks.at(task)->name;
+}
+
+const std::vector<TaskGraph::task_t>&
+TaskGraph::dependencies(task_t task) const
+{
+    return m_tasks.at(task)->dependencies;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+TaskGraph::start(ThreadPool& pool, completion_t completion)
+{
+    if (m_is_started) {
+        throw std::runtime_error("Invalid start of a started graph!");
+    }
+
+    m_pool = &pool;
+    m_completion = std::move(completion);
+    m_num_remaining = m_tasks.size();
+    m_start_time = clock_t::now();
+    m_is_started = true;
+
+    if (m_tasks.empty()) {
+        complete();
+        return;
+    }
+
+    //------------------------------------------------------------------------------
+    // Collect the roots first, tasks may complete (and submit their dependents)
+    // while submitting.
+    std::vector<task_t> roots;
+
+    for (task_t task = 0; task < task_t(m_tasks.size()); ++task) {
+        if (m_tasks[task]->dependencies.empty()) {
+            roots.push_back(task);
+        }
+    }
+
+    for (const task_t task : roots) {
+        submit(task);
+    }
+}
+
+void
+TaskGraph::wait()
+{
+    if (not m_is_started) {
+        throw std::runtime_error("Invalid wait on a graph that has not been started!");
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_complete.wait(lock, [this]() { return m_is_complete; });
+
+    if (m_exception) {
+        std::rethrow_exception(m_exception);
+    }
+}
+
+bool
+TaskGraph::is_complete() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_is_complete;
+}
+
+std::shared_future<void>
+TaskGraph::future(task_t task) const
+{
+    return m_tasks.at(task)->future;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const TaskGraph::Timing&
+TaskGraph::timing(task_t task) const
+{
+    return m_tasks.at(task)->timing;
+}
+
+double
+TaskGraph::total_run_seconds() const
+{
+    double total = 0.0;
+
+    for (const std::unique_ptr<Task>& task : m_tasks) {
+        total += task->timing.run_seconds();
+    }
+
+    return total;
+}
+
+double
+TaskGraph::critical_path_seconds(std::vector<task_t>* const path) const
+{
+    //------------------------------------------------------------------------------
+    // Tasks are in topological order.
+    const size_t num_tasks = m_tasks.size();
+
+    std::vector<double> path_seconds(num_tasks, 0.0);
+    std::vector<task_t> predecessors(num_tasks, INVALID_TASK);
+
+    task_t last = INVALID_TASK;
+    double longest = 0.0;
+
+    for (task_t task = 0; task < task_t(num_tasks); ++task) {
+        double seconds = 0.0;
+
+        for (const task_t dependency : m_tasks[task]->dependencies) {
+            if (path_seconds[dependency] > seconds) {
+                seconds = path_seconds[dependency];
+                predecessors[task] = dependency;
+            }
+        }
+
+        path_seconds[task] = (seconds + m_tasks[task]->timing.run_seconds());
+
+        if ((last == INVALID_TASK) || (path_seconds[task] > longest)) {
+            longest = path_seconds[task];
+            last = task;
+        }
+    }
+
+    if (path) {
+        path->clear();
+
+        for (task_t task = last; task != INVALID_TASK; task = predecessors[task]) {
+            path->push_back(task);
+        }
+
+        std::reverse(path->begin(), path->end());
+    }
+
+    return longest;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double
+TaskGraph::seconds_since_start() const
+{
+    return std::chrono::duration<double>(clock_t::now() - m_start_time).count();
+}
+
+void
+TaskGraph::submit(task_t task)
+{
+    m_tasks[task]->timing.ready_time = seconds_since_start();
+    m_pool->submit([this, task]() { run(task); });
+}
+
+void
+TaskGraph::run(task_t task)
+{
+    Task& current = *m_tasks[task];
+
+    current.timing.start_time = seconds_since_start();
+
+    //------------------------------------------------------------------------------
+    // The last dependency to complete wrote a failure before submitting the task.
+    std::exception_ptr exception = current.failed_dependency;
+
+    if (exception) {
+        current.timing.skipped = true;
+    }
+    else {
+        try {
+            current.function();
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+    }
+
+    current.function = nullptr;
+    current.timing.end_time = seconds_since_start();
+
+    if (exception) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (not m_exception) {
+            m_exception = exception;
+        }
+
+        current.promise.set_exception(exception);
+    }
+    else {
+        current.promise.set_value();
+    }
+
+    //------------------------------------------------------------------------------
+    // Submit the dependents this task was the last dependency of.
+    for (const task_t dependent : current.dependents) {
+        Task& next = *m_tasks[dependent];
+
+        if (exception) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (not next.failed_dependency) {
+                next.failed_dependency = exception;
+            }
+        }
+
+        if (--next.num_remaining_dependencies == 0) {
+            submit(dependent);
+        }
+    }
+
+    if (--m_num_remaining == 0) {
+        complete();
+    }
+}
+
+void
+TaskGraph::complete()
+{
+    m_elapsed_seconds = seconds_since_start();
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        exception = m_exception;
+    }
+
+    if (m_completion) {
+        m_completion(exception);
+    }
+
+    //------------------------------------------------------------------------------
+    // Notify while holding the lock, the graph may be destroyed as soon as a
+    // waiter wakes up.
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_is_complete = true;
+    m_complete.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,222 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TASK_GRAPH_H__
+#define __TASK_GRAPH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// A graph of named tasks with dependencies, run once on a ThreadPool.
+//
+// Tasks may only depend on tasks added before them, so the graph is acyclic by
+// construction. start() submits the tasks without dependencies; every finishing
+// task submits the dependents it was the last dependency of, so no worker ever
+// blocks waiting for another task. Tasks may use ThreadPool::parallel_for()
+// internally.
+//
+// A throwing task fails its future with the exception. Its (transitive)
+// dependents are skipped and fail with the same exception, independent tasks
+// still run. wait() rethrows the first exception.
+//
+// Per-task timings (relative to start()) are available once the graph has
+// completed. The destructor waits for a started graph to complete.
+//------------------------------------------------------------------------------
+
+class TaskGraph
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    typedef uint32_t task_t;
+    typedef std::function<void()> function_t;
+
+    static constexpr task_t INVALID_TASK = UINT32_MAX;
+
+    //------------------------------------------------------------------------------
+    // Times in seconds since start(). A task is ready once all its dependencies
+    // have completed, the time until it starts is spent in the pool's queues.
+    struct Timing
+    {
+        double      ready_time = 0.0;
+        double      start_time = 0.0;
+        double      end_time = 0.0;
+        bool        skipped = false;        // A dependency failed
+
+        double queue_seconds() const { return (start_time - ready_time); }
+        double run_seconds() const { return (end_time - start_time); }
+    };
+
+    //------------------------------------------------------------------------------
+    // Called once on the thread completing the last task, with the first exception
+    // of any task (nullptr if all succeeded). Must not throw.
+    typedef std::function<void(std::exception_ptr)> completion_t;
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    TaskGraph();
+    ~TaskGraph();
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Building
+public:
+
+    //------------------------------------------------------------------------------
+    // Add a task depending on the given (previously added) tasks. Throws if the
+    // graph has been started, the function is empty or a dependency is invalid.
+    task_t add(const std::string& name, function_t function, const std::vector<task_t>& dependencies);
+    task_t add(const std::string& name, function_t function, std::initializer_list<task_t> dependencies = {})
+    {
+        return add(name, std::move(function), std::vector<task_t>(dependencies));
+    }
+
+    size_t num_tasks() const { return m_tasks.size(); }
+
+    const std::string& name(task_t task) const;
+    const std::vector<task_t>& dependencies(task_t task) const;
+
+    //------------------------------------------------------------------------------
+    // Execution
+public:
+
+    //------------------------------------------------------------------------------
+    // Submit the graph to the given pool and return immediately. The pool must
+    // outlive the execution of the graph. Throws if already started.
+    void start(ThreadPool& pool, completion_t completion = {});
+
+    //------------------------------------------------------------------------------
+    // Block until all tasks have completed and rethrow the first exception of any
+    // task. Must not be called from a task of this graph.
+    void wait();
+
+    bool is_started() const { return m_is_started; }
+    bool is_complete() const;
+
+    //------------------------------------------------------------------------------
+    // The future of the given task, ready when the task has completed. Waiting on
+    // it from a task of the same pool may deadlock, add a dependency instead.
+    std::shared_future<void> future(task_t task) const;
+
+    //------------------------------------------------------------------------------
+    // Timings (valid once complete)
+public:
+
+    const Timing& timing(task_t task) const;
+
+    //------------------------------------------------------------------------------
+    // The time from start() to the completion of the last task.
+    double elapsed_seconds() const { return m_elapsed_seconds; }
+
+    //------------------------------------------------------------------------------
+    // The sum of the run times of all tasks, i.e. the time running them serially
+    // would have taken (ignoring their internal parallelism).
+    double total_run_seconds() const;
+
+    //------------------------------------------------------------------------------
+    // The longest chain of dependent run times, the lower bound of the elapsed
+    // time for any number of threads. Tasks on the path are written to 'path' in
+    // dependency order if given.
+    double critical_path_seconds(std::vector<task_t>* const path = nullptr) const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    struct Task
+    {
+        std::string                 name;
+        function_t                  function;
+        std::vector<task_t>         dependencies;
+        std::vector<task_t>         dependents;
+
+        std::atomic<size_t>         num_remaining_dependencies;
+        std::exception_ptr          failed_dependency;      // Written under m_mutex until ready
+
+        std::promise<void>          promise;
+        std::shared_future<void>    future;
+
+        Timing                      timing;
+    };
+
+    typedef std::chrono::steady_clock clock_t;
+
+    double seconds_since_start() const;
+
+    void submit(task_t task);
+    void run(task_t task);
+    void complete();
+
+    std::vector<std::unique_ptr<Task>>  m_tasks;
+
+    ThreadPool*                         m_pool;
+    clock_t::time_point                 m_start_time;
+    completion_t                        m_completion;
+    bool                                m_is_started;
+
+    std::atomic<size_t>                 m_num_remaining;
+    double                              m_elapsed_seconds;
+
+    mutable std::mutex                  m_mutex;
+    std::condition_variable             m_complete;
+    bool                                m_is_complete;
+    std::exception_ptr                  m_exception;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __TASK_GRAPH_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,263 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // The pool and queue the current thread works for (if any).
+    thread_local const ThreadPool* t_pool = nullptr;
+    thread_local size_t t_worker_index = 0;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : m_num_pending(0)
+    , m_next_queue(0)
+    , m_stop(false)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::worker_main, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ThreadPool::submit(task_t task)
+{
+    const size_t queue_index = ((t_pool == this) ? t_worker_index : (m_next_queue++ % m_queues.size()));
+
+    //------------------------------------------------------------------------------
+    // Count the task while holding the queue lock: a worker can only pop it after
+    // the lock is released, so the count never drops below the number of queued
+    // tasks.
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue_index]->mutex);
+        m_queues[queue_index]->tasks.push_back(std::move(task));
+        ++m_num_pending;
+    }
+
+    //------------------------------------------------------------------------------
+    // Taking the lock orders the notification after any worker's predicate check.
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+    }
+
+    m_wake.notify_one();
+}
+
+void
+ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& body, size_t grain)
+{
+    if (count == 0) {
+        return;
+    }
+
+    //------------------------------------------------------------------------------
+    // Split into a few chunks per thread to give stealing something to balance.
+    grain = std::max(size_t(1), grain);
+
+    const size_t max_num_chunks = (4 * (m_workers.size() + 1));
+    const size_t chunk_size = std::max(grain, ((count + max_num_chunks - 1) / max_num_chunks));
+    const size_t num_chunks = ((count + chunk_size - 1) / chunk_size);
+
+    if (num_chunks == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<size_t>     remaining;
+        std::mutex              mutex;
+        std::condition_variable done;
+        std::exception_ptr      exception;
+    };
+
+    const std::shared_ptr<State> state = std::make_shared<State>();
+    state->remaining = num_chunks;
+
+    for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const size_t begin = (chunk * chunk_size);
+        const size_t end = std::min(count, (begin + chunk_size));
+
+        submit([state, &body, begin, end]() {
+            try {
+                for (size_t i = begin; i < end; ++i) {
+                    body(i);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+
+                if (not state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+
+            if (--state->remaining == 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        });
+    }
+
+    //------------------------------------------------------------------------------
+    // Help out until every chunk has been picked up, then wait for the stragglers.
+    const size_t helper_index = ((t_pool == this) ? t_worker_index : 0);
+
+    while (state->remaining != 0) {
+        task_t task;
+
+        if (pop_task(helper_index, task) || steal_task(helper_index, task)) {
+            run_task(task);
+        }
+        else {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->done.wait(lock, [&state]() { return (state->remaining == 0); });
+        }
+    }
+
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ThreadPool::worker_main(size_t worker_index)
+{
+    t_pool = this;
+    t_worker_index = worker_index;
+
+    for (;;) {
+        task_t task;
+
+        if (pop_task(worker_index, task) || steal_task(worker_index, task)) {
+            run_task(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        m_wake.wait(lock, [this]() { return (m_stop || (m_num_pending != 0)); });
+
+        if (m_stop && (m_num_pending == 0)) {
+            return;
+        }
+    }
+}
+
+bool
+ThreadPool::pop_task(size_t queue_index, task_t& task)
+{
+    WorkQueue& queue = *m_queues[queue_index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+
+    return true;
+}
+
+bool
+ThreadPool::steal_task(size_t thief_index, task_t& task)
+{
+    const size_t num_queues = m_queues.size();
+
+    for (size_t i = 1; i < num_queues; ++i) {
+        WorkQueue& queue = *m_queues[(thief_index + i) % num_queues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (not queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+ThreadPool::run_task(task_t& task)
+{
+    assert(m_num_pending != 0);
+
+    --m_num_pending;
+    task();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
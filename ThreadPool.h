@@ -0,0 +1,128 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Work-stealing thread pool.
+//
+// Each worker owns a task queue. Workers take tasks from the back of their own
+// queue and steal from the front of other workers' queues when theirs runs dry.
+// Tasks submitted from a worker go to that worker's queue, tasks submitted from
+// other threads are distributed round-robin.
+//
+// parallel_for() blocks until all iterations have completed. The calling thread
+// runs queued tasks while waiting so nested use from within a task is safe.
+//------------------------------------------------------------------------------
+
+class ThreadPool
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    typedef std::function<void()> task_t;
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Create a pool with the given number of worker threads. Zero uses one thread
+    // per hardware thread.
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Task Execution
+public:
+
+    size_t num_threads() const { return m_workers.size(); }
+
+    //------------------------------------------------------------------------------
+    // Queue a task for asynchronous execution. The task must not throw.
+    void submit(task_t task);
+
+    //------------------------------------------------------------------------------
+    // Invoke body(index) for every index in [0, count). Iterations are grouped into
+    // contiguous chunks of at least 'grain' iterations. If an iteration throws the
+    // first exception is rethrown on the calling thread once all chunks are done.
+    void parallel_for(size_t count, const std::function<void(size_t)>& body, size_t grain = 1);
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    struct WorkQueue
+    {
+        std::mutex              mutex;
+        std::deque<task_t>      tasks;
+    };
+
+    void worker_main(size_t worker_index);
+
+    bool pop_task(size_t queue_index, task_t& task);
+    bool steal_task(size_t thief_index, task_t& task);
+
+    void run_task(task_t& task);
+
+    std::vector<std::unique_ptr<WorkQueue>>     m_queues;
+    std::vector<std::thread>                    m_workers;
+
+    std::mutex                                  m_wake_mutex;
+    std::condition_variable                     m_wake;
+    std::atomic<size_t>                         m_num_pending;
+    std::atomic<size_t>                         m_next_queue;
+    bool                                        m_stop;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __THREAD_POOL_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
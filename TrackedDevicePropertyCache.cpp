@@ -0,0 +1,413 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TrackedDevicePropertyCache.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // Most strings fit, longer ones take a second query with the reported size.
+    constexpr size_t INITIAL_STRING_BUFFER_SIZE = 256;
+
+    //------------------------------------------------------------------------------
+    // Column numbers are stored offset by one in 16 bits.
+    constexpr size_t MAX_CAPACITY = UINT16_MAX;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TrackedDevicePropertyCache::TrackedDevicePropertyCache(vr::IVRSystem* const system, size_t capacity)
+    : m_system(system)
+    , m_capacity(capacity)
+    , m_size(0)
+    , m_num_queries(0)
+{
+    if (not m_system) {
+        throw std::runtime_error("Invalid system!");
+    }
+
+    if ((capacity == 0) || (capacity > MAX_CAPACITY)) {
+        throw std::runtime_error("Invalid capacity!");
+    }
+
+    const size_t num_columns = (size_t(PROPERTY_LIMIT) * ValueType_Count);
+    m_columns.reset(new std::atomic<uint16_t>[num_columns]);
+
+    for (size_t i = 0; i < num_columns; ++i) {
+        m_columns[i].store(0, std::memory_order_relaxed);
+    }
+
+    const size_t num_cells = (m_capacity * vr::k_unMaxTrackedDeviceCount);
+    m_cells.reset(new Cell[num_cells]);
+
+    for (size_t i = 0; i < num_cells; ++i) {
+        m_cells[i].sequence.store(0, std::memory_order_relaxed);
+        m_cells[i].error.store(INVALID_ERROR, std::memory_order_relaxed);
+        m_cells[i].value.store(0, std::memory_order_relaxed);
+    }
+
+    m_column_keys.reserve(m_capacity);
+}
+
+TrackedDevicePropertyCache::~TrackedDevicePropertyCache() = default;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string_view
+TrackedDevicePropertyCache::get_string(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error)
+{
+    const Entry entry = lookup(device_index, property, ValueType_String);
+    if (error) { *error = entry.error; }
+    return (entry.value ? std::string_view(*reinterpret_cast<const std::string*>(entry.value)) : std::string_view());
+}
+
+bool
+TrackedDevicePropertyCache::get_bool(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error)
+{
+    const Entry entry = lookup(device_index, property, ValueType_Bool);
+    if (error) { *error = entry.error; }
+    return (entry.value != 0);
+}
+
+float
+TrackedDevicePropertyCache::get_float(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error)
+{
+    const Entry entry = lookup(device_index, property, ValueType_Float);
+    if (error) { *error = entry.error; }
+
+    const uint32_t bits = uint32_t(entry.value);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int32_t
+TrackedDevicePropertyCache::get_int32(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error)
+{
+    const Entry entry = lookup(device_index, property, ValueType_Int32);
+    if (error) { *error = entry.error; }
+    return int32_t(uint32_t(entry.value));
+}
+
+vr::HmdMatrix34_t
+TrackedDevicePropertyCache::get_matrix34(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error)
+{
+    const Entry entry = lookup(device_index, property, ValueType_Matrix34);
+    if (error) { *error = entry.error; }
+
+    vr::HmdMatrix34_t matrix = {};
+
+    if (entry.value) {
+        memcpy(&matrix, reinterpret_cast<const std::string*>(entry.value)->data(), sizeof(matrix));
+    }
+
+    return matrix;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+TrackedDevicePropertyCache::handle_event(const vr::VREvent_t& event)
+{
+    const bool is_activated = (event.eventType == vr::VREvent_TrackedDeviceActivated);
+    const bool is_property_changed = (event.eventType == vr::VREvent_PropertyChanged);
+
+    if ((not is_activated) && (not is_property_changed)) {
+        return false;
+    }
+
+    if (event.trackedDeviceIndex >= vr::k_unMaxTrackedDeviceCount) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t column = 0; column < m_column_keys.size(); ++column) {
+        if (is_activated || (m_column_keys[column].first == event.data.property.prop)) {
+            Cell& invalidated = cell(uint32_t(column), event.trackedDeviceIndex);
+
+            if (invalidated.error.load(std::memory_order_relaxed) != INVALID_ERROR) {
+                write(invalidated, INVALID_ERROR, 0);
+            }
+        }
+    }
+
+    return true;
+}
+
+void
+TrackedDevicePropertyCache::refresh()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t column = 0; column < m_column_keys.size(); ++column) {
+        const auto [property, type] = m_column_keys[column];
+
+        for (vr::TrackedDeviceIndex_t device_index = 0; device_index < vr::k_unMaxTrackedDeviceCount; ++device_index) {
+            Cell& refreshed = cell(uint32_t(column), device_index);
+
+            if (refreshed.sequence.load(std::memory_order_relaxed) != 0) {
+                const Entry entry = query(device_index, property, type);
+                write(refreshed, entry.error, entry.value);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TrackedDevicePropertyCache::Entry
+TrackedDevicePropertyCache::lookup(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type)
+{
+    if (device_index >= vr::k_unMaxTrackedDeviceCount) {
+        return { vr::TrackedProp_InvalidDevice, 0 };
+    }
+
+    const bool is_indexed = ((property >= 0) && (uint32_t(property) < PROPERTY_LIMIT));
+    const size_t column_index = (is_indexed ? ((size_t(property) * ValueType_Count) + type) : 0);
+
+    //------------------------------------------------------------------------------
+    // Lock-free hit. A column is assigned before any of its cells is written.
+    if (is_indexed) {
+        const uint32_t column = m_columns[column_index].load(std::memory_order_acquire);
+        Entry entry;
+
+        if ((column != 0) && read(cell((column - 1), device_index), entry)) {
+            return entry;
+        }
+    }
+
+    return lookup_miss(device_index, property, type);
+}
+
+TrackedDevicePropertyCache::Entry
+TrackedDevicePropertyCache::lookup_miss(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type)
+{
+    const bool is_indexed = ((property >= 0) && (uint32_t(property) < PROPERTY_LIMIT));
+    const size_t column_index = (is_indexed ? ((size_t(property) * ValueType_Count) + type) : 0);
+
+    uint32_t column = 0;
+    uint32_t sequence = 0;
+    Entry entry;
+
+    //------------------------------------------------------------------------------
+    // Assign a column if needed and check the cell again (another thread may have
+    // written it in the meantime).
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        column = (is_indexed ? m_columns[column_index].load(std::memory_order_relaxed) : 0);
+
+        if ((column == 0) && is_indexed && (m_column_keys.size() < m_capacity)) {
+            m_column_keys.emplace_back(property, type);
+            column = uint32_t(m_column_keys.size());
+            m_columns[column_index].store(uint16_t(column), std::memory_order_release);
+        }
+
+        if (column != 0) {
+            const Cell& cached = cell((column - 1), device_index);
+
+            if (read(cached, entry)) {
+                return entry;
+            }
+
+            sequence = cached.sequence.load(std::memory_order_relaxed);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Query without the lock so misses on different threads (e.g. the startup
+    // tasks of VRInitializer) overlap their round trips.
+    std::string bytes;
+    entry = fetch(device_index, property, type, bytes);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    intern(type, bytes, entry);
+
+    //------------------------------------------------------------------------------
+    // Not indexed or full, don't cache.
+    if (column == 0) {
+        return entry;
+    }
+
+    //------------------------------------------------------------------------------
+    // If the cell was written during the query (by another miss or an
+    // invalidation) the result may already be stale, keep the cell as it is.
+    Cell& cached = cell((column - 1), device_index);
+
+    if (cached.sequence.load(std::memory_order_relaxed) != sequence) {
+        Entry current;
+        return (read(cached, current) ? current : entry);
+    }
+
+    if (sequence == 0) {
+        m_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    write(cached, entry.error, entry.value);
+    return entry;
+}
+
+TrackedDevicePropertyCache::Entry
+TrackedDevicePropertyCache::query(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type)
+{
+    std::string bytes;
+    Entry entry = fetch(device_index, property, type, bytes);
+
+    intern(type, bytes, entry);
+    return entry;
+}
+
+TrackedDevicePropertyCache::Entry
+TrackedDevicePropertyCache::fetch(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type, std::string& bytes)
+{
+    Entry entry;
+    m_num_queries.fetch_add(1, std::memory_order_relaxed);
+
+    switch (type) {
+        case ValueType_String: {
+            bytes.resize(INITIAL_STRING_BUFFER_SIZE);
+            uint32_t size = m_system->GetStringTrackedDeviceProperty(device_index, property, &bytes[0], uint32_t(bytes.size()), &entry.error);
+
+            if ((entry.error == vr::TrackedProp_BufferTooSmall) && (size > bytes.size())) {
+                bytes.resize(size);
+                m_num_queries.fetch_add(1, std::memory_order_relaxed);
+                size = m_system->GetStringTrackedDeviceProperty(device_index, property, &bytes[0], uint32_t(bytes.size()), &entry.error);
+            }
+
+            bytes.resize(((entry.error == vr::TrackedProp_Success) && (size > 0)) ? (size - 1) : 0);     // 'size' includes terminator
+            break;
+        }
+
+        case ValueType_Bool:
+            entry.value = (m_system->GetBoolTrackedDeviceProperty(device_index, property, &entry.error) ? 1 : 0);
+            break;
+
+        case ValueType_Float: {
+            const float value = m_system->GetFloatTrackedDeviceProperty(device_index, property, &entry.error);
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            entry.value = bits;
+            break;
+        }
+
+        case ValueType_Int32:
+            entry.value = uint32_t(m_system->GetInt32TrackedDeviceProperty(device_index, property, &entry.error));
+            break;
+
+        case ValueType_Matrix34: {
+            const vr::HmdMatrix34_t matrix = m_system->GetMatrix34TrackedDeviceProperty(device_index, property, &entry.error);
+            bytes.assign(reinterpret_cast<const char*>(&matrix), sizeof(matrix));
+            break;
+        }
+
+        default:
+            assert(false);
+            break;
+    }
+
+    return entry;
+}
+
+void
+TrackedDevicePropertyCache::intern(ValueType type, const std::string& bytes, Entry& entry)
+{
+    if ((type == ValueType_String) && (entry.error == vr::TrackedProp_Success)) {
+        entry.value = uint64_t(uintptr_t(&*m_strings.insert(bytes).first));
+    }
+    else if (type == ValueType_Matrix34) {
+        entry.value = uint64_t(uintptr_t(&*m_matrices.insert(bytes).first));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+TrackedDevicePropertyCache::read(const Cell& cell, Entry& entry)
+{
+    for (;;) {
+        const uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if ((sequence & 1) != 0) {
+            continue;
+        }
+
+        const uint32_t error = cell.error.load(std::memory_order_relaxed);
+        const uint64_t value = cell.value.load(std::memory_order_relaxed);
+
+        //------------------------------------------------------------------------------
+        // Order the loads above before the sequence check below.
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (cell.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        if (error == INVALID_ERROR) {
+            return false;
+        }
+
+        entry.error = vr::ETrackedPropertyError(error);
+        entry.value = value;
+        return true;
+    }
+}
+
+void
+TrackedDevicePropertyCache::write(Cell& cell, uint32_t error, uint64_t value)
+{
+    const uint32_t sequence = cell.sequence.load(std::memory_order_relaxed);
+
+    //------------------------------------------------------------------------------
+    // Order the odd sequence before the stores below.
+    cell.sequence.store((sequence + 1), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    cell.error.store(error, std::memory_order_relaxed);
+    cell.value.store(value, std::memory_order_relaxed);
+
+    cell.sequence.store((sequence + 2), std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
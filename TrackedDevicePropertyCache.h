@@ -0,0 +1,213 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRACKED_DEVICE_PROPERTY_CACHE_H__
+#define __TRACKED_DEVICE_PROPERTY_CACHE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Cache of tracked device properties keyed by (device index, property, type).
+//
+// The first lookup of a key queries the system, later lookups are served from
+// the cache without locking. Errors are cached like values, so querying a
+// property a device does not provide does not hit the system every frame.
+// Cached entries are only invalidated by handle_event(): all properties of a
+// device on VREvent_TrackedDeviceActivated, a single property on
+// VREvent_PropertyChanged. refresh() queries every known key again at once.
+// Device indices past vr::k_unMaxTrackedDeviceCount fail with
+// TrackedProp_InvalidDevice without querying the system.
+//
+// Each (property, type) is assigned a column of one cell per device on first
+// use, found through a table indexed by the property, so a lookup is two array
+// accesses. Cells are rewritten in place (under a sequence lock, readers retry
+// while a cell is written) so invalidation and refresh do not allocate. String
+// and matrix values are interned: the returned views stay valid for the
+// lifetime of the cache, also across invalidation and refresh, and memory only
+// grows with the number of distinct values.
+//
+// Lookups may be called from any thread. Misses call the system on the calling
+// thread without holding the cache's mutex, so misses on different threads
+// overlap; handle_event() and refresh() are serialized by the mutex.
+//------------------------------------------------------------------------------
+
+class TrackedDevicePropertyCache
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // The capacity is the maximum number of (property, type) pairs that can be
+    // cached, each for all devices. Lookups past the capacity, or of properties
+    // past the standard and vendor specific ranges, still work but query the
+    // system every time. Throws if the system is null or the capacity is 0 or
+    // larger than 65535.
+    explicit TrackedDevicePropertyCache(vr::IVRSystem* const system, size_t capacity = 128);
+    ~TrackedDevicePropertyCache();
+
+    TrackedDevicePropertyCache(const TrackedDevicePropertyCache&) = delete;
+    TrackedDevicePropertyCache& operator=(const TrackedDevicePropertyCache&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Lookup
+public:
+
+    std::string_view get_string(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error = nullptr);
+    bool get_bool(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error = nullptr);
+    float get_float(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error = nullptr);
+    int32_t get_int32(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error = nullptr);
+    vr::HmdMatrix34_t get_matrix34(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, vr::TrackedPropertyError* const error = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Invalidation
+public:
+
+    //------------------------------------------------------------------------------
+    // Invalidate the entries affected by the given event. Returns true if the
+    // event is one the cache reacts to.
+    bool handle_event(const vr::VREvent_t& event);
+
+    //------------------------------------------------------------------------------
+    // Query all known keys (including invalidated ones) again so that following
+    // lookups of these keys do not miss.
+    void refresh();
+
+    //------------------------------------------------------------------------------
+    // Statistics
+public:
+
+    //------------------------------------------------------------------------------
+    // The number of keys cached.
+    size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+    //------------------------------------------------------------------------------
+    // The number of property queries made to the system so far.
+    size_t num_queries() const { return m_num_queries.load(std::memory_order_relaxed); }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    enum ValueType : uint8_t {
+        ValueType_String = 0,
+        ValueType_Bool,
+        ValueType_Float,
+        ValueType_Int32,
+        ValueType_Matrix34,
+
+        ValueType_Count
+    };
+
+    //------------------------------------------------------------------------------
+    // Properties below the limit (all standard and vendor specific ones) have a
+    // column table entry.
+    static constexpr uint32_t PROPERTY_LIMIT = 11000;
+
+    //------------------------------------------------------------------------------
+    // The error of empty and invalidated cells.
+    static constexpr uint32_t INVALID_ERROR = UINT32_MAX;
+
+    //------------------------------------------------------------------------------
+    // A query result: the error and the value as bool/float/int32 bits or as a
+    // pointer to the interned string or matrix (0 if there is none).
+    struct Entry
+    {
+        vr::ETrackedPropertyError   error = vr::TrackedProp_Success;
+        uint64_t                    value = 0;
+    };
+
+    //------------------------------------------------------------------------------
+    // A cached entry. The sequence is odd while the cell is written and 0 until
+    // it is written the first time.
+    struct Cell
+    {
+        std::atomic<uint32_t>       sequence;
+        std::atomic<uint32_t>       error;
+        std::atomic<uint64_t>       value;
+    };
+
+    Entry lookup(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type);
+    Entry lookup_miss(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type);
+
+    //------------------------------------------------------------------------------
+    // fetch() and intern() (requires m_mutex to be held).
+    Entry query(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type);
+
+    //------------------------------------------------------------------------------
+    // Query the system without touching the cache. String and matrix values are
+    // returned as bytes for intern() (which requires m_mutex to be held) to turn
+    // into the entry's value.
+    Entry fetch(vr::TrackedDeviceIndex_t device_index, vr::TrackedDeviceProperty property, ValueType type, std::string& bytes);
+    void intern(ValueType type, const std::string& bytes, Entry& entry);
+
+    Cell& cell(uint32_t column, vr::TrackedDeviceIndex_t device_index) const { return m_cells[(size_t(column) * vr::k_unMaxTrackedDeviceCount) + device_index]; }
+
+    //------------------------------------------------------------------------------
+    // Read a cell, false if it is empty or invalidated.
+    static bool read(const Cell& cell, Entry& entry);
+
+    //------------------------------------------------------------------------------
+    // Write a cell (requires m_mutex to be held).
+    void write(Cell& cell, uint32_t error, uint64_t value);
+
+    vr::IVRSystem* const                m_system;
+
+    const size_t                        m_capacity;
+    std::unique_ptr<std::atomic<uint16_t>[]>    m_columns;  // Per (property, type): 1 + column, 0 if none
+    std::unique_ptr<Cell[]>             m_cells;            // Per column and device
+
+    std::mutex                          m_mutex;            // Guards the members below and all writes to cells and columns
+    std::vector<std::pair<vr::TrackedDeviceProperty, ValueType>>    m_column_keys;
+    std::unordered_set<std::string>     m_strings;
+    std::unordered_set<std::string>     m_matrices;         // As bytes
+
+    std::atomic<size_t>                 m_size;
+    std::atomic<size_t>                 m_num_queries;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __TRACKED_DEVICE_PROPERTY_CACHE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
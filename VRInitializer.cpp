@@ -0,0 +1,334 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VRInitializer.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    //------------------------------------------------------------------------------
+    // The properties making up a CalibrationKey.
+    constexpr vr::TrackedDeviceProperty CALIBRATION_KEY_PROPERTIES[] = {
+        vr::Prop_ModelNumber_String,
+        vr::Prop_SerialNumber_String,
+        vr::Prop_DriverVersion_String,
+    };
+
+    const char* eye_name(vr::EVREye eye)
+    {
+        return ((eye == vr::Eye_Left) ? "left" : "right");
+    }
+
+    const char* mesh_type_name(vr::EHiddenAreaMeshType type)
+    {
+        switch (type) {
+            case vr::k_eHiddenAreaMesh_Standard: return "standard";
+            case vr::k_eHiddenAreaMesh_Inverse: return "inverse";
+            case vr::k_eHiddenAreaMesh_LineLoop: return "line loop";
+            default: return "unknown";
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VRInitializer::Settings
+VRInitializer::Settings::defaults()
+{
+    Settings settings;
+
+    settings.string_properties = {
+        vr::Prop_TrackingSystemName_String,
+        vr::Prop_ModelNumber_String,
+        vr::Prop_SerialNumber_String,
+        vr::Prop_ManufacturerName_String,
+        vr::Prop_DriverVersion_String,
+    };
+
+    settings.float_properties = {
+        vr::Prop_DisplayFrequency_Float,
+        vr::Prop_SecondsFromVsyncToPhotons_Float,
+        vr::Prop_UserIpdMeters_Float,
+    };
+
+    return settings;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VRInitializer::VRInitializer(vr::IVRSystem* const system, const Settings& settings)
+    : m_system(system)
+    , m_settings(settings)
+    , m_pool(nullptr)
+    , m_calibration_cache_task(TaskGraph::INVALID_TASK)
+    , m_calibration_cache_write_task(TaskGraph::INVALID_TASK)
+    , m_render_target_size_task(TaskGraph::INVALID_TASK)
+    , m_properties_task(TaskGraph::INVALID_TASK)
+    , m_distortion_lut_task(TaskGraph::INVALID_TASK)
+    , m_render_target_width(0)
+    , m_render_target_height(0)
+    , m_property_cache(system)
+{
+    //------------------------------------------------------------------------------
+    // Render target size. Always queried, it is not covered by the cache key.
+    m_render_target_size_task = m_graph.add("render target size", [this]() {
+        m_system->GetRecommendedRenderTargetSize(&m_render_target_width, &m_render_target_height);
+    });
+
+    //------------------------------------------------------------------------------
+    // Properties, a task each since cache misses overlap. With a calibration
+    // cache its key is read from the property cache, so the key strings are
+    // queried (once) even if not requested.
+    const bool use_calibration_cache = (not m_settings.calibration_cache_path.empty());
+
+    std::vector<vr::TrackedDeviceProperty> string_properties = m_settings.string_properties;
+    std::vector<task_t> property_tasks;
+    std::vector<task_t> calibration_load_dependencies;
+
+    if (use_calibration_cache) {
+        for (const vr::TrackedDeviceProperty property : CALIBRATION_KEY_PROPERTIES) {
+            if (std::find(string_properties.begin(), string_properties.end(), property) == string_properties.end()) {
+                string_properties.push_back(property);
+            }
+        }
+    }
+
+    for (const vr::TrackedDeviceProperty property : string_properties) {
+        const task_t task = m_graph.add(("string property " + std::to_string(property)), [this, property]() {
+            m_property_cache.get_string(vr::k_unTrackedDeviceIndex_Hmd, property);
+        });
+
+        property_tasks.push_back(task);
+
+        if (std::find(std::begin(CALIBRATION_KEY_PROPERTIES), std::end(CALIBRATION_KEY_PROPERTIES), property) != std::end(CALIBRATION_KEY_PROPERTIES)) {
+            calibration_load_dependencies.push_back(task);
+        }
+    }
+
+    for (const vr::TrackedDeviceProperty property : m_settings.float_properties) {
+        property_tasks.push_back(m_graph.add(("float property " + std::to_string(property)), [this, property]() {
+            m_property_cache.get_float(vr::k_unTrackedDeviceIndex_Hmd, property);
+        }));
+    }
+
+    if (not property_tasks.empty()) {
+        m_properties_task = m_graph.add("properties", []() {}, property_tasks);
+    }
+
+    //------------------------------------------------------------------------------
+    // Calibration cache. The cache always holds a LUT, of at least the minimum
+    // size if the LUT is skipped. It is only loaded here, on a miss the mesh and
+    // LUT tasks query the system and the cache is written once they are done.
+    std::vector<task_t> calibration_dependencies;
+
+    if (use_calibration_cache) {
+        calibration_load_dependencies.push_back(m_render_target_size_task);
+
+        m_calibration_cache_task = m_graph.add("calibration cache", [this]() {
+            std::unique_ptr<CalibrationCache> cache = CalibrationCache::load(m_settings.calibration_cache_path.c_str(), calibration_key(), calibration_lut_size());
+
+            if (cache && ((cache->render_target_width() != m_render_target_width) || (cache->render_target_height() != m_render_target_height))) {
+                cache.reset();
+            }
+
+            m_calibration_cache = std::move(cache);
+        }, calibration_load_dependencies);
+
+        calibration_dependencies.push_back(m_calibration_cache_task);
+    }
+
+    //------------------------------------------------------------------------------
+    // Hidden area meshes.
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        for (int type_index = 0; type_index < vr::k_eHiddenAreaMesh_Max; ++type_index) {
+            const vr::EHiddenAreaMeshType type = vr::EHiddenAreaMeshType(type_index);
+
+            m_hidden_area_mesh_tasks[eye][type] = m_graph.add((std::string("hidden area mesh (") + eye_name(eye) + ", " + mesh_type_name(type) + ")"), [this, eye, type]() {
+                const vr::HiddenAreaMesh_t mesh = (m_calibration_cache ? m_calibration_cache->hidden_area_mesh(eye, type) : m_system->GetHiddenAreaMesh(eye, type));
+                const size_t num_vertices = ((type == vr::k_eHiddenAreaMesh_LineLoop) ? mesh.unTriangleCount : (3 * size_t(mesh.unTriangleCount)));
+
+                HiddenAreaMeshData& data = m_eyes[eye].hidden_area_meshes[type];
+
+                data.vertices.assign(mesh.pVertexData, (mesh.pVertexData + (mesh.pVertexData ? num_vertices : 0)));
+                data.count = (mesh.pVertexData ? mesh.unTriangleCount : 0);
+
+                if (m_settings.index_meshes && (type != vr::k_eHiddenAreaMesh_LineLoop) && (data.count > 0)) {
+                    MeshProcessing::make_indexed_mesh(data.as_hidden_area_mesh(), m_eyes[eye].indexed_meshes[type]);
+                }
+            }, calibration_dependencies);
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Tile masks and visible regions.
+    for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+        m_tile_mask_tasks[eye] = TaskGraph::INVALID_TASK;
+        m_visible_region_tasks[eye] = TaskGraph::INVALID_TASK;
+
+        if (m_settings.tile_size > 0) {
+            m_tile_mask_tasks[eye] = m_graph.add((std::string("tile mask (") + eye_name(eye) + ")"), [this, eye]() {
+                m_eyes[eye].tile_mask = std::make_unique<HiddenAreaTileMask>(m_eyes[eye].hidden_area_meshes[vr::k_eHiddenAreaMesh_Standard].as_hidden_area_mesh(),
+                                                                             m_render_target_width,
+                                                                             m_render_target_height,
+                                                                             m_settings.tile_size);
+            }, { m_render_target_size_task, m_hidden_area_mesh_tasks[eye][vr::k_eHiddenAreaMesh_Standard] });
+        }
+
+        if (m_settings.visible_regions) {
+            m_visible_region_tasks[eye] = m_graph.add((std::string("visible region (") + eye_name(eye) + ")"), [this, eye]() {
+                if (m_calibration_cache) {
+                    m_eyes[eye].visible_region = m_calibration_cache->visible_region(eye);
+
+                    if (m_eyes[eye].visible_region) {
+                        return;
+                    }
+                }
+
+                m_eyes[eye].visible_region = std::make_unique<VisibleRegion>(m_eyes[eye].hidden_area_meshes[vr::k_eHiddenAreaMesh_Inverse].as_hidden_area_mesh(),
+                                                                             vr::k_eHiddenAreaMesh_Inverse,
+                                                                             m_render_target_width,
+                                                                             m_render_target_height);
+            }, { m_render_target_size_task, m_hidden_area_mesh_tasks[eye][vr::k_eHiddenAreaMesh_Inverse] });
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Distortion.
+    if (m_settings.distortion_lut_size > 0) {
+        m_distortion_lut_task = m_graph.add("distortion LUT", [this]() {
+            if (m_calibration_cache) {
+                const DistortionLUT& lut = m_calibration_cache->distortion_lut();
+
+                m_distortion_lut = std::make_unique<DistortionLUT>(lut.width(), lut.height(),
+                                                                   lut.channel(vr::Eye_Left, DistortionLUT::Channel_RedU),
+                                                                   lut.channel(vr::Eye_Right, DistortionLUT::Channel_RedU));
+            }
+            else {
+                m_distortion_lut = std::make_unique<DistortionLUT>(m_system, m_settings.distortion_lut_size, m_settings.distortion_lut_size, m_pool);
+            }
+        }, calibration_dependencies);
+    }
+
+    //------------------------------------------------------------------------------
+    // Write the calibration cache from the queried data on a miss. Failing to
+    // write it is not fatal, it is built again at the next start.
+    if (use_calibration_cache) {
+        std::vector<task_t> write_dependencies = { m_calibration_cache_task, m_render_target_size_task };
+
+        for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+            write_dependencies.insert(write_dependencies.end(), std::begin(m_hidden_area_mesh_tasks[eye]), std::end(m_hidden_area_mesh_tasks[eye]));
+        }
+
+        for (const task_t task : { m_visible_region_tasks[vr::Eye_Left], m_visible_region_tasks[vr::Eye_Right], m_distortion_lut_task }) {
+            if (task != TaskGraph::INVALID_TASK) {
+                write_dependencies.push_back(task);
+            }
+        }
+
+        m_calibration_cache_write_task = m_graph.add("calibration cache write", [this]() {
+            if (m_calibration_cache) {
+                return;
+            }
+
+            vr::HiddenAreaMesh_t meshes[2][vr::k_eHiddenAreaMesh_Max] = {};
+            const VisibleRegion* visible_regions[2] = {};
+
+            for (const vr::EVREye eye : { vr::Eye_Left, vr::Eye_Right }) {
+                for (int type = 0; type < vr::k_eHiddenAreaMesh_Max; ++type) {
+                    meshes[eye][type] = m_eyes[eye].hidden_area_meshes[type].as_hidden_area_mesh();
+                }
+
+                visible_regions[eye] = m_eyes[eye].visible_region.get();
+            }
+
+            try {
+                std::unique_ptr<DistortionLUT> minimum_lut;
+
+                if (not m_distortion_lut) {
+                    minimum_lut = std::make_unique<DistortionLUT>(m_system, calibration_lut_size(), calibration_lut_size());
+                }
+
+                CalibrationCache::build(m_settings.calibration_cache_path.c_str(),
+                                        calibration_key(),
+                                        meshes,
+                                        (m_distortion_lut ? *m_distortion_lut : *minimum_lut),
+                                        m_render_target_width,
+                                        m_render_target_height,
+                                        visible_regions);
+            }
+            catch (const std::runtime_error&) {
+            }
+        }, write_dependencies);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CalibrationKey
+VRInitializer::calibration_key()
+{
+    CalibrationKey key;
+
+    key.model = m_property_cache.get_string(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_ModelNumber_String);
+    key.serial = m_property_cache.get_string(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String);
+    key.driver_version = m_property_cache.get_string(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DriverVersion_String);
+
+    return key;
+}
+
+size_t
+VRInitializer::calibration_lut_size() const
+{
+    return std::max(m_settings.distortion_lut_size, size_t(2));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+VRInitializer::start(ThreadPool& pool, TaskGraph::completion_t completion)
+{
+    m_pool = &pool;
+    m_graph.start(pool, std::move(completion));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
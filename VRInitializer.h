@@ -0,0 +1,216 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VR_INITIALIZER_H__
+#define __VR_INITIALIZER_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CalibrationCache.h"
+#include "DistortionLUT.h"
+#include "HiddenAreaTileMask.h"
+#include "MeshProcessing.h"
+#include "TaskGraph.h"
+#include "TrackedDevicePropertyCache.h"
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// Startup queries and derived resources of an IVRSystem as a TaskGraph.
+//
+// Each resource is a task so independent ones run concurrently on a thread
+// pool: the render target size, the hidden area meshes of both eyes and all
+// three types (copied and, for triangle meshes, indexed), each property of the
+// property cache warm-up, and the distortion LUT (sampled with parallel_for()
+// itself). Tile masks and visible regions depend on the render target size and
+// their eye's standard/inverse mesh. Most of the startup time is spent waiting
+// for OpenVR round trips, so overlapping them cuts the time to the first frame
+// even where little computation is involved.
+//
+// With a calibration cache path the meshes, the distortion LUT and the visible
+// regions are taken from a CalibrationCache, skipping their OpenVR queries (and
+// rasterizing the regions) once the cache exists.
+// It is loaded by a task depending on the key properties (read through the
+// property cache) and the render target size, which the mesh and LUT tasks
+// depend on. If there is no valid cache they query the system as without one
+// and a final task writes the cache from their results.
+//
+// Platform code can add its own tasks depending on these (e.g. uploading the
+// meshes once the device is known) via graph() before start(). Resources are
+// valid once their task has completed, see TaskGraph::future(), or after
+// wait(). The system must support concurrent calls, like the OpenVR client.
+//------------------------------------------------------------------------------
+
+class VRInitializer
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    typedef TaskGraph::task_t task_t;
+
+    //------------------------------------------------------------------------------
+    // What to initialize. Zero sizes skip the respective resource.
+    struct Settings
+    {
+        bool                                    index_meshes = true;            // See MeshProcessing::make_indexed_mesh()
+        uint32_t                                tile_size = 16;                 // Of the hidden area tile masks
+        bool                                    visible_regions = true;
+        size_t                                  distortion_lut_size = 0;        // Samples per side
+        std::string                             calibration_cache_path;         // Empty to always query the system
+
+        //------------------------------------------------------------------------------
+        // HMD properties to query into the property cache.
+        std::vector<vr::TrackedDeviceProperty>  string_properties;
+        std::vector<vr::TrackedDeviceProperty>  float_properties;
+
+        //------------------------------------------------------------------------------
+        // The device strings and display timing properties.
+        static Settings defaults();
+    };
+
+    //------------------------------------------------------------------------------
+    // The resources of one eye. Meshes are in OpenVR layout, indexed meshes are
+    // empty for line loops, if indexing is disabled or not possible.
+    struct EyeResources
+    {
+        HiddenAreaMeshData                      hidden_area_meshes[vr::k_eHiddenAreaMesh_Max];
+        IndexedMesh                             indexed_meshes[vr::k_eHiddenAreaMesh_Max];
+        std::unique_ptr<HiddenAreaTileMask>     tile_mask;
+        std::unique_ptr<VisibleRegion>          visible_region;
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Build the graph. Throws if the system is null.
+    VRInitializer(vr::IVRSystem* const system, const Settings& settings);
+
+    VRInitializer(const VRInitializer&) = delete;
+    VRInitializer& operator=(const VRInitializer&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Execution
+public:
+
+    TaskGraph& graph() { return m_graph; }
+    const TaskGraph& graph() const { return m_graph; }
+
+    //------------------------------------------------------------------------------
+    // See TaskGraph::start() and TaskGraph::wait(). The distortion LUT is sampled
+    // on the same pool.
+    void start(ThreadPool& pool, TaskGraph::completion_t completion = {});
+    void wait() { m_graph.wait(); }
+
+    //------------------------------------------------------------------------------
+    // The tasks producing each resource (TaskGraph::INVALID_TASK if skipped).
+    task_t calibration_cache_task() const { return m_calibration_cache_task; }
+    task_t calibration_cache_write_task() const { return m_calibration_cache_write_task; }
+    task_t render_target_size_task() const { return m_render_target_size_task; }
+    task_t properties_task() const { return m_properties_task; }
+    task_t hidden_area_mesh_task(vr::EVREye eye, vr::EHiddenAreaMeshType type) const { return m_hidden_area_mesh_tasks[eye][type]; }
+    task_t tile_mask_task(vr::EVREye eye) const { return m_tile_mask_tasks[eye]; }
+    task_t visible_region_task(vr::EVREye eye) const { return m_visible_region_tasks[eye]; }
+    task_t distortion_lut_task() const { return m_distortion_lut_task; }
+
+    //------------------------------------------------------------------------------
+    // Resources
+public:
+
+    vr::IVRSystem* system() const { return m_system; }
+
+    uint32_t render_target_width() const { return m_render_target_width; }
+    uint32_t render_target_height() const { return m_render_target_height; }
+
+    const EyeResources& eye(vr::EVREye eye) const { return m_eyes[eye]; }
+
+    //------------------------------------------------------------------------------
+    // Null if skipped.
+    const DistortionLUT* distortion_lut() const { return m_distortion_lut.get(); }
+
+    //------------------------------------------------------------------------------
+    // Null without a calibration cache path or if there was no valid cache to load.
+    const CalibrationCache* calibration_cache() const { return m_calibration_cache.get(); }
+
+    TrackedDevicePropertyCache& property_cache() { return m_property_cache; }
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    //------------------------------------------------------------------------------
+    // The calibration cache key from the property cache, and the LUT size of the
+    // calibration cache.
+    CalibrationKey calibration_key();
+    size_t calibration_lut_size() const;
+
+    vr::IVRSystem* const                    m_system;
+    const Settings                          m_settings;
+
+    ThreadPool*                             m_pool;
+
+    task_t                                  m_calibration_cache_task;
+    task_t                                  m_calibration_cache_write_task;
+    task_t                                  m_render_target_size_task;
+    task_t                                  m_properties_task;
+    task_t                                  m_hidden_area_mesh_tasks[2][vr::k_eHiddenAreaMesh_Max];
+    task_t                                  m_tile_mask_tasks[2];
+    task_t                                  m_visible_region_tasks[2];
+    task_t                                  m_distortion_lut_task;
+
+    std::unique_ptr<CalibrationCache>       m_calibration_cache;    // Before the LUT which may refer to it
+    uint32_t                                m_render_target_width;
+    uint32_t                                m_render_target_height;
+    EyeResources                            m_eyes[2];
+    std::unique_ptr<DistortionLUT>          m_distortion_lut;
+    TrackedDevicePropertyCache              m_property_cache;
+
+    //------------------------------------------------------------------------------
+    // Last, so it is destroyed (waiting for running tasks) before the resources.
+    TaskGraph                               m_graph;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __VR_INITIALIZER_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
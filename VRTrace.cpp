@@ -0,0 +1,1072 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VRTrace.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    constexpr size_t RECORD_ALIGNMENT = 8;
+
+    size_t padded_size(size_t size)
+    {
+        return ((size + (RECORD_ALIGNMENT - 1)) & ~(RECORD_ALIGNMENT - 1));
+    }
+
+    uint32_t float_bits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    //------------------------------------------------------------------------------
+    // Keys of the records recorded per distinct set of arguments. Floats are keyed
+    // by their bits so every distinct value is recorded.
+    uint64_t uv_key(float u, float v)
+    {
+        return ((uint64_t(float_bits(u)) << 32) | uint64_t(float_bits(v)));
+    }
+
+    uint64_t property_key(vr::TrackedDeviceIndex_t device, vr::ETrackedDeviceProperty property, VRTracePropertyType type)
+    {
+        return ((uint64_t(device) << 40) | (uint64_t(type) << 32) | uint64_t(uint32_t(property)));
+    }
+
+    //------------------------------------------------------------------------------
+    // The number of vertices of a hidden area mesh: line loops count vertices,
+    // the other types triangles.
+    size_t num_hidden_area_vertices(const vr::HiddenAreaMesh_t& mesh, vr::EHiddenAreaMeshType type)
+    {
+        return ((type == vr::k_eHiddenAreaMesh_LineLoop) ? size_t(mesh.unTriangleCount) : (size_t(mesh.unTriangleCount) * 3));
+    }
+
+    void require_valid(bool valid)
+    {
+        if (not valid) {
+            throw std::runtime_error("Invalid trace file!");
+        }
+    }
+
+    size_t property_value_size(VRTracePropertyType type)
+    {
+        switch (type) {
+            case VRTraceProperty_Bool: return sizeof(uint8_t);
+            case VRTraceProperty_Float: return sizeof(float);
+            case VRTraceProperty_Int32: return sizeof(int32_t);
+            case VRTraceProperty_Uint64: return sizeof(uint64_t);
+            case VRTraceProperty_Matrix34: return sizeof(vr::HmdMatrix34_t);
+            default: throw std::runtime_error("Invalid trace file!");
+        }
+    }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr char VRTraceFileHeader::MAGIC[4];
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecordingVRSystem::RecordingVRSystem(vr::IVRSystem* const system, const char* const path)
+    : m_system(system)
+    , m_num_bytes_written(0)
+    , m_num_pose_frames(0)
+    , m_recorded_render_target_size(false)
+    , m_recorded_projection_raw()
+    , m_recorded_eye_to_head_transforms()
+    , m_recorded_hidden_area_meshes()
+    , m_recorded_devices()
+{
+    if (not system) {
+        throw std::runtime_error("Invalid system!");
+    }
+
+    if (not m_writer.open(path, true)) {
+        throw std::runtime_error("Failed to open trace file!");
+    }
+
+    VRTraceFileHeader header = {};
+    std::memcpy(header.magic, VRTraceFileHeader::MAGIC, sizeof(header.magic));
+    header.version = VRTraceFileHeader::VERSION;
+    header.header_size = sizeof(VRTraceFileHeader);
+    header.pose_size = sizeof(vr::TrackedDevicePose_t);
+
+    m_writer.write_bytes(&header, sizeof(header));
+    m_num_bytes_written = sizeof(header);
+}
+
+RecordingVRSystem::~RecordingVRSystem()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RecordingVRSystem::record_distortion_grid(size_t width, size_t height, ThreadPool* const pool)
+{
+    //------------------------------------------------------------------------------
+    // Sample the wrapped system directly so the individual samples are not
+    // recorded as well.
+    const DistortionLUT lut(m_system, width, height, pool);
+
+    VRTraceDistortionGrid grid = {};
+    grid.width = uint32_t(width);
+    grid.height = uint32_t(height);
+
+    //------------------------------------------------------------------------------
+    // The tables of both eyes are stored back to back, see DistortionLUT's
+    // constructor for existing tables.
+    const size_t table_size = (lut.size_in_bytes() / 2);
+
+    std::vector<float> tables(lut.size_in_bytes() / sizeof(float));
+    std::memcpy(tables.data(), lut.channel(vr::Eye_Left, DistortionLUT::Channel_RedU), table_size);
+    std::memcpy((reinterpret_cast<char*>(tables.data()) + table_size), lut.channel(vr::Eye_Right, DistortionLUT::Channel_RedU), table_size);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    write_record(VRTraceRecord_DistortionGrid, &grid, sizeof(grid), tables.data(), lut.size_in_bytes());
+}
+
+bool
+RecordingVRSystem::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_writer.close();
+}
+
+uint64_t
+RecordingVRSystem::num_bytes_written() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_bytes_written;
+}
+
+uint64_t
+RecordingVRSystem::num_pose_frames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_pose_frames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RecordingVRSystem::GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight)
+{
+    VRTraceRenderTargetSize size = {};
+    m_system->GetRecommendedRenderTargetSize(&size.width, &size.height);
+
+    if (pnWidth) {
+        *pnWidth = size.width;
+    }
+
+    if (pnHeight) {
+        *pnHeight = size.height;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (not m_recorded_render_target_size) {
+        m_recorded_render_target_size = true;
+        write_record(VRTraceRecord_RenderTargetSize, &size, sizeof(size));
+    }
+}
+
+vr::HmdMatrix44_t
+RecordingVRSystem::GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ)
+{
+    VRTraceProjectionMatrix record = {};
+    record.eye = uint32_t(eEye);
+    record.near_z = fNearZ;
+    record.far_z = fFarZ;
+    record.matrix = m_system->GetProjectionMatrix(eEye, fNearZ, fFarZ);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_recorded_projection_matrices[eEye].insert(uv_key(fNearZ, fFarZ)).second) {
+        write_record(VRTraceRecord_ProjectionMatrix, &record, sizeof(record));
+    }
+
+    return record.matrix;
+}
+
+void
+RecordingVRSystem::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom)
+{
+    VRTraceProjectionRaw record = {};
+    record.eye = uint32_t(eEye);
+    m_system->GetProjectionRaw(eEye, &record.left, &record.right, &record.top, &record.bottom);
+
+    if (pfLeft) {
+        *pfLeft = record.left;
+    }
+
+    if (pfRight) {
+        *pfRight = record.right;
+    }
+
+    if (pfTop) {
+        *pfTop = record.top;
+    }
+
+    if (pfBottom) {
+        *pfBottom = record.bottom;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (not m_recorded_projection_raw[eEye]) {
+        m_recorded_projection_raw[eEye] = true;
+        write_record(VRTraceRecord_ProjectionRaw, &record, sizeof(record));
+    }
+}
+
+bool
+RecordingVRSystem::ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates)
+{
+    if (not pDistortionCoordinates) {
+        return m_system->ComputeDistortion(eEye, fU, fV, pDistortionCoordinates);
+    }
+
+    VRTraceDistortion record = {};
+    record.eye = uint32_t(eEye);
+    record.u = fU;
+    record.v = fV;
+    record.result = (m_system->ComputeDistortion(eEye, fU, fV, &record.coordinates) ? 1 : 0);
+
+    *pDistortionCoordinates = record.coordinates;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_recorded_distortions[eEye].insert(uv_key(fU, fV)).second) {
+        write_record(VRTraceRecord_Distortion, &record, sizeof(record));
+    }
+
+    return (record.result != 0);
+}
+
+vr::HmdMatrix34_t
+RecordingVRSystem::GetEyeToHeadTransform(vr::EVREye eEye)
+{
+    VRTraceEyeToHeadTransform record = {};
+    record.eye = uint32_t(eEye);
+    record.matrix = m_system->GetEyeToHeadTransform(eEye);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (not m_recorded_eye_to_head_transforms[eEye]) {
+        m_recorded_eye_to_head_transforms[eEye] = true;
+        write_record(VRTraceRecord_EyeToHeadTransform, &record, sizeof(record));
+    }
+
+    return record.matrix;
+}
+
+void
+RecordingVRSystem::GetOutputDevice(uint64_t* pnDevice, vr::ETextureType textureType, VkInstance_T* pInstance)
+{
+    m_system->GetOutputDevice(pnDevice, textureType, pInstance);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RecordingVRSystem::GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                                   float fPredictedSecondsToPhotonsFromNow,
+                                                   vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                                   uint32_t unTrackedDevicePoseArrayCount)
+{
+    m_system->GetDeviceToAbsoluteTrackingPose(eOrigin, fPredictedSecondsToPhotonsFromNow, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+
+    if (not pTrackedDevicePoseArray) {
+        return;
+    }
+
+    VRTracePoses record = {};
+    record.origin = uint32_t(eOrigin);
+    record.predicted_seconds = fPredictedSecondsToPhotonsFromNow;
+    record.count = unTrackedDevicePoseArrayCount;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    write_record(VRTraceRecord_Poses, &record, sizeof(record), pTrackedDevicePoseArray, (sizeof(vr::TrackedDevicePose_t) * unTrackedDevicePoseArrayCount));
+    ++m_num_pose_frames;
+}
+
+vr::ETrackedDeviceClass
+RecordingVRSystem::GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    record_device(unDeviceIndex);
+    return m_system->GetTrackedDeviceClass(unDeviceIndex);
+}
+
+bool
+RecordingVRSystem::IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    record_device(unDeviceIndex);
+    return m_system->IsTrackedDeviceConnected(unDeviceIndex);
+}
+
+vr::EDeviceActivityLevel
+RecordingVRSystem::GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId)
+{
+    record_device(unDeviceId);
+    return m_system->GetTrackedDeviceActivityLevel(unDeviceId);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+RecordingVRSystem::GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const uint8_t value = (m_system->GetBoolTrackedDeviceProperty(unDeviceIndex, prop, &error) ? 1 : 0);
+
+    record_property(unDeviceIndex, prop, VRTraceProperty_Bool, error, &value, sizeof(value));
+    return fail(pError, (value != 0), error);
+}
+
+float
+RecordingVRSystem::GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const float value = m_system->GetFloatTrackedDeviceProperty(unDeviceIndex, prop, &error);
+
+    record_property(unDeviceIndex, prop, VRTraceProperty_Float, error, &value, sizeof(value));
+    return fail(pError, value, error);
+}
+
+int32_t
+RecordingVRSystem::GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const int32_t value = m_system->GetInt32TrackedDeviceProperty(unDeviceIndex, prop, &error);
+
+    record_property(unDeviceIndex, prop, VRTraceProperty_Int32, error, &value, sizeof(value));
+    return fail(pError, value, error);
+}
+
+uint64_t
+RecordingVRSystem::GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const uint64_t value = m_system->GetUint64TrackedDeviceProperty(unDeviceIndex, prop, &error);
+
+    record_property(unDeviceIndex, prop, VRTraceProperty_Uint64, error, &value, sizeof(value));
+    return fail(pError, value, error);
+}
+
+vr::HmdMatrix34_t
+RecordingVRSystem::GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const vr::HmdMatrix34_t value = m_system->GetMatrix34TrackedDeviceProperty(unDeviceIndex, prop, &error);
+
+    record_property(unDeviceIndex, prop, VRTraceProperty_Matrix34, error, &value, sizeof(value));
+    return fail(pError, value, error);
+}
+
+uint32_t
+RecordingVRSystem::GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                                  vr::ETrackedDeviceProperty prop,
+                                                  char* pchValue,
+                                                  uint32_t unBufferSize,
+                                                  vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error = vr::TrackedProp_Success;
+    const uint32_t size = m_system->GetStringTrackedDeviceProperty(unDeviceIndex, prop, pchValue, unBufferSize, &error);
+
+    if (pError) {
+        *pError = error;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_recorded_properties.count(property_key(unDeviceIndex, prop, VRTraceProperty_String)) != 0) {
+            return size;
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Record the whole string even if the caller only asked for its size (or its
+    // buffer was too small), querying it again if necessary.
+    if ((error == vr::TrackedProp_Success) && pchValue) {
+        record_property(unDeviceIndex, prop, VRTraceProperty_String, error, pchValue, size);
+    }
+    else if ((error == vr::TrackedProp_Success) || (error == vr::TrackedProp_BufferTooSmall)) {
+        std::vector<char> value(std::max(size, uint32_t(1)));
+        vr::ETrackedPropertyError value_error = vr::TrackedProp_Success;
+        const uint32_t value_size = m_system->GetStringTrackedDeviceProperty(unDeviceIndex, prop, value.data(), uint32_t(value.size()), &value_error);
+
+        if (value_error == vr::TrackedProp_Success) {
+            record_property(unDeviceIndex, prop, VRTraceProperty_String, value_error, value.data(), value_size);
+        }
+    }
+    else {
+        record_property(unDeviceIndex, prop, VRTraceProperty_String, error, nullptr, size);
+    }
+
+    return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::HiddenAreaMesh_t
+RecordingVRSystem::GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type)
+{
+    const vr::HiddenAreaMesh_t mesh = m_system->GetHiddenAreaMesh(eEye, type);
+
+    VRTraceHiddenAreaMesh record = {};
+    record.eye = uint32_t(eEye);
+    record.type = uint32_t(type);
+    record.count = mesh.unTriangleCount;
+    record.num_vertices = (mesh.pVertexData ? uint32_t(num_hidden_area_vertices(mesh, type)) : 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (not m_recorded_hidden_area_meshes[eEye][type]) {
+        m_recorded_hidden_area_meshes[eEye][type] = true;
+        write_record(VRTraceRecord_HiddenAreaMesh, &record, sizeof(record), mesh.pVertexData, (sizeof(vr::HmdVector2_t) * record.num_vertices));
+    }
+
+    return mesh;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RecordingVRSystem::record_device(vr::TrackedDeviceIndex_t device)
+{
+    if (device >= vr::k_unMaxTrackedDeviceCount) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_recorded_devices[device]) {
+            return;
+        }
+    }
+
+    VRTraceDevice record = {};
+    record.device = device;
+    record.device_class = uint32_t(m_system->GetTrackedDeviceClass(device));
+    record.connected = (m_system->IsTrackedDeviceConnected(device) ? 1 : 0);
+    record.activity_level = uint32_t(m_system->GetTrackedDeviceActivityLevel(device));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (not m_recorded_devices[device]) {
+        m_recorded_devices[device] = true;
+        write_record(VRTraceRecord_Device, &record, sizeof(record));
+    }
+}
+
+void
+RecordingVRSystem::record_property(vr::TrackedDeviceIndex_t device,
+                                   vr::ETrackedDeviceProperty property,
+                                   VRTracePropertyType type,
+                                   vr::ETrackedPropertyError error,
+                                   const void* const value,
+                                   uint32_t size)
+{
+    VRTraceProperty record = {};
+    record.device = device;
+    record.property = uint32_t(property);
+    record.type = uint32_t(type);
+    record.error = uint32_t(error);
+    record.size = size;
+
+    //------------------------------------------------------------------------------
+    // Strings that could not be read record only the return value.
+    const size_t value_size = (value ? size_t(size) : 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_recorded_properties.insert(property_key(device, property, type)).second) {
+        write_record(VRTraceRecord_Property, &record, sizeof(record), value, value_size);
+    }
+}
+
+void
+RecordingVRSystem::write_record(VRTraceRecordType type, const void* const payload, size_t payload_size, const void* const data, size_t data_size)
+{
+    static const uint8_t PADDING[RECORD_ALIGNMENT] = {};
+
+    if (not m_writer.is_open()) {
+        return;
+    }
+
+    VRTraceRecordHeader header = {};
+    header.type = uint32_t(type);
+    header.size = uint32_t(payload_size + data_size);
+
+    const size_t size = padded_size(header.size);
+
+    m_writer.write_bytes(&header, sizeof(header));
+    m_writer.write_bytes(payload, payload_size);
+
+    if (data_size != 0) {
+        m_writer.write_bytes(data, data_size);
+    }
+
+    m_writer.write_bytes(PADDING, (size - header.size));
+    m_num_bytes_written += (sizeof(header) + size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReplayVRSystem::ReplayVRSystem(const char* const path)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_end(0)
+    , m_num_distortion_misses(0)
+    , m_num_pose_frames(0)
+    , m_first_pose_offset(0)
+    , m_next_pose_offset(0)
+{
+    //------------------------------------------------------------------------------
+    // Map the whole file.
+    const int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open trace file!");
+    }
+
+    struct stat file_stat;
+
+    if ((::fstat(fd, &file_stat) != 0) || (size_t(file_stat.st_size) < sizeof(VRTraceFileHeader))) {
+        ::close(fd);
+        throw std::runtime_error("Invalid trace file!");
+    }
+
+    m_size = size_t(file_stat.st_size);
+    m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    ::close(fd);
+
+    if (m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw std::runtime_error("Failed to map trace file!");
+    }
+
+    //------------------------------------------------------------------------------
+    // Index the records. Of static records recorded more than once the first one
+    // wins, like when recording. Unknown record types are skipped.
+    const char* const bytes = static_cast<const char*>(m_data);
+
+    try {
+        const VRTraceFileHeader* const header = reinterpret_cast<const VRTraceFileHeader*>(bytes);
+
+        if ((std::memcmp(header->magic, VRTraceFileHeader::MAGIC, sizeof(header->magic)) != 0) ||
+            (header->version != VRTraceFileHeader::VERSION) ||
+            (header->header_size != sizeof(VRTraceFileHeader)) ||
+            (header->pose_size != sizeof(vr::TrackedDevicePose_t)))
+        {
+            throw std::runtime_error("Invalid trace file!");
+        }
+
+        size_t offset = sizeof(VRTraceFileHeader);
+
+        while ((m_size - offset) >= sizeof(VRTraceRecordHeader)) {
+            const VRTraceRecordHeader* const record = reinterpret_cast<const VRTraceRecordHeader*>(bytes + offset);
+            const size_t size = record->size;
+
+            if (((m_size - offset) - sizeof(VRTraceRecordHeader)) < padded_size(size)) {
+                break;
+            }
+
+            const char* const payload = (bytes + offset + sizeof(VRTraceRecordHeader));
+
+            switch (record->type) {
+                case VRTraceRecord_RenderTargetSize: {
+                    require_valid(size >= sizeof(VRTraceRenderTargetSize));
+
+                    if (not m_render_target_size) {
+                        m_render_target_size = reinterpret_cast<const VRTraceRenderTargetSize*>(payload);
+                    }
+                } break;
+
+                case VRTraceRecord_ProjectionRaw: {
+                    require_valid(size >= sizeof(VRTraceProjectionRaw));
+                    const VRTraceProjectionRaw* const projection = reinterpret_cast<const VRTraceProjectionRaw*>(payload);
+                    require_valid(projection->eye < 2);
+
+                    if (not m_projection_raw[projection->eye]) {
+                        m_projection_raw[projection->eye] = projection;
+                    }
+                } break;
+
+                case VRTraceRecord_ProjectionMatrix: {
+                    require_valid(size >= sizeof(VRTraceProjectionMatrix));
+                    const VRTraceProjectionMatrix* const projection = reinterpret_cast<const VRTraceProjectionMatrix*>(payload);
+                    require_valid(projection->eye < 2);
+
+                    m_projection_matrices[projection->eye].emplace(uv_key(projection->near_z, projection->far_z), projection);
+                } break;
+
+                case VRTraceRecord_EyeToHeadTransform: {
+                    require_valid(size >= sizeof(VRTraceEyeToHeadTransform));
+                    const VRTraceEyeToHeadTransform* const transform = reinterpret_cast<const VRTraceEyeToHeadTransform*>(payload);
+                    require_valid(transform->eye < 2);
+
+                    if (not m_eye_to_head_transforms[transform->eye]) {
+                        m_eye_to_head_transforms[transform->eye] = transform;
+                    }
+                } break;
+
+                case VRTraceRecord_HiddenAreaMesh: {
+                    require_valid(size >= sizeof(VRTraceHiddenAreaMesh));
+                    const VRTraceHiddenAreaMesh* const mesh = reinterpret_cast<const VRTraceHiddenAreaMesh*>(payload);
+                    require_valid(mesh->eye < 2);
+                    require_valid(mesh->type < vr::k_eHiddenAreaMesh_Max);
+                    require_valid(size >= (sizeof(VRTraceHiddenAreaMesh) + (sizeof(vr::HmdVector2_t) * size_t(mesh->num_vertices))));
+
+                    if (not m_hidden_area_meshes[mesh->eye][mesh->type]) {
+                        m_hidden_area_meshes[mesh->eye][mesh->type] = mesh;
+                    }
+                } break;
+
+                case VRTraceRecord_Distortion: {
+                    require_valid(size >= sizeof(VRTraceDistortion));
+                    const VRTraceDistortion* const distortion = reinterpret_cast<const VRTraceDistortion*>(payload);
+                    require_valid(distortion->eye < 2);
+
+                    m_distortions[distortion->eye].emplace(uv_key(distortion->u, distortion->v), distortion);
+                } break;
+
+                case VRTraceRecord_DistortionGrid: {
+                    require_valid(size >= sizeof(VRTraceDistortionGrid));
+                    const VRTraceDistortionGrid* const grid = reinterpret_cast<const VRTraceDistortionGrid*>(payload);
+                    const size_t table_size = (size_t(grid->width) * size_t(grid->height) * DistortionLUT::Channel_Count);
+                    require_valid(size >= (sizeof(VRTraceDistortionGrid) + (sizeof(float) * 2 * table_size)));
+
+                    if (not m_distortion_grid) {
+                        const float* const tables = reinterpret_cast<const float*>(grid + 1);
+                        m_distortion_grid = std::make_unique<DistortionLUT>(grid->width, grid->height, tables, (tables + table_size));
+                    }
+                } break;
+
+                case VRTraceRecord_Property: {
+                    require_valid(size >= sizeof(VRTraceProperty));
+                    const VRTraceProperty* const property = reinterpret_cast<const VRTraceProperty*>(payload);
+                    const VRTracePropertyType type = VRTracePropertyType(property->type);
+
+                    //------------------------------------------------------------------------------
+                    // Strings hold their value only if they could be read.
+                    if (type == VRTraceProperty_String) {
+                        require_valid(size >= (sizeof(VRTraceProperty) + ((property->error == vr::TrackedProp_Success) ? size_t(property->size) : 0)));
+                    }
+                    else {
+                        require_valid(property->size >= property_value_size(type));
+                        require_valid(size >= (sizeof(VRTraceProperty) + property_value_size(type)));
+                    }
+
+                    m_properties.emplace(property_key(property->device, vr::ETrackedDeviceProperty(property->property), type), property);
+                } break;
+
+                case VRTraceRecord_Device: {
+                    require_valid(size >= sizeof(VRTraceDevice));
+                    const VRTraceDevice* const device = reinterpret_cast<const VRTraceDevice*>(payload);
+                    require_valid(device->device < vr::k_unMaxTrackedDeviceCount);
+
+                    if (not m_devices[device->device]) {
+                        m_devices[device->device] = device;
+                    }
+                } break;
+
+                case VRTraceRecord_Poses: {
+                    require_valid(size >= sizeof(VRTracePoses));
+                    const VRTracePoses* const poses = reinterpret_cast<const VRTracePoses*>(payload);
+                    require_valid(size >= (sizeof(VRTracePoses) + (sizeof(vr::TrackedDevicePose_t) * size_t(poses->count))));
+
+                    if (m_num_pose_frames++ == 0) {
+                        m_first_pose_offset = offset;
+                    }
+                } break;
+
+                default:
+                    break;
+            }
+
+            offset += (sizeof(VRTraceRecordHeader) + padded_size(size));
+        }
+
+        m_end = offset;
+        m_next_pose_offset = m_first_pose_offset;
+    }
+    catch (...) {
+        ::munmap(m_data, m_size);
+        throw;
+    }
+}
+
+ReplayVRSystem::~ReplayVRSystem()
+{
+    //------------------------------------------------------------------------------
+    // The grid points into the mapping.
+    m_distortion_grid.reset();
+
+    ::munmap(m_data, m_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ReplayVRSystem::rewind_poses()
+{
+    std::lock_guard<std::mutex> lock(m_pose_mutex);
+    m_next_pose_offset = m_first_pose_offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ReplayVRSystem::GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight)
+{
+    if (not m_render_target_size) {
+        NullVRSystem::GetRecommendedRenderTargetSize(pnWidth, pnHeight);
+        return;
+    }
+
+    if (pnWidth) {
+        *pnWidth = m_render_target_size->width;
+    }
+
+    if (pnHeight) {
+        *pnHeight = m_render_target_size->height;
+    }
+}
+
+vr::HmdMatrix44_t
+ReplayVRSystem::GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ)
+{
+    const auto projection = m_projection_matrices[eEye].find(uv_key(fNearZ, fFarZ));
+
+    if (projection != m_projection_matrices[eEye].end()) {
+        return projection->second->matrix;
+    }
+
+    //------------------------------------------------------------------------------
+    // Compose the raw projection like the runtime (depth in [0, 1]), see
+    // SyntheticVRSystem::GetProjectionMatrix().
+    float left, right, top, bottom;
+    GetProjectionRaw(eEye, &left, &right, &top, &bottom);
+
+    const float idx = (1.0f / (right - left));
+    const float idy = (1.0f / (bottom - top));
+    const float idz = (1.0f / (fFarZ - fNearZ));
+
+    vr::HmdMatrix44_t m = {};
+    m.m[0][0] = (2.0f * idx);
+    m.m[0][2] = ((right + left) * idx);
+    m.m[1][1] = (2.0f * idy);
+    m.m[1][2] = ((bottom + top) * idy);
+    m.m[2][2] = (-fFarZ * idz);
+    m.m[2][3] = (-fFarZ * fNearZ * idz);
+    m.m[3][2] = -1.0f;
+
+    return m;
+}
+
+void
+ReplayVRSystem::GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom)
+{
+    const VRTraceProjectionRaw* const projection = m_projection_raw[eEye];
+
+    if (not projection) {
+        NullVRSystem::GetProjectionRaw(eEye, pfLeft, pfRight, pfTop, pfBottom);
+        return;
+    }
+
+    if (pfLeft) {
+        *pfLeft = projection->left;
+    }
+
+    if (pfRight) {
+        *pfRight = projection->right;
+    }
+
+    if (pfTop) {
+        *pfTop = projection->top;
+    }
+
+    if (pfBottom) {
+        *pfBottom = projection->bottom;
+    }
+}
+
+bool
+ReplayVRSystem::ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates)
+{
+    if (not pDistortionCoordinates) {
+        return false;
+    }
+
+    const auto distortion = m_distortions[eEye].find(uv_key(fU, fV));
+
+    if (distortion != m_distortions[eEye].end()) {
+        *pDistortionCoordinates = distortion->second->coordinates;
+        return (distortion->second->result != 0);
+    }
+
+    m_num_distortion_misses.fetch_add(1, std::memory_order_relaxed);
+
+    if (not m_distortion_grid) {
+        return false;
+    }
+
+    *pDistortionCoordinates = m_distortion_grid->lookup(eEye, fU, fV);
+    return true;
+}
+
+vr::HmdMatrix34_t
+ReplayVRSystem::GetEyeToHeadTransform(vr::EVREye eEye)
+{
+    return (m_eye_to_head_transforms[eEye] ? m_eye_to_head_transforms[eEye]->matrix : identity34());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ReplayVRSystem::GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                                float fPredictedSecondsToPhotonsFromNow,
+                                                vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                                uint32_t unTrackedDevicePoseArrayCount)
+{
+    if ((m_num_pose_frames == 0) || (not pTrackedDevicePoseArray)) {
+        NullVRSystem::GetDeviceToAbsoluteTrackingPose(eOrigin, fPredictedSecondsToPhotonsFromNow, pTrackedDevicePoseArray, unTrackedDevicePoseArrayCount);
+        return;
+    }
+
+    size_t offset;
+
+    {
+        std::lock_guard<std::mutex> lock(m_pose_mutex);
+        offset = m_next_pose_offset;
+        m_next_pose_offset = next_pose_offset(offset);
+    }
+
+    //------------------------------------------------------------------------------
+    // Copy outside the lock, the mapping is read-only. Devices beyond the recorded
+    // ones are reported as not connected.
+    const char* const payload = (static_cast<const char*>(m_data) + offset + sizeof(VRTraceRecordHeader));
+    const VRTracePoses* const frame = reinterpret_cast<const VRTracePoses*>(payload);
+    const uint32_t count = std::min(frame->count, unTrackedDevicePoseArrayCount);
+
+    std::memcpy(pTrackedDevicePoseArray, (frame + 1), (sizeof(vr::TrackedDevicePose_t) * count));
+
+    for (uint32_t i = count; i < unTrackedDevicePoseArrayCount; ++i) {
+        pTrackedDevicePoseArray[i] = invalid_pose();
+    }
+}
+
+vr::ETrackedDeviceClass
+ReplayVRSystem::GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    const VRTraceDevice* const device = ((unDeviceIndex < vr::k_unMaxTrackedDeviceCount) ? m_devices[unDeviceIndex] : nullptr);
+    return (device ? vr::ETrackedDeviceClass(device->device_class) : vr::TrackedDeviceClass_Invalid);
+}
+
+bool
+ReplayVRSystem::IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex)
+{
+    const VRTraceDevice* const device = ((unDeviceIndex < vr::k_unMaxTrackedDeviceCount) ? m_devices[unDeviceIndex] : nullptr);
+    return (device ? (device->connected != 0) : false);
+}
+
+vr::EDeviceActivityLevel
+ReplayVRSystem::GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId)
+{
+    const VRTraceDevice* const device = ((unDeviceId < vr::k_unMaxTrackedDeviceCount) ? m_devices[unDeviceId] : nullptr);
+    return (device ? vr::EDeviceActivityLevel(device->activity_level) : vr::k_EDeviceActivityLevel_Unknown);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ReplayVRSystem::GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error;
+    const void* const value = property_value(unDeviceIndex, prop, VRTraceProperty_Bool, &error);
+    return fail(pError, (value ? (*static_cast<const uint8_t*>(value) != 0) : false), error);
+}
+
+float
+ReplayVRSystem::GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error;
+    const void* const value = property_value(unDeviceIndex, prop, VRTraceProperty_Float, &error);
+    return fail(pError, (value ? *static_cast<const float*>(value) : 0.0f), error);
+}
+
+int32_t
+ReplayVRSystem::GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error;
+    const void* const value = property_value(unDeviceIndex, prop, VRTraceProperty_Int32, &error);
+    return fail(pError, (value ? *static_cast<const int32_t*>(value) : int32_t(0)), error);
+}
+
+uint64_t
+ReplayVRSystem::GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error;
+    const void* const value = property_value(unDeviceIndex, prop, VRTraceProperty_Uint64, &error);
+    return fail(pError, (value ? *static_cast<const uint64_t*>(value) : uint64_t(0)), error);
+}
+
+vr::HmdMatrix34_t
+ReplayVRSystem::GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError)
+{
+    vr::ETrackedPropertyError error;
+    const void* const value = property_value(unDeviceIndex, prop, VRTraceProperty_Matrix34, &error);
+    return fail(pError, (value ? *static_cast<const vr::HmdMatrix34_t*>(value) : identity34()), error);
+}
+
+uint32_t
+ReplayVRSystem::GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                               vr::ETrackedDeviceProperty prop,
+                                               char* pchValue,
+                                               uint32_t unBufferSize,
+                                               vr::ETrackedPropertyError* pError)
+{
+    if (pchValue && (unBufferSize > 0)) {
+        pchValue[0] = '\0';
+    }
+
+    const auto it = m_properties.find(property_key(unDeviceIndex, prop, VRTraceProperty_String));
+
+    if (it == m_properties.end()) {
+        return fail(pError, uint32_t(0));
+    }
+
+    const VRTraceProperty* const property = it->second;
+
+    if (property->error != vr::TrackedProp_Success) {
+        return fail(pError, property->size, vr::ETrackedPropertyError(property->error));
+    }
+
+    //------------------------------------------------------------------------------
+    // Like the runtime: return the required size including the terminator and fail
+    // without copying if the buffer is too small.
+    if ((pchValue == nullptr) || (unBufferSize < property->size)) {
+        return fail(pError, property->size, vr::TrackedProp_BufferTooSmall);
+    }
+
+    std::memcpy(pchValue, (property + 1), property->size);
+    return succeed(pError, property->size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vr::HiddenAreaMesh_t
+ReplayVRSystem::GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type)
+{
+    const VRTraceHiddenAreaMesh* const mesh = m_hidden_area_meshes[eEye][type];
+
+    if ((not mesh) || (mesh->num_vertices == 0)) {
+        return { nullptr, (mesh ? mesh->count : 0) };
+    }
+
+    return { reinterpret_cast<const vr::HmdVector2_t*>(mesh + 1), mesh->count };
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const void*
+ReplayVRSystem::property_value(vr::TrackedDeviceIndex_t device,
+                               vr::ETrackedDeviceProperty property,
+                               VRTracePropertyType type,
+                               vr::ETrackedPropertyError* const error) const
+{
+    const auto it = m_properties.find(property_key(device, property, type));
+
+    if (it == m_properties.end()) {
+        *error = vr::TrackedProp_UnknownProperty;
+        return nullptr;
+    }
+
+    //------------------------------------------------------------------------------
+    // The value is recorded even if the query failed, return it like the system.
+    *error = vr::ETrackedPropertyError(it->second->error);
+    return (it->second + 1);
+}
+
+size_t
+ReplayVRSystem::next_pose_offset(size_t offset) const
+{
+    const char* const bytes = static_cast<const char*>(m_data);
+
+    do {
+        const VRTraceRecordHeader* const record = reinterpret_cast<const VRTraceRecordHeader*>(bytes + offset);
+        offset += (sizeof(VRTraceRecordHeader) + padded_size(record->size));
+
+        if (offset >= m_end) {
+            return m_first_pose_offset;
+        }
+    } while (reinterpret_cast<const VRTraceRecordHeader*>(bytes + offset)->type != VRTraceRecord_Poses);
+
+    return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
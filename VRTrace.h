@@ -0,0 +1,460 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VR_TRACE_H__
+#define __VR_TRACE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "DistortionLUT.h"
+#include "ExportFormat.h"
+#include "NullVRSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ThreadPool;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// IVRSystem trace file format.
+//
+// A file is a VRTraceFileHeader followed by a sequence of records, each a
+// VRTraceRecordHeader and 'size' bytes of payload, zero padded to a multiple of
+// 8 bytes so every payload can be used in place once the file is memory mapped.
+// Records are only ever appended, so a trace can be written while recording
+// without holding it in memory, and a trailing partial record (e.g. of an
+// interrupted recording) is ignored when reading. Values are stored in the byte
+// order of the machine that wrote the file (little-endian on all supported
+// platforms).
+//------------------------------------------------------------------------------
+
+enum VRTraceRecordType : uint32_t {
+    VRTraceRecord_RenderTargetSize = 1,         // VRTraceRenderTargetSize
+    VRTraceRecord_ProjectionRaw = 2,            // VRTraceProjectionRaw
+    VRTraceRecord_ProjectionMatrix = 3,         // VRTraceProjectionMatrix
+    VRTraceRecord_EyeToHeadTransform = 4,       // VRTraceEyeToHeadTransform
+    VRTraceRecord_HiddenAreaMesh = 5,           // VRTraceHiddenAreaMesh followed by the vr::HmdVector2_t vertices
+    VRTraceRecord_Distortion = 6,               // VRTraceDistortion
+    VRTraceRecord_DistortionGrid = 7,           // VRTraceDistortionGrid followed by the DistortionLUT tables of both eyes
+    VRTraceRecord_Property = 8,                 // VRTraceProperty followed by the value
+    VRTraceRecord_Device = 9,                   // VRTraceDevice
+    VRTraceRecord_Poses = 10,                   // VRTracePoses followed by the vr::TrackedDevicePose_t array
+};
+
+enum VRTracePropertyType : uint32_t {
+    VRTraceProperty_Bool = 1,                   // uint8_t
+    VRTraceProperty_Float = 2,                  // float
+    VRTraceProperty_Int32 = 3,                  // int32_t
+    VRTraceProperty_Uint64 = 4,                 // uint64_t
+    VRTraceProperty_Matrix34 = 5,               // vr::HmdMatrix34_t
+    VRTraceProperty_String = 6,                 // Characters including the terminator
+};
+
+struct VRTraceFileHeader
+{
+    static constexpr char MAGIC[4] = { 'O', 'V', 'R', 'T' };
+    static constexpr uint16_t VERSION = 1;
+
+    char        magic[4];
+    uint16_t    version;
+    uint16_t    header_size;                    // sizeof(VRTraceFileHeader)
+    uint32_t    pose_size;                      // sizeof(vr::TrackedDevicePose_t)
+    uint32_t    reserved0;
+    uint8_t     reserved[16];
+};
+
+static_assert(sizeof(VRTraceFileHeader) == 32, "!");
+
+struct VRTraceRecordHeader
+{
+    uint32_t    type;                           // VRTraceRecordType
+    uint32_t    size;                           // Of the payload, excluding the padding
+};
+
+static_assert(sizeof(VRTraceRecordHeader) == 8, "!");
+
+struct VRTraceRenderTargetSize
+{
+    uint32_t    width;
+    uint32_t    height;
+};
+
+struct VRTraceProjectionRaw
+{
+    uint32_t    eye;                            // vr::EVREye
+    float       left;
+    float       right;
+    float       top;
+    float       bottom;
+    uint32_t    reserved0;
+};
+
+struct VRTraceProjectionMatrix
+{
+    uint32_t            eye;                    // vr::EVREye
+    float               near_z;
+    float               far_z;
+    uint32_t            reserved0;
+    vr::HmdMatrix44_t   matrix;
+};
+
+struct VRTraceEyeToHeadTransform
+{
+    uint32_t            eye;                    // vr::EVREye
+    uint32_t            reserved0;
+    vr::HmdMatrix34_t   matrix;
+};
+
+struct VRTraceHiddenAreaMesh
+{
+    uint32_t    eye;                            // vr::EVREye
+    uint32_t    type;                           // vr::EHiddenAreaMeshType
+    uint32_t    count;                          // HiddenAreaMesh_t::unTriangleCount
+    uint32_t    num_vertices;
+};
+
+struct VRTraceDistortion
+{
+    uint32_t                        eye;        // vr::EVREye
+    float                           u;
+    float                           v;
+    uint32_t                        result;     // Return value of ComputeDistortion()
+    vr::DistortionCoordinates_t     coordinates;
+};
+
+struct VRTraceDistortionGrid
+{
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    reserved[2];
+};
+
+struct VRTraceProperty
+{
+    uint32_t    device;                         // vr::TrackedDeviceIndex_t
+    uint32_t    property;                       // vr::ETrackedDeviceProperty
+    uint32_t    type;                           // VRTracePropertyType
+    uint32_t    error;                          // vr::ETrackedPropertyError
+    uint32_t    size;                           // Of the value; of strings the return value (required buffer size)
+    uint32_t    reserved0;
+};
+
+struct VRTraceDevice
+{
+    uint32_t    device;                         // vr::TrackedDeviceIndex_t
+    uint32_t    device_class;                   // vr::ETrackedDeviceClass
+    uint32_t    connected;
+    uint32_t    activity_level;                 // vr::EDeviceActivityLevel
+};
+
+struct VRTracePoses
+{
+    uint32_t    origin;                         // vr::ETrackingUniverseOrigin
+    float       predicted_seconds;              // fPredictedSecondsToPhotonsFromNow
+    uint32_t    count;
+    uint32_t    reserved0;
+};
+
+static_assert((sizeof(VRTraceProjectionRaw) % 8) == 0, "!");
+static_assert((sizeof(VRTraceProjectionMatrix) % 8) == 0, "!");
+static_assert((sizeof(VRTraceEyeToHeadTransform) % 8) == 0, "!");
+static_assert((sizeof(VRTraceDistortion) % 8) == 0, "!");
+static_assert((sizeof(VRTraceProperty) % 8) == 0, "!");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// An IVRSystem forwarding to another one and recording its responses to a trace
+// file for ReplayVRSystem.
+//
+// Recorded are the queries this library makes: the render target size, raw
+// and composed projections, eye transforms, hidden area meshes, distortion,
+// device classes and connection state, and all scalar, matrix and string
+// properties. These are recorded once per distinct set of arguments (the
+// first response wins) so repeated queries do not grow the trace. Poses are
+// recorded on every call to GetDeviceToAbsoluteTrackingPose(), one record per
+// frame, and written through a fixed size buffer so long recordings stream to
+// disk. GetOutputDevice() is forwarded without recording; everything else
+// behaves like NullVRSystem. Calls may be made concurrently if the wrapped
+// system supports it.
+//------------------------------------------------------------------------------
+
+class RecordingVRSystem : public NullVRSystem
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Start a trace at the given path, replacing an existing file. Throws if the
+    // system is null or the file can not be opened.
+    RecordingVRSystem(vr::IVRSystem* const system, const char* const path);
+    ~RecordingVRSystem();
+
+    RecordingVRSystem(const RecordingVRSystem&) = delete;
+    RecordingVRSystem& operator=(const RecordingVRSystem&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Recording
+public:
+
+    //------------------------------------------------------------------------------
+    // Sample the distortion of both eyes on a (width x height) grid (see
+    // DistortionLUT) and record the tables. ReplayVRSystem interpolates them for
+    // ComputeDistortion() calls with UVs that were not recorded exactly.
+    void record_distortion_grid(size_t width, size_t height, ThreadPool* const pool = nullptr);
+
+    //------------------------------------------------------------------------------
+    // Flush and close the trace. Later calls are still forwarded but no longer
+    // recorded. Returns false if any write has failed.
+    bool close();
+
+    vr::IVRSystem* system() const { return m_system; }
+
+    uint64_t num_bytes_written() const;
+    uint64_t num_pose_frames() const;
+
+    //------------------------------------------------------------------------------
+    // vr::IVRSystem
+public:
+
+    void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override;
+    vr::HmdMatrix44_t GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ) override;
+    void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override;
+    bool ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) override;
+    vr::HmdMatrix34_t GetEyeToHeadTransform(vr::EVREye eEye) override;
+    void GetOutputDevice(uint64_t* pnDevice, vr::ETextureType textureType, VkInstance_T* pInstance) override;
+
+    void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                         float fPredictedSecondsToPhotonsFromNow,
+                                         vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                         uint32_t unTrackedDevicePoseArrayCount) override;
+
+    vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) override;
+
+    bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    vr::HmdMatrix34_t GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                            vr::ETrackedDeviceProperty prop,
+                                            char* pchValue,
+                                            uint32_t unBufferSize,
+                                            vr::ETrackedPropertyError* pError) override;
+
+    vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type) override;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    //------------------------------------------------------------------------------
+    // Record the device class, connection state and activity level of the device
+    // unless already done.
+    void record_device(vr::TrackedDeviceIndex_t device);
+
+    //------------------------------------------------------------------------------
+    // Record a scalar or matrix property unless already done.
+    void record_property(vr::TrackedDeviceIndex_t device,
+                         vr::ETrackedDeviceProperty property,
+                         VRTracePropertyType type,
+                         vr::ETrackedPropertyError error,
+                         const void* const value,
+                         uint32_t size);
+
+    //------------------------------------------------------------------------------
+    // Append a record. Requires m_mutex to be held.
+    void write_record(VRTraceRecordType type, const void* const payload, size_t payload_size, const void* const data = nullptr, size_t data_size = 0);
+
+    vr::IVRSystem* const                m_system;
+
+    mutable std::mutex                  m_mutex;
+    BufferedFileWriter                  m_writer;
+    uint64_t                            m_num_bytes_written;
+    uint64_t                            m_num_pose_frames;
+
+    //------------------------------------------------------------------------------
+    // What has been recorded already, keyed by the arguments.
+    bool                                m_recorded_render_target_size;
+    bool                                m_recorded_projection_raw[2];
+    bool                                m_recorded_eye_to_head_transforms[2];
+    bool                                m_recorded_hidden_area_meshes[2][vr::k_eHiddenAreaMesh_Max];
+    bool                                m_recorded_devices[vr::k_unMaxTrackedDeviceCount];
+    std::unordered_set<uint64_t>        m_recorded_projection_matrices[2];
+    std::unordered_set<uint64_t>        m_recorded_distortions[2];
+    std::unordered_set<uint64_t>        m_recorded_properties;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// An IVRSystem answering from a trace recorded by RecordingVRSystem, for
+// deterministic tests and benchmarks without a headset.
+//
+// The trace is memory mapped and indexed once; responses are served from the
+// mapping without copying where the API allows it (hidden area meshes point
+// into the mapping, like the runtime's own). Queries that were not recorded
+// fail like NullVRSystem's, except that ComputeDistortion() falls back to
+// interpolating a recorded distortion grid and GetProjectionMatrix() to
+// composing the raw projection. Pose frames are replayed in order, one per call
+// to GetDeviceToAbsoluteTrackingPose() regardless of its arguments, starting
+// over after the last one; they are read sequentially from the mapping so long
+// traces need not fit in memory. All methods are safe to call concurrently.
+//------------------------------------------------------------------------------
+
+class ReplayVRSystem : public NullVRSystem
+{
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Map and index the trace at the given path. Throws if the file can not be
+    // mapped or is not a valid trace.
+    explicit ReplayVRSystem(const char* const path);
+    ~ReplayVRSystem();
+
+    ReplayVRSystem(const ReplayVRSystem&) = delete;
+    ReplayVRSystem& operator=(const ReplayVRSystem&) = delete;
+
+    //------------------------------------------------------------------------------
+    // Replay
+public:
+
+    size_t num_pose_frames() const { return m_num_pose_frames; }
+
+    //------------------------------------------------------------------------------
+    // Continue with the first pose frame.
+    void rewind_poses();
+
+    //------------------------------------------------------------------------------
+    // The recorded distortion grid, null if there is none.
+    const DistortionLUT* distortion_grid() const { return m_distortion_grid.get(); }
+
+    //------------------------------------------------------------------------------
+    // The number of ComputeDistortion() calls with UVs that were not recorded.
+    uint64_t num_distortion_misses() const { return m_num_distortion_misses.load(std::memory_order_relaxed); }
+
+    //------------------------------------------------------------------------------
+    // vr::IVRSystem
+public:
+
+    void GetRecommendedRenderTargetSize(uint32_t* pnWidth, uint32_t* pnHeight) override;
+    vr::HmdMatrix44_t GetProjectionMatrix(vr::EVREye eEye, float fNearZ, float fFarZ) override;
+    void GetProjectionRaw(vr::EVREye eEye, float* pfLeft, float* pfRight, float* pfTop, float* pfBottom) override;
+    bool ComputeDistortion(vr::EVREye eEye, float fU, float fV, vr::DistortionCoordinates_t* pDistortionCoordinates) override;
+    vr::HmdMatrix34_t GetEyeToHeadTransform(vr::EVREye eEye) override;
+
+    void GetDeviceToAbsoluteTrackingPose(vr::ETrackingUniverseOrigin eOrigin,
+                                         float fPredictedSecondsToPhotonsFromNow,
+                                         vr::TrackedDevicePose_t* pTrackedDevicePoseArray,
+                                         uint32_t unTrackedDevicePoseArrayCount) override;
+
+    vr::ETrackedDeviceClass GetTrackedDeviceClass(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    bool IsTrackedDeviceConnected(vr::TrackedDeviceIndex_t unDeviceIndex) override;
+    vr::EDeviceActivityLevel GetTrackedDeviceActivityLevel(vr::TrackedDeviceIndex_t unDeviceId) override;
+
+    bool GetBoolTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    float GetFloatTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    int32_t GetInt32TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    uint64_t GetUint64TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    vr::HmdMatrix34_t GetMatrix34TrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex, vr::ETrackedDeviceProperty prop, vr::ETrackedPropertyError* pError) override;
+    uint32_t GetStringTrackedDeviceProperty(vr::TrackedDeviceIndex_t unDeviceIndex,
+                                            vr::ETrackedDeviceProperty prop,
+                                            char* pchValue,
+                                            uint32_t unBufferSize,
+                                            vr::ETrackedPropertyError* pError) override;
+
+    vr::HiddenAreaMesh_t GetHiddenAreaMesh(vr::EVREye eEye, vr::EHiddenAreaMeshType type) override;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    //------------------------------------------------------------------------------
+    // The recorded value of a scalar or matrix property of the given type, or null
+    // (with the error set) if it was not recorded successfully.
+    const void* property_value(vr::TrackedDeviceIndex_t device,
+                               vr::ETrackedDeviceProperty property,
+                               VRTracePropertyType type,
+                               vr::ETrackedPropertyError* const error) const;
+
+    //------------------------------------------------------------------------------
+    // The offset of the pose frame following the one at the given offset, the
+    // first one after the last.
+    size_t next_pose_offset(size_t offset) const;
+
+    void*                                                               m_data;
+    size_t                                                              m_size;
+    size_t                                                              m_end;                  // Of the last complete record
+
+    const VRTraceRenderTargetSize*                                      m_render_target_size = nullptr;
+    const VRTraceProjectionRaw*                                         m_projection_raw[2] = {};
+    const VRTraceEyeToHeadTransform*                                    m_eye_to_head_transforms[2] = {};
+    const VRTraceHiddenAreaMesh*                                        m_hidden_area_meshes[2][vr::k_eHiddenAreaMesh_Max] = {};
+    const VRTraceDevice*                                                m_devices[vr::k_unMaxTrackedDeviceCount] = {};
+    std::unordered_map<uint64_t, const VRTraceProjectionMatrix*>        m_projection_matrices[2];
+    std::unordered_map<uint64_t, const VRTraceDistortion*>              m_distortions[2];
+    std::unordered_map<uint64_t, const VRTraceProperty*>                m_properties;
+    std::unique_ptr<DistortionLUT>                                      m_distortion_grid;
+    std::atomic<uint64_t>                                               m_num_distortion_misses;
+
+    //------------------------------------------------------------------------------
+    // Pose frames: the offsets of the first and next frame's record header.
+    size_t                                                              m_num_pose_frames;
+    size_t                                                              m_first_pose_offset;
+    std::mutex                                                          m_pose_mutex;
+    size_t                                                              m_next_pose_offset;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __VR_TRACE_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,336 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VisibleRegion.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "HiddenAreaTileMask.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VisibleRegion::VisibleRegion(const vr::HiddenAreaMesh_t& mesh, vr::EHiddenAreaMeshType type, uint32_t width, uint32_t height)
+    : m_width(width)
+    , m_height(height)
+    , m_row_begin(height, 0)
+    , m_row_end(height, 0)
+    , m_num_visible_pixels(0)
+{
+    if ((width == 0) || (height == 0)) {
+        throw std::runtime_error("Invalid visible region size!");
+    }
+
+    switch (type) {
+        case vr::k_eHiddenAreaMesh_Standard:
+        case vr::k_eHiddenAreaMesh_Inverse: {
+            std::vector<uint64_t> coverage;
+            HiddenAreaTileMask::rasterize_coverage(mesh, width, height, coverage);
+
+            //------------------------------------------------------------------------------
+            // The standard mesh covers the hidden pixels, invert it (without the bits
+            // past the width).
+            const size_t row_words = HiddenAreaTileMask::coverage_row_words(width);
+            const uint64_t last_word_mask = (((width % 64) == 0) ? ~uint64_t(0) : ((uint64_t(1) << (width % 64)) - 1));
+            const bool invert = (type == vr::k_eHiddenAreaMesh_Standard);
+
+            for (uint32_t y = 0; y < height; ++y) {
+                const uint64_t* const row = (coverage.data() + (row_words * y));
+                bool is_empty = true;
+
+                for (size_t word_index = 0; word_index < row_words; ++word_index) {
+                    uint64_t word = (invert ? ~row[word_index] : row[word_index]);
+
+                    if ((word_index + 1) == row_words) {
+                        word &= last_word_mask;
+                    }
+
+                    if (word == 0) {
+                        continue;
+                    }
+
+                    const uint32_t first = uint32_t((64 * word_index) + size_t(__builtin_ctzll(word)));
+                    const uint32_t last = uint32_t((64 * word_index) + 63 - size_t(__builtin_clzll(word)));
+
+                    if (is_empty) {
+                        m_row_begin[y] = first;
+                        is_empty = false;
+                    }
+
+                    m_row_end[y] = (last + 1);
+                    m_num_visible_pixels += size_t(__builtin_popcountll(word));
+                }
+            }
+
+            break;
+        }
+
+        case vr::k_eHiddenAreaMesh_LineLoop: {
+            //------------------------------------------------------------------------------
+            // Scan convert the polygon (even-odd rule) at pixel centers.
+            std::vector<double> x(mesh.unTriangleCount), y(mesh.unTriangleCount);
+
+            for (uint32_t i = 0; ((mesh.pVertexData != nullptr) && (i < mesh.unTriangleCount)); ++i) {
+                x[i] = (double(mesh.pVertexData[i].v[0]) * double(width));
+                y[i] = (double(mesh.pVertexData[i].v[1]) * double(height));
+            }
+
+            std::vector<double> crossings;
+
+            for (uint32_t row = 0; row < height; ++row) {
+                const double py = (double(row) + 0.5);
+
+                crossings.clear();
+
+                for (size_t i = 0; i < x.size(); ++i) {
+                    const size_t j = (((i + 1) < x.size()) ? (i + 1) : 0);
+
+                    if ((y[i] <= py) != (y[j] <= py)) {
+                        crossings.push_back(x[i] + (((py - y[i]) * (x[j] - x[i])) / (y[j] - y[i])));
+                    }
+                }
+
+                std::sort(crossings.begin(), crossings.end());
+
+                bool is_empty = true;
+
+                for (size_t i = 0; (i + 1) < crossings.size(); i += 2) {
+                    const auto center_index = [width](double position) {
+                        return uint32_t(std::min(std::max(std::ceil(position - 0.5), 0.0), double(width)));
+                    };
+
+                    const uint32_t begin = center_index(crossings[i]);
+                    const uint32_t end = center_index(crossings[i + 1]);
+
+                    if (begin >= end) {
+                        continue;
+                    }
+
+                    if (is_empty) {
+                        m_row_begin[row] = begin;
+                        is_empty = false;
+                    }
+
+                    m_row_end[row] = end;
+                    m_num_visible_pixels += (end - begin);
+                }
+            }
+
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Invalid hidden area mesh type!");
+            break;
+    }
+
+    compute_bounds();
+}
+
+VisibleRegion::VisibleRegion(uint32_t width, uint32_t height, const uint32_t* const row_begin, const uint32_t* const row_end, size_t num_visible_pixels)
+    : m_width(width)
+    , m_height(height)
+    , m_row_begin(row_begin, (row_begin + height))
+    , m_row_end(row_end, (row_end + height))
+    , m_num_visible_pixels(num_visible_pixels)
+{
+    if ((width == 0) || (height == 0)) {
+        throw std::runtime_error("Invalid visible region size!");
+    }
+
+    for (uint32_t y = 0; y < height; ++y) {
+        if ((m_row_begin[y] > m_row_end[y]) || (m_row_end[y] > width)) {
+            throw std::runtime_error("Invalid visible region row!");
+        }
+    }
+
+    compute_bounds();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+VisibleRegion::compute_bounds()
+{
+    uint32_t x0 = m_width, x1 = 0, y0 = m_height, y1 = 0;
+
+    for (uint32_t y = 0; y < m_height; ++y) {
+        if (m_row_begin[y] < m_row_end[y]) {
+            x0 = std::min(x0, m_row_begin[y]);
+            x1 = std::max(x1, m_row_end[y]);
+            y0 = std::min(y0, y);
+            y1 = (y + 1);
+        }
+    }
+
+    if (x0 < x1) {
+        m_bounds = { x0, y0, (x1 - x0), (y1 - y0) };
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<PixelRect>
+VisibleRegion::cover(size_t max_num_rects) const
+{
+    if (m_bounds.is_empty() || (max_num_rects == 0)) {
+        return {};
+    }
+
+    const size_t num_rows = m_bounds.height;
+    const size_t max_num_bands = std::min(max_num_rects, num_rows);
+
+    const uint32_t* const row_begin = (m_row_begin.data() + m_bounds.y);
+    const uint32_t* const row_end = (m_row_end.data() + m_bounds.y);
+
+    //------------------------------------------------------------------------------
+    // area[k][j] is the least area covering rows [0, j) with k bands, the last band
+    // starting at row start[k][j].
+    const size_t INVALID_AREA = SIZE_MAX;
+
+    std::vector<std::vector<size_t>> area((max_num_bands + 1), std::vector<size_t>((num_rows + 1), INVALID_AREA));
+    std::vector<std::vector<size_t>> start((max_num_bands + 1), std::vector<size_t>((num_rows + 1), 0));
+
+    area[0][0] = 0;
+
+    for (size_t k = 1; k <= max_num_bands; ++k) {
+        for (size_t j = k; j <= num_rows; ++j) {
+            uint32_t x0 = m_width, x1 = 0;
+
+            for (size_t i = j; i-- > (k - 1);) {
+                if (row_begin[i] < row_end[i]) {
+                    x0 = std::min(x0, row_begin[i]);
+                    x1 = std::max(x1, row_end[i]);
+                }
+
+                if (area[k - 1][i] == INVALID_AREA) {
+                    continue;
+                }
+
+                const size_t band_area = ((x0 < x1) ? (size_t(x1 - x0) * (j - i)) : 0);
+                const size_t total_area = (area[k - 1][i] + band_area);
+
+                if (total_area < area[k][j]) {
+                    area[k][j] = total_area;
+                    start[k][j] = i;
+                }
+            }
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Use as few bands as possible for the least area.
+    size_t num_bands = 1;
+
+    for (size_t k = 2; k <= max_num_bands; ++k) {
+        if (area[k][num_rows] < area[num_bands][num_rows]) {
+            num_bands = k;
+        }
+    }
+
+    std::vector<PixelRect> rects;
+
+    for (size_t k = num_bands, j = num_rows; k > 0; --k) {
+        const size_t i = start[k][j];
+        uint32_t x0 = m_width, x1 = 0;
+
+        for (size_t row = i; row < j; ++row) {
+            if (row_begin[row] < row_end[row]) {
+                x0 = std::min(x0, row_begin[row]);
+                x1 = std::max(x1, row_end[row]);
+            }
+        }
+
+        if (x0 < x1) {
+            rects.push_back({ x0, uint32_t(m_bounds.y + i), (x1 - x0), uint32_t(j - i) });
+        }
+
+        j = i;
+    }
+
+    std::reverse(rects.begin(), rects.end());
+
+    return rects;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VisibleRegion::Savings
+VisibleRegion::compute_savings(size_t max_num_rects, size_t bytes_per_pixel) const
+{
+    const std::vector<PixelRect> rects = cover(max_num_rects);
+
+    Savings savings;
+    savings.num_pixels = (size_t(m_width) * size_t(m_height));
+    savings.num_visible_pixels = m_num_visible_pixels;
+    savings.num_bounds_pixels = m_bounds.area();
+    savings.num_cover_rects = rects.size();
+    savings.bytes_per_pixel = bytes_per_pixel;
+
+    for (const PixelRect& rect : rects) {
+        savings.num_cover_pixels += rect.area();
+    }
+
+    return savings;
+}
+
+vr::VRTextureBounds_t
+VisibleRegion::texture_bounds(const PixelRect& rect) const
+{
+    if (rect.is_empty() || (rect.x > m_width) || (rect.y > m_height) || (rect.width > (m_width - rect.x)) || (rect.height > (m_height - rect.y))) {
+        throw std::runtime_error("Invalid texture bounds rect!");
+    }
+
+    vr::VRTextureBounds_t bounds;
+    bounds.uMin = float(double(rect.x) / double(m_width));
+    bounds.uMax = float(double(rect.x + rect.width) / double(m_width));
+    bounds.vMin = float(double(rect.y) / double(m_height));
+    bounds.vMax = float(double(rect.y + rect.height) / double(m_height));
+
+    if ((not ((bounds.uMin >= 0.0f) && (bounds.uMin < bounds.uMax) && (bounds.uMax <= 1.0f))) ||
+        (not ((bounds.vMin >= 0.0f) && (bounds.vMin < bounds.vMax) && (bounds.vMax <= 1.0f))))
+    {
+        throw std::runtime_error("Invalid texture bounds!");
+    }
+
+    return bounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,169 @@
+//
+// MIT License
+//
+// Copyright (c) 2018 Chris Birkhold
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VISIBLE_REGION_H__
+#define __VISIBLE_REGION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <vector>
+#include <OpenVR/OpenVR.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// A rectangle in pixels, (x, y) being the top-left corner.
+//------------------------------------------------------------------------------
+
+struct PixelRect
+{
+    uint32_t    x = 0;
+    uint32_t    y = 0;
+    uint32_t    width = 0;
+    uint32_t    height = 0;
+
+    size_t area() const { return (size_t(width) * size_t(height)); }
+    bool is_empty() const { return ((width == 0) || (height == 0)); }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// The region of a render target the lens can show.
+//
+// Pixels are classified by their centers, triangle meshes with the same rules as
+// HiddenAreaTileMask. k_eHiddenAreaMesh_Inverse and k_eHiddenAreaMesh_LineLoop
+// describe the visible region directly, for k_eHiddenAreaMesh_Standard it is the
+// complement of the mesh. The region is stored as the horizontal extent of the
+// visible pixels of each row, which is all that is needed for scissor rects.
+//------------------------------------------------------------------------------
+
+class VisibleRegion
+{
+    //------------------------------------------------------------------------------
+    // Types
+public:
+
+    //------------------------------------------------------------------------------
+    // Pixels (and bytes at the given size per pixel) that have to be shaded and
+    // written when rendering the whole render target or restricting rendering to
+    // the tight bounds of the visible region or a cover of up to 'num_cover_rects'
+    // rects with scissor rects.
+    struct Savings
+    {
+        size_t      num_pixels = 0;
+        size_t      num_visible_pixels = 0;
+        size_t      num_bounds_pixels = 0;
+        size_t      num_cover_pixels = 0;
+        size_t      num_cover_rects = 0;
+        size_t      bytes_per_pixel = 0;
+
+        size_t bytes() const { return (num_pixels * bytes_per_pixel); }
+        size_t bounds_bytes() const { return (num_bounds_pixels * bytes_per_pixel); }
+        size_t cover_bytes() const { return (num_cover_pixels * bytes_per_pixel); }
+    };
+
+    //------------------------------------------------------------------------------
+    // Construction/Destruction
+public:
+
+    //------------------------------------------------------------------------------
+    // Determine the visible region of a (width x height) render target, e.g. of
+    // the size returned by VRSystem::GetRecommendedRenderTargetSize().
+    VisibleRegion(const vr::HiddenAreaMesh_t& mesh, vr::EHiddenAreaMeshType type, uint32_t width, uint32_t height);
+
+    //------------------------------------------------------------------------------
+    // A region from the row extents and pixel count of another one, e.g. kept in a
+    // CalibrationCache. Throws if the size is 0 or a row is not within the width.
+    VisibleRegion(uint32_t width, uint32_t height, const uint32_t* const row_begin, const uint32_t* const row_end, size_t num_visible_pixels);
+
+    //------------------------------------------------------------------------------
+    // Region
+public:
+
+    uint32_t width() const { return m_width; }
+    uint32_t height() const { return m_height; }
+
+    //------------------------------------------------------------------------------
+    // The tight bounding rectangle of the visible pixels (empty if none).
+    const PixelRect& bounds() const { return m_bounds; }
+
+    size_t num_visible_pixels() const { return m_num_visible_pixels; }
+
+    //------------------------------------------------------------------------------
+    // The visible pixels of row y are within [row_begin()[y], row_end()[y]), empty
+    // rows have begin == end.
+    const uint32_t* row_begin() const { return m_row_begin.data(); }
+    const uint32_t* row_end() const { return m_row_end.data(); }
+
+    //------------------------------------------------------------------------------
+    // Cover the visible pixels with up to 'max_num_rects' full-width bands of rows,
+    // each cropped to the extent of its rows, with the least total area (exact,
+    // by dynamic programming over the row boundaries). Rects are ordered top to
+    // bottom.
+    std::vector<PixelRect> cover(size_t max_num_rects) const;
+
+    Savings compute_savings(size_t max_num_rects, size_t bytes_per_pixel) const;
+
+    //------------------------------------------------------------------------------
+    // Texture bounds selecting the given rect of a (width x height) eye texture,
+    // i.e. the rect divided by the size, so they are always within [0, 1] with
+    // min < max as the compositor requires. To skip the pixels outside the
+    // visible region, render the full-size texture with the scissor rect set to
+    // bounds() (or the rects of cover()) and submit the bounds of the whole
+    // texture; the pixels that are not drawn are never visible. Throws if the rect
+    // is empty or not within the render target.
+    vr::VRTextureBounds_t texture_bounds(const PixelRect& rect) const;
+
+    //------------------------------------------------------------------------------
+    // {Private}
+private:
+
+    void compute_bounds();
+
+    uint32_t                m_width;
+    uint32_t                m_height;
+
+    // Visible pixels of row y are in [m_row_begin[y], m_row_end[y]), empty rows have begin == end.
+    std::vector<uint32_t>   m_row_begin;
+    std::vector<uint32_t>   m_row_end;
+
+    PixelRect               m_bounds;
+    size_t                  m_num_visible_pixels;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // __VISIBLE_REGION_H__
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////